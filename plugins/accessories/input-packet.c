@@ -0,0 +1,141 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+/*
+ * Evdev event packet assembly. Events are read from the device in bulk
+ * and handed out as SYN_REPORT delimited packets, so that consumers can
+ * apply all changes of a packet at once. After a SYN_DROPPED everything
+ * up to the next SYN_REPORT is discarded and the consumer is asked to
+ * requery the device state instead.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "input-packet.h"
+
+#ifndef SYN_DROPPED
+#define SYN_DROPPED 3
+#endif
+
+
+void
+input_packet_init(input_packet_t *pkt, input_packet_cb_t packet_cb,
+                  input_resync_cb_t resync_cb, void *user_data)
+{
+    memset(pkt, 0, sizeof(*pkt));
+
+    pkt->packet_cb = packet_cb;
+    pkt->resync_cb = resync_cb;
+    pkt->user_data = user_data;
+}
+
+
+static void
+packet_flush(input_packet_t *pkt)
+{
+    if (pkt->nevent > 0) {
+        pkt->npacket++;
+
+        if (pkt->packet_cb != NULL)
+            pkt->packet_cb(pkt->events, pkt->nevent, pkt->user_data);
+
+        pkt->nevent = 0;
+    }
+}
+
+
+/********************
+ * input_packet_feed
+ ********************/
+int
+input_packet_feed(input_packet_t *pkt, const struct input_event *events,
+                  int nevent)
+{
+    const struct input_event *ev;
+    int                       i, npacket;
+
+    npacket = 0;
+
+    for (i = 0, ev = events; i < nevent; i++, ev++) {
+        if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+            pkt->nevent   = 0;
+            pkt->dropping = 1;
+            continue;
+        }
+
+        if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+            if (pkt->dropping) {
+                pkt->dropping = 0;
+                pkt->nresync++;
+
+                if (pkt->resync_cb != NULL)
+                    pkt->resync_cb(pkt->user_data);
+            }
+            else {
+                packet_flush(pkt);
+                npacket++;
+            }
+            continue;
+        }
+
+        if (pkt->dropping)
+            continue;
+
+        if (pkt->nevent >= INPUT_PACKET_MAX) {
+            pkt->noverflow++;
+            packet_flush(pkt);
+            npacket++;
+        }
+
+        pkt->events[pkt->nevent++] = *ev;
+    }
+
+    return npacket;
+}
+
+
+/********************
+ * input_packet_read
+ ********************/
+int
+input_packet_read(input_packet_t *pkt, int fd)
+{
+    struct input_event events[INPUT_PACKET_MAX];
+    ssize_t            size;
+
+    size = read(fd, events, sizeof(events));
+
+    if (size < 0)
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+    if (size == 0 || size % sizeof(events[0]) != 0)
+        return -1;
+
+    return input_packet_feed(pkt, events, size / sizeof(events[0]));
+}
+
+/* 
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -0,0 +1,60 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+
+#ifndef __INPUT_PACKET_H__
+#define __INPUT_PACKET_H__
+
+#include <linux/input.h>
+
+#define INPUT_PACKET_MAX  (64)          /* max. events per packet */
+
+/* called with the events of a complete, SYN_REPORT terminated packet */
+typedef void (*input_packet_cb_t)(const struct input_event *events, int nevent,
+                                  void *user_data);
+/* called when the kernel dropped events and the state needs a requery */
+typedef void (*input_resync_cb_t)(void *user_data);
+
+typedef struct {
+    struct input_event  events[INPUT_PACKET_MAX]; /* packet being collected */
+    int                 nevent;
+    int                 dropping;       /* discarding after SYN_DROPPED */
+    input_packet_cb_t   packet_cb;
+    input_resync_cb_t   resync_cb;
+    void               *user_data;
+    unsigned long       npacket;        /* packets delivered */
+    unsigned long       nresync;        /* resyncs requested */
+    unsigned long       noverflow;      /* packets split due to overflow */
+} input_packet_t;
+
+void input_packet_init(input_packet_t *pkt, input_packet_cb_t packet_cb,
+                       input_resync_cb_t resync_cb, void *user_data);
+int  input_packet_feed(input_packet_t *pkt, const struct input_event *events,
+                       int nevent);
+int  input_packet_read(input_packet_t *pkt, int fd);
+
+#endif /* __INPUT_PACKET_H__ */
+/* 
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
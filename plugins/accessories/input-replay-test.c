@@ -0,0 +1,280 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/* wired jack event replay test
+ *
+ * usage: input-replay-test [recording ...]
+ *
+ * Replays recorded evdev streams through the jack event handler of the
+ * wired accessory code. Accessory requests, ie. the fact updates, are
+ * stubbed out and counted, so the test can check that a packet of jack
+ * events results in a single update. Without arguments a set of built-in
+ * recordings is replayed and checked, otherwise each argument is taken to
+ * be a raw recording of an event device (eg. cat /dev/input/eventN >
+ * recording) and the requests it results in are dumped. Run without
+ * arguments by 'make check'. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "input-packet.c"
+#include "wired.c"
+
+#define EV(t, c, v) { .type = (t), .code = (c), .value = (v) }
+#define SW(c, v)    EV(EV_SW, c, v)
+#define SYN         EV(EV_SYN, SYN_REPORT, 0)
+#define DROPPED     EV(EV_SYN, SYN_DROPPED, 0)
+
+typedef struct {
+    const char         *name;
+    struct input_event  events[INPUT_PACKET_MAX * 2];
+    int                 nevent;
+    int                 npacket;                /* expected packets */
+    int                 nresync;                /* expected resyncs */
+    int                 nrequest;               /* expected fact updates */
+    const char         *device;                 /* expected final device */
+} recording_t;
+
+#define RECORDING(_name, _npacket, _nresync, _nrequest, _device, ...)   \
+    { .name      = _name,                                               \
+      .events    = { __VA_ARGS__ },                                     \
+      .nevent    = sizeof((struct input_event []){ __VA_ARGS__ }) /     \
+                   sizeof(struct input_event),                          \
+      .npacket   = _npacket,                                            \
+      .nresync   = _nresync,                                            \
+      .nrequest  = _nrequest,                                           \
+      .device    = _device }
+
+static recording_t recordings[] = {
+    RECORDING("headset insert", 1, 0, 1, "headset",
+              SW(SW_HEADPHONE_INSERT, 1), SW(SW_MICROPHONE_INSERT, 1),
+              SW(SW_JACK_PHYSICAL_INSERT, 1), SYN),
+    RECORDING("headset insert and removal", 2, 0, 2, NULL,
+              SW(SW_HEADPHONE_INSERT, 1), SW(SW_MICROPHONE_INSERT, 1), SYN,
+              SW(SW_MICROPHONE_INSERT, 0), SW(SW_HEADPHONE_INSERT, 0), SYN),
+    RECORDING("headphone, then mic in separate packets", 2, 0, 3, "headset",
+              SW(SW_HEADPHONE_INSERT, 1), SYN,
+              SW(SW_MICROPHONE_INSERT, 1), SYN),
+    RECORDING("incomplete trailing packet", 1, 0, 1, "headphone",
+              SW(SW_HEADPHONE_INSERT, 1), SYN,
+              SW(SW_MICROPHONE_INSERT, 1)),
+    RECORDING("events dropped by kernel", 1, 1, 1, "headmike",
+              SW(SW_HEADPHONE_INSERT, 1), DROPPED,
+              SW(SW_HEADPHONE_INSERT, 0), SYN,
+              SW(SW_MICROPHONE_INSERT, 1), SYN),
+    RECORDING("empty reports", 0, 0, 0, NULL,
+              SYN, SYN, SYN),
+};
+
+static int nrequest;                    /* number of accessory requests */
+static int verbose;
+
+
+void ohm_log(OhmLogLevel level, const gchar *format, ...)
+{
+    va_list ap;
+
+    if (!verbose || level != OHM_LOG_ERROR)
+        return;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    fputs("\n", stderr);
+    va_end(ap);
+}
+
+/*
+ * stubs for the rest of the plugin
+ */
+
+int dres_accessory_request(const char *name, int driver, int connected)
+{
+    (void)driver;
+
+    nrequest++;
+
+    if (verbose)
+        printf("  %s %sconnected\n", name, connected ? "" : "dis");
+
+    return TRUE;
+}
+
+
+static void replay_reset(input_dev_t *dev, int fd)
+{
+    device_state_t *device;
+
+    headphone = microphone = lineout = videoout = 0;
+    incompatible = physical = 0;
+
+    for (device = states; device->name != NULL; device++)
+        device->connected = 0;
+
+    nrequest = 0;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->fd = fd;
+    input_packet_init(&dev->packet, jack_packet, jack_resync, dev);
+}
+
+
+static const char *replay_device(void)
+{
+    device_state_t *device;
+
+    for (device = states; device->name != NULL; device++)
+        if (device->connected)
+            return device->name;
+
+    return NULL;
+}
+
+
+static void replay_fd(input_dev_t *dev)
+{
+    /* the handler gives up when it hits the end of the recording */
+    while (jack_event_handler(NULL, G_IO_IN, dev))
+        ;
+}
+
+
+static int replay_recording(recording_t *rec)
+{
+    input_dev_t  dev;
+    int          fds[2];
+    ssize_t      size;
+    const char  *device;
+
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    size = rec->nevent * sizeof(rec->events[0]);
+
+    if (write(fds[1], rec->events, size) != size) {
+        perror("write");
+        return -1;
+    }
+    close(fds[1]);
+
+    replay_reset(&dev, fds[0]);
+    replay_fd(&dev);
+    close(fds[0]);
+
+    device = replay_device();
+
+    if ((int)dev.packet.npacket != rec->npacket  ||
+        (int)dev.packet.nresync != rec->nresync  ||
+        nrequest                != rec->nrequest ||
+        (device == NULL) != (rec->device == NULL) ||
+        (device != NULL && strcmp(device, rec->device))) {
+        printf("FAIL: %s: %lu packets, %lu resyncs, %d updates, %s "
+               "(expected %d, %d, %d, %s)\n", rec->name,
+               dev.packet.npacket, dev.packet.nresync, nrequest,
+               device ? device : "none", rec->npacket, rec->nresync,
+               rec->nrequest, rec->device ? rec->device : "none");
+        return -1;
+    }
+
+    printf("PASS: %s\n", rec->name);
+
+    return 0;
+}
+
+
+static int replay_overflow(void)
+{
+    input_dev_t        dev;
+    struct input_event events[INPUT_PACKET_MAX + 2];
+    struct input_event ev = SW(SW_LINEOUT_INSERT, 1), syn = SYN;
+    int                i;
+
+    replay_reset(&dev, -1);
+
+    for (i = 0; i < INPUT_PACKET_MAX + 1; i++)
+        events[i] = ev;
+    events[i] = syn;
+
+    input_packet_feed(&dev.packet, events, INPUT_PACKET_MAX + 2);
+
+    if (dev.packet.npacket != 2 || dev.packet.noverflow != 1 ||
+        nrequest != 1) {
+        printf("FAIL: packet overflow: %lu packets, %lu overflows, "
+               "%d updates\n", dev.packet.npacket, dev.packet.noverflow,
+               nrequest);
+        return -1;
+    }
+
+    printf("PASS: packet overflow\n");
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    input_dev_t dev;
+    int         i, fd, failed;
+
+    failed = 0;
+
+    if (argc > 1) {
+        verbose = 1;
+
+        for (i = 1; i < argc; i++) {
+            if ((fd = open(argv[i], O_RDONLY)) < 0) {
+                perror(argv[i]);
+                failed++;
+                continue;
+            }
+
+            printf("%s:\n", argv[i]);
+            replay_reset(&dev, fd);
+            replay_fd(&dev);
+            printf("%s: %lu packets, %lu resyncs, %d updates\n", argv[i],
+                   dev.packet.npacket, dev.packet.nresync, nrequest);
+
+            close(fd);
+        }
+    }
+    else {
+        for (i = 0; i < (int)(sizeof(recordings)/sizeof(recordings[0])); i++)
+            if (replay_recording(recordings + i) < 0)
+                failed++;
+
+        if (replay_overflow() < 0)
+            failed++;
+    }
+
+    return failed ? 1 : 0;
+}
+
+
+/* 
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
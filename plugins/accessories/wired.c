@@ -34,6 +34,7 @@ USA.
 #include <linux/input.h>
 #include <linux/types.h>
 #include <linux/netlink.h>
+#include <linux/filter.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -45,6 +46,7 @@ USA.
 
 #include "wired.h"
 #include "accessories.h"
+#include "input-packet.h"
 
 
 #define NBITS(x) ((((x)-1)/BITS_PER_U32)+1)
@@ -142,6 +144,7 @@ struct input_dev_s {
     gulong           gsrc;               /*       and I/O source */
     guint            initial_query_src;  /* timer for initial jack query */
     int              init_retry;         /* Retry count if initial init fails */
+    input_packet_t   packet;             /* event packet being collected */
 };
 
 #define JACK_INIT_RETRY_COUNT (10)
@@ -151,7 +154,9 @@ static void jack_exit(void **data);
 static int  jack_event_handler_add(input_dev_t *dev);
 static void jack_event_handler_del(input_dev_t *dev);
 static gboolean jack_event_handler(GIOChannel *gioc, GIOCondition mask, gpointer data);
-static int  jack_event(input_dev_t *dev, struct input_event *event);
+static int  jack_event(input_dev_t *dev, const struct input_event *event);
+static void jack_packet(const struct input_event *events, int nevent, void *data);
+static void jack_resync(void *data);
 static int  jack_query(input_dev_t *dev);
 
 static gboolean jack_initial_query_cb(input_dev_t *dev);
@@ -175,11 +180,19 @@ struct uevent_dev_s {
     GIOChannel         *iochannel;
     guint               netlink_watch_src;
     guint               initial_query_src;
+    int                 filtered;        /* kernel-side filter attached */
+    uint64_t            seqnum_base;     /* uevent seqnum at init */
+    uint64_t            seqnum_last;     /* last seqnum received */
+    unsigned long       delivered;       /* messages received */
+    unsigned long       handled;         /* messages for our switch */
 };
 
 #define UEVENT_SWITCH_SYSFS         "/sys/devices/virtual/switch/%s/state"
 #define UEVENT_SWITCH_DEFAULT       "h2w"
 #define UEVENT_MAX_PAYLOAD          (2048)
+#define UEVENT_MAX_DRAIN            (16)  /* max. messages per wakeup */
+#define UEVENT_SEQNUM_SYSFS         "/sys/kernel/uevent_seqnum"
+#define UEVENT_FILTER_PREFIX        "change@/devices/virtual/switch/"
 #define UEVENT_SWITCH_DISCONNECTED  "0"
 #define UEVENT_SWITCH_HEADSET       "1"
 #define UEVENT_SWITCH_HEADPHONE     "2"
@@ -188,6 +201,9 @@ static int uevent_init(OhmPlugin *plugin, void **data);
 static void uevent_exit(void **data);
 static void uevent_update_connected(const char *switch_state);
 static gboolean uevent_handle_cb(GIOChannel *io, GIOCondition cond, gpointer userdata);
+static int uevent_process(uevent_dev_t *dev, char *buf, int len);
+static int uevent_attach_filter(int fd, const char *prefix);
+static uint64_t uevent_seqnum(void);
 static gboolean uevent_initial_query_cb(gpointer userdata);
 static void uevent_initial_query_schedule(uevent_dev_t *dev);
 static void uevent_initial_query_cancel(uevent_dev_t *dev);
@@ -478,14 +494,9 @@ uevent_handle_cb(GIOChannel *io, GIOCondition cond, gpointer userdata)
     uevent_dev_t *dev = (uevent_dev_t *) userdata;
 
     char        buf[UEVENT_MAX_PAYLOAD];
-    const char *line;
     int         fd;
-    int         len, i = 0;
-
-    const char *action       = NULL;
-    const char *subsystem    = NULL;
-    const char *switch_name  = NULL;
-    const char *switch_state = NULL;
+    int         len, n;
+    int         changed = 0;
 
     if (cond & (G_IO_HUP | G_IO_ERR | G_IO_NVAL)) {
         OHM_ERROR("accessories: got uevent cond %d", cond);
@@ -503,12 +514,46 @@ uevent_handle_cb(GIOChannel *io, GIOCondition cond, gpointer userdata)
     }
 
     fd = g_io_channel_unix_get_fd(io);
-    len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
-    if (len == -1) {
-        OHM_ERROR("accessories: recv failed");
-        goto done;
+
+    /* Drain what is queued, but leave the rest for the next round
+     * if we get flooded. */
+    for (n = 0; n < UEVENT_MAX_DRAIN; n++) {
+        len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+        if (len == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                OHM_ERROR("accessories: recv failed");
+            break;
+        }
+
+        buf[len] = '\0';
+        changed |= uevent_process(dev, buf, len);
     }
 
+    if (changed)
+        update_facts();
+
+    return TRUE;
+
+error:
+    OHM_ERROR("accessories: uevent watch disabled");
+    return FALSE;
+}
+
+
+static int
+uevent_process(uevent_dev_t *dev, char *buf, int len)
+{
+    const char *line;
+    int         i = 0;
+
+    const char *action       = NULL;
+    const char *subsystem    = NULL;
+    const char *switch_name  = NULL;
+    const char *switch_state = NULL;
+    const char *seqnum       = NULL;
+
+    dev->delivered++;
+
     while (i < len) {
         line = buf + i;
 
@@ -524,44 +569,117 @@ uevent_handle_cb(GIOChannel *io, GIOCondition cond, gpointer userdata)
             switch_name = line + 12;
         else if (!switch_state && g_str_has_prefix(line, "SWITCH_STATE="))
             switch_state = line + 13;
-        else if (g_str_has_prefix(line, "SEQNUM=")) /* end of uevent message */
-            break;
-
-        if (action && subsystem && switch_name && switch_state)
+        else if (g_str_has_prefix(line, "SEQNUM=")) { /* end of uevent message */
+            seqnum = line + 7;
             break;
+        }
 
         i += strnlen(line, len - i) + 1;
     }
 
+    if (seqnum)
+        dev->seqnum_last = g_ascii_strtoull(seqnum, NULL, 10);
+
     /* Not all data */
     if (!action || !subsystem || !switch_name || !switch_state)
-        goto done;
+        return FALSE;
 
     /* Not our event */
     if (g_strcmp0(subsystem, "switch"))
-        goto done;
+        return FALSE;
 
     /* Not our action */
     if (g_strcmp0(action, "change"))
-        goto done;
+        return FALSE;
 
     /* Not our switch */
     if (g_strcmp0(switch_name, dev->switch_name))
-        goto done;
+        return FALSE;
+
+    dev->handled++;
 
     uevent_update_connected(switch_state);
 
     OHM_DEBUG(DBG_WIRED, "uevent action: %s subsystem: %s switch_name: %s switch_state: %s",
                          action, subsystem, switch_name, switch_state);
 
-    update_facts();
+    return TRUE;
+}
+
+
+/*
+ * Kernel uevent messages start with an "<action>@<devpath>" header. Switch
+ * devices live under a fixed devpath, so a classic BPF program comparing
+ * the header against a constant prefix lets the kernel drop everything but
+ * switch change events before they ever wake us up.
+ */
+static int
+uevent_attach_filter(int fd, const char *prefix)
+{
+#define MAX_INSNS (2 * 32 + 2)
+    struct sock_filter  insns[MAX_INSNS];
+    struct sock_fprog   prog;
+    const uint8_t      *p = (const uint8_t *) prefix;
+    int                 len, off, n, i, size;
+    uint32_t            value;
+
+    len = strlen(prefix);
+    n   = 0;
+
+    for (off = 0; off < len; off += size) {
+        if (len - off >= 4) {
+            size  = 4;
+            value = (p[off] << 24) | (p[off+1] << 16) | (p[off+2] << 8) | p[off+3];
+            insns[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, off);
+        }
+        else {
+            size  = 1;
+            value = p[off];
+            insns[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, off);
+        }
+
+        /* jump target fixed up below */
+        insns[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, value, 0, 0);
+
+        if (n > MAX_INSNS - 2) {
+            OHM_ERROR("accessories: uevent filter prefix too long");
+            return FALSE;
+        }
+    }
+
+    insns[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0xffffffff);
+    insns[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0);
+
+    /* on mismatch jump to the final reject */
+    for (i = 1; i < n - 2; i += 2)
+        insns[i].jf = (n - 1) - (i + 1);
+
+    prog.len    = n;
+    prog.filter = insns;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        OHM_WARNING("accessories: failed to attach uevent filter (%d: %s)",
+                    errno, strerror(errno));
+        return FALSE;
+    }
 
-done:
     return TRUE;
+#undef MAX_INSNS
+}
 
-error:
-    OHM_ERROR("accessories: uevent watch disabled");
-    return FALSE;
+
+static uint64_t
+uevent_seqnum(void)
+{
+    gchar    *buf = NULL;
+    uint64_t  seqnum = 0;
+
+    if (g_file_get_contents(UEVENT_SEQNUM_SYSFS, &buf, NULL, NULL))
+        seqnum = g_ascii_strtoull(buf, NULL, 10);
+
+    g_free(buf);
+
+    return seqnum;
 }
 
 
@@ -643,6 +761,10 @@ uevent_init(OhmPlugin *plugin, void **data)
         goto error;
     }
 
+    dev->filtered    = uevent_attach_filter(dev->pollfd.fd, UEVENT_FILTER_PREFIX);
+    dev->seqnum_base = uevent_seqnum();
+    dev->seqnum_last = dev->seqnum_base;
+
     dev->iochannel = g_io_channel_unix_new(dev->pollfd.fd);
     dev->netlink_watch_src = g_io_add_watch(dev->iochannel,
                                             G_IO_IN | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
@@ -695,6 +817,16 @@ uevent_exit(void **data)
     if (dev) {
         uevent_initial_query_cancel(dev);
 
+        /* The kernel numbers every uevent, so whatever we did not see
+         * since init was dropped by the socket filter. */
+        dev->seqnum_last = MAX(dev->seqnum_last, uevent_seqnum());
+        OHM_INFO("accessories: uevents: %lu delivered (%lu handled), "
+                 "%" PRIu64 " filtered in kernel%s",
+                 dev->delivered, dev->handled,
+                 dev->seqnum_last - dev->seqnum_base > dev->delivered ?
+                 dev->seqnum_last - dev->seqnum_base - dev->delivered : 0,
+                 dev->filtered ? "" : " (no filter)");
+
         if (dev->netlink_watch_src)
             g_source_remove(dev->netlink_watch_src), dev->netlink_watch_src = 0;
 
@@ -718,11 +850,11 @@ uevent_exit(void **data)
  * jack_event
  ********************/
 static int
-jack_event(input_dev_t *dev, struct input_event *event)
+jack_event(input_dev_t *dev, const struct input_event *event)
 {
     int value;
 
-    if (event->type != EV_SW && event->type != EV_SYN) {
+    if (event->type != EV_SW) {
         OHM_DEBUG(DBG_WIRED, "ignoring jack event type %d", event->type);
         return TRUE;
     }
@@ -732,9 +864,6 @@ jack_event(input_dev_t *dev, struct input_event *event)
     OHM_DEBUG(DBG_WIRED, "jack detection event (%d, %d (interpret as: %d))",
               event->code, event->value, value);
 
-    if (event->type == EV_SYN)
-        goto SYN_EVENT;
-
     switch (event->code) {
     case SW_HEADPHONE_INSERT:
         headphone = value;
@@ -763,10 +892,6 @@ jack_event(input_dev_t *dev, struct input_event *event)
             physical = value;
         break;
 
-    SYN_EVENT:
-        update_facts();
-        break;
-
     default:
         OHM_WARNING("accessories: unknown event code 0x%x", event->code);
         break;
@@ -776,6 +901,38 @@ jack_event(input_dev_t *dev, struct input_event *event)
 }
 
 
+/********************
+ * jack_packet
+ ********************/
+static void
+jack_packet(const struct input_event *events, int nevent, void *data)
+{
+    input_dev_t *dev = (input_dev_t *)data;
+    int          i;
+
+    OHM_DEBUG(DBG_WIRED, "jack event packet of %d events", nevent);
+
+    for (i = 0; i < nevent; i++)
+        jack_event(dev, events + i);
+
+    update_facts();
+}
+
+
+/********************
+ * jack_resync
+ ********************/
+static void
+jack_resync(void *data)
+{
+    input_dev_t *dev = (input_dev_t *)data;
+
+    OHM_INFO("accessories: jack events dropped, requerying jack state");
+
+    jack_query(dev);
+}
+
+
 /********************
  * device_connect
  ********************/
@@ -981,18 +1138,15 @@ jack_find_device(const char *pattern, input_dev_t *dev)
 static gboolean
 jack_event_handler(GIOChannel *gioc, GIOCondition mask, gpointer data)
 {
-    input_dev_t        *dev = (input_dev_t *)data;
-    struct input_event  event;
+    input_dev_t *dev = (input_dev_t *)data;
 
     (void)gioc;
 
     if (mask & G_IO_IN) {
-        if (read(dev->fd, &event, sizeof(event)) != sizeof(event)) {
-            OHM_ERROR("accessories: failed to read jack event");
+        if (input_packet_read(&dev->packet, dev->fd) < 0) {
+            OHM_ERROR("accessories: failed to read jack events");
             return FALSE;
         }
-
-        jack_event(dev, &event);
     }
 
     if (mask & G_IO_HUP) {
@@ -1019,6 +1173,8 @@ jack_event_handler_add(input_dev_t *dev)
 
     mask = G_IO_IN | G_IO_HUP | G_IO_ERR;
 
+    input_packet_init(&dev->packet, jack_packet, jack_resync, dev);
+
     dev->gioc = g_io_channel_unix_new(dev->fd);
     dev->gsrc = g_io_add_watch(dev->gioc, mask, jack_event_handler, dev);
 
@@ -32,6 +32,41 @@ USA.
 #include "plugin.h"
 #include "auth-creds.h"
 
+#define CACHE_ERRLEN 128
+
+typedef struct cache_entry_s {
+    struct cache_entry_s *next;
+    unsigned long long    start;       /* start time of the process */
+    char                 *request;     /* dump of the pattern set */
+    int                   success;     /* the decision */
+    char                  err[CACHE_ERRLEN];
+} cache_entry_t;
+
+typedef struct {
+    int          enabled;              /* whether we use the cache */
+    int          usable;               /* whether we get exit/exec events */
+    GHashTable  *pids;                 /* pid => cache_entry_t chain */
+    unsigned int hits;
+    unsigned int misses;
+} cache_t;
+
+OHM_IMPORTABLE(int , proc_subscribe  , (void (*callback)(int, pid_t, void *),
+                                        void *user_data));
+OHM_IMPORTABLE(void, proc_unsubscribe, (void (*callback)(int, pid_t, void *),
+                                        void *user_data));
+
+static cache_t cache;
+
+static int  check_creds(pid_t, char **, char *, int);
+static int  request_key(char **, char *, int);
+static int  cache_lookup(pid_t, unsigned long long, const char *,
+                         char *, int, int *);
+static void cache_insert(pid_t, unsigned long long, const char *,
+                         int, const char *);
+static void cache_purge(gpointer);
+static void process_event(int, pid_t, void *);
+static int  process_start_time(pid_t, unsigned long long *);
+
 
 
 /*! \addtogroup pubif
@@ -41,18 +76,121 @@ USA.
 
 void auth_creds_init(OhmPlugin *plugin)
 {
-    (void)plugin;
+    const char *cache_str;
+    char       *subscribe_sig;
+    char       *unsubscribe_sig;
+
+    if ((cache_str = ohm_plugin_get_param(plugin, "creds-cache")) == NULL)
+        cache.enabled = TRUE;
+    else
+        cache.enabled = strcmp(cache_str, "no") && strcmp(cache_str, "off");
+
+    /*
+     * Decisions can only be cached safely if we learn about the exit
+     * and exec of the processes. We get these from the cgroups plugin.
+     */
+    subscribe_sig   = (char *)proc_subscribe_SIGNATURE;
+    unsubscribe_sig = (char *)proc_unsubscribe_SIGNATURE;
+
+    if (ohm_module_find_method("cgroups.proc_subscribe",
+                               &subscribe_sig, (void *)&proc_subscribe) &&
+        ohm_module_find_method("cgroups.proc_unsubscribe",
+                               &unsubscribe_sig, (void *)&proc_unsubscribe) &&
+        proc_subscribe(process_event, NULL))
+    {
+        cache.pids   = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, cache_purge);
+        cache.usable = TRUE;
+    }
+
+    OHM_INFO("auth: credential decision cache is %s",
+             !cache.usable ? "unavailable (no process events)" :
+             cache.enabled ? "enabled" : "disabled");
 }
 
 void auth_creds_exit(OhmPlugin *plugin)
 {
     (void)plugin;
+
+    if (cache.usable) {
+        proc_unsubscribe(process_event, NULL);
+        g_hash_table_destroy(cache.pids);
+    }
+
+    OHM_DEBUG(DBG_CREDS, "decision cache: %u hits, %u misses",
+              cache.hits, cache.misses);
+
+    memset(&cache, 0, sizeof(cache));
+}
+
+void auth_creds_cache_enable(int enable)
+{
+    if (!enable && cache.usable)
+        g_hash_table_remove_all(cache.pids);
+
+    cache.enabled = enable;
+    cache.hits    = 0;
+    cache.misses  = 0;
 }
 
 int auth_creds_check(pid_t pid, void *request, char *err, int len)
+{
+    unsigned long long start;
+    char               key[512];
+    int                success;
+
+    if (!cache.enabled || !cache.usable                    ||
+        request_key((char **)request, key, sizeof(key)) < 0  ||
+        process_start_time(pid, &start) < 0                    )
+        return check_creds(pid, (char **)request, err, len);
+
+    /*
+     * Cached decisions are dropped on exit and exec. The process events
+     * can get lost though, so a hit is only trusted if the start time of
+     * the process still matches, otherwise the pid has been recycled.
+     */
+    if (cache_lookup(pid, start, key, err, len, &success)) {
+        cache.hits++;
+        return success;
+    }
+
+    cache.misses++;
+
+    success = check_creds(pid, (char **)request, err, len);
+
+    cache_insert(pid, start, key, success, err);
+
+    return success;
+}
+
+char *auth_creds_request_dump(void *request, char *buf, int len)
+{
+    char **list = (char **)request;
+    char  *p    = buf;
+    int    prl;
+    char  *sep;
+    int    i;
+
+    for (i = 0, sep = "";  list[i] && len > 0;  i++, sep = ", ") {
+        prl = snprintf(p, len, "%s%s", sep, list[i]);
+
+        p   += prl;
+        len -= prl;
+    }
+
+    return buf;
+}
+
+
+
+
+/*!
+ * @}
+ */
+
+static int check_creds(pid_t pid, char **pattern, char *err, int len)
 {
 #ifdef HAVE_CREDS
-    char    **pattern = (char **)request;
     creds_t   creds;
     int       i;
     char      match[256];
@@ -94,7 +232,7 @@ int auth_creds_check(pid_t pid, void *request, char *err, int len)
     
 #else
     (void) pid;
-    (void)request;
+    (void)pattern;
 
     snprintf(err, len, "OK (default acceptance: creds are not available)");
 
@@ -102,32 +240,140 @@ int auth_creds_check(pid_t pid, void *request, char *err, int len)
 #endif
 }
 
-char *auth_creds_request_dump(void *request, char *buf, int len)
+static int request_key(char **pattern, char *buf, int len)
 {
-    char **list = (char **)request;
-    char  *p    = buf;
-    int    prl;
-    char  *sep;
-    int    i;
+    char *p = buf;
+    int   l;
+    int   i;
 
-    for (i = 0, sep = "";  list[i] && len > 0;  i++, sep = ", ") {
-        prl = snprintf(p, len, "%s%s", sep, list[i]);
+    for (i = 0;  pattern[i];  i++) {
+        l = snprintf(p, len, "%s%s", i ? "," : "", pattern[i]);
 
-        p   += prl;
-        len -= prl;
+        if (l >= len)
+            return -1;          /* too long to be cached */
+
+        p   += l;
+        len -= l;
     }
 
-    return buf;
+    if (i == 0)
+        *buf = '\0';
+
+    return 0;
 }
 
+static int cache_lookup(pid_t pid, unsigned long long start,
+                        const char *request, char *err, int len, int *success)
+{
+    cache_entry_t *entry;
 
+    entry = g_hash_table_lookup(cache.pids, GINT_TO_POINTER(pid));
 
+    if (entry != NULL && entry->start != start) {
+        OHM_DEBUG(DBG_CREDS, "pid %u has been recycled, dropping its "
+                  "cached decisions", pid);
+        g_hash_table_remove(cache.pids, GINT_TO_POINTER(pid));
+        return FALSE;
+    }
 
-/*!
- * @}
- */
+    for ( ;  entry != NULL;  entry = entry->next) {
+        if (!strcmp(entry->request, request)) {
+            OHM_DEBUG(DBG_CREDS, "cached decision for pid %u: %s", pid,
+                      entry->success ? "granted" : "denied");
+
+            snprintf(err, len, "%s", entry->err);
+            *success = entry->success;
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void cache_insert(pid_t pid, unsigned long long start,
+                         const char *request, int success, const char *err)
+{
+    cache_entry_t *entry;
+    cache_entry_t *head;
+
+    if ((entry = malloc(sizeof(*entry))) == NULL)
+        return;
+
+    memset(entry, 0, sizeof(*entry));
+
+    if ((entry->request = strdup(request)) == NULL) {
+        free(entry);
+        return;
+    }
+
+    entry->start   = start;
+    entry->success = success;
+    snprintf(entry->err, sizeof(entry->err), "%s", err);
 
+    head = g_hash_table_lookup(cache.pids, GINT_TO_POINTER(pid));
+
+    if (head != NULL) {
+        entry->next = head->next;
+        head->next  = entry;
+    }
+    else
+        g_hash_table_insert(cache.pids, GINT_TO_POINTER(pid), entry);
+}
+
+static void cache_purge(gpointer data)
+{
+    cache_entry_t *entry = (cache_entry_t *)data;
+    cache_entry_t *next;
+
+    for ( ;  entry != NULL;  entry = next) {
+        next = entry->next;
+
+        free(entry->request);
+        free(entry);
+    }
+}
+
+static void process_event(int what, pid_t pid, void *data)
+{
+    (void)what;
+    (void)data;
 
+    /* an exec may change the credentials, an exit frees up the pid */
+    if (g_hash_table_remove(cache.pids, GINT_TO_POINTER(pid)))
+        OHM_DEBUG(DBG_CREDS, "dropped cached decisions for pid %u", pid);
+}
+
+static int process_start_time(pid_t pid, unsigned long long *start)
+{
+    char  path[64];
+    char  buf[1024];
+    char *p;
+    FILE *fp;
+    int   i;
+
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return -1;
+
+    p = fgets(buf, sizeof(buf), fp);
+    fclose(fp);
+
+    /* skip past the command name, it may contain spaces and parentheses */
+    if (p == NULL || (p = strrchr(buf, ')')) == NULL)
+        return -1;
+
+    /* starttime is the 22nd field, the 20th after the command name */
+    for (i = 0;  i < 20;  i++) {
+        if ((p = strchr(p + 1, ' ')) == NULL)
+            return -1;
+    }
+
+    *start = strtoull(p + 1, NULL, 10);
+
+    return 0;
+}
 
 
 /* 
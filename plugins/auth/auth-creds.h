@@ -29,6 +29,7 @@ typedef struct _OhmPlugin OhmPlugin;
 void  auth_creds_init(OhmPlugin *);
 void  auth_creds_exit(OhmPlugin *);
 
+void  auth_creds_cache_enable(int);
 int   auth_creds_check(pid_t, void *, char *,int);
 char *auth_creds_request_dump(void *, char *,int);
 
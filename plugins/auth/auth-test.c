@@ -24,6 +24,7 @@ USA.
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/types.h>
 
 #include <glib.h>
@@ -41,7 +42,29 @@ OHM_IMPORTABLE(int, auth_request, (char *id_type,  void *id,
                                    char *req_type, void *req,
                                    auth_request_cb_t callback, void *data));
 
+#define BENCH_CREDS_MAX 16
+
+typedef struct {
+    int              total;            /* number of requests per round */
+    int              done;             /* completed requests of the round */
+    int              granted;          /* granted requests of the round */
+    int              round;            /* 0: without cache, 1: with cache */
+    pid_t            pid;
+    char            *creds[BENCH_CREDS_MAX + 1];
+    struct timespec  start;
+    double           msec[2];
+} bench_t;
+
+/* optional, only present if auth was built with the decision cache */
+OHM_IMPORTABLE(void, creds_cache, (int enable));
+
+static bench_t bench;
+
 static void  auth_callback(int, char *, void *);
+static void  bench_start(int, pid_t, char **);
+static void  bench_round(void);
+static void  bench_callback(int, char *, void *);
+static void  bench_cleanup(void);
 
 static void  console_command(char *);
 
@@ -52,8 +75,13 @@ static char **keyword_list(char **, char **, int);
 
 static void plugin_init(OhmPlugin *plugin)
 {
+    char *signature = (char *)creds_cache_SIGNATURE;
+
     (void)plugin;
 
+    ohm_module_find_method("auth.creds_cache", &signature,
+                           (void *)&creds_cache);
+
     add_command("auth-test", console_command);
     OHM_INFO("auth-test: registered auth console command handler");
 }
@@ -62,6 +90,8 @@ static void plugin_destroy(OhmPlugin *plugin)
 {
 
     (void)plugin;
+
+    bench_cleanup();
 }
 
 static void auth_callback(int success, char *err, void *data)
@@ -89,6 +119,7 @@ static void console_command(char *cmd)
     if (!strcmp(cmd, "help")) {
         printf("auth-test help        show this help\n");
         printf("auth-test {pid|dbus} 'id' creds 'list-of-creds'\n");
+        printf("auth-test bench 'count' pid 'id' creds 'list-of-creds'\n");
         return;
     }
 
@@ -101,6 +132,27 @@ static void console_command(char *cmd)
         (rq_type = keyword(&str)) != NULL   )
     {
         do {
+            if (!strcmp(id_type, "bench")) {
+                /* bench 'count' pid 'id' creds 'list-of-creds' */
+                int count = strtol(id_str, &e, 10);
+
+                if (e == id_str || *e || count < 1 || strcmp(rq_type, "pid"))
+                    break;
+
+                if ((id_str  = keyword(&str)) == NULL ||
+                    (rq_type = keyword(&str)) == NULL   )
+                    break;
+
+                pid = strtoul(id_str, &e, 10);
+
+                if (e == id_str || *e || pid < 1 || strcmp(rq_type, "creds") ||
+                    !keyword_list(&str, creds, MAX_CREDS))
+                    break;
+
+                bench_start(count, pid, creds);
+                return;
+            }
+
             if (!strcmp(id_type, "pid")) {
                 pid = strtoul(id_str, &e, 10);
                 id  = GUINT_TO_POINTER(pid);
@@ -136,6 +188,102 @@ static void console_command(char *cmd)
 #undef MAX_CREDS
 }
 
+static void bench_start(int count, pid_t pid, char **creds)
+{
+    int i;
+
+    if (bench.total > 0) {
+        printf("auth-test: a benchmark is already running\n");
+        return;
+    }
+
+    for (i = 0;  i < BENCH_CREDS_MAX && creds[i];  i++)
+        bench.creds[i] = strdup(creds[i]);
+    bench.creds[i] = NULL;
+
+    bench.total = count;
+    bench.pid   = pid;
+    bench.round = 0;
+
+    if (creds_cache == NULL)
+        printf("auth-test: no decision cache control, results will match\n");
+
+    bench_round();
+}
+
+static void bench_round(void)
+{
+    int i, sts;
+
+    if (creds_cache != NULL)
+        creds_cache(bench.round);
+
+    bench.done    = 0;
+    bench.granted = 0;
+    clock_gettime(CLOCK_MONOTONIC, &bench.start);
+
+    for (i = 0;  i < bench.total;  i++) {
+        sts = auth_request("pid", GUINT_TO_POINTER(bench.pid),
+                           "creds", bench.creds, bench_callback, &bench);
+        if (sts != 0) {
+            printf("auth-test: auth_request returned %d (%s)\n",
+                   sts, strerror(sts));
+            bench_cleanup();
+            return;
+        }
+    }
+}
+
+static void bench_callback(int success, char *err, void *data)
+{
+    struct timespec now;
+    double          msec;
+
+    (void)err;
+    (void)data;
+
+    if (bench.total <= 0)
+        return;
+
+    bench.done++;
+    if (success)
+        bench.granted++;
+
+    if (bench.done < bench.total)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    msec = (now.tv_sec  - bench.start.tv_sec)  * 1000.0 +
+           (now.tv_nsec - bench.start.tv_nsec) / 1000000.0;
+
+    bench.msec[bench.round] = msec;
+
+    printf("auth-test: %d requests %s cache: %.3f msec, %.0f req/sec, "
+           "%d granted\n", bench.total, bench.round ? "with" : "without",
+           msec, msec > 0.0 ? bench.total * 1000.0 / msec : 0.0,
+           bench.granted);
+
+    if (bench.round++ == 0)
+        bench_round();
+    else {
+        if (bench.msec[1] > 0.0)
+            printf("auth-test: cache speedup %.2fx\n",
+                   bench.msec[0] / bench.msec[1]);
+        bench_cleanup();
+    }
+}
+
+static void bench_cleanup(void)
+{
+    int i;
+
+    for (i = 0;  i < BENCH_CREDS_MAX && bench.creds[i];  i++)
+        free(bench.creds[i]);
+
+    memset(&bench, 0, sizeof(bench));
+}
+
 static char *keyword(char **str)
 {
     char *kwd = NULL;
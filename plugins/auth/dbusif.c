@@ -39,6 +39,11 @@ typedef struct {
     }     cb;
 } query_t;
 
+/* shared, cached pid resolution of the dbus plugin, if it is loaded */
+OHM_IMPORTABLE(int, query_pid, (DBusBusType type, const char *name,
+                                void (*callback)(pid_t, const char *, void *),
+                                void *data));
+
 static DBusConnection *sys_conn;   /* D-Bus system bus */
 static DBusConnection *sess_conn;  /* D-Bus session bus */
 
@@ -47,6 +52,7 @@ static void session_bus_init(const char *);
 static void session_bus_cleanup();
 
 static void pid_queried(DBusPendingCall *, void *);
+static void pid_resolved(pid_t, const char *, void *);
 
 
 
@@ -57,9 +63,16 @@ static void pid_queried(DBusPendingCall *, void *);
 
 void dbusif_init(OhmPlugin *plugin)
 {
+    char *signature = (char *)query_pid_SIGNATURE;
+
     (void)plugin;
 
     system_bus_init();
+
+    if (ohm_module_find_method("dbus.query_pid", &signature,(void*)&query_pid))
+        OHM_INFO("auth: using shared D-Bus pid cache");
+    else
+        OHM_INFO("auth: no shared D-Bus pid cache, querying directly");
 }
 
 void dbusif_exit(OhmPlugin *plugin)
@@ -121,6 +134,7 @@ int dbusif_pid_query(char *bustype, char *addr,
                      dbusif_pid_query_cb_t func, void *data)
 {
     DBusConnection  *conn;
+    DBusBusType      type;
     DBusMessage     *msg;
     DBusPendingCall *pend;
     query_t         *query;
@@ -129,12 +143,18 @@ int dbusif_pid_query(char *bustype, char *addr,
     if (!bustype || !addr || !func)
         return EINVAL;
 
-    if (!strcmp(bustype, "system"))
+    if (!strcmp(bustype, "system")) {
         conn = sys_conn;
-    else if (!strcmp(bustype, "session"))
+        type = DBUS_BUS_SYSTEM;
+    }
+    else if (!strcmp(bustype, "session")) {
         conn = sess_conn;
-    else
+        type = DBUS_BUS_SESSION;
+    }
+    else {
         conn = NULL;
+        type = DBUS_BUS_SYSTEM;
+    }
 
     if (!conn)
         return EIO;
@@ -149,6 +169,9 @@ int dbusif_pid_query(char *bustype, char *addr,
         query->cb.func = func;
         query->cb.data = data;
 
+        if (query_pid != NULL && query_pid(type, addr, pid_resolved, query))
+            return 0;
+
         msg = dbus_message_new_method_call(DBUS_ADMIN_SERVICE,
                                            DBUS_ADMIN_PATH,
                                            DBUS_ADMIN_INTERFACE,
@@ -324,6 +347,26 @@ static void pid_queried(DBusPendingCall *pend, void *data)
     dbus_pending_call_unref(pend);
 }
 
+static void pid_resolved(pid_t pid, const char *error, void *data)
+{
+    query_t *query = (query_t *)data;
+
+    if (error == NULL) {
+        OHM_DEBUG(DBG_DBUS, "pid query succeeded: %s -> %u", query->addr, pid);
+        error = "OK";
+    }
+    else {
+        OHM_DEBUG(DBG_DBUS, "pid query for %s failed: %s", query->addr, error);
+        pid = 0;
+    }
+
+    query->cb.func(pid, error, query->cb.data);
+
+    free(query->bus);
+    free(query->addr);
+    free(query);
+}
+
 
 /* 
  * Local Variables:
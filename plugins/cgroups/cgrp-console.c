@@ -19,20 +19,18 @@ USA.
 
 
 #include "cgrp-plugin.h"
+#include "../common/console-command.h"
 
-#define IMPORT_METHOD(name, ptr) ({                                     \
-            signature = (char *)ptr##_SIGNATURE;                        \
-            ohm_module_find_method((name), &signature, (void *)&(ptr)); \
-        })
+OHM_IMPORTABLE(ohm_stats_t *, stats_register, (const char *name, int type));
+OHM_IMPORTABLE(void, stats_unregister, (ohm_stats_t *stats));
 
 
-OHM_IMPORTABLE(int, add_command, (char *name, void (*handler)(char *)));
-
-
-static void console_command(char *);
+static void     console_command(char *);
+static gboolean stats_init(gpointer);
 
 
 static cgrp_context_t *ctx;
+static guint           stats_id;
 
 /********************
  * console_init
@@ -40,10 +38,7 @@ static cgrp_context_t *ctx;
 int
 console_init(cgrp_context_t *context)
 {
-    char *signature;
-
-    if (IMPORT_METHOD("dres.add_command", add_command)) {
-        add_command("cgroup", console_command);
+    if (console_command_add("cgroup", console_command)) {
         OHM_INFO("cgrp: registered cgroup console command handler");
     }
     else
@@ -51,6 +46,9 @@ console_init(cgrp_context_t *context)
 
     ctx = context;
 
+    /* the console plugin, that keeps the statistics, may be loaded later */
+    stats_id = g_idle_add(stats_init, NULL);
+
     return TRUE;
 }
 
@@ -61,10 +59,48 @@ console_init(cgrp_context_t *context)
 void
 console_exit(void)
 {
+    if (stats_id != 0) {
+        g_source_remove(stats_id);
+        stats_id = 0;
+    }
+
+    if (ctx != NULL && stats_unregister != NULL) {
+        stats_unregister(ctx->stats_events);
+        stats_unregister(ctx->stats_classify);
+        ctx->stats_events   = NULL;
+        ctx->stats_classify = NULL;
+    }
+
     ctx = NULL;
 }
 
 
+/********************
+ * stats_init
+ ********************/
+static gboolean
+stats_init(gpointer data)
+{
+    (void)data;
+
+    stats_id = 0;
+
+    if (!IMPORT_METHOD("console.stats_register", stats_register) ||
+        !IMPORT_METHOD("console.stats_unregister", stats_unregister)) {
+        OHM_INFO("cgrp: console statistics not available");
+        stats_register   = NULL;
+        stats_unregister = NULL;
+        return FALSE;
+    }
+
+    ctx->stats_events   = stats_register("cgroups.events", OHM_STATS_COUNTER);
+    ctx->stats_classify = stats_register("cgroups.classify.usec",
+                                         OHM_STATS_HISTOGRAM);
+
+    return FALSE;
+}
+
+
 /********************
  * help
  ********************/
@@ -249,6 +249,30 @@ OHM_EXPORTABLE(void, cgrp_app_query, (pid_t *pid,
 }
 
 
+/********************
+ * cgrp_proc_subscribe
+ ********************/
+OHM_EXPORTABLE(int, cgrp_proc_subscribe,
+               (void (*callback)(int, pid_t, void *), void *user_data))
+{
+    if (ctx == NULL)
+        return FALSE;
+
+    return proc_subscribe_ext(ctx, callback, user_data);
+}
+
+
+/********************
+ * cgrp_proc_unsubscribe
+ ********************/
+OHM_EXPORTABLE(void, cgrp_proc_unsubscribe,
+               (void (*callback)(int, pid_t, void *), void *user_data))
+{
+    if (ctx != NULL)
+        proc_unsubscribe_ext(ctx, callback, user_data);
+}
+
+
 static int
 cgrp_track_process(void *data, char *name,
                    vm_stack_entry_t *args, int narg,
@@ -371,11 +395,13 @@ OHM_PLUGIN_REQUIRES_METHODS(PLUGIN_PREFIX, 5,
    OHM_IMPORT("dres.register_method"  , register_method),
    OHM_IMPORT("dres.unregister_method", unregister_method));
 
-OHM_PLUGIN_PROVIDES_METHODS(cgroups, 4,
-    OHM_EXPORT(cgrp_process_info   , "process_info"),
-    OHM_EXPORT(cgrp_app_subscribe  , "app_subscribe"),
-    OHM_EXPORT(cgrp_app_unsubscribe, "app_unsubscribe"),
-    OHM_EXPORT(cgrp_app_query      , "app_query"));
+OHM_PLUGIN_PROVIDES_METHODS(cgroups, 6,
+    OHM_EXPORT(cgrp_process_info    , "process_info"),
+    OHM_EXPORT(cgrp_app_subscribe   , "app_subscribe"),
+    OHM_EXPORT(cgrp_app_unsubscribe , "app_unsubscribe"),
+    OHM_EXPORT(cgrp_app_query       , "app_query"),
+    OHM_EXPORT(cgrp_proc_subscribe  , "proc_subscribe"),
+    OHM_EXPORT(cgrp_proc_unsubscribe, "proc_unsubscribe"));
 
 
 /* 
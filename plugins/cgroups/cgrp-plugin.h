@@ -35,6 +35,7 @@ USA.
 #include "cgrp-basic-types.h"
 #include "mm.h"
 #include "list.h"
+#include "../console/ohm-ext/stats.h"
 
 #define PLUGIN_PREFIX   cgroups
 #define PLUGIN_NAME    "cgroups"
@@ -702,6 +703,9 @@ typedef struct {
     int               oom_default;          /* default/starting value */
     cgrp_curve_t     *prio_curve;           /* priority adjustment mapping */
     int               prio_default;         /* default/starting value */
+
+    ohm_stats_t      *stats_events;         /* # of classified events */
+    ohm_stats_t      *stats_classify;       /* classification time (usecs) */
 } cgrp_context_t;
 
 
@@ -753,6 +757,9 @@ void procattr_dump(cgrp_proc_attr_t *);
 
 void proc_notify(cgrp_context_t *,
                  void (*)(cgrp_context_t *, int, pid_t, void *), void *);
+int  proc_subscribe_ext(cgrp_context_t *, void (*)(int, pid_t, void *), void *);
+void proc_unsubscribe_ext(cgrp_context_t *,
+                          void (*)(int, pid_t, void *), void *);
 
 int  process_track_add(cgrp_process_t *, const char *, int);
 int  process_track_del(cgrp_process_t *, const char *, int);
@@ -25,6 +25,7 @@ USA.
 #include <errno.h>
 #include <string.h>
 #include <dirent.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
@@ -83,6 +84,7 @@ static void subscr_notify(cgrp_context_t *ctx, int what, pid_t pid);
 typedef struct {
     list_hook_t   hook;
     void        (*cb)(cgrp_context_t *, int, pid_t, void *);
+    void        (*extcb)(int, pid_t, void *);     /* external subscriber */
     void         *data;
 } proc_handler_t;
 
@@ -488,6 +490,7 @@ netlink_cb(GIOChannel *chnl, GIOCondition mask, gpointer data)
                 event.exec.type = CGRP_EVENT_EXEC;
                 event.exec.pid  = pevt->event_data.exec.process_pid;
                 event.exec.tgid = pevt->event_data.exec.process_tgid;
+                subscr_notify(ctx, pevt->what, event.exec.tgid);
                 break;
 
             case PROC_EVENT_UID:
@@ -510,6 +513,8 @@ netlink_cb(GIOChannel *chnl, GIOCondition mask, gpointer data)
                 event.any.type = CGRP_EVENT_EXIT;
                 event.any.pid  = pevt->event_data.exit.process_pid;
                 event.any.tgid = pevt->event_data.exit.process_tgid;
+                if (event.any.pid == event.any.tgid)
+                    subscr_notify(ctx, pevt->what, event.any.pid);
                 break;
 
 #ifdef HAVE_PROC_EVENT_SID
@@ -540,7 +545,21 @@ netlink_cb(GIOChannel *chnl, GIOCondition mask, gpointer data)
                 continue;
             }
 
-            classify_event(ctx, &event);
+            if (ctx->stats_classify != NULL) {
+                struct timespec start, end;
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                classify_event(ctx, &event);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                ohm_stats_sample(ctx->stats_classify,
+                                 (end.tv_sec - start.tv_sec) * 1000000 +
+                                 (end.tv_nsec - start.tv_nsec) / 1000);
+            }
+            else
+                classify_event(ctx, &event);
+
+            ohm_stats_inc(ctx->stats_events);
         }
     }
     
@@ -1705,7 +1724,10 @@ subscr_notify(cgrp_context_t *ctx, int what, pid_t pid)
     
     list_foreach(&ctx->procsubscr, p, n) {
         handler = list_entry(p, proc_handler_t, hook);
-        handler->cb(ctx, what, pid, handler->data);
+        if (handler->cb != NULL)
+            handler->cb(ctx, what, pid, handler->data);
+        else
+            handler->extcb(what, pid, handler->data);
     }
 }
 
@@ -1732,6 +1754,51 @@ proc_notify(cgrp_context_t *ctx,
 }
 
 
+/********************
+ * proc_subscribe_ext
+ ********************/
+int
+proc_subscribe_ext(cgrp_context_t *ctx,
+                   void (*cb)(int, pid_t, void *), void *data)
+{
+    proc_handler_t *handler;
+
+    if (ALLOC_OBJ(handler) == NULL) {
+        OHM_ERROR("cgrp: failed to allocate process notification handler");
+        return FALSE;
+    }
+
+    handler->extcb = cb;
+    handler->data  = data;
+    
+    list_append(&ctx->procsubscr, &handler->hook);
+
+    return TRUE;
+}
+
+
+/********************
+ * proc_unsubscribe_ext
+ ********************/
+void
+proc_unsubscribe_ext(cgrp_context_t *ctx,
+                     void (*cb)(int, pid_t, void *), void *data)
+{
+    proc_handler_t *handler;
+    list_hook_t    *p, *n;
+    
+    list_foreach(&ctx->procsubscr, p, n) {
+        handler = list_entry(p, proc_handler_t, hook);
+
+        if (handler->extcb == cb && handler->data == data) {
+            list_delete(&handler->hook);
+            FREE(handler);
+            return;
+        }
+    }
+}
+
+
 /* 
  * Local Variables:
  * c-basic-offset: 4
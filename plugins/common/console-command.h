@@ -0,0 +1,62 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+
+#ifndef __OHM_CONSOLE_COMMAND_H__
+#define __OHM_CONSOLE_COMMAND_H__
+
+/*
+ * Console command registration, shared by the plugins that extend the
+ * console of dres with commands of their own.
+ *
+ * console_command_add() looks up dres.add_command the first time it is
+ * called and registers the given command handler with it. A plugin that
+ * is loaded before dres has to call it once the main loop is running.
+ */
+
+#include <ohm/ohm-plugin.h>
+
+#define IMPORT_METHOD(name, ptr) ({                                     \
+            char *__sig = (char *)ptr##_SIGNATURE;                      \
+            ohm_module_find_method((name), &__sig, (void *)&(ptr));     \
+        })
+
+OHM_IMPORTABLE(int, add_command, (char *name, void (*handler)(char *)));
+
+static inline int
+console_command_add(char *name, void (*handler)(char *))
+{
+    if (add_command == NULL && !IMPORT_METHOD("dres.add_command", add_command))
+        return FALSE;
+
+    add_command(name, handler);
+
+    return TRUE;
+}
+
+#endif /* __OHM_CONSOLE_COMMAND_H__ */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -0,0 +1,496 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include <ohm/ohm-plugin.h>
+#include <ohm/ohm-plugin-log.h>
+#include <ohm/ohm-plugin-debug.h>
+#include <ohm/ohm-fact.h>
+
+#include "rule-memo.h"
+
+#define DIM(a) (sizeof(a) / sizeof(a[0]))
+
+/*
+ * Every rule with a dependency list has its own generation stamp that
+ * is bumped when any of its facts changes. Results of rules without one
+ * carry the generation stamp of the whole factstore instead.
+ */
+
+typedef struct {
+    int            rule;            /* rule id */
+    char          *name;            /* rule name */
+    char         **facts;           /* facts the rule depends on */
+    unsigned int   stamp;           /* generation of the facts */
+} memo_rule_t;
+
+typedef struct {
+    memo_rule_t   *rule;            /* rule, NULL if depending on all facts */
+    unsigned int   stamp;           /* generation of the result */
+    int            status;          /* rule_eval() status */
+    char         **entry;           /* copy of the single result entry */
+} memo_entry_t;
+
+typedef struct {
+    const char    *owner;           /* plugin name for messages */
+    int           *debug;           /* debug flag of the owner */
+    OhmPlugin     *plugin;
+    GHashTable    *entries;         /* memo_entry_t by rule and args */
+    GHashTable    *rules;           /* memo_rule_t by rule id */
+    GHashTable    *deps;            /* list of memo_rule_t by fact name */
+    unsigned int   stamp;           /* factstore generation */
+    unsigned int   sweep;           /* cache size triggering a sweep */
+    gulong         sigs[3];         /* factstore signal handlers */
+    char         **uncached;        /* last result that was not cached */
+    unsigned long  hits;
+    unsigned long  misses;
+    unsigned long  evictions;
+} memo_t;
+
+static memo_t memo;
+
+static int      memo_key(int, char **, int, char *, int);
+static char   **copy_entry(char **);
+static void     free_entry(char **);
+static void     entry_free(gpointer);
+static void     rule_free(gpointer);
+static gboolean entry_stale(gpointer, gpointer, gpointer);
+static void     sweep(void);
+static void     fact_changed(OhmFact *);
+static void     inserted_cb(void *, OhmFact *, gpointer);
+static void     removed_cb(void *, OhmFact *, gpointer);
+static void     updated_cb(void *, OhmFact *, GQuark, gpointer, gpointer);
+
+
+void rule_memo_init(OhmPlugin *plugin, const char *owner, int *debug)
+{
+    OhmFactStore *fs;
+    const char   *param;
+
+    memo.owner  = owner;
+    memo.debug  = debug;
+    memo.plugin = plugin;
+
+    param = ohm_plugin_get_param(plugin, "rule-cache");
+
+    if (param != NULL && !strcmp(param, "no")) {
+        OHM_INFO("%s: rule result caching disabled", owner);
+        return;
+    }
+
+    memo.entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free, entry_free);
+    memo.rules   = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, rule_free);
+    memo.deps    = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify)g_slist_free);
+    memo.sweep   = RULE_MEMO_SWEEP;
+
+    fs = ohm_fact_store_get_fact_store();
+
+    memo.sigs[0] = g_signal_connect(G_OBJECT(fs), "inserted",
+                                    G_CALLBACK(inserted_cb), NULL);
+    memo.sigs[1] = g_signal_connect(G_OBJECT(fs), "removed",
+                                    G_CALLBACK(removed_cb), NULL);
+    memo.sigs[2] = g_signal_connect(G_OBJECT(fs), "updated",
+                                    G_CALLBACK(updated_cb), NULL);
+}
+
+
+void rule_memo_exit(void)
+{
+    OhmFactStore *fs;
+    unsigned int  i;
+
+    free_entry(memo.uncached);
+    memo.uncached = NULL;
+
+    if (memo.entries == NULL)
+        return;
+
+    OHM_INFO("%s: rule cache %lu hits, %lu misses, %lu evictions",
+             memo.owner, memo.hits, memo.misses, memo.evictions);
+
+    fs = ohm_fact_store_get_fact_store();
+
+    for (i = 0;  i < DIM(memo.sigs);  i++) {
+        if (memo.sigs[i] && g_signal_handler_is_connected(G_OBJECT(fs),
+                                                          memo.sigs[i]))
+            g_signal_handler_disconnect(G_OBJECT(fs), memo.sigs[i]);
+        memo.sigs[i] = 0;
+    }
+
+    /* entries refer to the rules, rules are listed in the dependencies */
+    g_hash_table_destroy(memo.entries);
+    g_hash_table_destroy(memo.deps);
+    g_hash_table_destroy(memo.rules);
+
+    memo.entries = NULL;
+    memo.deps    = NULL;
+    memo.rules   = NULL;
+}
+
+
+void rule_memo_add_rule(int rule, const char *name)
+{
+    memo_rule_t  *r;
+    GSList       *list;
+    const char   *param;
+    char          key[256];
+    char        **fact;
+
+    if (memo.entries == NULL || rule < 0 ||
+        g_hash_table_lookup(memo.rules, GINT_TO_POINTER(rule)) != NULL)
+        return;
+
+    snprintf(key, sizeof(key), "%s-facts", name);
+
+    if ((param = ohm_plugin_get_param(memo.plugin, key)) == NULL)
+        return;
+
+    r = g_new0(memo_rule_t, 1);
+    r->rule  = rule;
+    r->name  = g_strdup(name);
+    r->facts = g_strsplit(param, ",", 0);
+
+    g_hash_table_insert(memo.rules, GINT_TO_POINTER(rule), r);
+
+    for (fact = r->facts;  *fact != NULL;  fact++) {
+        g_strstrip(*fact);
+
+        if ((list = g_hash_table_lookup(memo.deps, *fact)) != NULL)
+            g_slist_append(list, r);
+        else
+            g_hash_table_insert(memo.deps, g_strdup(*fact),
+                                g_slist_append(NULL, r));
+    }
+
+    OHM_INFO("%s: results of rule '%s' depend on %s", memo.owner, name,
+             param);
+}
+
+
+int rule_memo_lookup(int rule, char **argv, int narg,
+                     int *status_ret, char ***entry_ret)
+{
+    memo_entry_t *m;
+    char          key[256];
+
+    free_entry(memo.uncached);
+    memo.uncached = NULL;
+
+    if (memo.entries == NULL || !memo_key(rule, argv, narg, key, sizeof(key)))
+        return FALSE;
+
+    if ((m = g_hash_table_lookup(memo.entries, key)) != NULL) {
+        if (m->stamp == (m->rule ? m->rule->stamp : memo.stamp)) {
+            memo.hits++;
+
+            OHM_DEBUG(*memo.debug, "cached result for %s (status %d)",
+                      key, m->status);
+
+            *status_ret = m->status;
+            *entry_ret  = m->entry;
+
+            return TRUE;
+        }
+
+        g_hash_table_remove(memo.entries, key);
+        memo.evictions++;
+    }
+
+    memo.misses++;
+
+    return FALSE;
+}
+
+
+char **rule_memo_store(int rule, char **argv, int narg, int status,
+                       char ***retval)
+{
+    memo_entry_t *m;
+    char        **entry;
+    char          key[256];
+
+    if (status > 0 && retval && retval[0] != NULL && retval[1] == NULL)
+        entry = copy_entry(retval[0]);
+    else
+        entry = NULL;
+
+    if (memo.entries == NULL || status < 0 ||
+        !memo_key(rule, argv, narg, key, sizeof(key))) {
+        memo.uncached = entry;
+        return entry;
+    }
+
+    if (g_hash_table_size(memo.entries) >= memo.sweep)
+        sweep();
+
+    m = g_new0(memo_entry_t, 1);
+    m->rule   = g_hash_table_lookup(memo.rules, GINT_TO_POINTER(rule));
+    m->stamp  = m->rule ? m->rule->stamp : memo.stamp;
+    m->status = status;
+    m->entry  = entry;
+
+    g_hash_table_replace(memo.entries, g_strdup(key), m);
+
+    return entry;
+}
+
+
+void rule_memo_show(void)
+{
+    GHashTableIter  iter;
+    gpointer        value;
+    memo_rule_t    *r;
+    char           *facts;
+
+    if (memo.entries == NULL) {
+        printf("%s rule cache is disabled\n", memo.owner);
+        return;
+    }
+
+    printf("%s rule cache: %u entries, %lu hits, %lu misses, "
+           "%lu evictions\n", memo.owner, g_hash_table_size(memo.entries),
+           memo.hits, memo.misses, memo.evictions);
+
+    g_hash_table_iter_init(&iter, memo.rules);
+
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        r     = (memo_rule_t *)value;
+        facts = g_strjoinv(",", r->facts);
+
+        printf("    %s depends on %s (generation %u)\n", r->name, facts,
+               r->stamp);
+
+        g_free(facts);
+    }
+
+    printf("    other rules depend on all facts (generation %u)\n",
+           memo.stamp);
+}
+
+
+static int memo_key(int rule, char **argv, int narg, char *buf, int len)
+{
+    char *p;
+    int   i, n, l;
+
+    p = buf;
+    l = len;
+
+    n = snprintf(p, l, "%d", rule);
+
+    for (i = 0;  i < narg && n >= 0 && n < l;  i++) {
+        p += n;
+        l -= n;
+
+        switch (GPOINTER_TO_INT(argv[2*i])) {
+        case 's':
+            n = snprintf(p, l, "|s:%s", argv[2*i+1]);
+            break;
+        case 'i':
+            n = snprintf(p, l, "|i:%d", GPOINTER_TO_INT(argv[2*i+1]));
+            break;
+        default:
+            return FALSE;
+        }
+    }
+
+    return n >= 0 && n < l;
+}
+
+
+static char **copy_entry(char **entry)
+{
+    char   **copy;
+    double  *d;
+    int      i, n;
+
+    for (n = 0;  entry[n] != NULL;  n += 3)
+        ;
+
+    copy = g_new0(char *, n + 1);
+
+    for (i = 0;  i < n;  i += 3) {
+        copy[i]   = g_strdup(entry[i]);
+        copy[i+1] = entry[i+1];
+
+        switch (GPOINTER_TO_INT(entry[i+1])) {
+        case 's':
+            copy[i+2] = g_strdup(entry[i+2]);
+            break;
+        case 'd':
+            d  = g_new(double, 1);
+            *d = *(double *)entry[i+2];
+            copy[i+2] = (char *)d;
+            break;
+        default:
+            copy[i+2] = entry[i+2];
+            break;
+        }
+    }
+
+    return copy;
+}
+
+
+static void free_entry(char **entry)
+{
+    int i;
+
+    if (entry == NULL)
+        return;
+
+    for (i = 0;  entry[i] != NULL;  i += 3) {
+        g_free(entry[i]);
+
+        switch (GPOINTER_TO_INT(entry[i+1])) {
+        case 's':
+        case 'd':
+            g_free(entry[i+2]);
+            break;
+        default:
+            break;
+        }
+    }
+
+    g_free(entry);
+}
+
+
+static void entry_free(gpointer data)
+{
+    memo_entry_t *m = (memo_entry_t *)data;
+
+    free_entry(m->entry);
+    g_free(m);
+}
+
+
+static void rule_free(gpointer data)
+{
+    memo_rule_t *r = (memo_rule_t *)data;
+
+    g_free(r->name);
+    g_strfreev(r->facts);
+    g_free(r);
+}
+
+
+static gboolean entry_stale(gpointer key, gpointer value, gpointer data)
+{
+    memo_entry_t *m = (memo_entry_t *)value;
+
+    (void)key;
+    (void)data;
+
+    return m->stamp != (m->rule ? m->rule->stamp : memo.stamp);
+}
+
+
+/*
+ * Evict the stale entries. Entries keyed by short-lived arguments (eg.
+ * resource set ids) can stay fresh without ever being looked up again,
+ * so if that is not enough to get below the size limit the cache is
+ * flushed.
+ */
+static void sweep(void)
+{
+    unsigned int n;
+
+    n = g_hash_table_foreach_remove(memo.entries, entry_stale, NULL);
+
+    if (g_hash_table_size(memo.entries) >= RULE_MEMO_MAX) {
+        n += g_hash_table_size(memo.entries);
+        g_hash_table_remove_all(memo.entries);
+    }
+
+    memo.evictions += n;
+    memo.sweep      = MAX(RULE_MEMO_SWEEP, 2 * g_hash_table_size(memo.entries));
+
+    OHM_DEBUG(*memo.debug, "evicted %u rule cache entries, %u left", n,
+              g_hash_table_size(memo.entries));
+}
+
+
+static void fact_changed(OhmFact *fact)
+{
+    GSList      *l;
+    memo_rule_t *r;
+
+    memo.stamp++;
+
+    if (fact == NULL)
+        return;
+
+    l = g_hash_table_lookup(memo.deps,
+                            ohm_structure_get_name(OHM_STRUCTURE(fact)));
+
+    for ( ;  l != NULL;  l = l->next) {
+        r = (memo_rule_t *)l->data;
+        r->stamp++;
+    }
+}
+
+
+static void inserted_cb(void *fs, OhmFact *fact, gpointer data)
+{
+    (void)fs;
+    (void)data;
+
+    fact_changed(fact);
+}
+
+
+static void removed_cb(void *fs, OhmFact *fact, gpointer data)
+{
+    (void)fs;
+    (void)data;
+
+    fact_changed(fact);
+}
+
+
+static void updated_cb(void *fs, OhmFact *fact, GQuark fldquark,
+                       gpointer value, gpointer data)
+{
+    (void)fs;
+    (void)fldquark;
+    (void)value;
+    (void)data;
+
+    fact_changed(fact);
+}
+
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
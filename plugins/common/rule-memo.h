@@ -0,0 +1,69 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+#ifndef __OHM_RULE_MEMO_H__
+#define __OHM_RULE_MEMO_H__
+
+/*
+ * Memoization of rule evaluation results, compiled into the rule
+ * interface of the plugins that use it.
+ *
+ * Results are memoized by rule and argument tuple. A rule registered
+ * with rule_memo_add_rule() may be given the facts it depends on with
+ * the '<rule>-facts = <fact>,...' plugin parameter, so that only changes
+ * to those facts invalidate its results. The results of any other rule
+ * are invalidated by every factstore change. Stale results are evicted
+ * when they are looked up and by a sweep once the cache has grown.
+ * 'rule-cache = no' turns the cache off.
+ *
+ * A lookup that misses is followed by the evaluation of the rule and a
+ * rule_memo_store() of its result:
+ *
+ *   if (!rule_memo_lookup(rule, argv, narg, &status, &entry)) {
+ *       status = rule_eval(rule, &retval, (void **)argv, narg);
+ *       entry  = rule_memo_store(rule, argv, narg, status, retval);
+ *       rules_free_result(retval);
+ *   }
+ *
+ * The returned entry is a copy of the single result entry of the rule,
+ * owned by the cache and valid until the next lookup.
+ */
+
+#include <ohm/ohm-plugin.h>
+
+#define RULE_MEMO_SWEEP  64             /* cache size of the first sweep */
+#define RULE_MEMO_MAX    1024           /* cache size limit */
+
+void    rule_memo_init(OhmPlugin *, const char *, int *);
+void    rule_memo_exit(void);
+void    rule_memo_add_rule(int, const char *);
+int     rule_memo_lookup(int, char **, int, int *, char ***);
+char  **rule_memo_store(int, char **, int, int, char ***);
+void    rule_memo_show(void);
+
+#endif /* __OHM_RULE_MEMO_H__ */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -25,6 +25,7 @@ USA.
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -36,6 +37,9 @@ USA.
 
 #include <ohm/ohm-plugin.h>
 
+#include "ohm-ext/stats.h"
+#include "../common/console-command.h"
+
 #define BUSY_MESSAGE "Only a single console allowed and is already active.\n"
 
 #define INVALID_ID   -1
@@ -131,6 +135,9 @@ struct console_s {
     char      *buf;                      /* input buffer */
     size_t     size;                     /* buffer size */
     size_t     used;                     /* buffer used */
+    size_t     start;                    /* start of unprocessed input */
+    size_t     scan;                     /* end of scanned input */
+    int        cr;                       /* last line ended in '\r' */
     
     void (*opened)(int, struct sockaddr *, int); /* open callback */
     void (*closed)(int);                         /* close callback */
@@ -157,6 +164,25 @@ static int grab_fd  (int fd, int sock);
 static int ungrab_fd(int grab);
 
 
+typedef struct {
+    ohm_stats_t stats;                   /* published statistics, 1st ! */
+    ohm_stats_t snapshot;                /* statistics at last snapshot */
+    int         refcnt;                  /* number of registrations */
+} stats_entry_t;
+
+static GHashTable     *stats;            /* statistics by name */
+static struct timeval  stats_snapped;    /* time of last snapshot */
+static guint           stats_idle;       /* command registration source */
+static ohm_stats_t    *stats_lines;      /* console input lines */
+static ohm_stats_t    *stats_bytes;      /* console input bytes */
+
+static ohm_stats_t *console_stats_register  (const char *name, int type);
+static void         console_stats_unregister(ohm_stats_t *s);
+
+static gboolean stats_add_command(gpointer data);
+static void     stats_command    (char *args);
+
+
 /*****************************************************************************
  *                       *** initialization & cleanup ***                    *
  *****************************************************************************/
@@ -168,7 +194,14 @@ static void
 plugin_init(OhmPlugin *plugin)
 {
     (void)plugin;
-    return;
+
+    stats_lines = console_stats_register("console.input.lines",
+                                         OHM_STATS_COUNTER);
+    stats_bytes = console_stats_register("console.input.bytes",
+                                         OHM_STATS_COUNTER);
+
+    /* the stats command can only be added once dres is loaded */
+    stats_idle = g_idle_add(stats_add_command, NULL);
 }
 
 
@@ -179,7 +212,20 @@ static void
 plugin_exit(OhmPlugin *plugin)
 {
     (void)plugin;
-    return;
+
+    if (stats_idle != 0) {
+        g_source_remove(stats_idle);
+        stats_idle = 0;
+    }
+
+    console_stats_unregister(stats_lines);
+    console_stats_unregister(stats_bytes);
+    stats_lines = stats_bytes = NULL;
+
+    if (stats != NULL) {
+        g_hash_table_destroy(stats);
+        stats = NULL;
+    }
 }
 
 
@@ -228,6 +274,9 @@ del_console(console_t *c)
     c->endpoint = NULL;
     c->sock     = -1;
     c->used     = 0;
+    c->start    = 0;
+    c->scan     = 0;
+    c->cr       = FALSE;
     memset(c->buf, 0, c->size);
 
     if (c->nchild > 0) {
@@ -600,6 +649,357 @@ OHM_EXPORTABLE(int, console_ungrab, (int id))
 #endif
 
 
+/*****************************************************************************
+ *                         *** statistics registry ***                       *
+ *****************************************************************************/
+
+/********************
+ * stats_free
+ ********************/
+static void
+stats_free(gpointer data)
+{
+    stats_entry_t *e = (stats_entry_t *)data;
+
+    FREE((char *)e->stats.name);
+    FREE(e);
+}
+
+
+/********************
+ * console_stats_register
+ ********************/
+OHM_EXPORTABLE(ohm_stats_t *, console_stats_register, (const char *name,
+                                                       int type))
+{
+    stats_entry_t *e;
+
+    if (name == NULL || !*name ||
+        type < OHM_STATS_COUNTER || type > OHM_STATS_HISTOGRAM) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (stats == NULL)
+        stats = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      NULL, stats_free);
+    
+    if ((e = g_hash_table_lookup(stats, name)) != NULL) {
+        if (e->stats.type != type) {
+            errno = EEXIST;
+            return NULL;
+        }
+        
+        e->refcnt++;
+        return &e->stats;
+    }
+
+    if (ALLOC_OBJ(e) == NULL)
+        return NULL;
+
+    if ((e->stats.name = STRDUP((char *)name)) == NULL) {
+        FREE(e);
+        return NULL;
+    }
+    
+    e->stats.type = type;
+    e->refcnt     = 1;
+    
+    g_hash_table_insert(stats, (gpointer)e->stats.name, e);
+    
+    return &e->stats;
+}
+
+
+/********************
+ * console_stats_unregister
+ ********************/
+OHM_EXPORTABLE(void, console_stats_unregister, (ohm_stats_t *s))
+{
+    stats_entry_t *e = (stats_entry_t *)s;
+
+    if (e == NULL || stats == NULL)
+        return;
+
+    if (--e->refcnt <= 0)
+        g_hash_table_remove(stats, e->stats.name);
+}
+
+
+/********************
+ * stats_match
+ ********************/
+static int
+stats_match(const char *name, const char *prefix)
+{
+    size_t len = strlen(prefix);
+
+    /* a prefix matches whole components of the dotted name */
+    if (!len)
+        return TRUE;
+    
+    if (strncmp(name, prefix, len))
+        return FALSE;
+    
+    return name[len] == '\0' || name[len] == '.' || prefix[len - 1] == '.';
+}
+
+
+/********************
+ * stats_cmp
+ ********************/
+static gint
+stats_cmp(gconstpointer a, gconstpointer b)
+{
+    const ohm_stats_t *sa = (const ohm_stats_t *)a;
+    const ohm_stats_t *sb = (const ohm_stats_t *)b;
+
+    return strcmp(sa->name, sb->name);
+}
+
+
+/********************
+ * stats_sorted
+ ********************/
+static GList *
+stats_sorted(void)
+{
+    if (stats == NULL)
+        return NULL;
+    
+    return g_list_sort(g_hash_table_get_values(stats), stats_cmp);
+}
+
+
+/********************
+ * stats_percentile
+ ********************/
+static uint64_t
+stats_percentile(ohm_stats_t *s, int percent)
+{
+    uint64_t target, seen, limit;
+    int      i;
+
+    if (!s->count)
+        return 0;
+
+    /* the upper limit of the bucket the given percentile falls into */
+    target = (s->count * percent + 99) / 100;
+
+    for (i = 0, seen = 0; i < OHM_STATS_BUCKETS; i++) {
+        if ((seen += s->buckets[i]) >= target)
+            break;
+    }
+
+    limit = i ? (((uint64_t)1) << i) - 1 : 0;
+
+    if (limit < s->min)
+        return s->min;
+    if (limit > s->max)
+        return s->max;
+    else
+        return limit;
+}
+
+
+/********************
+ * stats_dump
+ ********************/
+static void
+stats_dump(const char *prefix)
+{
+    stats_entry_t  *e;
+    ohm_stats_t    *s;
+    GList          *list, *l;
+    struct timeval  now;
+    int             i, n, sep;
+
+    list = stats_sorted();
+
+    for (l = list, n = 0; l != NULL; l = l->next)
+        n += stats_match(((ohm_stats_t *)l->data)->name, prefix);
+
+    /*
+     * One line per statistics, '<name> <type> <key>=<value> ...', with
+     * deltas relative to the last snapshot. Comments start with '#'.
+     */
+    
+    if (stats_snapped.tv_sec) {
+        gettimeofday(&now, NULL);
+        printf("# stats entries=%d snapshot-age=%.3f\n", n,
+               (now.tv_sec - stats_snapped.tv_sec) +
+               (now.tv_usec - stats_snapped.tv_usec) / 1000000.0);
+    }
+    else
+        printf("# stats entries=%d snapshot-age=none\n", n);
+    
+    for (l = list; l != NULL; l = l->next) {
+        e = (stats_entry_t *)l->data;
+        s = &e->stats;
+
+        if (!stats_match(s->name, prefix))
+            continue;
+        
+        switch (s->type) {
+        case OHM_STATS_COUNTER:
+            printf("%s counter value=%lld delta=%lld\n", s->name,
+                   (long long)s->value,
+                   (long long)(s->value - e->snapshot.value));
+            break;
+
+        case OHM_STATS_GAUGE:
+            printf("%s gauge value=%lld\n", s->name, (long long)s->value);
+            break;
+
+        case OHM_STATS_HISTOGRAM:
+            printf("%s histogram count=%llu delta=%llu sum=%llu min=%llu "
+                   "max=%llu avg=%llu p50=%llu p90=%llu p99=%llu buckets=",
+                   s->name,
+                   (unsigned long long)s->count,
+                   (unsigned long long)(s->count - e->snapshot.count),
+                   (unsigned long long)s->sum,
+                   (unsigned long long)s->min,
+                   (unsigned long long)s->max,
+                   (unsigned long long)(s->count ? s->sum / s->count : 0),
+                   (unsigned long long)stats_percentile(s, 50),
+                   (unsigned long long)stats_percentile(s, 90),
+                   (unsigned long long)stats_percentile(s, 99));
+            
+            for (i = 0, sep = FALSE; i < OHM_STATS_BUCKETS; i++) {
+                if (!s->buckets[i])
+                    continue;
+                printf("%s%llu:%llu", sep ? "," : "",
+                       (unsigned long long)(i ? (((uint64_t)1) << i) - 1 : 0),
+                       (unsigned long long)s->buckets[i]);
+                sep = TRUE;
+            }
+            printf("%s\n", sep ? "" : "-");
+            break;
+        }
+    }
+
+    printf("# end\n");
+    
+    g_list_free(list);
+}
+
+
+/********************
+ * stats_snapshot
+ ********************/
+static void
+stats_snapshot(void)
+{
+    GList         *list, *l;
+    stats_entry_t *e;
+
+    list = stats_sorted();
+
+    for (l = list; l != NULL; l = l->next) {
+        e = (stats_entry_t *)l->data;
+        e->snapshot = e->stats;
+    }
+    
+    gettimeofday(&stats_snapped, NULL);
+    
+    printf("stats: snapshot of %u entries taken\n", g_list_length(list));
+    
+    g_list_free(list);
+}
+
+
+/********************
+ * stats_reset
+ ********************/
+static void
+stats_reset(const char *prefix)
+{
+    GList         *list, *l;
+    stats_entry_t *e;
+    ohm_stats_t   *s;
+    int            n;
+
+    list = stats_sorted();
+
+    /* gauges track the current state of things, they are left alone */
+    for (l = list, n = 0; l != NULL; l = l->next) {
+        e = (stats_entry_t *)l->data;
+        s = &e->stats;
+        
+        if (s->type == OHM_STATS_GAUGE || !stats_match(s->name, prefix))
+            continue;
+
+        s->value = 0;
+        s->count = s->sum = s->min = s->max = 0;
+        memset(s->buckets, 0, sizeof(s->buckets));
+        e->snapshot = *s;
+        n++;
+    }
+
+    printf("stats: %d entries reset\n", n);
+    
+    g_list_free(list);
+}
+
+
+/********************
+ * stats_command
+ ********************/
+static void
+stats_command(char *args)
+{
+    char *cmd, *prefix;
+    int   len;
+
+    cmd = args;
+    while (*cmd == ' ' || *cmd == '\t')
+        cmd++;
+
+    for (len = 0; cmd[len] && cmd[len] != ' ' && cmd[len] != '\t'; len++)
+        ;
+
+    prefix = cmd + len;
+    while (*prefix == ' ' || *prefix == '\t')
+        prefix++;
+
+#define IS(name) (len == sizeof(name) - 1 && !strncmp(cmd, name, len))
+    
+    if (!len || IS("show"))
+        stats_dump(prefix);
+    else if (IS("snapshot"))
+        stats_snapshot();
+    else if (IS("reset"))
+        stats_reset(prefix);
+    else if (IS("help")) {
+        printf("stats help:             show this help\n");
+        printf("stats [show [prefix]]   show statistics, with deltas since "
+               "the last snapshot\n");
+        printf("stats snapshot          take a snapshot for the deltas\n");
+        printf("stats reset [prefix]    reset counters and histograms\n");
+    }
+    else
+        printf("unknown stats command \"%s\"\n", args);
+
+#undef IS
+}
+
+
+/********************
+ * stats_add_command
+ ********************/
+static gboolean
+stats_add_command(gpointer data)
+{
+    (void)data;
+
+    stats_idle = 0;
+
+    console_command_add("stats", stats_command);
+
+    return FALSE;
+}
+
+
 /*****************************************************************************
  *                       *** misc. helper functions ***                      *
  *****************************************************************************/
@@ -685,25 +1085,93 @@ console_accept(GIOChannel *source, GIOCondition condition, gpointer data)
 static int
 console_read(console_t *c)
 {
-    int n, left = c->size - c->used - 1;
+    int n;
+
+    /*
+     * Make room for at least BUFFER_CHUNK bytes. The consumed lines are
+     * dropped only here, by moving the trailing partial line (if any)
+     * to the front once per read, and the buffer is grown by doubling.
+     */
     
-    if (left < BUFFER_CHUNK) {
-        if (REALLOC_ARR(c->buf, c->size, c->size + BUFFER_CHUNK) == NULL)
-            return -ENOMEM;
-        c->size += BUFFER_CHUNK;
+    if (c->size - c->used - 1 < BUFFER_CHUNK) {
+        if (c->start > 0) {
+            c->used -= c->start;
+            c->scan -= c->start;
+            memmove(c->buf, c->buf + c->start, c->used);
+            c->start = 0;
+        }
+        
+        if (c->size - c->used - 1 < BUFFER_CHUNK) {
+            if (REALLOC_ARR(c->buf, c->size, 2 * c->size) == NULL)
+                return -ENOMEM;
+            c->size *= 2;
+        }
     }
 
-    switch ((n = read(c->sock, c->buf + c->used, left))) {
+    switch ((n = read(c->sock, c->buf + c->used, c->size - c->used - 1))) {
     case  0:
     case -1:
         return n;
     default:
+        ohm_stats_add(stats_bytes, n);
         c->used += n;
+        c->buf[c->used] = '\0';
         return c->used;
     }
 }
 
 
+/********************
+ * console_input
+ ********************/
+static int
+console_input(console_t *c)
+{
+    char *line, *p, *end;
+
+    /*
+     * Pass all complete lines to the input callback in a single pass
+     * over the newly read data. Lines are terminated by '\r', '\n' or
+     * "\r\n", even if the '\n' of the latter comes in the next read.
+     */
+    
+    end = c->buf + c->used;
+    
+    for (p = c->buf + c->scan; p < end; p++) {
+        if (*p != '\r' && *p != '\n')
+            continue;
+
+        if (*p == '\n' && c->cr && p == c->buf + c->start) {
+            c->cr = FALSE;
+            c->start++;
+            continue;
+        }
+        
+        line  = c->buf + c->start;
+        c->cr = (*p == '\r');
+        *p    = '\0';
+
+        if (c->cr && p + 1 < end && p[1] == '\n') {
+            *++p  = '\0';
+            c->cr = FALSE;
+        }
+        
+        c->start = p + 1 - c->buf;
+
+        ohm_stats_inc(stats_lines);
+        CALLBACK(c, input, line, c->data);
+        if (CLOSED(c))
+            return -1;
+    }
+    
+    if (c->start == c->used)
+        c->start = c->used = 0;
+    c->scan = c->used;
+    
+    return 0;
+}
+
+
 /********************
  * console_handler
  ********************/
@@ -711,37 +1179,17 @@ static gboolean
 console_handler(GIOChannel *source, GIOCondition condition, gpointer data)
 {
     console_t    *c = (console_t *)data;
-    int           left = c->size - c->used - 1;
-    unsigned int  i;
 
     (void)source;
 
     if (condition & G_IO_IN) {
         switch (console_read(c)) {
-        case -1:
-            break;
         case 0:
             goto closed;
         default:
-            for (i = 0; i < c->used; i++)
-                if (c->buf[i] == '\r') {
-                    c->buf[i] = '\0';
-                    if (i < c->used && c->buf[i+1] == '\n') {
-                        i++;
-                        c->buf[++i] = '\0';
-                    }
-                    CALLBACK(c, input, c->buf, c->data);
-                    if (CLOSED(c))
-                        goto closed;
-                    if ((left = c->used - i - 1) > 0) {
-                        memmove(c->buf, c->buf + i + 1, left);
-                        c->used         -= i + 1;
-                        c->buf[c->used]  = '\0';
-                        i                = 0;
-                    }
-                    else
-                        c->used = 0;
-                }
+            if (c->used > c->scan && console_input(c) < 0)
+                goto closed;
+            break;
         }
     }
     
@@ -766,13 +1214,15 @@ OHM_PLUGIN_DESCRIPTION("console",
                        plugin_exit,
                        NULL);
 
-OHM_PLUGIN_PROVIDES_METHODS(console, 6,
-    OHM_EXPORT(console_open  , "open"  ),
-    OHM_EXPORT(console_close , "close" ),
-    OHM_EXPORT(console_write , "write" ),
-    OHM_EXPORT(console_printf, "printf"),
-    OHM_EXPORT(console_grab  , "grab"),
-    OHM_EXPORT(console_ungrab, "ungrab")
+OHM_PLUGIN_PROVIDES_METHODS(console, 8,
+    OHM_EXPORT(console_open            , "open"            ),
+    OHM_EXPORT(console_close           , "close"           ),
+    OHM_EXPORT(console_write           , "write"           ),
+    OHM_EXPORT(console_printf          , "printf"          ),
+    OHM_EXPORT(console_grab            , "grab"            ),
+    OHM_EXPORT(console_ungrab          , "ungrab"          ),
+    OHM_EXPORT(console_stats_register  , "stats_register"  ),
+    OHM_EXPORT(console_stats_unregister, "stats_unregister")
 );
 
 
@@ -0,0 +1,107 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+#ifndef __OHM_EXT_STATS_H__
+#define __OHM_EXT_STATS_H__
+
+/*
+ * Runtime statistics registry of the console plugin.
+ *
+ * A plugin registers its statistics once by a dotted name, eg.
+ * "cgroups.classify.count", and keeps the returned pointer. Updates are
+ * plain memory operations done with the inline helpers below, without
+ * locking or lookups, so they must only be done from the main thread.
+ * The registry is dumped with the 'stats' console command.
+ *
+ *   OHM_IMPORTABLE(ohm_stats_t *, stats_register,
+ *                  (const char *name, int type));
+ *   OHM_IMPORTABLE(void, stats_unregister, (ohm_stats_t *stats));
+ *
+ *   OHM_IMPORT("console.stats_register"  , stats_register),
+ *   OHM_IMPORT("console.stats_unregister", stats_unregister),
+ */
+
+#include <stdint.h>
+
+typedef enum {
+    OHM_STATS_COUNTER = 0,               /* monotonic event counter */
+    OHM_STATS_GAUGE,                     /* current value of something */
+    OHM_STATS_HISTOGRAM,                 /* distribution of samples */
+} ohm_stats_type_t;
+
+/* histogram bucket i counts samples in [2^(i-1), 2^i), bucket 0 zeroes */
+#define OHM_STATS_BUCKETS 33
+
+typedef struct {
+    const char *name;                    /* dotted name, owned by console */
+    int         type;                    /* OHM_STATS_* */
+    int64_t     value;                   /* counter or gauge value */
+    uint64_t    count;                   /* number of histogram samples */
+    uint64_t    sum;                     /* sum of histogram samples */
+    uint64_t    min;                     /* smallest sample */
+    uint64_t    max;                     /* largest sample */
+    uint64_t    buckets[OHM_STATS_BUCKETS];
+} ohm_stats_t;
+
+
+static inline void
+ohm_stats_add(ohm_stats_t *stats, int64_t n)
+{
+    if (stats != NULL)
+        stats->value += n;
+}
+
+
+static inline void
+ohm_stats_inc(ohm_stats_t *stats)
+{
+    ohm_stats_add(stats, 1);
+}
+
+
+static inline void
+ohm_stats_set(ohm_stats_t *stats, int64_t value)
+{
+    if (stats != NULL)
+        stats->value = value;
+}
+
+
+static inline void
+ohm_stats_sample(ohm_stats_t *stats, uint32_t sample)
+{
+    int bucket;
+
+    if (stats == NULL)
+        return;
+
+    bucket = sample ? 32 - __builtin_clz(sample) : 0;
+
+    if (!stats->count || sample < stats->min)
+        stats->min = sample;
+    if (sample > stats->max)
+        stats->max = sample;
+
+    stats->count++;
+    stats->sum += sample;
+    stats->buckets[bucket]++;
+}
+
+
+#endif /* __OHM_EXT_STATS_H__ */
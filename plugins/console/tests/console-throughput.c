@@ -0,0 +1,215 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/**
+ * @file console-throughput.c
+ * @brief Pipe a large command script through a console socket
+ *
+ * A console is opened on the loopback interface and a child process
+ * writes a script of numbered commands to it in large chunks, with
+ * "\n", "\r\n" and "\r" line endings mixed. Every command must come out
+ * of the input callback intact and in order; the throughput is reported.
+ *
+ *  usage: console-throughput [commands [port]]
+ */
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "../console.c"
+
+#define DEFAULT_COMMANDS 100000
+#define DEFAULT_PORT     3099
+#define WRITE_CHUNK      8192
+
+static GMainLoop *loop;
+static int        expected;
+static int        received;
+static int        errors;
+
+
+/* no dres here to register the stats console command with */
+gboolean
+ohm_module_find_method(char *name, char **signature, void **method)
+{
+    (void)name;
+    (void)signature;
+    (void)method;
+
+    return FALSE;
+}
+
+
+static double
+now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+static void
+script_opened(int id, struct sockaddr *addr, int addrlen)
+{
+    (void)id;
+    (void)addr;
+    (void)addrlen;
+}
+
+
+static void
+script_closed(int id)
+{
+    (void)id;
+    g_main_loop_quit(loop);
+}
+
+
+static void
+script_input(int id, char *input, void *data)
+{
+    char cmd[64];
+
+    (void)id;
+    (void)data;
+
+    snprintf(cmd, sizeof(cmd), "cgroups show group %d", received);
+
+    if (strcmp(input, cmd)) {
+        if (errors++ < 10)
+            printf("line %d: expected '%s', got '%s'\n", received, cmd, input);
+    }
+
+    if (++received == expected)
+        g_main_loop_quit(loop);
+}
+
+
+static void
+write_script(int port, int n)
+{
+    static const char *eol[] = { "\n", "\r\n", "\r" };
+    struct sockaddr_in  sin;
+    char                buf[WRITE_CHUNK + 64];
+    int                 sock, len, i, w, o;
+
+    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        exit(1);
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family      = AF_INET;
+    sin.sin_port        = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (connect(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+        exit(1);
+
+    for (i = 0, len = 0; i < n; i++) {
+        len += sprintf(buf + len, "cgroups show group %d%s", i, eol[i % 3]);
+
+        if (len >= WRITE_CHUNK || i == n - 1) {
+            for (o = 0; o < len; o += w)
+                if ((w = write(sock, buf + o, len - o)) < 0)
+                    exit(1);
+            len = 0;
+        }
+    }
+
+    close(sock);
+    exit(0);
+}
+
+
+static gboolean
+timeout(gpointer data)
+{
+    (void)data;
+
+    printf("timed out\n");
+    g_main_loop_quit(loop);
+
+    return FALSE;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    char   address[64];
+    int    port, id, status;
+    pid_t  pid;
+    double start, elapsed;
+
+    expected = argc > 1 ? atoi(argv[1]) : DEFAULT_COMMANDS;
+    port     = argc > 2 ? atoi(argv[2]) : DEFAULT_PORT;
+
+    if (expected <= 0) {
+        printf("usage: %s [commands [port]]\n", argv[0]);
+        exit(1);
+    }
+
+    snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+
+    loop = g_main_loop_new(NULL, FALSE);
+    id   = console_open(address, script_opened, script_closed,
+                        script_input, NULL, FALSE);
+
+    if (id < 0) {
+        printf("failed to open console at %s\n", address);
+        exit(1);
+    }
+
+    start = now();
+
+    if ((pid = fork()) < 0)
+        exit(1);
+    if (pid == 0)
+        write_script(port, expected);
+
+    g_timeout_add(60 * 1000, timeout, NULL);
+    g_main_loop_run(loop);
+
+    elapsed = now() - start;
+
+    waitpid(pid, &status, 0);
+    console_close(id);
+
+    printf("%d/%d commands in %.3f s, %.0f commands/s\n",
+           received, expected, elapsed, received / elapsed);
+
+    if (received != expected || errors ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("FAILED (%d errors)\n", errors);
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
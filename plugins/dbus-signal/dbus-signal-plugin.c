@@ -34,6 +34,12 @@ USA.
  * signature = si
  * target = dres_signal_handler
  * arguments = foo,bar
+ * coalesce = 100
+ *
+ * The optional coalesce key gives a window in milliseconds. The first
+ * signal resolves the target immediately and opens the window; signals
+ * arriving while the window is open replace each other and only the
+ * latest one is used to resolve the target when the window closes.
  *
  */
 
@@ -77,6 +83,14 @@ static void free_dbus_signal_parameters(struct dbus_signal_parameters_s *params)
     g_free(params->target);
     g_strfreev(params->arguments);
 
+    if (params->timer)
+        g_source_remove(params->timer);
+    if (params->pending != NULL)
+        dbus_message_unref(params->pending);
+
+    g_free(params->dres_args);
+    g_free(params->doubles);
+
     g_free(params);
 
     return;
@@ -84,101 +98,169 @@ static void free_dbus_signal_parameters(struct dbus_signal_parameters_s *params)
 
 #define DRES_VARTYPE(t)  (char *)(t)
 
-static DBusHandlerResult handler(DBusConnection *c, DBusMessage *msg, void *data)
+static int compile_layout(struct dbus_signal_parameters_s *params)
 {
-    struct dbus_signal_parameters_s *params = data;
-    /* i is the dres array iterator, j is the parameter iterator and k
-     * is the double storage iterator */
-    int status, len, i = 0, j = 0, k = 0;
-    const char *sig;
-    DBusMessageIter msg_it;
-    char **dres_args = NULL;
-    double double_storage[32];
+    /* Set up the name, type, value triplets for resolve() once, so that
+     * only the values need to be filled in when a signal arrives. */
 
-    (void) c;
-    (void) msg;
+    int i, n;
 
-    if (params == NULL || msg == NULL || dbus_plugin == NULL) {
-        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    params->nargs = strlen(params->signature);
+    params->ndouble = 0;
+
+    if (params->nargs == 0)
+        return TRUE;
+
+    for (i = 0; i < params->nargs; i++) {
+        if (params->signature[i] == 'd')
+            params->ndouble++;
     }
 
-    OHM_DEBUG(DBG_DBUS_SIGNAL, "handling signal '%s.%s' on path '%s', calling target '%s'",
-            params->interface, params->name, params->path, params->target);
+    params->dres_args = g_new0(char *, params->nargs * 3 + 1);
 
-    /* get the signal parameters */
+    if (params->ndouble > 0)
+        params->doubles = g_new0(double, params->ndouble);
 
-    sig = dbus_message_get_signature(msg);
+    if (params->dres_args == NULL ||
+            (params->ndouble > 0 && params->doubles == NULL)) {
+        OHM_ERROR("dbus-signal: cannot allocate memory!");
+        return FALSE;
+    }
 
-    if (strcmp(sig, params->signature) != 0) {
-        OHM_DEBUG(DBG_DBUS_SIGNAL, "wrong signal signature ('%s': expected '%s'", sig, params->signature);
-        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    for (i = 0, n = 0; i < params->nargs; i++, n += 3) {
+        params->dres_args[n] = params->arguments[i];
+        params->dres_args[n+1] = DRES_VARTYPE((long) params->signature[i]);
     }
 
-    len = strlen(sig) * 3 + 1;
+    return TRUE;
+}
 
-    if (len > 1) {
+static int marshal_args(struct dbus_signal_parameters_s *params, DBusMessage *msg)
+{
+    DBusMessageIter msg_it;
+    char **value;
+    int i, k = 0;
 
-        dres_args = calloc(len, sizeof(char *));
+    if (params->nargs == 0)
+        return TRUE;
 
-        if (dres_args == NULL) {
-            OHM_DEBUG(DBG_DBUS_SIGNAL, "error allocating memory");
-            return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    if (!dbus_message_iter_init(msg, &msg_it))
+        return FALSE;
+
+    for (i = 0; i < params->nargs; i++) {
+
+        /* the D-Bus type codes of the allowed types match the signature */
+        if (dbus_message_iter_get_arg_type(&msg_it) != params->signature[i]) {
+            OHM_DEBUG(DBG_DBUS_SIGNAL, "unexpected type for argument %d", i);
+            return FALSE;
         }
 
-        dbus_message_iter_init(msg, &msg_it);
-        do {
-            switch (dbus_message_iter_get_arg_type(&msg_it)) {
-                case DBUS_TYPE_STRING:
-                    {
-                        char *strvalue;
-                        dbus_message_iter_get_basic(&msg_it, &strvalue);
-                        dres_args[i++] = params->arguments[j++];
-                        dres_args[i++] = DRES_VARTYPE('s');
-                        dres_args[i++] = strvalue;
-                        break;
-                    }
-                case DBUS_TYPE_INT32:
-                    {
-                        int intvalue;
-                        dbus_message_iter_get_basic(&msg_it, &intvalue);
-                        dres_args[i++] = params->arguments[j++];
-                        dres_args[i++] = DRES_VARTYPE('i');
-                        dres_args[i++] = GINT_TO_POINTER(intvalue);
-                        break;
-                    }
-                case DBUS_TYPE_DOUBLE:
-                    {
-                        if (k == 32) {
-                            OHM_DEBUG(DBG_DBUS_SIGNAL, "too many double arguments");
-                            free(dres_args);
-                            return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-                        }
-                        dbus_message_iter_get_basic(&msg_it, &double_storage[k]);
-                        dres_args[i++] = params->arguments[j++];
-                        dres_args[i++] = DRES_VARTYPE('d');
-                        dres_args[i++] = (char *) &double_storage[k];
-                        k++;
-                        break;
-                    }
-                default:
-                    OHM_DEBUG(DBG_DBUS_SIGNAL, "impossible signal parameter error");
-                    free(dres_args);
-                    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-            }
+        value = &params->dres_args[i*3 + 2];
 
-        } while (dbus_message_iter_next(&msg_it) && i < len-1);
+        switch (params->signature[i]) {
+            case 's':
+                {
+                    const char *strvalue;
+                    dbus_message_iter_get_basic(&msg_it, &strvalue);
+                    *value = (char *) strvalue;
+                    break;
+                }
+            case 'i':
+                {
+                    dbus_int32_t intvalue;
+                    dbus_message_iter_get_basic(&msg_it, &intvalue);
+                    *value = GINT_TO_POINTER(intvalue);
+                    break;
+                }
+            case 'd':
+                {
+                    dbus_message_iter_get_basic(&msg_it, &params->doubles[k]);
+                    *value = (char *) &params->doubles[k];
+                    k++;
+                    break;
+                }
+            default:
+                OHM_DEBUG(DBG_DBUS_SIGNAL, "impossible signal parameter error");
+                return FALSE;
+        }
 
-        dres_args[len-1] = NULL;
+        dbus_message_iter_next(&msg_it);
     }
 
-    status = resolve(params->target, dres_args);
+    return TRUE;
+}
+
+static void run_target(struct dbus_signal_parameters_s *params, DBusMessage *msg)
+{
+    int status;
+
+    OHM_DEBUG(DBG_DBUS_SIGNAL, "handling signal '%s.%s' on path '%s', calling target '%s'",
+            params->interface, params->name, params->path, params->target);
+
+    if (!marshal_args(params, msg))
+        return;
 
-    free(dres_args);
+    status = resolve(params->target, params->nargs ? params->dres_args : NULL);
+    params->resolved++;
 
     if (status < 0) {
         OHM_DEBUG(DBG_DBUS_SIGNAL, "ran policy hook '%s' with status %d",
                 params->target ? params->target : "NULL", status);
     }
+}
+
+static gboolean window_cb(gpointer data)
+{
+    struct dbus_signal_parameters_s *params = data;
+    DBusMessage *msg = params->pending;
+
+    if (msg == NULL) {
+        /* nothing arrived within the window, close it */
+        params->timer = 0;
+        return FALSE;
+    }
+
+    /* resolve with the latest signal and keep the window open */
+    params->pending = NULL;
+    run_target(params, msg);
+    dbus_message_unref(msg);
+
+    return TRUE;
+}
+
+static DBusHandlerResult handler(DBusConnection *c, DBusMessage *msg, void *data)
+{
+    struct dbus_signal_parameters_s *params = data;
+
+    (void) c;
+
+    if (params == NULL || msg == NULL || dbus_plugin == NULL) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    /* the dbus plugin only dispatches signals with the registered
+     * signature to us, so there is no need to check it here */
+
+    params->received++;
+
+    if (params->window > 0) {
+        if (params->timer != 0) {
+            if (params->pending != NULL) {
+                dbus_message_unref(params->pending);
+                params->skipped++;
+            }
+            params->pending = dbus_message_ref(msg);
+
+            OHM_DEBUG(DBG_DBUS_SIGNAL, "coalesced signal '%s.%s' (%lu skipped)",
+                    params->interface, params->name, params->skipped);
+
+            return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+        }
+
+        params->timer = g_timeout_add(params->window, window_cb, params);
+    }
+
+    run_target(params, msg);
 
     return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
@@ -231,7 +313,7 @@ static void plugin_init(OhmPlugin *plugin)
             struct dbus_signal_parameters_s *params;
             int success;
             int len, arg_len, j, error = 0;
-            gchar *arg_string, **iter;
+            gchar *arg_string, *window, **iter;
 
             params = calloc(1, sizeof(struct dbus_signal_parameters_s));
 
@@ -246,6 +328,11 @@ static void plugin_init(OhmPlugin *plugin)
                 params->arguments = g_strsplit(arg_string, INI_FILE_STRING_DELIMITER, 0);
                 g_free(arg_string);
             }
+            window = g_key_file_get_value(keyfile, signals[i], "coalesce", NULL);
+            if (window != NULL) {
+                params->window = (guint) strtoul(window, NULL, 10);
+                g_free(window);
+            }
 
             if (params->name == NULL || params->path == NULL || params->interface == NULL
                     || params->target == NULL) {
@@ -296,6 +383,11 @@ static void plugin_init(OhmPlugin *plugin)
                 continue;
             }
 
+            if (!compile_layout(params)) {
+                free_dbus_signal_parameters(params);
+                continue;
+            }
+
             success = add_signal(DBUS_BUS_SYSTEM, params->path, params->interface,
                     params->name, params->signature, params->sender, handler, params);
 
@@ -303,6 +395,9 @@ static void plugin_init(OhmPlugin *plugin)
                 dbus_plugin->signals = g_slist_prepend(dbus_plugin->signals, params);
                 OHM_INFO("dbus-signal: added watcher for signal '%s' (%s) on interface '%s'",
                         params->name, params->signature, params->interface);
+                if (params->window > 0)
+                    OHM_INFO("dbus-signal: coalescing signal '%s' within %u msecs",
+                            params->name, params->window);
             }
             else {
                 OHM_ERROR("dbus-signal: failed to add signal watcher!");
@@ -340,6 +435,13 @@ plugin_exit(OhmPlugin *plugin)
             del_signal(DBUS_BUS_SYSTEM, params->path, params->interface,
                     params->name, params->signature, params->sender, handler, params);
 
+            if (params->pending != NULL)
+                params->skipped++;
+
+            OHM_INFO("dbus-signal: signal '%s.%s': %lu received, %lu resolved, "
+                    "%lu skipped", params->interface, params->name,
+                    params->received, params->resolved, params->skipped);
+
             free_dbus_signal_parameters(params);
         }
         g_slist_free(dbus_plugin->signals);
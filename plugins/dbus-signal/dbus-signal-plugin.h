@@ -45,6 +45,22 @@ struct dbus_signal_parameters_s {
     gchar *sender;
     gchar *target;
     gchar **arguments;
+
+    /* argument layout, compiled when the signal is configured */
+    int nargs;                  /* number of signal arguments */
+    int ndouble;                /* number of double arguments */
+    char **dres_args;           /* name, type, value triplets for resolve */
+    double *doubles;            /* storage for double argument values */
+
+    /* rate limiting */
+    guint window;               /* coalescing window in msecs, 0 if none */
+    guint timer;                /* window timer, 0 if window is closed */
+    DBusMessage *pending;       /* latest signal received within window */
+
+    /* statistics */
+    unsigned long received;     /* signals received */
+    unsigned long resolved;     /* resolves run */
+    unsigned long skipped;      /* resolves skipped due to coalescing */
 };
 
 #endif
@@ -120,6 +120,11 @@ bus_destroy(bus_t *bus)
             bus->watches = NULL;
         }
 
+        if (bus->pids) {
+            hash_table_destroy(bus->pids);
+            bus->pids = NULL;
+        }
+
         bus_disconnect(bus);
 
         FREE(bus);
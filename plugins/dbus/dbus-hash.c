@@ -84,6 +84,16 @@ hash_table_unhash(hash_table_t *ht, const char *key)
 }
 
 
+/********************
+ * hash_table_clear
+ ********************/
+void
+hash_table_clear(hash_table_t *ht)
+{
+    g_hash_table_remove_all(ht);
+}
+
+
 /********************
  * hash_table_empty
  ********************/
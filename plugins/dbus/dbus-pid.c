@@ -0,0 +1,612 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+#include <stdio.h>
+
+#include "dbus-plugin.h"
+#include "list.h"
+
+extern int DBG_PID;                            /* debug flag for pid cache */
+
+#define DBUS_ADMIN_SERVICE    "org.freedesktop.DBus"
+#define DBUS_ADMIN_PATH       "/org/freedesktop/DBus"
+#define DBUS_ADMIN_INTERFACE  "org.freedesktop.DBus"
+#define DBUS_QUERY_PID_METHOD "GetConnectionUnixProcessID"
+
+/*
+ * We only need to hear about names that lose their owner. Unique names
+ * are never reused, so an entry for one stays valid until its owner goes.
+ */
+#define PID_RULE                                                        \
+    "type='signal',sender='org.freedesktop.DBus',"                      \
+    "path='/org/freedesktop/DBus',interface='org.freedesktop.DBus',"    \
+    "member='NameOwnerChanged',arg2=''"
+
+typedef struct {
+    char            *name;                     /* bus name */
+    bus_t           *bus;                      /* bus of the name */
+    pid_t            pid;                      /* pid, if known */
+    DBusPendingCall *pending;                  /* query in progress */
+    int              stale;                    /* owner gone while querying */
+    list_hook_t      waiters;                  /* queued pid_waiter_t's */
+} pidentry_t;
+
+typedef struct {
+    list_hook_t     hook;
+    bus_t          *bus;                       /* bus of the query */
+    pid_query_cb_t  callback;
+    void           *data;
+    pid_t           pid;                       /* result for cached hits */
+    guint           id;                        /* idle source for cached hits */
+} pid_waiter_t;
+
+
+static list_hook_t ready;                      /* cached hits to deliver */
+
+static pidentry_t *pidentry_add(bus_t *bus, const char *name);
+static void pidentry_purge(void *ptr);
+static int pidentry_query(pidentry_t *entry);
+static void pidentry_notify(pidentry_t *entry, const char *error);
+static void pidentry_abort(gpointer key, gpointer value, gpointer data);
+static int waiter_cancel(list_hook_t *list, bus_t *bus,
+                         pid_query_cb_t callback, void *data);
+static void pid_queried(DBusPendingCall *pend, void *data);
+static int pid_add_filter(bus_t *bus);
+static void pid_del_filter(bus_t *bus);
+static gboolean ready_dispatch(gpointer data);
+static void session_bus_event(bus_t *bus, int event, void *data);
+
+
+/********************
+ * pid_init
+ ********************/
+int
+pid_init(void)
+{
+    bus_t *system, *session;
+
+    list_init(&ready);
+
+    if ((system = bus_by_type(DBUS_BUS_SYSTEM)) == NULL)
+        return FALSE;
+
+    if ((system->pids = hash_table_create(NULL, pidentry_purge)) == NULL) {
+        OHM_ERROR("dbus: failed to create pid cache");
+        pid_exit();
+        return FALSE;
+    }
+
+    if (!pid_add_filter(system)) {
+        OHM_ERROR("dbus: failed to add pid cache filter for system bus");
+        pid_exit();
+        return FALSE;
+    }
+
+    if ((session = bus_by_type(DBUS_BUS_SESSION)) == NULL)
+        return FALSE;
+
+    if ((session->pids = hash_table_create(NULL, pidentry_purge)) == NULL) {
+        OHM_ERROR("dbus: failed to create pid cache");
+        pid_exit();
+        return FALSE;
+    }
+
+    if (!bus_watch_add(session, session_bus_event, NULL)) {
+        OHM_ERROR("dbus: failed to install session bus watch");
+        pid_exit();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/********************
+ * pid_exit
+ ********************/
+void
+pid_exit(void)
+{
+    bus_t        *system, *session;
+    pid_waiter_t *waiter;
+    list_hook_t  *p, *n;
+
+    system  = bus_by_type(DBUS_BUS_SYSTEM);
+    session = bus_by_type(DBUS_BUS_SESSION);
+
+    if (system != NULL) {
+        pid_del_filter(system);
+        if (system->pids) {
+            hash_table_destroy(system->pids);
+            system->pids = NULL;
+        }
+    }
+    if (session != NULL) {
+        pid_del_filter(session);
+        bus_watch_del(session, session_bus_event, NULL);
+        if (session->pids) {
+            hash_table_destroy(session->pids);
+            session->pids = NULL;
+        }
+    }
+
+    if (ready.next != NULL) {
+        list_foreach(&ready, p, n) {
+            list_delete(p);
+            waiter = list_entry(p, pid_waiter_t, hook);
+            g_source_remove(waiter->id);
+            FREE(waiter);
+        }
+    }
+}
+
+
+/********************
+ * pid_query
+ ********************/
+int
+pid_query(DBusBusType type, const char *name, pid_query_cb_t callback,
+          void *data)
+{
+    bus_t        *bus;
+    pidentry_t   *entry;
+    pid_waiter_t *waiter;
+
+    if (name == NULL || callback == NULL)
+        return FALSE;
+
+    if ((bus = bus_by_type(type)) == NULL || bus->conn == NULL || !bus->pids)
+        return FALSE;
+
+    if (ALLOC_OBJ(waiter) == NULL)
+        return FALSE;
+
+    list_init(&waiter->hook);
+    waiter->bus      = bus;
+    waiter->callback = callback;
+    waiter->data     = data;
+
+    if ((entry = hash_table_lookup(bus->pids, name)) != NULL) {
+        if (entry->pending == NULL) {
+            OHM_DEBUG(DBG_PID, "pid of %s is %u (cached)", name, entry->pid);
+
+            waiter->pid = entry->pid;
+            waiter->id  = g_idle_add(ready_dispatch, waiter);
+            list_append(&ready, &waiter->hook);
+        }
+        else {
+            OHM_DEBUG(DBG_PID, "joining pending pid query for %s", name);
+            list_append(&entry->waiters, &waiter->hook);
+        }
+
+        return TRUE;
+    }
+
+    if ((entry = pidentry_add(bus, name)) == NULL) {
+        FREE(waiter);
+        return FALSE;
+    }
+
+    list_append(&entry->waiters, &waiter->hook);
+
+    if (!pidentry_query(entry)) {
+        hash_table_remove(bus->pids, entry->name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/********************
+ * pid_cancel
+ ********************/
+int
+pid_cancel(DBusBusType type, const char *name, pid_query_cb_t callback,
+           void *data)
+{
+    bus_t      *bus;
+    pidentry_t *entry;
+
+    if (name == NULL || callback == NULL)
+        return FALSE;
+
+    if ((bus = bus_by_type(type)) == NULL || !bus->pids)
+        return FALSE;
+
+    if ((entry = hash_table_lookup(bus->pids, name)) != NULL &&
+        waiter_cancel(&entry->waiters, bus, callback, data)) {
+        OHM_DEBUG(DBG_PID, "cancelled pending pid query for %s", name);
+        return TRUE;
+    }
+
+    if (waiter_cancel(&ready, bus, callback, data)) {
+        OHM_DEBUG(DBG_PID, "cancelled cached pid reply for %s", name);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+/********************
+ * waiter_cancel
+ ********************/
+static int
+waiter_cancel(list_hook_t *list, bus_t *bus, pid_query_cb_t callback,
+              void *data)
+{
+    pid_waiter_t *waiter;
+    list_hook_t  *p, *n;
+
+    list_foreach(list, p, n) {
+        waiter = list_entry(p, pid_waiter_t, hook);
+
+        if (waiter->bus      == bus      &&
+            waiter->callback == callback &&
+            waiter->data     == data) {
+            list_delete(p);
+            if (waiter->id != 0)
+                g_source_remove(waiter->id);
+            FREE(waiter);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/********************
+ * pidentry_add
+ ********************/
+static pidentry_t *
+pidentry_add(bus_t *bus, const char *name)
+{
+    pidentry_t *entry;
+
+    if (ALLOC_OBJ(entry) == NULL)
+        return NULL;
+
+    list_init(&entry->waiters);
+    entry->bus = bus;
+
+    if ((entry->name = STRDUP(name)) == NULL) {
+        FREE(entry);
+        return NULL;
+    }
+
+    if (!hash_table_insert(bus->pids, entry->name, entry)) {
+        pidentry_purge(entry);
+        return NULL;
+    }
+
+    return entry;
+}
+
+
+/********************
+ * pidentry_purge
+ ********************/
+static void
+pidentry_purge(void *ptr)
+{
+    pidentry_t   *entry = (pidentry_t *)ptr;
+    pid_waiter_t *waiter;
+    list_hook_t  *p, *n;
+
+    if (entry) {
+        if (entry->pending != NULL) {
+            dbus_pending_call_cancel(entry->pending);
+            dbus_pending_call_unref(entry->pending);
+        }
+
+        list_foreach(&entry->waiters, p, n) {
+            list_delete(p);
+            waiter = list_entry(p, pid_waiter_t, hook);
+            FREE(waiter);
+        }
+
+        FREE(entry->name);
+        FREE(entry);
+    }
+}
+
+
+/********************
+ * pidentry_query
+ ********************/
+static int
+pidentry_query(pidentry_t *entry)
+{
+    DBusMessage     *msg;
+    DBusPendingCall *pend;
+    const char      *name = entry->name;
+
+    msg = dbus_message_new_method_call(DBUS_ADMIN_SERVICE,
+                                       DBUS_ADMIN_PATH,
+                                       DBUS_ADMIN_INTERFACE,
+                                       DBUS_QUERY_PID_METHOD);
+    if (msg == NULL)
+        return FALSE;
+
+    if (!dbus_message_append_args(msg,
+                                  DBUS_TYPE_STRING, &name,
+                                  DBUS_TYPE_INVALID)            ||
+        !dbus_connection_send_with_reply(entry->bus->conn, msg, &pend, -1))
+        goto failed;
+
+    if (pend == NULL)                          /* connection is gone */
+        goto failed;
+
+    if (!dbus_pending_call_set_notify(pend, pid_queried, entry, NULL)) {
+        dbus_pending_call_cancel(pend);
+        dbus_pending_call_unref(pend);
+        goto failed;
+    }
+
+    dbus_message_unref(msg);
+
+    entry->pending = pend;
+
+    OHM_DEBUG(DBG_PID, "querying pid of %s", name);
+
+    return TRUE;
+
+ failed:
+    OHM_ERROR("dbus: failed to query pid of %s", name);
+    dbus_message_unref(msg);
+    return FALSE;
+}
+
+
+/********************
+ * pidentry_notify
+ ********************/
+static void
+pidentry_notify(pidentry_t *entry, const char *error)
+{
+    pid_waiter_t *waiter;
+    list_hook_t  *p, *n;
+
+    list_foreach(&entry->waiters, p, n) {
+        list_delete(p);
+        waiter = list_entry(p, pid_waiter_t, hook);
+        waiter->callback(entry->pid, error, waiter->data);
+        FREE(waiter);
+    }
+}
+
+
+/********************
+ * pidentry_abort
+ ********************/
+static void
+pidentry_abort(gpointer key, gpointer value, gpointer data)
+{
+    pidentry_t  *entry   = (pidentry_t *)value;
+    list_hook_t *aborted = (list_hook_t *)data;
+    list_hook_t *p, *n;
+
+    (void)key;
+
+    /*
+     * Only collect the waiters here. The callbacks are invoked once we
+     * are done with the hash table, as they may issue new queries.
+     */
+    list_foreach(&entry->waiters, p, n) {
+        list_delete(p);
+        list_append(aborted, p);
+    }
+}
+
+
+/********************
+ * pid_queried
+ ********************/
+static void
+pid_queried(DBusPendingCall *pend, void *data)
+{
+    pidentry_t    *entry = (pidentry_t *)data;
+    bus_t         *bus   = entry->bus;
+    DBusMessage   *reply;
+    DBusError      err;
+    dbus_uint32_t  pid;
+    const char    *error;
+
+    dbus_error_init(&err);
+
+    if ((reply = dbus_pending_call_steal_reply(pend)) == NULL)
+        error = "no reply";
+    else if (dbus_set_error_from_message(&err, reply))
+        error = err.message;
+    else if (!dbus_message_get_args(reply, &err,
+                                    DBUS_TYPE_UINT32, &pid,
+                                    DBUS_TYPE_INVALID))
+        error = dbus_error_is_set(&err) ? err.message : "invalid reply";
+    else {
+        error      = NULL;
+        entry->pid = (pid_t)pid;
+    }
+
+    dbus_pending_call_unref(entry->pending);
+    entry->pending = NULL;
+
+    if (error != NULL)
+        OHM_DEBUG(DBG_PID, "pid query for %s failed (%s)", entry->name, error);
+    else
+        OHM_DEBUG(DBG_PID, "pid of %s is %u", entry->name, entry->pid);
+
+    /*
+     * Only successfully resolved, still existing unique names are cached.
+     * Unhash anything else before notifying so that a query issued from
+     * a callback will not pick up the result as a cached one.
+     */
+    if (error != NULL || entry->stale || entry->name[0] != ':') {
+        hash_table_unhash(bus->pids, entry->name);
+        pidentry_notify(entry, error);
+        pidentry_purge(entry);
+    }
+    else
+        pidentry_notify(entry, NULL);
+
+    if (reply != NULL)
+        dbus_message_unref(reply);
+
+    dbus_error_free(&err);
+}
+
+
+/********************
+ * pid_dispatch
+ ********************/
+static DBusHandlerResult
+pid_dispatch(DBusConnection *c, DBusMessage *msg, void *data)
+{
+    bus_t      *bus;
+    const char *name, *previous, *current;
+    pidentry_t *entry;
+
+    (void)data;
+
+    if ((bus = bus_by_connection(c)) == NULL || bus->pids == NULL ||
+        !dbus_message_is_signal(msg,
+                                "org.freedesktop.DBus", "NameOwnerChanged"))
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+    if (!dbus_message_get_args(msg, NULL,
+                               DBUS_TYPE_STRING, &name,
+                               DBUS_TYPE_STRING, &previous,
+                               DBUS_TYPE_STRING, &current,
+                               DBUS_TYPE_INVALID))
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+    if (current[0] == '\0' &&
+        (entry = hash_table_lookup(bus->pids, name)) != NULL) {
+        if (entry->pending != NULL) {
+            OHM_DEBUG(DBG_PID, "%s is gone while querying its pid", name);
+            entry->stale = TRUE;
+        }
+        else {
+            OHM_DEBUG(DBG_PID, "%s is gone, dropping cached pid %u",
+                      name, entry->pid);
+            hash_table_remove(bus->pids, name);
+        }
+    }
+
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+
+/********************
+ * pid_add_filter
+ ********************/
+static int
+pid_add_filter(bus_t *bus)
+{
+    DBusError err;
+
+    if (bus->conn == NULL)
+        return FALSE;
+
+    if (!dbus_connection_add_filter(bus->conn, pid_dispatch, NULL, NULL))
+        return FALSE;
+
+    dbus_error_init(&err);
+    dbus_bus_add_match(bus->conn, PID_RULE, &err);
+
+    if (dbus_error_is_set(&err)) {
+        OHM_ERROR("dbus: failed to add match \"%s\" (%s)", PID_RULE,
+                  err.message);
+        dbus_error_free(&err);
+        dbus_connection_remove_filter(bus->conn, pid_dispatch, NULL);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/********************
+ * pid_del_filter
+ ********************/
+static void
+pid_del_filter(bus_t *bus)
+{
+    if (bus->conn != NULL) {
+        dbus_bus_remove_match(bus->conn, PID_RULE, NULL);
+        dbus_connection_remove_filter(bus->conn, pid_dispatch, NULL);
+    }
+}
+
+
+/********************
+ * ready_dispatch
+ ********************/
+static gboolean
+ready_dispatch(gpointer data)
+{
+    pid_waiter_t *waiter = (pid_waiter_t *)data;
+
+    list_delete(&waiter->hook);
+    waiter->callback(waiter->pid, NULL, waiter->data);
+    FREE(waiter);
+
+    return FALSE;
+}
+
+
+/********************
+ * session_bus_event
+ ********************/
+static void
+session_bus_event(bus_t *bus, int event, void *data)
+{
+    pid_waiter_t *waiter;
+    list_hook_t   aborted, *p, *n;
+
+    (void)data;
+
+    if (event == BUS_EVENT_CONNECTED) {
+        /* unique names of a new bus have nothing to do with the old ones */
+        if (bus->pids != NULL) {
+            list_init(&aborted);
+            hash_table_foreach(bus->pids, pidentry_abort, &aborted);
+            hash_table_clear(bus->pids);
+
+            list_foreach(&aborted, p, n) {
+                list_delete(p);
+                waiter = list_entry(p, pid_waiter_t, hook);
+                waiter->callback(0, "bus reconnected", waiter->data);
+                FREE(waiter);
+            }
+        }
+        pid_add_filter(bus);
+    }
+}
+
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -26,11 +26,12 @@ USA.
 static OhmPlugin *dbus_plugin;                /* this plugin */
 
 /* debug flags */
-int DBG_SIGNAL, DBG_METHOD;
+int DBG_SIGNAL, DBG_METHOD, DBG_PID;
 
 OHM_DEBUG_PLUGIN(dbus,
     OHM_DEBUG_FLAG("signals", "DBUS signal routing", &DBG_SIGNAL),
-    OHM_DEBUG_FLAG("methods", "DBUS method routing", &DBG_METHOD));
+    OHM_DEBUG_FLAG("methods", "DBUS method routing", &DBG_METHOD),
+    OHM_DEBUG_FLAG("pids"   , "DBUS pid cache"     , &DBG_PID));
 
 
 static void plugin_exit(OhmPlugin *plugin);
@@ -55,6 +56,7 @@ plugin_init(OhmPlugin *plugin)
     retval += watch_init()    * 2;
     retval += method_init()   * 4;
     retval += signal_init()   * 8;
+    retval += pid_init()      * 16;
 
     if (!retval) {
         OHM_ERROR("dbus ERROR: 0x%04x", retval);
@@ -86,6 +88,7 @@ plugin_exit(OhmPlugin *plugin)
                "com.nokia.policy", "NewSession", "s", NULL,
                session_bus_up, NULL);
     
+    pid_exit();
     signal_exit();
     method_exit();
     watch_exit();
@@ -246,6 +249,29 @@ OHM_EXPORTABLE(int, del_watch, (DBusBusType type,
 }
 
 
+/********************
+ * query_pid
+ ********************/
+OHM_EXPORTABLE(int, query_pid, (DBusBusType type, const char *name,
+                                void (*callback)(pid_t, const char *, void *),
+                                void *data))
+{
+    return pid_query(type, name, callback, data);
+}
+
+
+/********************
+ * cancel_pid_query
+ ********************/
+OHM_EXPORTABLE(int, cancel_pid_query, (DBusBusType type, const char *name,
+                                       void (*callback)(pid_t, const char *,
+                                                        void *),
+                                       void *data))
+{
+    return pid_cancel(type, name, callback, data);
+}
+
+
 /*****************************************************************************
  *                            *** OHM plugin glue ***                        *
  *****************************************************************************/
@@ -256,13 +282,15 @@ OHM_PLUGIN_DESCRIPTION(PLUGIN_NAME,
                        OHM_LICENSE_LGPL, /* OHM_LICENSE_LGPL */
                        plugin_init, plugin_exit, NULL);
 
-OHM_PLUGIN_PROVIDES_METHODS(PLUGIN_PREFIX, 6,
+OHM_PLUGIN_PROVIDES_METHODS(PLUGIN_PREFIX, 8,
                             OHM_EXPORT(add_method, "add_method"),
                             OHM_EXPORT(del_method, "del_method"),
                             OHM_EXPORT(add_signal, "add_signal"),
                             OHM_EXPORT(del_signal, "del_signal"),
                             OHM_EXPORT(add_watch , "add_watch"),
-                            OHM_EXPORT(del_watch , "del_watch")
+                            OHM_EXPORT(del_watch , "del_watch"),
+                            OHM_EXPORT(query_pid , "query_pid"),
+                            OHM_EXPORT(cancel_pid_query, "cancel_pid_query")
 #if 0
                             OHM_EXPORT(register_name, "register_name"),
                             OHM_EXPORT(release_name , "release_name")
@@ -25,6 +25,7 @@ USA.
 #include <ohm/ohm-plugin-log.h>
 #include <ohm/ohm-plugin-debug.h>
 
+#include <sys/types.h>
 #include <glib.h>
 #include <dbus/dbus.h>
 
@@ -43,6 +44,7 @@ typedef struct {
     hash_table_t   *watches;               /* watched names */
     hash_table_t   *objects;               /* exported objects */
     hash_table_t   *signals;               /* signals we listen for */
+    hash_table_t   *pids;                  /* name -> pid cache */
     list_hook_t     notify;                /* bus event watchers */
 } bus_t;
 
@@ -106,6 +108,17 @@ int watch_del(DBusBusType type, const char *name,
 
 void watch_bus_up(bus_t *bus);
 
+/* dbus-pid.c */
+typedef void (*pid_query_cb_t)(pid_t pid, const char *error, void *data);
+
+int  pid_init(void);
+void pid_exit(void);
+
+int pid_query(DBusBusType type, const char *name, pid_query_cb_t callback,
+              void *data);
+int pid_cancel(DBusBusType type, const char *name, pid_query_cb_t callback,
+               void *data);
+
 
 /*
  * hash tables (just a wrapper around GHashTable)
@@ -118,6 +131,7 @@ int hash_table_insert(hash_table_t *ht, char *key, void *value);
 void *hash_table_lookup(hash_table_t *ht, const char *key);
 int hash_table_remove(hash_table_t *ht, const char *key);
 int hash_table_unhash(hash_table_t *ht, const char *key);
+void hash_table_clear(hash_table_t *ht);
 int hash_table_empty(hash_table_t *ht);
 void hash_table_foreach(hash_table_t *ht, GHFunc callback, void *data);
 
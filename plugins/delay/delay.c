@@ -25,6 +25,7 @@ USA.
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/timerfd.h>
 
 
 #include <gmodule.h>
@@ -38,6 +39,7 @@ USA.
 
 #include "delay.h"
 #include "request.h"
+#include "wheel.h"
 #include "timer.h"
 #include "../fsif/fsif.h"
 
@@ -69,6 +71,11 @@ OHM_IMPORTABLE(fsif_entry_t *, get_entry, (char           *name,
 
 OHM_IMPORTABLE(int, destroy_factstore_entry, (fsif_entry_t *fact));
 
+OHM_IMPORTABLE(int, add_fact_watch, (char                 *factname,
+                                     fsif_fact_watch_e     type,
+                                     fsif_fact_watch_cb_t  callback,
+                                     void                 *usrdata));
+
 int fsif_add_factstore_entry(char *name,
                              fsif_field_t *fldlist)
 {
@@ -102,6 +109,14 @@ int fsif_destroy_factstore_entry(fsif_entry_t *fact)
     return destroy_factstore_entry(fact);
 }
 
+int fsif_add_fact_watch(char                 *factname,
+                        fsif_fact_watch_e     type,
+                        fsif_fact_watch_cb_t  callback,
+                        void                 *usrdata)
+{
+    return add_fact_watch(factname, type, callback, usrdata);
+}
+
 
 static void plugin_init(OhmPlugin *plugin)
 {
@@ -121,12 +136,15 @@ static void plugin_exit(OhmPlugin *plugin)
     (void)plugin;
 
     OHM_INFO("delay: exit ...");
+
+    timer_exit(plugin);
 }
 
 
 
 
 #include "request.c"
+#include "wheel.c"
 #include "timer.c"
 
 OHM_PLUGIN_PROVIDES_METHODS(delay, 2,
@@ -134,12 +152,13 @@ OHM_PLUGIN_PROVIDES_METHODS(delay, 2,
     OHM_EXPORT(delay_cancel   , "delay_cancel")
 );
 
-OHM_PLUGIN_REQUIRES_METHODS(delay, 5,
+OHM_PLUGIN_REQUIRES_METHODS(delay, 6,
     OHM_IMPORT("fsif.add_factstore_entry", add_factstore_entry),
     OHM_IMPORT("fsif.get_field_by_entry", get_field_by_entry),
     OHM_IMPORT("fsif.set_field_by_entry", set_field_by_entry),
     OHM_IMPORT("fsif.get_entry", get_entry),
-    OHM_IMPORT("fsif.destroy_factstore_entry", destroy_factstore_entry)
+    OHM_IMPORT("fsif.destroy_factstore_entry", destroy_factstore_entry),
+    OHM_IMPORT("fsif.add_fact_watch", add_fact_watch)
 );
 
 OHM_PLUGIN_DESCRIPTION("delay",
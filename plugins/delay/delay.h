@@ -53,6 +53,11 @@ fsif_entry_t * fsif_get_entry(char           *name,
 
 int fsif_destroy_factstore_entry(fsif_entry_t *fact);
 
+int fsif_add_fact_watch(char                 *factname,
+                        fsif_fact_watch_e     type,
+                        fsif_fact_watch_cb_t  callback,
+                        void                 *usrdata);
+
 
 #endif /* __OHM_DELAY_H__ */
 
@@ -23,14 +23,52 @@ static int build_fldlist(fsif_field_t *, char *, char *, unsigned int,
 static void calculate_expiration_time(unsigned int, char *,int);
 
 static unsigned int schedule_timer_event(char *, unsigned int);
-static void cancel_timer_event_by_srcid(unsigned int);
+static void cancel_timer_event(char *, unsigned int);
 static void cancel_timer_event_by_entry(fsif_entry_t *);
 static int  timer_event_cb(void *);
+static void timer_expired(wheel_timer_t *);
+static void timer_removed(fsif_entry_t *, char *, fsif_fact_watch_e, void *);
+static void timer_release(wheel_timer_t *);
+
+static int timer_wheel;                 /* whether the timer wheel is up */
+static int timer_cache;                 /* whether facts can be cached */
+static wheel_timer_t *timer_firing;     /* timer whose callback is running */
 
 
 static void timer_init(OhmPlugin *plugin)
+{
+    const char   *param;
+    char         *end;
+    unsigned int  slack;
+
+    slack = TIMER_SLACK_DEFAULT;
+
+    if ((param = ohm_plugin_get_param(plugin, "timer-slack")) != NULL) {
+        slack = (unsigned int)strtoul(param, &end, 10);
+
+        if (*end || !slack) {
+            OHM_ERROR("delay: invalid timer-slack '%s'", param);
+            slack = TIMER_SLACK_DEFAULT;
+        }
+    }
+
+    if (wheel_init(slack, timer_expired))
+        timer_wheel = TRUE;
+    else
+        OHM_ERROR("delay: failed to set up timer wheel, using GLib timeouts");
+
+    if (fsif_add_fact_watch(FACTSTORE_TIMER, fact_watch_remove,
+                            timer_removed, NULL) < 0)
+        OHM_WARNING("delay: failed to watch timer facts, not caching them");
+    else
+        timer_cache = TRUE;
+}
+
+static void timer_exit(OhmPlugin *plugin)
 {
     (void)plugin;
+
+    wheel_exit();
 }
 
 static int timer_add(char *id, unsigned int delay, char *cb_name,
@@ -55,7 +93,7 @@ static int timer_add(char *id, unsigned int delay, char *cb_name,
         if (!build_fldlist(fldlist, id, state, delay, srcid, cb_name, cb, argt, argv) ||
             !fsif_add_factstore_entry(FACTSTORE_TIMER, fldlist)               )
         {
-            cancel_timer_event_by_srcid(srcid);
+            cancel_timer_event(id, srcid);
             success = FALSE;            
         }
     }
@@ -108,18 +146,33 @@ static int timer_stop(fsif_entry_t *entry)
 
 static fsif_entry_t *timer_lookup(char *id)
 {
-    fsif_entry_t *fsentry;
-    fsif_field_t  selist[2];
+    wheel_timer_t *t;
+    fsif_entry_t  *fsentry;
+    fsif_field_t   selist[2];
 
     if (id == NULL)
         fsentry = NULL;
     else {
+        /*
+         * The fact of a known timer is cached in its wheel entry and
+         * dropped from there when the fact gets removed from the factstore
+         * (see timer_removed), so we only need to scan the factstore the
+         * first time a timer is looked up after (re)creating its fact.
+         */
+        t = timer_cache ? wheel_timer_lookup(id) : NULL;
+
+        if (t != NULL && t->data != NULL)
+            return (fsif_entry_t *)t->data;
+
         memset(selist, 0, sizeof(selist));
         selist[0].type = fldtype_string;
         selist[0].name = TIMER_ID;
         selist[0].value.string = id;
         
         fsentry = fsif_get_entry(FACTSTORE_TIMER, selist);
+
+        if (t != NULL)
+            t->data = fsentry;
     }
 
     return fsentry;
@@ -242,44 +295,61 @@ static int build_fldlist(fsif_field_t *fldlist, char *id, char *state,
 
 static void calculate_expiration_time(unsigned int delay, char *buf, int len)
 {
-    struct timeval  tv;
-    struct tm      *tm;
+    static time_t   last_sec = (time_t)-1;
+    static char     last_hms[16];
+    struct timespec ts;
+    struct tm       tm;
     uint64_t        now;
     uint64_t        exp;
     time_t          exp_sec;
     int             exp_ms;
 
-    gettimeofday(&tv, NULL);
-    now = (uint64_t)tv.tv_sec * 1000ULL  + (uint64_t)(tv.tv_usec / 1000);
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    now = (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)(ts.tv_nsec / 1000000);
     exp = now + (uint64_t)delay;
 
     exp_sec = exp / 1000ULL;
     exp_ms  = exp % 1000ULL;
 
-    tm = gmtime(&exp_sec);
+    /* timers are typically started in bursts, reuse the last conversion */
+    if (exp_sec != last_sec) {
+        gmtime_r(&exp_sec, &tm);
+        snprintf(last_hms, sizeof(last_hms), "%2d:%02d:%02d",
+                 tm.tm_hour, tm.tm_min, tm.tm_sec);
+        last_sec = exp_sec;
+    }
 
-    snprintf(buf, len, "%2d:%02d:%02d.%03d",
-             tm->tm_hour, tm->tm_min, tm->tm_sec, exp_ms);
+    snprintf(buf, len, "%s.%03d", last_hms, exp_ms);
 }
 
 
 static unsigned int schedule_timer_event(char *id, unsigned int delay)
 {
-    gpointer      data;
-    unsigned int  srcid;
+    wheel_timer_t *t;
+    gpointer       data;
+    unsigned int   srcid;
 
-    if (id == NULL) 
+    if (id == NULL)
         srcid = 0;
-    else {
-        data = strdup(id);
-
-        if (!delay)
+    else if (!delay || !timer_wheel) {
+        /*
+         * An immediate event should run as soon as the main loop is idle,
+         * not on the next wheel tick. Without a wheel everything falls back
+         * to GLib timeouts.
+         */
+        if ((data = strdup(id)) == NULL)
+            srcid = 0;
+        else if (!delay)
             srcid = g_idle_add_full(G_PRIORITY_HIGH, timer_event_cb,data,free);
         else {
             srcid = g_timeout_add_full(G_PRIORITY_HIGH, delay,
                                        timer_event_cb, data, free);
         }
     }
+    else if ((t = wheel_timer_create(id)) == NULL)
+        srcid = 0;
+    else
+        srcid = wheel_timer_start(t, delay);
 
     if (srcid) {
         OHM_DEBUG(DBG_EVENT, "sheduled event with %s=%u (id=%s)",
@@ -292,32 +362,92 @@ static unsigned int schedule_timer_event(char *id, unsigned int delay)
     return srcid;
 }
 
-static void cancel_timer_event_by_srcid(unsigned int srcid)
+static void cancel_timer_event(char *id, unsigned int srcid)
 {
-    if (srcid != 0) {
-        if (g_source_remove(srcid))
-            OHM_DEBUG(DBG_EVENT, "event with %s=%u removed",
-                      TIMER_SRCID, srcid);
-        else
-            OHM_DEBUG(DBG_EVENT, "Failed to remove event with %s=%u",
-                      TIMER_SRCID, srcid);
+    wheel_timer_t *t;
+
+    if (srcid == 0) {
+        OHM_DEBUG(DBG_EVENT, "no pending event to remove (id=%s)",
+                  id ? id : "<null>");
+        return;
+    }
+
+    /* a pending wheel timer owns the srcid, otherwise it is a GLib source */
+    if ((t = wheel_timer_lookup(id)) != NULL && t->seqno == srcid) {
+        OHM_DEBUG(DBG_EVENT, "event with %s=%u removed (id=%s)",
+                  TIMER_SRCID, srcid, id);
+        wheel_timer_stop(t);
+        timer_release(t);
     }
+    else if (g_source_remove(srcid))
+        OHM_DEBUG(DBG_EVENT, "event with %s=%u removed",
+                  TIMER_SRCID, srcid);
+    else
+        OHM_DEBUG(DBG_EVENT, "Failed to remove event with %s=%u",
+                  TIMER_SRCID, srcid);
 }
 
 static void cancel_timer_event_by_entry(fsif_entry_t *entry)
 {
     fsif_value_t stopped;
+    fsif_value_t id;
     fsif_value_t srcid;
 
     if (timer_active(entry)) {
+        fsif_get_field_by_entry(entry, fldtype_string, TIMER_ID, &id);
         fsif_get_field_by_entry(entry, fldtype_unsignd, TIMER_SRCID, &srcid);
-        cancel_timer_event_by_srcid(srcid.unsignd);
+        cancel_timer_event(id.string, srcid.unsignd);
         stopped.string = "stopped";
         fsif_set_field_by_entry(entry, fldtype_string, TIMER_STATE, &stopped);
     }
 }
 
 
+static void timer_expired(wheel_timer_t *t)
+{
+    timer_firing = t;
+    timer_event_cb(t->id);
+    timer_firing = NULL;
+
+    timer_release(t);
+}
+
+static void timer_removed(fsif_entry_t *entry, char *name,
+                          fsif_fact_watch_e type, void *data)
+{
+    wheel_timer_t *t;
+    fsif_value_t   id;
+
+    (void)name;
+    (void)data;
+
+    if (type != fact_watch_remove)
+        return;
+
+    fsif_get_field_by_entry(entry, fldtype_string, TIMER_ID, &id);
+
+    if ((t = wheel_timer_lookup(id.string)) != NULL && t->data == entry) {
+        t->data = NULL;
+        timer_release(t);
+    }
+}
+
+/*
+ * Drop the wheel entry of a timer once it is neither pending nor caching
+ * the fact of the timer. The entry of a timer whose callback is running
+ * is left alone until the callback has returned.
+ */
+static void timer_release(wheel_timer_t *t)
+{
+    if (t == NULL || t == timer_firing || t->seqno || t->data != NULL)
+        return;
+
+    OHM_DEBUG(DBG_EVENT, "releasing timer '%s'", t->id);
+
+    wheel_timer_destroy(t);
+}
+
+
 static int timer_event_cb(void *data)
 {
 #define MAX_ARG 64
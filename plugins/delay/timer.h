@@ -35,7 +35,10 @@ USA.
 #define TIMER_ARGC      "argc"
 #define TIMER_ARGV      "argv%lu"
 
+#define TIMER_SLACK_DEFAULT  1          /* default timer slack in msec */
+
 static void          timer_init(OhmPlugin *);
+static void          timer_exit(OhmPlugin *);
 static int           timer_add(char *, unsigned int, char *,
                                delay_cb_t, char *, void **);
 static int           timer_restart(fsif_entry_t *, unsigned int, char *,
@@ -0,0 +1,246 @@
+/*
+ *  gcc -Wall `pkg-config --cflags glib-2.0` \
+ *      wheel-bench.c -o wheel-bench `pkg-config --libs glib-2.0`
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include <glib.h>
+
+#define OHM_INFO(fmt, args...)    printf("I: "fmt"\n" , ## args)
+#define OHM_WARNING(fmt, args...) printf("W: "fmt"\n" , ## args)
+#define OHM_ERROR(fmt, args...)   printf("E: "fmt"\n" , ## args)
+
+#define OHM_DEBUG(flag, fmt, args...) do {      \
+        if (flag)                               \
+            printf("D: "fmt"\n" , ## args);     \
+    } while (0)
+
+static int DBG_TIMER, DBG_EVENT;
+
+#include "wheel.h"
+#include "wheel.c"
+
+
+#define DEFAULT_TIMERS  10000
+#define DEFAULT_SPREAD  2000                  /* max. timer delay in msec */
+
+typedef struct {
+    char         id[32];
+    unsigned int delay;
+    uint64_t     due;                         /* expected expiry (usec) */
+    guint        srcid;                       /* for the GLib baseline */
+} bench_timer_t;
+
+static bench_timer_t *timers;
+static int            ntimer;
+static int            nleft;
+static uint64_t       late_sum;
+static uint64_t       late_max;
+static GMainLoop     *loop;
+
+
+static uint64_t usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
+static void account(bench_timer_t *bt)
+{
+    uint64_t now  = usecs();
+    uint64_t late = now > bt->due ? now - bt->due : 0;
+
+    late_sum += late;
+    if (late > late_max)
+        late_max = late;
+
+    if (--nleft == 0)
+        g_main_loop_quit(loop);
+}
+
+
+static void report(const char *what, uint64_t start, uint64_t restart,
+                   uint64_t stop)
+{
+    printf("%-6s %d timers: start %.3f ms, restart %.3f ms, stop %.3f ms, "
+           "avg. lateness %.3f ms, max. lateness %.3f ms\n", what, ntimer,
+           start / 1000.0, restart / 1000.0, stop / 1000.0,
+           ntimer ? late_sum / 1000.0 / ntimer : 0.0, late_max / 1000.0);
+}
+
+
+/********************
+ * timer wheel
+ ********************/
+static void wheel_expired(wheel_timer_t *t)
+{
+    account((bench_timer_t *)t->data);
+}
+
+
+static void bench_wheel(unsigned int slack)
+{
+    wheel_timer_t *t;
+    uint64_t       t0, start, restart, stop;
+    int            i;
+
+    if (!wheel_init(slack, wheel_expired))
+        exit(1);
+
+    t0 = usecs();
+    for (i = 0; i < ntimer; i++) {
+        t = wheel_timer_create(timers[i].id);
+        t->data = timers + i;
+        wheel_timer_start(t, timers[i].delay);
+    }
+    start = usecs() - t0;
+
+    t0 = usecs();
+    for (i = 0; i < ntimer; i++) {
+        t = wheel_timer_lookup(timers[i].id);
+        wheel_timer_start(t, timers[i].delay);
+        timers[i].due = t0 + timers[i].delay * 1000ULL;
+    }
+    restart = usecs() - t0;
+
+    nleft    = ntimer;
+    late_sum = late_max = 0;
+    g_main_loop_run(loop);
+
+    for (i = 0; i < ntimer; i++)
+        wheel_timer_start(wheel_timer_lookup(timers[i].id), timers[i].delay);
+
+    t0 = usecs();
+    for (i = 0; i < ntimer; i++)
+        wheel_timer_stop(wheel_timer_lookup(timers[i].id));
+    stop = usecs() - t0;
+
+    for (i = 0; i < ntimer; i++)
+        wheel_timer_destroy(wheel_timer_lookup(timers[i].id));
+
+    if (g_hash_table_size(wheel.timers) != 0) {
+        fprintf(stderr, "timers left after destroying them\n");
+        exit(1);
+    }
+
+    wheel_exit();
+
+    report("wheel", start, restart, stop);
+}
+
+
+/********************
+ * GLib baseline
+ ********************/
+static gboolean glib_expired(gpointer data)
+{
+    bench_timer_t *bt = (bench_timer_t *)data;
+
+    bt->srcid = 0;
+    account(bt);
+
+    return FALSE;
+}
+
+
+static guint glib_start(bench_timer_t *bt)
+{
+    if (bt->delay == 0)
+        return g_idle_add_full(G_PRIORITY_HIGH, glib_expired, bt, NULL);
+    else
+        return g_timeout_add_full(G_PRIORITY_HIGH, bt->delay,
+                                  glib_expired, bt, NULL);
+}
+
+
+static void bench_glib(void)
+{
+    GHashTable    *hash;
+    bench_timer_t *bt;
+    uint64_t       t0, start, restart, stop;
+    int            i;
+
+    hash = g_hash_table_new(g_str_hash, g_str_equal);
+
+    t0 = usecs();
+    for (i = 0; i < ntimer; i++) {
+        g_hash_table_insert(hash, timers[i].id, timers + i);
+        timers[i].srcid = glib_start(timers + i);
+    }
+    start = usecs() - t0;
+
+    t0 = usecs();
+    for (i = 0; i < ntimer; i++) {
+        bt = g_hash_table_lookup(hash, timers[i].id);
+        g_source_remove(bt->srcid);
+        bt->srcid = glib_start(bt);
+        bt->due   = t0 + bt->delay * 1000ULL;
+    }
+    restart = usecs() - t0;
+
+    nleft    = ntimer;
+    late_sum = late_max = 0;
+    g_main_loop_run(loop);
+
+    for (i = 0; i < ntimer; i++)
+        timers[i].srcid = glib_start(timers + i);
+
+    t0 = usecs();
+    for (i = 0; i < ntimer; i++) {
+        bt = g_hash_table_lookup(hash, timers[i].id);
+        g_source_remove(bt->srcid);
+        bt->srcid = 0;
+    }
+    stop = usecs() - t0;
+
+    g_hash_table_destroy(hash);
+
+    report("glib", start, restart, stop);
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int spread, slack;
+    int          i;
+
+    ntimer = argc > 1 ? atoi(argv[1]) : DEFAULT_TIMERS;
+    spread = argc > 2 ? (unsigned int)atoi(argv[2]) : DEFAULT_SPREAD;
+    slack  = argc > 3 ? (unsigned int)atoi(argv[3]) : 1;
+
+    if (ntimer <= 0 || spread == 0) {
+        printf("usage: %s [timers [max-delay-msec [slack-msec]]]\n", argv[0]);
+        exit(1);
+    }
+
+    if ((timers = calloc(ntimer, sizeof(*timers))) == NULL)
+        exit(1);
+
+    srand(ntimer);
+
+    for (i = 0; i < ntimer; i++) {
+        snprintf(timers[i].id, sizeof(timers[i].id), "timer-%d", i);
+        timers[i].delay = rand() % spread;
+    }
+
+    loop = g_main_loop_new(NULL, FALSE);
+
+    bench_wheel(slack);
+    bench_glib();
+
+    g_main_loop_unref(loop);
+    free(timers);
+
+    return 0;
+}
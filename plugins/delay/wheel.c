@@ -0,0 +1,530 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/*
+ * A hierarchical timing wheel driving all delay timers from a single
+ * timerfd. Level 0 has one slot per tick, each further level has
+ * WHEEL_SIZE times coarser slots. Timers are hashed into the level their
+ * remaining time falls into and cascaded down as the wheel advances. The
+ * timerfd is always armed for the next tick that needs processing, which
+ * is found from the per-level slot occupancy bitmaps. Timers expiring
+ * within the same tick (the slack) are dispatched together.
+ */
+
+static wheel_t wheel = { .fd = -1 };
+
+static void     wheel_advance(uint64_t);
+static void     wheel_arm(void);
+static gboolean wheel_dispatch(GIOChannel *, GIOCondition, gpointer);
+static void     wheel_timer_free(gpointer);
+
+
+static int wheel_init(unsigned int tick, wheel_cb_t expired)
+{
+    int l, s;
+
+    wheel.tick    = tick ? tick : 1;
+    wheel.expired = expired;
+
+    for (l = 0;  l < WHEEL_LEVELS;  l++) {
+        for (s = 0;  s < WHEEL_SIZE;  s++) {
+            wheel.slots[l][s].next = (wheel_timer_t *)&wheel.slots[l][s];
+            wheel.slots[l][s].prev = (wheel_timer_t *)&wheel.slots[l][s];
+        }
+    }
+
+    memset(wheel.busy, 0, sizeof(wheel.busy));
+
+    clock_gettime(CLOCK_MONOTONIC, &wheel.epoch);
+
+    wheel.timers = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         NULL, wheel_timer_free);
+    if (wheel.timers == NULL)
+        goto failed;
+
+    wheel.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (wheel.fd < 0) {
+        OHM_ERROR("delay: failed to create timerfd (%d: %s)",
+                  errno, strerror(errno));
+        goto failed;
+    }
+
+    if ((wheel.chan = g_io_channel_unix_new(wheel.fd)) == NULL)
+        goto failed;
+
+    wheel.evsrc = g_io_add_watch_full(wheel.chan, G_PRIORITY_HIGH, G_IO_IN,
+                                      wheel_dispatch, NULL, NULL);
+    if (!wheel.evsrc)
+        goto failed;
+
+    OHM_DEBUG(DBG_TIMER, "timer wheel with %u msec ticks", wheel.tick);
+
+    return TRUE;
+
+ failed:
+    wheel_exit();
+    return FALSE;
+}
+
+
+static void wheel_exit(void)
+{
+    if (wheel.evsrc) {
+        g_source_remove(wheel.evsrc);
+        wheel.evsrc = 0;
+    }
+
+    if (wheel.chan != NULL) {
+        g_io_channel_unref(wheel.chan);
+        wheel.chan = NULL;
+    }
+
+    if (wheel.fd >= 0) {
+        close(wheel.fd);
+        wheel.fd = -1;
+    }
+
+    if (wheel.timers != NULL) {
+        g_hash_table_destroy(wheel.timers);
+        wheel.timers = NULL;
+    }
+
+    wheel.npending = 0;
+    wheel.armed    = 0;
+}
+
+
+/********************
+ * wheel_timer_lookup
+ ********************/
+static wheel_timer_t *wheel_timer_lookup(const char *id)
+{
+    if (id == NULL || wheel.timers == NULL)
+        return NULL;
+
+    return g_hash_table_lookup(wheel.timers, id);
+}
+
+
+/********************
+ * wheel_timer_create
+ ********************/
+static wheel_timer_t *wheel_timer_create(const char *id)
+{
+    wheel_timer_t *t;
+
+    if (id == NULL || wheel.timers == NULL)
+        return NULL;
+
+    if ((t = wheel_timer_lookup(id)) != NULL)
+        return t;
+
+    if ((t = calloc(1, sizeof(*t))) == NULL)
+        return NULL;
+
+    if ((t->id = strdup(id)) == NULL) {
+        free(t);
+        return NULL;
+    }
+
+    t->level = -1;
+
+    g_hash_table_insert(wheel.timers, t->id, t);
+
+    return t;
+}
+
+
+static void wheel_timer_free(gpointer data)
+{
+    wheel_timer_t *t = (wheel_timer_t *)data;
+
+    if (t != NULL) {
+        free(t->id);
+        free(t);
+    }
+}
+
+
+/********************
+ * wheel helpers
+ ********************/
+static inline uint64_t wheel_msec(void)
+{
+    struct timespec ts;
+    int64_t         ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    ms  = (int64_t)(ts.tv_sec - wheel.epoch.tv_sec) * 1000;
+    ms += (ts.tv_nsec - wheel.epoch.tv_nsec) / 1000000;
+
+    return ms > 0 ? (uint64_t)ms : 0;
+}
+
+
+static inline void wheel_set_busy(int level, int slot)
+{
+    wheel.busy[level][slot / 64] |= (1ULL << (slot % 64));
+}
+
+
+static inline void wheel_clear_busy(int level, int slot)
+{
+    wheel.busy[level][slot / 64] &= ~(1ULL << (slot % 64));
+}
+
+
+static inline int wheel_level_empty(int level)
+{
+    int w;
+
+    for (w = 0;  w < WHEEL_WORDS;  w++)
+        if (wheel.busy[level][w])
+            return FALSE;
+
+    return TRUE;
+}
+
+
+static void wheel_unlink(wheel_timer_t *t)
+{
+    wheel_list_t *slot;
+
+    if (t->next == NULL)
+        return;
+
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+
+    if (t->level >= 0) {
+        slot = &wheel.slots[t->level][t->slot];
+
+        if (slot->next == (wheel_timer_t *)slot)
+            wheel_clear_busy(t->level, t->slot);
+
+        t->level = -1;
+    }
+}
+
+
+/*
+ * Hash a timer into the wheel relative to wheel.now. The caller must make
+ * sure the timer does not expire before wheel.now.
+ */
+static void wheel_insert(wheel_timer_t *t)
+{
+    wheel_list_t *slot;
+    uint64_t      delta;
+    int           level, idx;
+
+    delta = t->expire - wheel.now;
+
+    for (level = 0;  level < WHEEL_LEVELS - 1;  level++)
+        if (delta < (1ULL << (WHEEL_BITS * (level + 1))))
+            break;
+
+    if (delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS)))
+        t->expire = wheel.now + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+
+    idx  = (t->expire >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    slot = &wheel.slots[level][idx];
+
+    t->next = (wheel_timer_t *)slot;
+    t->prev = slot->prev;
+    slot->prev->next = t;
+    slot->prev = t;
+
+    t->level = level;
+    t->slot  = idx;
+
+    wheel_set_busy(level, idx);
+}
+
+
+static void wheel_detach(int level, int idx, wheel_list_t *list)
+{
+    wheel_list_t  *slot = &wheel.slots[level][idx];
+    wheel_timer_t *t;
+
+    if (slot->next == (wheel_timer_t *)slot) {
+        list->next = list->prev = (wheel_timer_t *)list;
+        return;
+    }
+
+    list->next = slot->next;
+    list->prev = slot->prev;
+    list->next->prev = (wheel_timer_t *)list;
+    list->prev->next = (wheel_timer_t *)list;
+
+    slot->next = slot->prev = (wheel_timer_t *)slot;
+    wheel_clear_busy(level, idx);
+
+    for (t = list->next;  t != (wheel_timer_t *)list;  t = t->next)
+        t->level = -1;
+}
+
+
+/*
+ * Return the distance (1 ... WHEEL_SIZE) to the next busy slot after pos
+ * on the given level, or 0 if the level is empty.
+ */
+static int wheel_next_busy(int level, int pos)
+{
+    uint64_t bits;
+    int      k, idx;
+
+    if (wheel_level_empty(level))
+        return 0;
+
+    for (k = 1;  k <= WHEEL_SIZE;  k++) {
+        idx  = (pos + k) & WHEEL_MASK;
+        bits = wheel.busy[level][idx / 64] >> (idx % 64);
+
+        if (bits == 0) {
+            k += 63 - (idx % 64);
+            continue;
+        }
+
+        k += __builtin_ctzll(bits);
+
+        return k <= WHEEL_SIZE ? k : 0;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Return the next tick after wheel.now that needs processing, ie. either
+ * expires timers or cascades a higher level slot, or 0 if there is none.
+ */
+static uint64_t wheel_next_event(void)
+{
+    uint64_t next, tick;
+    int      level, shift, k;
+
+    if (wheel.npending == 0)
+        return 0;
+
+    next = 0;
+
+    for (level = 0;  level < WHEEL_LEVELS;  level++) {
+        shift = WHEEL_BITS * level;
+
+        if ((k = wheel_next_busy(level, (wheel.now >> shift) & WHEEL_MASK)))  {
+            tick = ((wheel.now >> shift) + k) << shift;
+
+            if (next == 0 || tick < next)
+                next = tick;
+        }
+    }
+
+    return next;
+}
+
+
+static void wheel_cascade(uint64_t tick)
+{
+    wheel_list_t   list;
+    wheel_timer_t *t;
+    int            level, idx;
+
+    for (level = 1;  level < WHEEL_LEVELS;  level++) {
+        idx = (tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+        wheel_detach(level, idx, &list);
+
+        while (list.next != (wheel_timer_t *)&list) {
+            t = list.next;
+            wheel_unlink(t);
+            wheel_insert(t);
+        }
+
+        if (idx != 0)
+            break;
+    }
+}
+
+
+static void wheel_advance(uint64_t target)
+{
+    wheel_list_t   due;
+    wheel_timer_t *t;
+    uint64_t       next;
+    int            n;
+
+    while ((next = wheel_next_event()) != 0 && next <= target) {
+        wheel.now = next;
+
+        if ((next & WHEEL_MASK) == 0)
+            wheel_cascade(next);
+
+        wheel_detach(0, next & WHEEL_MASK, &due);
+
+        for (n = 0;  due.next != (wheel_timer_t *)&due;  n++) {
+            t = due.next;
+            wheel_unlink(t);
+
+            t->seqno = 0;
+            wheel.npending--;
+
+            wheel.expired(t);
+        }
+
+        if (n > 0)
+            OHM_DEBUG(DBG_EVENT, "%d timer(s) expired at tick %llu", n,
+                      (unsigned long long)next);
+    }
+
+    if (target > wheel.now)
+        wheel.now = target;
+}
+
+
+static void wheel_arm(void)
+{
+    struct itimerspec it;
+    uint64_t          next, ms;
+
+    next = wheel_next_event();
+
+    if (next == wheel.armed || wheel.fd < 0)
+        return;
+
+    memset(&it, 0, sizeof(it));
+
+    if (next != 0) {
+        ms = next * wheel.tick;
+
+        it.it_value.tv_sec  = wheel.epoch.tv_sec + ms / 1000;
+        it.it_value.tv_nsec = wheel.epoch.tv_nsec + (ms % 1000) * 1000000;
+
+        if (it.it_value.tv_nsec >= 1000000000) {
+            it.it_value.tv_sec  += 1;
+            it.it_value.tv_nsec -= 1000000000;
+        }
+    }
+
+    if (timerfd_settime(wheel.fd, TFD_TIMER_ABSTIME, &it, NULL) < 0) {
+        OHM_ERROR("delay: failed to arm timerfd (%d: %s)",
+                  errno, strerror(errno));
+        wheel.armed = 0;
+    }
+    else
+        wheel.armed = next;
+}
+
+
+static gboolean wheel_dispatch(GIOChannel *chan, GIOCondition cond,
+                               gpointer data)
+{
+    uint64_t nexp;
+
+    (void)chan;
+    (void)cond;
+    (void)data;
+
+    while (read(wheel.fd, &nexp, sizeof(nexp)) < 0 && errno == EINTR)
+        ;
+
+    wheel.armed = 0;
+
+    wheel_advance(wheel_msec() / wheel.tick);
+    wheel_arm();
+
+    return TRUE;
+}
+
+
+/********************
+ * wheel_timer_start
+ ********************/
+static unsigned int wheel_timer_start(wheel_timer_t *t, unsigned int delay)
+{
+    uint64_t now;
+
+    if (t == NULL || wheel.timers == NULL)
+        return 0;
+
+    wheel_timer_stop(t);
+
+    now = wheel_msec();
+
+    if (wheel.npending == 0)
+        wheel.now = now / wheel.tick;
+
+    t->expire = (now + delay + wheel.tick - 1) / wheel.tick;
+
+    if (t->expire <= wheel.now)
+        t->expire = wheel.now + 1;
+
+    if (++wheel.seqno == 0)
+        wheel.seqno = 1;
+
+    t->seqno = wheel.seqno;
+
+    wheel_insert(t);
+    wheel.npending++;
+
+    wheel_arm();
+
+    return t->seqno;
+}
+
+
+/********************
+ * wheel_timer_stop
+ ********************/
+static void wheel_timer_stop(wheel_timer_t *t)
+{
+    if (t == NULL || !t->seqno)
+        return;
+
+    wheel_unlink(t);
+
+    t->seqno = 0;
+    wheel.npending--;
+}
+
+
+/********************
+ * wheel_timer_destroy
+ ********************/
+static void wheel_timer_destroy(wheel_timer_t *t)
+{
+    if (t == NULL || wheel.timers == NULL)
+        return;
+
+    wheel_timer_stop(t);
+
+    g_hash_table_remove(wheel.timers, t->id);
+}
+
+
+/* 
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
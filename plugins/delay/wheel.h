@@ -0,0 +1,88 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+
+#ifndef __OHM_DELAY_WHEEL_H__
+#define __OHM_DELAY_WHEEL_H__
+
+#include <time.h>
+#include <stdint.h>
+
+#define WHEEL_BITS    8                       /* log2 of slots per level */
+#define WHEEL_SIZE    (1 << WHEEL_BITS)       /* slots per level */
+#define WHEEL_MASK    (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS  4                       /* 2^32 ticks of range */
+#define WHEEL_WORDS   (WHEEL_SIZE / 64)       /* occupancy bitmap words */
+
+typedef struct wheel_timer_s wheel_timer_t;
+
+typedef void (*wheel_cb_t)(wheel_timer_t *);
+
+struct wheel_timer_s {
+    wheel_timer_t *next;                      /* slot list hook, must be */
+    wheel_timer_t *prev;                      /*   the first two fields */
+    char          *id;                        /* timer id */
+    uint64_t       expire;                    /* expiration tick */
+    unsigned int   seqno;                     /* nonzero while pending */
+    int            level;                     /* level or -1 if detached */
+    int            slot;                      /* slot within level */
+    void          *data;                      /* opaque user data */
+};
+
+typedef struct {
+    wheel_timer_t *next;
+    wheel_timer_t *prev;
+} wheel_list_t;
+
+typedef struct {
+    int             fd;                       /* timerfd driving the wheel */
+    GIOChannel     *chan;
+    guint           evsrc;
+    unsigned int    tick;                     /* tick length (slack) in msec */
+    struct timespec epoch;                    /* wheel start time */
+    uint64_t        now;                      /* last processed tick */
+    uint64_t        armed;                    /* tick timerfd is armed for */
+    unsigned int    npending;                 /* number of pending timers */
+    unsigned int    seqno;                    /* last handed out seqno */
+    GHashTable     *timers;                   /* timers by id */
+    wheel_cb_t      expired;                  /* expiration notifier */
+    wheel_list_t    slots[WHEEL_LEVELS][WHEEL_SIZE];
+    uint64_t        busy[WHEEL_LEVELS][WHEEL_WORDS];
+} wheel_t;
+
+
+static int            wheel_init(unsigned int, wheel_cb_t);
+static void           wheel_exit(void);
+static wheel_timer_t *wheel_timer_lookup(const char *);
+static wheel_timer_t *wheel_timer_create(const char *);
+static unsigned int   wheel_timer_start(wheel_timer_t *, unsigned int);
+static void           wheel_timer_stop(wheel_timer_t *);
+static void           wheel_timer_destroy(wheel_timer_t *);
+
+
+#endif /* __OHM_DELAY_WHEEL_H__ */
+
+/* 
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -31,9 +31,38 @@ typedef union
 } DBusBasicValue;
 
 
+/* a field name - value pair of a bulk request */
+typedef struct {
+	const gchar	*name;
+	GValue		*value;
+} field_value_t;
+
+/* a queued field change for subscribers */
+typedef struct {
+	GQuark		fact;
+	GQuark		field;
+	GValue		value;
+} fact_change_t;
+
+
 static int DBG_FACTTOOL;
 static OhmFactStore *store;
 
+/*
+ * Subscriptions: clients subscribe to changes of facts by name and get
+ * the field changes streamed in factschanged signals, batched per main
+ * loop iteration. Subscriptions of a client are dropped when it leaves
+ * the bus.
+ */
+static GHashTable	*subscribers;	/* unique name -> set of fact names */
+static GHashTable	*subscribed;	/* fact name -> number of subscribers */
+static GQueue		 changes = G_QUEUE_INIT;
+static guint		 changes_idle;
+static DBusConnection	*signal_conn;
+static gulong		 fs_signals[2];
+
+static void unsubscribe_all(void);
+
 
 OHM_DEBUG_PLUGIN(facttool,
 	OHM_DEBUG_FLAG("facttool", "facttool module"          , &DBG_FACTTOOL)
@@ -50,6 +79,10 @@ static void plugin_init(OhmPlugin *plugin)
 		OHM_ERROR("facttool: Failed to initialize factstore.");
 	}
 
+	subscribers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					    (GDestroyNotify)g_hash_table_destroy);
+	subscribed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
 	OHM_INFO("facttool: init done");
 }
 
@@ -58,6 +91,12 @@ static void plugin_exit(OhmPlugin *plugin)
 {
 	(void)plugin;
 
+	unsubscribe_all();
+
+	g_hash_table_destroy(subscribers);
+	g_hash_table_destroy(subscribed);
+	subscribers = subscribed = NULL;
+
 	OHM_INFO("facttool: exit");
 }
 
@@ -125,78 +164,113 @@ static int is_handled_type(int dbus_type)
 }
 
 
-static int map_to_dbus_type(GValue *gval, gchar *sig, void **value)
+/* Map a fact field value to a D-Bus basic value, without copying it. */
+static const char *value_to_dbus(GValue *gval, int *type, DBusBasicValue *value)
 {
-	int retval;
-	gulong ul, *pul;
-	glong l, *pl;
-	gdouble d, *pd;
-
-	*sig = '?';
-	if (!G_IS_VALUE(gval)) {
-		return DBUS_TYPE_INVALID;
-	}
+	if (gval == NULL || !G_IS_VALUE(gval))
+		return NULL;
 
 	switch(G_VALUE_TYPE(gval)) {
 	case G_TYPE_STRING:
-		*sig = 's';
-		*value = (void *) g_strdup(g_value_get_string(gval));
-		retval = DBUS_TYPE_STRING;
-		break;
+		*type = DBUS_TYPE_STRING;
+		value->str = (char *)g_value_get_string(gval);
+		if (value->str == NULL)
+			value->str = "";
+		return "s";
 	case G_TYPE_INT:
-		*sig = 'i';
-		l = g_value_get_int(gval);
-		pl = g_malloc(sizeof(glong));
-		*pl = l;
-		*value = pl;
-		retval = DBUS_TYPE_INT32;
-		break;
+		*type = DBUS_TYPE_INT32;
+		value->i32 = g_value_get_int(gval);
+		return "i";
 	case G_TYPE_UINT:
-		*sig = 'u';
-		ul = g_value_get_uint(gval);
-		pul = g_malloc(sizeof(gulong));
-		*pul = ul;
-		*value = pul;
-		retval = DBUS_TYPE_UINT32;
-		break;
+		*type = DBUS_TYPE_UINT32;
+		value->u32 = g_value_get_uint(gval);
+		return "u";
 	case G_TYPE_LONG:
-		*sig = 'i';
-		l = g_value_get_long(gval);
-		pl = g_malloc(sizeof(glong));
-		*pl = l;
-		*value = pl;
-		retval = DBUS_TYPE_INT32;
-		break;
+		*type = DBUS_TYPE_INT32;
+		value->i32 = g_value_get_long(gval);
+		return "i";
 	case G_TYPE_ULONG:
-		*sig = 'u';
-		ul = g_value_get_ulong(gval);
-		pul = g_malloc(sizeof(gulong));
-		*pul = ul;
-		*value = pul;
-		retval = DBUS_TYPE_UINT32;
-		break;
+		*type = DBUS_TYPE_UINT32;
+		value->u32 = g_value_get_ulong(gval);
+		return "u";
 	case G_TYPE_FLOAT:
-		*sig = 'd';
-		d = g_value_get_float(gval);
-		pd = g_malloc(sizeof(gdouble));
-		*pd = d;
-		*value = pd;
-		retval = DBUS_TYPE_DOUBLE;
-		break;
+		*type = DBUS_TYPE_DOUBLE;
+		value->dbl = g_value_get_float(gval);
+		return "d";
 	case G_TYPE_DOUBLE:
-		*sig = 'd';
-		d = g_value_get_double(gval);
-		pd = g_malloc(sizeof(gdouble));
-		*pd = d;
-		*value = pd;
-		retval = DBUS_TYPE_DOUBLE;
-		break;
+		*type = DBUS_TYPE_DOUBLE;
+		value->dbl = g_value_get_double(gval);
+		return "d";
 	default:
-		retval = DBUS_TYPE_INVALID;
-		break;
+		return NULL;
+	}
+}
+
+/* Append a field as (sv). Returns FALSE for unhandled values, -1 on error. */
+static int append_field(DBusMessageIter *it, const gchar *name, GValue *gval)
+{
+	DBusMessageIter	struct_it;
+	DBusMessageIter	variant_it;
+	DBusBasicValue	value;
+	const char	*sig;
+	int		type;
+
+	if ((sig = value_to_dbus(gval, &type, &value)) == NULL)
+		return FALSE;
+
+	if (!dbus_message_iter_open_container(it, DBUS_TYPE_STRUCT, NULL, &struct_it) ||
+	    !dbus_message_iter_append_basic(&struct_it, DBUS_TYPE_STRING, &name) ||
+	    !dbus_message_iter_open_container(&struct_it, DBUS_TYPE_VARIANT, sig, &variant_it) ||
+	    !dbus_message_iter_append_basic(&variant_it, type, &value) ||
+	    !dbus_message_iter_close_container(&struct_it, &variant_it) ||
+	    !dbus_message_iter_close_container(it, &struct_it))
+		return -1;
+
+	return TRUE;
+}
+
+/* Append a fact as a(sv), all fields or the given ones only. */
+static int append_fact(DBusMessageIter *it, OhmFact *fact, char **fields, int n_fields)
+{
+	DBusMessageIter	fields_it;
+	GSList		*l;
+	const gchar	*field_name;
+	int		i;
+
+	if (!dbus_message_iter_open_container(it, DBUS_TYPE_ARRAY, "(sv)", &fields_it)) {
+		OHM_ERROR("%s: error opening container", __FUNCTION__);
+		return -1;
+	}
+
+	if (n_fields > 0) {
+		for (i = 0; i < n_fields; i++) {
+			GValue *gval = ohm_fact_get(fact, fields[i]);
+
+			if (gval != NULL && append_field(&fields_it, fields[i], gval) < 0)
+				goto fail;
+		}
+	} else {
+		for (l = ohm_fact_get_fields(fact); l != NULL; l = g_slist_next(l)) {
+			GQuark qfield = (GQuark)GPOINTER_TO_INT(l->data);
+			int    status;
+
+			field_name = g_quark_to_string(qfield);
+			status = append_field(&fields_it, field_name, ohm_fact_get(fact, field_name));
+
+			if (status < 0)
+				goto fail;
+			if (status == FALSE)
+				OHM_WARNING("%s: ignoring invalid field %s", __FUNCTION__, field_name);
+		}
 	}
 
-	return retval;
+	if (!dbus_message_iter_close_container(it, &fields_it))
+		goto fail;
+
+	return 0;
+fail:
+	OHM_ERROR("%s: error appending OhmFact field", __FUNCTION__);
+	return -1;
 }
 
 /* Eat ssv from a dbus message, plus a(sv) if present
@@ -416,7 +490,6 @@ static DBusHandlerResult facttool_getfact(DBusConnection * c, DBusMessage * msg,
 	const gchar 	*name = NULL;
 	DBusMessageIter	rep_it;
 	DBusMessageIter	fact_it;
-	DBusMessageIter	fields_it;
 	DBusMessage	*reply;
 	int		n;
 	GSList		*fact_list;
@@ -446,64 +519,8 @@ static DBusHandlerResult facttool_getfact(DBusConnection * c, DBusMessage * msg,
 		goto end;
 	}
 	while (fact_list != NULL) {
-		GSList	*fields = NULL;
-		OhmFact	*fact;
-
-		if (!dbus_message_iter_open_container(&fact_it, DBUS_TYPE_ARRAY, "(sv)", &fields_it)) {
-			OHM_ERROR("%s: error opening container", __FUNCTION__);
+		if (append_fact(&fact_it, (OhmFact *)fact_list->data, NULL, 0) < 0)
 			goto end;
-		}
-		fact = (OhmFact *)fact_list->data;
-		for (fields = ohm_fact_get_fields(fact); fields != NULL; fields = g_slist_next(fields)) {
-			DBusMessageIter	struct_it;
-			DBusMessageIter	variant_it;
-			GQuark	qfield = (GQuark)GPOINTER_TO_INT(fields->data);
-			const	gchar *field_name = g_quark_to_string(qfield);
-			gchar	sig_c = '?';
-			gchar	sig[2] = "?";
-			void	*value;
-			GValue	*gval = ohm_fact_get(fact, field_name);
-			int	dbus_type = map_to_dbus_type(gval, &sig_c, &value);
-
-			sig[0] = sig_c;
-			if (dbus_type == DBUS_TYPE_INVALID) {
-				OHM_WARNING("%s: ignoring invalid field %s", __FUNCTION__, field_name);
-				continue;
-			}
-			if (!dbus_message_iter_open_container(&fields_it, DBUS_TYPE_STRUCT, NULL, &struct_it)) {
-				OHM_ERROR("%s: error opening container", __FUNCTION__);
-				g_free(value);
-				goto end;
-			}
-			if (!dbus_message_iter_append_basic(&struct_it, DBUS_TYPE_STRING, &field_name)) {
-				OHM_ERROR("%s: error appending OhmFact field", __FUNCTION__);
-				g_free(value);
-				goto end;
-			}
-			if (!dbus_message_iter_open_container(&struct_it, DBUS_TYPE_VARIANT, sig, &variant_it)) {
-				OHM_ERROR("%s: error opening container", __FUNCTION__);
-				g_free(value);
-				goto end;
-			}
-			if (dbus_type == DBUS_TYPE_STRING) {
-				if (!dbus_message_iter_append_basic(&variant_it, dbus_type, &value)) {
-					OHM_ERROR("%s: error appending OhmFact value", __FUNCTION__);
-					g_free(value);
-					goto end;
-				}
-			} else {
-				if (!dbus_message_iter_append_basic(&variant_it, dbus_type, value)) {
-					OHM_ERROR("%s: error appending OhmFact value", __FUNCTION__);
-					g_free(value);
-					goto end;
-				}
-			}
-			g_free(value);
-			dbus_message_iter_close_container(&struct_it, &variant_it);
-			dbus_message_iter_close_container(&fields_it, &struct_it);
-		}
-
-		dbus_message_iter_close_container(&fact_it, &fields_it);
 		fact_list = g_slist_next(fact_list);
 	}
 	dbus_message_iter_close_container(&rep_it, &fact_it);
@@ -518,6 +535,571 @@ cancel:
 	return DBUS_HANDLER_RESULT_HANDLED;
 }
 
+static void free_fields(GArray *fields)
+{
+	guint i;
+
+	for (i = 0; i < fields->len; i++) {
+		field_value_t *fv = &g_array_index(fields, field_value_t, i);
+
+		g_value_unset(fv->value);
+		g_free(fv->value);
+	}
+	g_array_free(fields, TRUE);
+}
+
+/* Parse an a(sv) array of field name - value pairs. */
+static GArray *parse_fields(DBusMessageIter *msg_it)
+{
+	DBusMessageIter	array_it;
+	DBusMessageIter	struct_it;
+	DBusMessageIter	variant_it;
+	DBusBasicValue	dbus_value;
+	field_value_t	fv;
+	GArray		*fields;
+	int		type;
+
+	if (dbus_message_iter_get_arg_type(msg_it) != DBUS_TYPE_ARRAY)
+		return NULL;
+
+	fields = g_array_new(FALSE, FALSE, sizeof(field_value_t));
+
+	dbus_message_iter_recurse(msg_it, &array_it);
+	while (dbus_message_iter_get_arg_type(&array_it) == DBUS_TYPE_STRUCT) {
+		dbus_message_iter_recurse(&array_it, &struct_it);
+		if (dbus_message_iter_get_arg_type(&struct_it) != DBUS_TYPE_STRING)
+			goto fail;
+		dbus_message_iter_get_basic(&struct_it, (void *)&fv.name);
+		dbus_message_iter_next(&struct_it);
+
+		if (dbus_message_iter_get_arg_type(&struct_it) != DBUS_TYPE_VARIANT)
+			goto fail;
+		dbus_message_iter_recurse(&struct_it, &variant_it);
+		type = dbus_message_iter_get_arg_type(&variant_it);
+		if (is_handled_type(type) == FALSE)
+			goto fail;
+		dbus_message_iter_get_basic(&variant_it, (void *)&dbus_value);
+		if ((fv.value = dbus_value_to_gvalue(&dbus_value, type)) == NULL)
+			goto fail;
+
+		g_array_append_val(fields, fv);
+		dbus_message_iter_next(&array_it);
+	}
+
+	if (dbus_message_iter_get_arg_type(&array_it) != DBUS_TYPE_INVALID)
+		goto fail;
+
+	return fields;
+fail:
+	free_fields(fields);
+	return NULL;
+}
+
+/* Apply a (sa(sv)a(sv)) operation: fact name, selection, fields to set. */
+static int setfacts_single(DBusMessageIter *msg_it)
+{
+	DBusMessageIter	op_it;
+	const gchar	*fact_name;
+	GArray		*select = NULL, *update = NULL;
+	GSList		*facts, *l;
+	OhmFact		*fact;
+	GValue		*fact_gval, *gval;
+	guint		i;
+	int		n = 0;
+
+	dbus_message_iter_recurse(msg_it, &op_it);
+	if (dbus_message_iter_get_arg_type(&op_it) != DBUS_TYPE_STRING)
+		goto fail;
+	dbus_message_iter_get_basic(&op_it, (void *)&fact_name);
+	dbus_message_iter_next(&op_it);
+
+	if ((select = parse_fields(&op_it)) == NULL)
+		goto fail;
+	dbus_message_iter_next(&op_it);
+	if ((update = parse_fields(&op_it)) == NULL)
+		goto fail;
+
+	/*
+	 * "updated" is emitted synchronously by ohm_fact_set and its watchers
+	 * may insert or remove facts, so iterate over a referenced copy of the
+	 * list instead of the one owned by the factstore.
+	 */
+	facts = g_slist_copy(ohm_fact_store_get_facts_by_name(store, fact_name));
+	g_slist_foreach(facts, (GFunc)g_object_ref, NULL);
+
+	for (l = facts; l; l = l->next) {
+		fact = (OhmFact *)l->data;
+
+		for (i = 0; i < select->len; i++) {
+			field_value_t *fv = &g_array_index(select, field_value_t, i);
+
+			fact_gval = ohm_fact_get(fact, fv->name);
+			if (fact_gval == NULL || !gval_match(fact_gval, fv->value))
+				break;
+		}
+		if (i < select->len)
+			continue;
+
+		for (i = 0; i < update->len; i++) {
+			field_value_t *fv = &g_array_index(update, field_value_t, i);
+
+			gval = g_new0(GValue, 1);
+			g_value_init(gval, G_VALUE_TYPE(fv->value));
+			g_value_copy(fv->value, gval);
+			ohm_fact_set(fact, fv->name, gval);
+		}
+		n++;
+	}
+
+	g_slist_foreach(facts, (GFunc)g_object_unref, NULL);
+	g_slist_free(facts);
+
+	OHM_DEBUG(DBG_FACTTOOL, "%s: %d facts %s updated", __FUNCTION__, n, fact_name);
+
+	free_fields(select);
+	free_fields(update);
+	return n;
+fail:
+	OHM_ERROR("%s:%d Invalid dbus request", __FUNCTION__, __LINE__);
+	if (select)
+		free_fields(select);
+	return -1;
+}
+
+/* Bulk set fields of facts
+ *
+ * DBUS arguments:
+ *
+ * arg 0: a(sa(sv)a(sv)): array of operations, each one with the name of
+ * the facts, an array of field - value pairs selecting the facts to update
+ * (empty to update all of them) and an array of field - value pairs to set.
+ *
+ * All operations are applied in a single factstore transaction, and are
+ * rolled back if any of them fails. Returns the number of updated facts,
+ * or an error.
+ */
+static DBusHandlerResult facttool_setfacts(DBusConnection * c, DBusMessage * msg,
+	void *user_data)
+
+{
+	DBusMessageIter msg_it;
+	DBusMessageIter array_it;
+	DBusMessage	*reply;
+	dbus_uint32_t	total = 0;
+	int		n = -1;
+
+	(void)user_data;
+
+	dbus_message_iter_init(msg, &msg_it);
+
+	if (dbus_message_iter_get_arg_type(&msg_it) == DBUS_TYPE_ARRAY &&
+	    dbus_message_iter_get_element_type(&msg_it) == DBUS_TYPE_STRUCT) {
+		ohm_fact_store_transaction_push(store);
+
+		n = 0;
+		dbus_message_iter_recurse(&msg_it, &array_it);
+		while (dbus_message_iter_get_arg_type(&array_it) == DBUS_TYPE_STRUCT) {
+			if ((n = setfacts_single(&array_it)) < 0)
+				break;
+			total += n;
+			dbus_message_iter_next(&array_it);
+		}
+
+		ohm_fact_store_transaction_pop(store, n < 0);
+	}
+
+	if (n < 0) {
+		OHM_INFO("%s: Rolling back fact operations", __FUNCTION__);
+		reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+					       "invalid fact operation");
+	} else {
+		OHM_INFO("%s: %u facts updated", __FUNCTION__, total);
+		if ((reply = dbus_message_new_method_return(msg)) != NULL &&
+		    !dbus_message_append_args(reply, DBUS_TYPE_UINT32, &total,
+					      DBUS_TYPE_INVALID)) {
+			dbus_message_unref(reply);
+			reply = NULL;
+		}
+	}
+
+	if (reply == NULL) {
+		OHM_ERROR("%s: failed to allocate D-BUS reply", __FUNCTION__);
+		goto end;
+	}
+	if (!dbus_connection_send(c, reply, NULL)) {
+		OHM_ERROR("%s: failed to send the reply", __FUNCTION__);
+	}
+	dbus_message_unref(reply);
+end:
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/* Bulk get facts
+ *
+ * DBUS arguments:
+ *
+ * arg 0: as: names of the facts to be retrieved
+ * arg 1: as: names of the fields to return, empty for all fields
+ *
+ * Returns a dictionary of fact name to the array of facts with that name,
+ * each fact as an array of (field name, value) structs, like getfact.
+ */
+static DBusHandlerResult facttool_getfacts(DBusConnection * c, DBusMessage * msg,
+	void *user_data)
+
+{
+	char		**names = NULL, **fields = NULL;
+	int		n_names, n_fields, i;
+	DBusMessageIter	rep_it;
+	DBusMessageIter	dict_it;
+	DBusMessageIter	entry_it;
+	DBusMessageIter	fact_it;
+	DBusMessage	*reply = NULL;
+	DBusError	error;
+	GSList		*l;
+
+	(void)user_data;
+
+	dbus_error_init(&error);
+
+	if (!dbus_message_get_args(msg, &error,
+				   DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &names, &n_names,
+				   DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &fields, &n_fields,
+				   DBUS_TYPE_INVALID)) {
+		OHM_ERROR("%s: Invalid dbus request: %s", __FUNCTION__, error.message);
+		reply = dbus_message_new_error(msg, error.name, error.message);
+		dbus_error_free(&error);
+		goto send;
+	}
+
+	if ((reply = dbus_message_new_method_return(msg)) == NULL)
+		goto send;
+
+	dbus_message_iter_init_append(reply, &rep_it);
+
+	if (!dbus_message_iter_open_container(&rep_it, DBUS_TYPE_ARRAY, "{saa(sv)}", &dict_it))
+		goto fail;
+
+	for (i = 0; i < n_names; i++) {
+		if (!dbus_message_iter_open_container(&dict_it, DBUS_TYPE_DICT_ENTRY, NULL, &entry_it) ||
+		    !dbus_message_iter_append_basic(&entry_it, DBUS_TYPE_STRING, &names[i]) ||
+		    !dbus_message_iter_open_container(&entry_it, DBUS_TYPE_ARRAY, "a(sv)", &fact_it))
+			goto fail;
+
+		for (l = ohm_fact_store_get_facts_by_name(store, names[i]); l; l = l->next) {
+			if (append_fact(&fact_it, (OhmFact *)l->data, fields, n_fields) < 0)
+				goto fail;
+		}
+
+		if (!dbus_message_iter_close_container(&entry_it, &fact_it) ||
+		    !dbus_message_iter_close_container(&dict_it, &entry_it))
+			goto fail;
+	}
+
+	if (!dbus_message_iter_close_container(&rep_it, &dict_it))
+		goto fail;
+
+	goto send;
+fail:
+	OHM_ERROR("%s: failed to build the reply", __FUNCTION__);
+	dbus_message_unref(reply);
+	reply = NULL;
+send:
+	if (reply == NULL) {
+		OHM_ERROR("%s: failed to allocate D-BUS reply", __FUNCTION__);
+	} else {
+		if (!dbus_connection_send(c, reply, NULL))
+			OHM_ERROR("%s: failed to send the reply", __FUNCTION__);
+		dbus_message_unref(reply);
+	}
+
+	dbus_free_string_array(names);
+	dbus_free_string_array(fields);
+
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static gboolean flush_changes(gpointer data)
+{
+	DBusMessage	*msg;
+	DBusMessageIter	msg_it;
+	DBusMessageIter	array_it;
+	DBusMessageIter	struct_it;
+	DBusMessageIter	variant_it;
+	DBusBasicValue	value;
+	fact_change_t	*change;
+	const char	*sig, *name;
+	int		type, ok;
+
+	(void)data;
+
+	changes_idle = 0;
+
+	msg = dbus_message_new_signal(DBUS_PATH_POLICY, DBUS_INTERFACE_POLICY,
+				      SIGNAL_POLICY_FACTTOOL_FACTS_CHANGED);
+	ok = (msg != NULL && signal_conn != NULL);
+
+	if (ok) {
+		dbus_message_iter_init_append(msg, &msg_it);
+		ok = dbus_message_iter_open_container(&msg_it, DBUS_TYPE_ARRAY,
+						      "(ssv)", &array_it);
+	}
+
+	while ((change = g_queue_pop_head(&changes)) != NULL) {
+		if (ok && (sig = value_to_dbus(&change->value, &type, &value)) != NULL) {
+			ok = dbus_message_iter_open_container(&array_it, DBUS_TYPE_STRUCT, NULL, &struct_it);
+			name = g_quark_to_string(change->fact);
+			ok = ok && dbus_message_iter_append_basic(&struct_it, DBUS_TYPE_STRING, &name);
+			name = g_quark_to_string(change->field);
+			ok = ok && dbus_message_iter_append_basic(&struct_it, DBUS_TYPE_STRING, &name);
+			ok = ok && dbus_message_iter_open_container(&struct_it, DBUS_TYPE_VARIANT, sig, &variant_it);
+			ok = ok && dbus_message_iter_append_basic(&variant_it, type, &value);
+			ok = ok && dbus_message_iter_close_container(&struct_it, &variant_it);
+			ok = ok && dbus_message_iter_close_container(&array_it, &struct_it);
+		}
+		g_value_unset(&change->value);
+		g_slice_free(fact_change_t, change);
+	}
+
+	if (ok)
+		ok = dbus_message_iter_close_container(&msg_it, &array_it);
+
+	if (ok) {
+		if (!dbus_connection_send(signal_conn, msg, NULL))
+			OHM_ERROR("%s: failed to send the signal", __FUNCTION__);
+	} else
+		OHM_ERROR("%s: failed to build the signal", __FUNCTION__);
+
+	if (msg != NULL)
+		dbus_message_unref(msg);
+
+	return FALSE;
+}
+
+static void queue_change(OhmFact *fact, GQuark field, GValue *value)
+{
+	fact_change_t *change;
+
+	if (value == NULL || !G_IS_VALUE(value))
+		return;
+
+	change = g_slice_new0(fact_change_t);
+	change->fact  = g_quark_from_string(ohm_structure_get_name(OHM_STRUCTURE(fact)));
+	change->field = field;
+	g_value_init(&change->value, G_VALUE_TYPE(value));
+	g_value_copy(value, &change->value);
+
+	g_queue_push_tail(&changes, change);
+
+	if (!changes_idle)
+		changes_idle = g_idle_add(flush_changes, NULL);
+}
+
+static int is_subscribed(OhmFact *fact)
+{
+	const char *name = ohm_structure_get_name(OHM_STRUCTURE(fact));
+
+	return name != NULL && g_hash_table_lookup(subscribed, name) != NULL;
+}
+
+static void fact_updated(OhmFactStore *fs, OhmFact *fact, GQuark field,
+			 gpointer value, gpointer data)
+{
+	(void)fs;
+	(void)data;
+
+	if (fact != NULL && is_subscribed(fact))
+		queue_change(fact, field, (GValue *)value);
+}
+
+static void fact_inserted(OhmFactStore *fs, OhmFact *fact, gpointer data)
+{
+	GSList *l;
+	GQuark  field;
+
+	(void)fs;
+	(void)data;
+
+	if (fact == NULL || !is_subscribed(fact))
+		return;
+
+	for (l = ohm_fact_get_fields(fact); l != NULL; l = g_slist_next(l)) {
+		field = (GQuark)GPOINTER_TO_INT(l->data);
+		queue_change(fact, field, ohm_fact_get(fact, g_quark_to_string(field)));
+	}
+}
+
+static void subscribed_changed(const char *name, int delta)
+{
+	guint count = GPOINTER_TO_UINT(g_hash_table_lookup(subscribed, name));
+
+	count += delta;
+
+	if (count > 0)
+		g_hash_table_replace(subscribed, g_strdup(name), GUINT_TO_POINTER(count));
+	else
+		g_hash_table_remove(subscribed, name);
+
+	/* only watch the factstore while somebody is interested */
+	if (g_hash_table_size(subscribed) > 0 && !fs_signals[0]) {
+		fs_signals[0] = g_signal_connect(G_OBJECT(store), "updated",
+						 G_CALLBACK(fact_updated), NULL);
+		fs_signals[1] = g_signal_connect(G_OBJECT(store), "inserted",
+						 G_CALLBACK(fact_inserted), NULL);
+	}
+	else if (g_hash_table_size(subscribed) == 0 && fs_signals[0]) {
+		g_signal_handler_disconnect(G_OBJECT(store), fs_signals[0]);
+		g_signal_handler_disconnect(G_OBJECT(store), fs_signals[1]);
+		fs_signals[0] = fs_signals[1] = 0;
+	}
+}
+
+static void drop_subscriber(const char *sender)
+{
+	GHashTable	*names;
+	GHashTableIter	it;
+	gpointer	name;
+
+	if ((names = g_hash_table_lookup(subscribers, sender)) == NULL)
+		return;
+
+	g_hash_table_iter_init(&it, names);
+	while (g_hash_table_iter_next(&it, &name, NULL))
+		subscribed_changed(name, -1);
+
+	g_hash_table_remove(subscribers, sender);
+}
+
+static void unsubscribe_all(void)
+{
+	GHashTableIter	it;
+	gpointer	sender;
+
+	g_hash_table_iter_init(&it, subscribers);
+	while (g_hash_table_iter_next(&it, &sender, NULL)) {
+		drop_subscriber(sender);
+		g_hash_table_iter_init(&it, subscribers);
+	}
+
+	if (changes_idle) {
+		g_source_remove(changes_idle);
+		changes_idle = 0;
+	}
+
+	while (!g_queue_is_empty(&changes)) {
+		fact_change_t *change = g_queue_pop_head(&changes);
+
+		g_value_unset(&change->value);
+		g_slice_free(fact_change_t, change);
+	}
+
+	if (signal_conn != NULL) {
+		dbus_connection_unref(signal_conn);
+		signal_conn = NULL;
+	}
+}
+
+/* Subscribe or unsubscribe to field changes
+ *
+ * DBUS arguments:
+ *
+ * arg 0: as: names of the facts
+ *
+ * Changes of the subscribed facts are emitted as factschanged signals with
+ * an a(ssv) argument: fact name, field name and new value of each changed
+ * field, in the order of the changes.
+ */
+static DBusHandlerResult facttool_subscription(DBusConnection * c, DBusMessage * msg,
+	void *user_data)
+
+{
+	const char	*sender = dbus_message_get_sender(msg);
+	int		subscribe = !strcmp(dbus_message_get_member(msg),
+					    METHOD_POLICY_FACTTOOL_SUBSCRIBE);
+	char		**names = NULL;
+	int		n_names, i;
+	GHashTable	*set;
+	DBusMessage	*reply;
+	DBusError	error;
+
+	(void)user_data;
+
+	dbus_error_init(&error);
+
+	if (sender == NULL ||
+	    !dbus_message_get_args(msg, &error,
+				   DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &names, &n_names,
+				   DBUS_TYPE_INVALID)) {
+		OHM_ERROR("%s: Invalid dbus request: %s", __FUNCTION__,
+			  dbus_error_is_set(&error) ? error.message : "no sender");
+		reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+					       "invalid subscription request");
+		dbus_error_free(&error);
+		goto send;
+	}
+
+	if ((set = g_hash_table_lookup(subscribers, sender)) == NULL && subscribe) {
+		set = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert(subscribers, g_strdup(sender), set);
+	}
+
+	for (i = 0; set != NULL && i < n_names; i++) {
+		int known = g_hash_table_lookup_extended(set, names[i], NULL, NULL);
+
+		if (subscribe && !known) {
+			g_hash_table_insert(set, g_strdup(names[i]), NULL);
+			subscribed_changed(names[i], +1);
+		}
+		else if (!subscribe && known) {
+			g_hash_table_remove(set, names[i]);
+			subscribed_changed(names[i], -1);
+		}
+	}
+
+	if (set != NULL && g_hash_table_size(set) == 0)
+		g_hash_table_remove(subscribers, sender);
+
+	if (subscribe && signal_conn == NULL)
+		signal_conn = dbus_connection_ref(c);
+
+	OHM_DEBUG(DBG_FACTTOOL, "%s: %s %d facts", sender,
+		  subscribe ? "subscribed to" : "unsubscribed from", n_names);
+
+	reply = dbus_message_new_method_return(msg);
+	dbus_free_string_array(names);
+send:
+	if (reply == NULL) {
+		OHM_ERROR("%s: failed to allocate D-BUS reply", __FUNCTION__);
+		goto end;
+	}
+	if (!dbus_connection_send(c, reply, NULL)) {
+		OHM_ERROR("%s: failed to send the reply", __FUNCTION__);
+	}
+	dbus_message_unref(reply);
+end:
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static DBusHandlerResult facttool_name_owner_changed(DBusConnection * c,
+	DBusMessage * msg, void *user_data)
+
+{
+	const char	*name, *old_owner, *new_owner;
+
+	(void)c;
+	(void)user_data;
+
+	if (dbus_message_get_args(msg, NULL,
+				  DBUS_TYPE_STRING, &name,
+				  DBUS_TYPE_STRING, &old_owner,
+				  DBUS_TYPE_STRING, &new_owner,
+				  DBUS_TYPE_INVALID) &&
+	    (new_owner == NULL || !*new_owner) && subscribers != NULL)
+		drop_subscriber(name);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
 OHM_PLUGIN_DESCRIPTION("facttool",
                        "0.0.1",
                        "mathieux.soulard@intel.com",
@@ -530,6 +1112,19 @@ OHM_PLUGIN_DBUS_METHODS(
 	{NULL, DBUS_PATH_POLICY, METHOD_POLICY_FACTTOOL_SET_FACT,
 		facttool_setfact, NULL},
 	{NULL, DBUS_PATH_POLICY, METHOD_POLICY_FACTTOOL_GET_FACT,
-		facttool_getfact, NULL}
+		facttool_getfact, NULL},
+	{NULL, DBUS_PATH_POLICY, METHOD_POLICY_FACTTOOL_SET_FACTS,
+		facttool_setfacts, NULL},
+	{NULL, DBUS_PATH_POLICY, METHOD_POLICY_FACTTOOL_GET_FACTS,
+		facttool_getfacts, NULL},
+	{NULL, DBUS_PATH_POLICY, METHOD_POLICY_FACTTOOL_SUBSCRIBE,
+		facttool_subscription, NULL},
+	{NULL, DBUS_PATH_POLICY, METHOD_POLICY_FACTTOOL_UNSUBSCRIBE,
+		facttool_subscription, NULL}
+);
+
+OHM_PLUGIN_DBUS_SIGNALS(
+	{"org.freedesktop.DBus", "org.freedesktop.DBus", "NameOwnerChanged",
+		NULL, facttool_name_owner_changed, NULL}
 );
 
@@ -41,6 +41,11 @@
 
 #define METHOD_POLICY_FACTTOOL_SET_FACT			"setfact"
 #define METHOD_POLICY_FACTTOOL_GET_FACT			"getfact"
+#define METHOD_POLICY_FACTTOOL_SET_FACTS		"setfacts"
+#define METHOD_POLICY_FACTTOOL_GET_FACTS		"getfacts"
+#define METHOD_POLICY_FACTTOOL_SUBSCRIBE		"subscribe"
+#define METHOD_POLICY_FACTTOOL_UNSUBSCRIBE		"unsubscribe"
+#define SIGNAL_POLICY_FACTTOOL_FACTS_CHANGED		"factschanged"
 
 static void plugin_init(OhmPlugin *);
 static void plugin_exit(OhmPlugin *);
@@ -29,11 +29,13 @@ USA.
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <time.h>
 #include <glib.h>
 
 #include <ohm/ohm-fact.h>
 
 #include "fsif.h"
+#include "../common/console-command.h"
 
 /* debug flags */
 int DBG_FS;
@@ -53,6 +55,25 @@ typedef enum {
 #error "unmatching enumerations fact_watch_insert and watch_type_e"
 #endif
 
+typedef enum {
+    prof_lookup = 0,
+    prof_update,
+    prof_insert,
+    prof_remove,
+    prof_max
+} prof_op_e;
+
+typedef struct {
+    unsigned long          calls;        /* number of calls */
+    unsigned long long     total;        /* total time spent (nsec) */
+    unsigned long long     max;          /* longest call (nsec) */
+} prof_stat_t;
+
+typedef struct {
+    char                  *name;         /* fact name */
+    prof_stat_t            op[prof_max]; /* per operation statistics */
+} prof_fact_t;
+
 typedef struct watch_fact_s {
     struct watch_fact_s   *next;
     char                  *factname;
@@ -69,6 +90,7 @@ typedef struct watch_entry_s {
         fsif_fact_watch_cb_t   fact_watch;
     }                      callback;
     void                  *usrdata;
+    prof_stat_t            prof;         /* callback statistics */
 } watch_entry_t;
 
 static OhmFactStore  *fs;
@@ -76,6 +98,9 @@ static int            watch_id = 1;
 static watch_fact_t  *wfact_inserts;
 static watch_fact_t  *wfact_removes;
 static watch_fact_t  *wfact_updates;
+static int            profiling;
+static GHashTable    *prof_facts;
+static guint          console_id;
 
 static OhmFact      *find_entry(char *, fsif_field_t *);
 static int           matching_entry(OhmFact *, fsif_field_t *);
@@ -96,6 +121,13 @@ static void          inserted_cb(void *, OhmFact *);
 static void          removed_cb(void *, OhmFact *);
 static void          updated_cb(void *, OhmFact *, GQuark, gpointer);
 static char         *time_str(unsigned long long, char *, int);
+static unsigned long long profile_start(void);
+static void          profile_fact(const char *, prof_op_e, unsigned long long);
+static void          profile_entry(fsif_entry_t *, prof_op_e,
+                                   unsigned long long);
+static void          profile_watch(watch_entry_t *, unsigned long long);
+static void          profile_free_fact(gpointer);
+static gboolean      console_init(gpointer);
 
 static guint         updated_id;
 static guint         inserted_id;
@@ -107,13 +139,20 @@ static guint         removed_id;
  ********************/
 static void plugin_init(OhmPlugin *plugin)
 {
-    (void)plugin;
+    const char *profile;
 
     if (!OHM_DEBUG_INIT(fsif))
         OHM_WARNING("fsif: failed to register for debugging");
 
     OHM_INFO("fsif: initializing...");
 
+    if ((profile = ohm_plugin_get_param(plugin, "profile")) != NULL &&
+        (!strcmp(profile, "yes") || !strcmp(profile, "true")))
+        profiling = TRUE;
+
+    /* dres needs the factstore interface, so it is loaded after us */
+    console_id = g_idle_add(console_init, NULL);
+
     fs = ohm_fact_store_get_fact_store();
 
     updated_id  = g_signal_connect(G_OBJECT(fs), "updated" ,
@@ -148,6 +187,16 @@ static void plugin_exit(OhmPlugin *plugin)
         g_signal_handler_disconnect(G_OBJECT(fs), removed_id);
         removed_id = 0;
     }
+
+    if (console_id) {
+        g_source_remove(console_id);
+        console_id = 0;
+    }
+
+    if (prof_facts != NULL) {
+        g_hash_table_destroy(prof_facts);
+        prof_facts = NULL;
+    }
 }
 
 
@@ -840,9 +889,10 @@ static void inserted_cb(void    *data,
 {
     (void)data;
 
-    char          *name;
-    watch_fact_t  *wfact;
-    watch_entry_t *wentry;
+    char               *name;
+    watch_fact_t       *wfact;
+    watch_entry_t      *wentry;
+    unsigned long long  start;
 
     if (fact == NULL) {
         OHM_ERROR("fsif: %s() called with null fact pointer",__FUNCTION__);
@@ -857,8 +907,10 @@ static void inserted_cb(void    *data,
 
         for (wentry = wfact->entries;  wentry != NULL;  wentry = wentry->next){
 
+            start = profile_start();
             wentry->callback.fact_watch(fact, name, fact_watch_insert,
                                         wentry->usrdata); 
+            profile_watch(wentry, start);
         } /* for */
     } /* if find_watch */
 }
@@ -869,9 +921,10 @@ static void removed_cb(void    *data,
 {
     (void)data;
 
-    char          *name;
-    watch_fact_t  *wfact;
-    watch_entry_t *wentry;
+    char               *name;
+    watch_fact_t       *wfact;
+    watch_entry_t      *wentry;
+    unsigned long long  start;
 
     if (fact == NULL) {
         OHM_ERROR("fsif: %s() called with null fact pointer",__FUNCTION__);
@@ -886,8 +939,10 @@ static void removed_cb(void    *data,
 
         for (wentry = wfact->entries;  wentry != NULL;  wentry = wentry->next){
 
+            start = profile_start();
             wentry->callback.fact_watch(fact, name, fact_watch_remove,
                                         wentry->usrdata); 
+            profile_watch(wentry, start);
         } /* for */
     } /* if find_watch */
 }
@@ -900,13 +955,14 @@ static void updated_cb(void    *data,
 {
     (void)data;
 
-    GValue        *gval = (GValue *)value;
-    char          *name;
-    watch_fact_t  *wfact;
-    watch_entry_t *wentry;
-    fsif_field_t   fld;
-    char           valb[256];
-    char          *valstr;
+    GValue             *gval = (GValue *)value;
+    char               *name;
+    watch_fact_t       *wfact;
+    watch_entry_t      *wentry;
+    fsif_field_t        fld;
+    char                valb[256];
+    char               *valstr;
+    unsigned long long  start;
 
     if (fact == NULL) {
         OHM_ERROR("fsif: %s() called with null fact pointer",__FUNCTION__);
@@ -973,7 +1029,9 @@ static void updated_cb(void    *data,
                 OHM_DEBUG(DBG_FS, "field watch point: field '%s:%s' "
                           "changed to '%s'", name, fld.name, valstr);
 
+                start = profile_start();
                 wentry->callback.field_watch(fact, name, &fld,wentry->usrdata);
+                profile_watch(wentry, start);
 
                 return;
             } /* if matching_entry */
@@ -1002,6 +1060,247 @@ static char *time_str(unsigned long long    t,
 }
 
 
+/*****************************************************************************
+ *                          *** access profiling ***                         *
+ *****************************************************************************/
+
+static unsigned long long profile_start(void)
+{
+    struct timespec ts;
+
+    if (!profiling)
+        return 0ULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec + 1ULL;
+}
+
+static unsigned long long profile_elapsed(unsigned long long start)
+{
+    return profile_start() - start;
+}
+
+static void profile_account(prof_stat_t *stat, unsigned long long start)
+{
+    unsigned long long t = profile_elapsed(start);
+
+    stat->calls++;
+    stat->total += t;
+
+    if (t > stat->max)
+        stat->max = t;
+}
+
+static void profile_fact(const char *name, prof_op_e op,
+                         unsigned long long start)
+{
+    prof_fact_t *pf;
+
+    /* start is 0 unless profiling was on when the call was made */
+    if (!start || !profiling || name == NULL)
+        return;
+
+    if (prof_facts == NULL)
+        prof_facts = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                           NULL, profile_free_fact);
+
+    if ((pf = g_hash_table_lookup(prof_facts, name)) == NULL) {
+        if ((pf = malloc(sizeof(*pf))) == NULL)
+            return;
+
+        memset(pf, 0, sizeof(*pf));
+        pf->name = strdup(name);
+
+        g_hash_table_insert(prof_facts, pf->name, pf);
+    }
+
+    profile_account(pf->op + op, start);
+}
+
+static void profile_entry(fsif_entry_t *entry, prof_op_e op,
+                          unsigned long long start)
+{
+    if (start && entry != NULL)
+        profile_fact(ohm_structure_get_name(OHM_STRUCTURE(entry)), op, start);
+}
+
+static void profile_watch(watch_entry_t *wentry, unsigned long long start)
+{
+    if (start && profiling)
+        profile_account(&wentry->prof, start);
+}
+
+static void profile_free_fact(gpointer data)
+{
+    prof_fact_t *pf = (prof_fact_t *)data;
+
+    free(pf->name);
+    free(pf);
+}
+
+static gint profile_cmp_fact(gconstpointer a, gconstpointer b)
+{
+    const prof_fact_t *pa = (const prof_fact_t *)a;
+    const prof_fact_t *pb = (const prof_fact_t *)b;
+    unsigned long long ta, tb;
+    int i;
+
+    for (i = 0, ta = tb = 0;  i < prof_max;  i++) {
+        ta += pa->op[i].total;
+        tb += pb->op[i].total;
+    }
+
+    /* most expensive first */
+    return ta < tb ? 1 : (ta > tb ? -1 : strcmp(pa->name, pb->name));
+}
+
+static void profile_print(FILE *fp, prof_stat_t *stat)
+{
+    fprintf(fp, "calls=%lu total=%.3fus avg=%.3fus max=%.3fus\n",
+            stat->calls, stat->total / 1000.0,
+            stat->calls ? stat->total / 1000.0 / stat->calls : 0.0,
+            stat->max / 1000.0);
+}
+
+static void profile_print_watches(FILE *fp, watch_fact_t *wfact,
+                                  const char *type)
+{
+    watch_entry_t *wentry;
+
+    for ( ;  wfact != NULL;  wfact = wfact->next) {
+        for (wentry = wfact->entries;  wentry;  wentry = wentry->next) {
+            if (!wentry->prof.calls)
+                continue;
+
+            fprintf(fp, "watch %d %s%s%s %s cb=%p ", wentry->id,
+                    wfact->factname, wentry->fldname ? ":" : "",
+                    wentry->fldname ? wentry->fldname : "", type,
+                    (void *)wentry->callback.field_watch);
+            profile_print(fp, &wentry->prof);
+        }
+    }
+}
+
+static void profile_reset_watches(watch_fact_t *wfact)
+{
+    watch_entry_t *wentry;
+
+    for ( ;  wfact != NULL;  wfact = wfact->next) {
+        for (wentry = wfact->entries;  wentry;  wentry = wentry->next)
+            memset(&wentry->prof, 0, sizeof(wentry->prof));
+    }
+}
+
+static int fsif_profile_enable(int enable)
+{
+    int was_enabled = profiling;
+
+    profiling = enable ? TRUE : FALSE;
+
+    if (profiling != was_enabled)
+        OHM_INFO("fsif: factstore access profiling %s",
+                 profiling ? "enabled" : "disabled");
+
+    return was_enabled;
+}
+
+static void fsif_profile_dump(FILE *fp, int reset)
+{
+    static const char *ops[prof_max] = {
+        [prof_lookup] = "lookup",
+        [prof_update] = "update",
+        [prof_insert] = "insert",
+        [prof_remove] = "remove",
+    };
+
+    prof_fact_t *pf;
+    GList       *list, *l;
+    int          i;
+
+    if (fp == NULL)
+        fp = stdout;
+
+    /*
+     * One line per fact name and operation and one per watch callback,
+     * facts with the most time spent first. The time of an update or
+     * insertion includes the time of the watch callbacks it triggered.
+     */
+
+    fprintf(fp, "# fsif profiling %s\n", profiling ? "enabled" : "disabled");
+
+    list = prof_facts ? g_hash_table_get_values(prof_facts) : NULL;
+    list = g_list_sort(list, profile_cmp_fact);
+
+    for (l = list;  l != NULL;  l = l->next) {
+        pf = (prof_fact_t *)l->data;
+
+        for (i = 0;  i < prof_max;  i++) {
+            if (!pf->op[i].calls)
+                continue;
+
+            fprintf(fp, "fact %s %s ", pf->name, ops[i]);
+            profile_print(fp, pf->op + i);
+        }
+    }
+
+    g_list_free(list);
+
+    profile_print_watches(fp, wfact_inserts, "insert");
+    profile_print_watches(fp, wfact_removes, "remove");
+    profile_print_watches(fp, wfact_updates, "update");
+
+    fprintf(fp, "# end\n");
+
+    if (reset) {
+        if (prof_facts != NULL)
+            g_hash_table_remove_all(prof_facts);
+
+        profile_reset_watches(wfact_inserts);
+        profile_reset_watches(wfact_removes);
+        profile_reset_watches(wfact_updates);
+    }
+}
+
+
+/*****************************************************************************
+ *                          *** console command ***                          *
+ *****************************************************************************/
+
+static void console_command(char *command)
+{
+    if (!strcmp(command, "help")) {
+        printf("fsif help:            show this help\n");
+        printf("fsif profile on|off   enable/disable factstore access "
+               "profiling\n");
+        printf("fsif profile show     show the collected profile\n");
+        printf("fsif profile reset    show and reset the collected profile\n");
+    }
+    else if (!strcmp(command, "profile on"))
+        fsif_profile_enable(TRUE);
+    else if (!strcmp(command, "profile off"))
+        fsif_profile_enable(FALSE);
+    else if (!strcmp(command, "profile show"))
+        fsif_profile_dump(stdout, FALSE);
+    else if (!strcmp(command, "profile reset"))
+        fsif_profile_dump(stdout, TRUE);
+    else
+        printf("unknown fsif command \"%s\"\n", command);
+}
+
+static gboolean console_init(gpointer data)
+{
+    (void)data;
+
+    console_id = 0;
+
+    if (!console_command_add("fsif", console_command))
+        OHM_INFO("fsif: console commands not available");
+
+    return FALSE;
+}
+
+
 /*****************************************************************************
  *                           *** public plugin API ***                       *
  *****************************************************************************/
@@ -1012,7 +1311,13 @@ static char *time_str(unsigned long long    t,
  ****************************/
 OHM_EXPORTABLE(int, add_factstore_entry, (char *name, fsif_field_t *fldlist))
 {
-    return fsif_add_factstore_entry(name, fldlist);
+    unsigned long long start = profile_start();
+    int                success;
+
+    success = fsif_add_factstore_entry(name, fldlist);
+    profile_fact(name, prof_insert, start);
+
+    return success;
 }
 
 
@@ -1021,7 +1326,13 @@ OHM_EXPORTABLE(int, add_factstore_entry, (char *name, fsif_field_t *fldlist))
  ****************************/
 OHM_EXPORTABLE(int, delete_factstore_entry, (char *name, fsif_field_t *selist))
 {
-    return fsif_delete_factstore_entry(name, selist);
+    unsigned long long start = profile_start();
+    int                success;
+
+    success = fsif_delete_factstore_entry(name, selist);
+    profile_fact(name, prof_remove, start);
+
+    return success;
 }
 
 
@@ -1032,7 +1343,13 @@ OHM_EXPORTABLE(int, update_factstore_entry, (char *name,
                                              fsif_field_t *selist,
                                              fsif_field_t *fldlist))
 {
-    return fsif_update_factstore_entry(name, selist, fldlist);
+    unsigned long long start = profile_start();
+    int                success;
+
+    success = fsif_update_factstore_entry(name, selist, fldlist);
+    profile_fact(name, prof_update, start);
+
+    return success;
 }
 
 
@@ -1041,7 +1358,20 @@ OHM_EXPORTABLE(int, update_factstore_entry, (char *name,
  ****************************/
 OHM_EXPORTABLE(int, destroy_factstore_entry, (fsif_entry_t *fact))
 {
-    return fsif_destroy_factstore_entry(fact);
+    unsigned long long  start = profile_start();
+    char               *name  = NULL;
+    int                 success;
+
+    /* the fact, and possibly its name, is gone after destroying it */
+    if (start && fact != NULL)
+        name = g_strdup(ohm_structure_get_name(OHM_STRUCTURE(fact)));
+
+    success = fsif_destroy_factstore_entry(fact);
+    profile_fact(name, prof_remove, start);
+
+    g_free(name);
+
+    return success;
 }
 
 
@@ -1051,7 +1381,13 @@ OHM_EXPORTABLE(int, destroy_factstore_entry, (fsif_entry_t *fact))
 OHM_EXPORTABLE(fsif_entry_t *, get_entry, (char           *name,
                                            fsif_field_t   *selist))
 {
-    return fsif_get_entry(name, selist);
+    unsigned long long  start = profile_start();
+    fsif_entry_t       *entry;
+
+    entry = fsif_get_entry(name, selist);
+    profile_fact(name, prof_lookup, start);
+
+    return entry;
 }
 
 /****************************
@@ -1062,7 +1398,13 @@ OHM_EXPORTABLE(int, get_field_by_entry, (fsif_entry_t *entry,
                                          char *name,
                                          fsif_value_t *vptr))
 {
-    return fsif_get_field_by_entry(entry, type, name, vptr);
+    unsigned long long start = profile_start();
+    int                success;
+
+    success = fsif_get_field_by_entry(entry, type, name, vptr);
+    profile_entry(entry, prof_lookup, start);
+
+    return success;
 }
 
 
@@ -1074,7 +1416,13 @@ OHM_EXPORTABLE(int, get_field_by_name, (const char *name,
                                         char *field,
                                         fsif_value_t *vptr))
 {
-    return fsif_get_field_by_name(name, type, field, vptr);
+    unsigned long long start = profile_start();
+    int                success;
+
+    success = fsif_get_field_by_name(name, type, field, vptr);
+    profile_fact(name, prof_lookup, start);
+
+    return success;
 }
 
 
@@ -1083,7 +1431,13 @@ OHM_EXPORTABLE(int, get_field_by_name, (const char *name,
  ****************************/
 OHM_EXPORTABLE(GSList*, get_entries_by_name, (const char *name))
 {
-    return fsif_get_entries_by_name(name);
+    unsigned long long  start = profile_start();
+    GSList             *list;
+
+    list = fsif_get_entries_by_name(name);
+    profile_fact(name, prof_lookup, start);
+
+    return list;
 }
 
 
@@ -1092,7 +1446,10 @@ OHM_EXPORTABLE(void, set_field_by_entry, (fsif_entry_t *entry,
                                           char *name,
                                           fsif_value_t *vptr))
 {
+    unsigned long long start = profile_start();
+
     fsif_set_field_by_entry(entry, type, name, vptr);
+    profile_entry(entry, prof_update, start);
 }
 
 
@@ -1121,6 +1478,24 @@ OHM_EXPORTABLE(int, add_field_watch, (char                  *factname,
 }
 
 
+/****************************
+ * profile_enable
+ ****************************/
+OHM_EXPORTABLE(int, profile_enable, (int enable))
+{
+    return fsif_profile_enable(enable);
+}
+
+
+/****************************
+ * profile_dump
+ ****************************/
+OHM_EXPORTABLE(void, profile_dump, (FILE *fp, int reset))
+{
+    fsif_profile_dump(fp, reset);
+}
+
+
 /*****************************************************************************
  *                            *** OHM plugin glue ***                        *
  *****************************************************************************/
@@ -1131,7 +1506,7 @@ OHM_PLUGIN_DESCRIPTION(PLUGIN_NAME,
                        OHM_LICENSE_LGPL, /* OHM_LICENSE_LGPL */
                        plugin_init, plugin_exit, NULL);
 
-OHM_PLUGIN_PROVIDES_METHODS(PLUGIN_PREFIX, 11,
+OHM_PLUGIN_PROVIDES_METHODS(PLUGIN_PREFIX, 13,
                             OHM_EXPORT(add_factstore_entry,     "add_factstore_entry"),
                             OHM_EXPORT(delete_factstore_entry,  "delete_factstore_entry"),
                             OHM_EXPORT(update_factstore_entry,  "update_factstore_entry"),
@@ -1142,7 +1517,9 @@ OHM_PLUGIN_PROVIDES_METHODS(PLUGIN_PREFIX, 11,
                             OHM_EXPORT(set_field_by_entry,      "set_field_by_entry"),
                             OHM_EXPORT(get_field_by_name,       "get_field_by_name"),
                             OHM_EXPORT(add_fact_watch,          "add_fact_watch"),
-                            OHM_EXPORT(add_field_watch,         "add_field_watch")
+                            OHM_EXPORT(add_field_watch,         "add_field_watch"),
+                            OHM_EXPORT(profile_enable,          "profile_enable"),
+                            OHM_EXPORT(profile_dump,            "profile_dump")
 );
 
 /*
@@ -74,6 +74,17 @@ typedef void (*fsif_field_watch_cb_t)(fsif_entry_t *, char *, fsif_field_t *,
 typedef void (*fsif_fact_watch_cb_t)(fsif_entry_t *, char *, fsif_fact_watch_e,
                                      void *);
 
+/*
+ * Factstore access profiling, enabled by the 'profile' plugin parameter
+ * or at runtime, collects call counts and the time spent per fact name
+ * and operation and in the watch callbacks. It is exported as
+ *
+ *   OHM_IMPORTABLE(int , profile_enable, (int enable));
+ *   OHM_IMPORTABLE(void, profile_dump  , (FILE *fp, int reset));
+ *
+ * and is also available as the 'fsif profile' console command.
+ */
+
 
 #endif /* __OHM_FSIF_PLUGIN_H__ */
 
@@ -35,21 +35,48 @@ static int DBG_GCONF;
 typedef struct _observer {
     guint notify;
     gchar *key;
+    char *dir;
+    OhmFact *fact;                  /* referenced while in the factstore */
     int refcount;
 } observer;
 
+static void forget_fact(observer *obs)
+{
+    if (obs->fact) {
+        g_object_unref(obs->fact);
+        obs->fact = NULL;
+    }
+}
 
-static gboolean update_fact(gconf_plugin *plugin, GConfEntry *entry)
+static void fact_removed(void *fs, OhmFact *fact, gpointer data)
 {
-    GSList *e = NULL, *list = NULL;
-    const gchar *key = NULL;
-    GConfValue *val = NULL;
-    OhmFact *fact = NULL;
+    gconf_plugin *plugin = data;
+    observer *obs = NULL;
+    GValue *gval = NULL;
 
-    /* create/update the fact */
+    (void) fs;
+
+    /* drop the cached fact if someone else removes it from the factstore */
+
+    if (plugin->observers == NULL ||
+        strcmp(ohm_structure_get_name(OHM_STRUCTURE(fact)), GCONF_FACT))
+        return;
+
+    if ((gval = ohm_fact_get(fact, "key")) == NULL ||
+        !G_VALUE_HOLDS_STRING(gval))
+        return;
+
+    obs = g_hash_table_lookup(plugin->observers, g_value_get_string(gval));
+
+    if (obs && obs->fact == fact)
+        forget_fact(obs);
+}
+
+
+static OhmFact *lookup_fact(gconf_plugin *plugin, const gchar *key)
+{
+    GSList *e = NULL, *list = NULL;
 
-    key = gconf_entry_get_key(entry);
-    val =  gconf_entry_get_value(entry);
     list = ohm_fact_store_get_facts_by_name(plugin->fs, GCONF_FACT);
 
     for (e = list; e != NULL; e = g_slist_next(e)) {
@@ -58,23 +85,46 @@ static gboolean update_fact(gconf_plugin *plugin, GConfEntry *entry)
 
         if (gval && !strcmp(key, g_value_get_string(gval))) {
             /* found a fact */
-            fact = tmp;
-            break;
+            return tmp;
         }
     }
 
-    if (!fact) {
-        /* not found, create new */
-        OHM_DEBUG(DBG_GCONF, "creating a new fact\n");
-    
-        fact = ohm_fact_new(GCONF_FACT);
-        ohm_fact_set(fact, "key", ohm_value_from_string(key));
-        ohm_fact_store_insert(plugin->fs, fact);
+    return NULL;
+}
+
+static gboolean update_fact(gconf_plugin *plugin, observer *obs,
+        GConfEntry *entry)
+{
+    const gchar *key = NULL;
+    GConfValue *val = NULL;
+    OhmFact *fact = NULL;
+
+    /* create/update the fact */
+
+    key = gconf_entry_get_key(entry);
+    val =  gconf_entry_get_value(entry);
+
+    /* the fact is looked up from the factstore only the first time */
+    if (obs->fact == NULL) {
+        if ((fact = lookup_fact(plugin, key)) == NULL) {
+            /* not found, create new */
+            OHM_DEBUG(DBG_GCONF, "creating a new fact\n");
+
+            fact = ohm_fact_new(GCONF_FACT);
+            ohm_fact_set(fact, "key", ohm_value_from_string(key));
+            ohm_fact_store_insert(plugin->fs, fact);
+        }
+
+        /* our own reference, dropped when the fact leaves the factstore */
+        obs->fact = g_object_ref(fact);
     }
+
+    fact = obs->fact;
         
     if (!val) {
         OHM_DEBUG(DBG_GCONF, "value was unset\n");
         /* the key was unset, delete from FS */
+        forget_fact(obs);
         ohm_fact_store_remove(plugin->fs, fact);
         g_object_unref(fact);
         return TRUE;
@@ -130,9 +180,8 @@ static gboolean update_fact(gconf_plugin *plugin, GConfEntry *entry)
 
 void notify(GConfClient *client, guint id, GConfEntry *entry, gpointer user_data)
 {
-    GSList *e = NULL;
     const gchar *key = NULL;
-    gboolean found = FALSE;
+    observer *obs = NULL;
     gconf_plugin *plugin = user_data;
 
     (void) client;
@@ -140,18 +189,10 @@ void notify(GConfClient *client, guint id, GConfEntry *entry, gpointer user_data
 
     key = gconf_entry_get_key(entry);
 
-    for (e = plugin->observers; e != NULL; e = g_slist_next(e)) {
-        observer *obs = e->data;
-        if (!strcmp(key, obs->key)) {
-            found = TRUE;
-            break;
-        }
-    }
-
-    if (!found)
+    if ((obs = g_hash_table_lookup(plugin->observers, key)) == NULL)
         return;
 
-    update_fact(plugin, entry);
+    update_fact(plugin, obs, entry);
 
     return;
 }
@@ -173,6 +214,15 @@ gconf_plugin * init_gconf(int flag_gconf)
         goto error;
     }
 
+    plugin->observers = g_hash_table_new(g_str_hash, g_str_equal);
+    plugin->watched_dirs = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, NULL);
+    plugin->dirs = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, NULL);
+
+    plugin->removed = g_signal_connect(G_OBJECT(plugin->fs), "removed",
+            G_CALLBACK(fact_removed), plugin);
+
     return plugin;
 
 error:
@@ -191,7 +241,9 @@ error:
 
 static void free_observer(observer *obs)
 {
+    forget_fact(obs);
     g_free(obs->key);
+    free(obs->dir);
     g_free(obs);
 
     return;
@@ -257,109 +309,134 @@ static int is_child_directory(const gchar *child, const gchar *parent)
 
     return is_child;
 }
-static GSList * listened_directories(GSList *observers)
+static gboolean is_watched(gconf_plugin *plugin, const gchar *dir)
 {
-    /* get a list of directories */
-    GSList *directories = NULL, *i, *j;
-    observer *obs = NULL;
-
-    for (i = observers; i != NULL; i = g_slist_next(i)) {
-        gchar *dir;
-        obs = (observer *) i->data;
-        dir = get_directory_from_key(obs->key);
-        if (dir) {
-            directories = g_slist_prepend(directories, dir);
-        }
+    /* see if the directory or one of its parents is listened already */
+    gchar *path = g_strdup(dir), *slash;
+    gboolean watched = FALSE;
+
+    while (!watched) {
+        if (g_hash_table_lookup_extended(plugin->watched_dirs, path, NULL, NULL))
+            watched = TRUE;
+        else if ((slash = strrchr(path, '/')) == NULL || slash == path)
+            break;
+        else
+            *slash = '\0';
     }
 
-    for (i = directories; i != NULL; i = g_slist_next(i)) {
-        int is_child = FALSE;
-        for (j = directories; j != NULL; j = g_slist_next(j)) {
-            if (j != i) {
-                is_child = is_child_directory(i->data, j->data);
-                if (is_child) {
-                    break;
-                }
-            }
-        }
-        if (is_child) {
+    g_free(path);
+    return watched;
+}
 
-            /* filter out the directories that are the direct descendents of
-             * other directories */
-            g_free(i->data);
-            directories = g_slist_delete_link(directories, i);
+static void add_dir(gconf_plugin *plugin, const gchar *dir)
+{
+    gconf_client_add_dir(plugin->client, dir, GCONF_CLIENT_PRELOAD_NONE, NULL);
+    g_hash_table_insert(plugin->watched_dirs, g_strdup(dir), NULL);
+    OHM_DEBUG(DBG_GCONF, "Add dir '%s' to be listened", dir);
+}
+
+static void watch_directory(gconf_plugin *plugin, const gchar *dir)
+{
+    GHashTableIter iter;
+    gpointer watched;
+    guint count;
+
+    /* Keep the set of listened directories minimal: a directory is
+     * added only if none of its parents is listened already, and the
+     * listened children of a new directory are removed after adding
+     * it. As before, we first subscribe and only then unsubscribe,
+     * hoping to avoid missing a key change in between. */
+
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(plugin->dirs, dir));
+    g_hash_table_replace(plugin->dirs, g_strdup(dir), GUINT_TO_POINTER(count + 1));
+
+    if (count > 0 || is_watched(plugin, dir))
+        return;
+
+    add_dir(plugin, dir);
 
-            /* Start from the beginning: this appears to be a limitation
-             * of g_slist */
-            i = directories;
+    g_hash_table_iter_init(&iter, plugin->watched_dirs);
+
+    while (g_hash_table_iter_next(&iter, &watched, NULL)) {
+        if (strcmp(watched, dir) && is_child_directory(watched, dir)) {
+            gconf_client_remove_dir(plugin->client, watched, NULL);
+            OHM_DEBUG(DBG_GCONF, "Remove dir '%s' from being listened",
+                      (gchar *) watched);
+            g_hash_table_iter_remove(&iter);
         }
     }
+}
 
-    return directories;
+static gint compare_length(gconstpointer a, gconstpointer b)
+{
+    return strlen(a) - strlen(b);
 }
 
-static void recalculate_directories(gconf_plugin *plugin)
+static void unwatch_directory(gconf_plugin *plugin, const gchar *dir)
 {
+    GHashTableIter iter;
+    GSList *children = NULL, *e = NULL;
+    gpointer child;
+    gchar *removed;
+    guint count;
+
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(plugin->dirs, dir));
+
+    if (count > 1) {
+        g_hash_table_replace(plugin->dirs, g_strdup(dir),
+                GUINT_TO_POINTER(count - 1));
+        return;
+    }
 
-    GSList *new_dirs = NULL, *e = NULL, *f = NULL;
+    g_hash_table_remove(plugin->dirs, dir);
 
-    new_dirs = listened_directories(plugin->observers);
+    /* nothing to do if a parent directory is listened instead */
+    if (!g_hash_table_lookup_extended(plugin->watched_dirs, dir, NULL, NULL))
+        return;
 
-    /* Calculate the difference between the original listened
-     * directories and the new ones. By first subscribing to new
-     * directories and then unsubscribing from old directories, we hope
-     * to remove the risk of a race condition when a key is changed
-     * before the new subscribtions. The API says that there can't be
-     * overlapping directories subscribed, though, but this appears to
-     * work. */
+    removed = g_strdup(dir);
+    g_hash_table_remove(plugin->watched_dirs, dir);
 
-    /* first subscribe to new ones */
+    /* listen to the directories this one was covering, parents first */
 
-    for (e = new_dirs; e != NULL; e = g_slist_next(e)) {
-        gboolean found = FALSE;
-        for (f = plugin->watched_dirs; f != NULL; f = g_slist_next(f)) {
-            if (strcmp((gchar *) f->data, (gchar *) e->data) == 0) {
-                found = TRUE;
-                break;
-            }
-        }
-        if (!found) {
-            gconf_client_add_dir(plugin->client, e->data, GCONF_CLIENT_PRELOAD_NONE, NULL);
-            OHM_DEBUG(DBG_GCONF, "Add dir '%s' to be listened", (gchar *) e->data);
-        }
+    g_hash_table_iter_init(&iter, plugin->dirs);
+
+    while (g_hash_table_iter_next(&iter, &child, NULL)) {
+        if (is_child_directory(child, removed))
+            children = g_slist_prepend(children, child);
     }
 
-    /* then unsubscribe from old ones */
+    children = g_slist_sort(children, compare_length);
 
-    for (e = plugin->watched_dirs; e != NULL; e = g_slist_next(e)) {
-        gboolean found = FALSE;
-        for (f = new_dirs; f != NULL; f = g_slist_next(f)) {
-            if (strcmp((gchar *) f->data, (gchar *) e->data) == 0) {
-                found = TRUE;
-                break;
-            }
-        }
-        if (!found) {
-            gconf_client_remove_dir(plugin->client, e->data, NULL);
-            OHM_DEBUG(DBG_GCONF, "Remove dir '%s' from being listened", (gchar *) e->data);
-        }
-        g_free(e->data);
+    for (e = children; e != NULL; e = g_slist_next(e)) {
+        if (!is_watched(plugin, e->data))
+            add_dir(plugin, e->data);
     }
 
-    g_slist_free(plugin->watched_dirs);
-    plugin->watched_dirs = new_dirs;
+    g_slist_free(children);
 
-    return;
+    gconf_client_remove_dir(plugin->client, removed, NULL);
+    OHM_DEBUG(DBG_GCONF, "Remove dir '%s' from being listened", removed);
+    g_free(removed);
 }
 
 void deinit_gconf(gconf_plugin *plugin)
 {
-    GSList *e = NULL, *list;
+    GSList *list;
+    GHashTableIter iter;
+    gpointer data;
     
+    if (plugin->removed) {
+        g_signal_handler_disconnect(G_OBJECT(plugin->fs), plugin->removed);
+        plugin->removed = 0;
+    }
+
     /* free the observers */
 
-    for (e = plugin->observers; e != NULL; e = g_slist_next(e)) {
-        observer *obs = e->data;
+    g_hash_table_iter_init(&iter, plugin->observers);
+
+    while (g_hash_table_iter_next(&iter, NULL, &data)) {
+        observer *obs = data;
         free_observer(obs);
     }
 
@@ -377,15 +454,17 @@ void deinit_gconf(gconf_plugin *plugin)
 
     }
 
-    g_slist_free(plugin->observers);
+    g_hash_table_destroy(plugin->observers);
     plugin->observers = NULL;
 
     /* stop watching all the directories that were being watched */
-    for (e = plugin->watched_dirs; e != NULL; e = g_slist_next(e)) {
-        gconf_client_remove_dir(plugin->client, e->data, NULL);
-        g_free(e->data);
+    g_hash_table_iter_init(&iter, plugin->watched_dirs);
+
+    while (g_hash_table_iter_next(&iter, &data, NULL)) {
+        gconf_client_remove_dir(plugin->client, data, NULL);
     }
-    g_slist_free(plugin->watched_dirs);
+    g_hash_table_destroy(plugin->watched_dirs);
+    g_hash_table_destroy(plugin->dirs);
 
     g_object_unref(plugin->client);
     g_free(plugin);
@@ -396,19 +475,15 @@ void deinit_gconf(gconf_plugin *plugin)
 
 gboolean observe(gconf_plugin *plugin, const gchar *key)
 {
-    GSList *e = NULL;
     observer *obs = NULL;
     GConfEntry *entry = NULL;
 
     
     /* see if we are already observing the key */
 
-    for (e = plugin->observers; e != NULL; e = g_slist_next(e)) {
-        obs = e->data;
-        if (!strcmp(key, obs->key)) {
-            obs->refcount++;
-            return TRUE;
-        }
+    if ((obs = g_hash_table_lookup(plugin->observers, key)) != NULL) {
+        obs->refcount++;
+        return TRUE;
     }
     
     /* create the initial fact */
@@ -419,9 +494,16 @@ gboolean observe(gconf_plugin *plugin, const gchar *key)
         return FALSE;
     }
 
-    if (!update_fact(plugin, entry)) {
+    obs = g_new0(observer, 1);
+
+    obs->key = g_strdup(key);
+    obs->dir = get_directory_from_key(key);
+    obs->refcount = 1;
+
+    if (!update_fact(plugin, obs, entry)) {
         OHM_DEBUG(DBG_GCONF, "ERROR creating the initial fact!");
         gconf_entry_unref(entry);
+        free_observer(obs);
         return FALSE;
     }
 
@@ -429,16 +511,12 @@ gboolean observe(gconf_plugin *plugin, const gchar *key)
 
     /* add new observer */
 
-    obs = g_new0(observer, 1);
+    g_hash_table_insert(plugin->observers, obs->key, obs);
 
-    obs->key = g_strdup(key);
-    obs->refcount = 1;
-
-    plugin->observers = g_slist_prepend(plugin->observers, obs);
-
-    /* recalculate the watched directory set: this enables the key
+    /* update the watched directory set: this enables the key
      * notification */
-    recalculate_directories(plugin);
+    if (obs->dir)
+        watch_directory(plugin, obs->dir);
 
     obs->notify = gconf_client_notify_add(plugin->client, key, notify, plugin, NULL, NULL);
     OHM_DEBUG(DBG_GCONF, "Requested notify for key '%s (id %u)'\n", key, obs->notify);
@@ -449,53 +527,42 @@ gboolean observe(gconf_plugin *plugin, const gchar *key)
 
 gboolean unobserve(gconf_plugin *plugin, const gchar *key)
 {
-    GSList *e = NULL, *f = NULL, *list = NULL;
     observer *obs = NULL;
-    gboolean ret = FALSE;
+    OhmFact *fact = NULL;
 
     /* remove observers */
 
-    for (e = plugin->observers; e != NULL; e = g_slist_next(e)) {
-        obs = e->data;
-        if (!strcmp(key, obs->key)) {
-            obs->refcount--;
-            if (obs->refcount == 0) {
-                
-                /* stop listening to the key */
+    if ((obs = g_hash_table_lookup(plugin->observers, key)) == NULL)
+        return FALSE;
 
-                gconf_client_notify_remove(plugin->client, obs->notify);
+    obs->refcount--;
 
-                /* remove the observer */
-                
-                plugin->observers = g_slist_delete_link(plugin->observers, e);
+    if (obs->refcount == 0) {
 
-                /* remove the fact from the FS that was observed */
+        /* stop listening to the key */
 
-                list = ohm_fact_store_get_facts_by_name(plugin->fs, GCONF_FACT);
-                
-                for (f = list; f != NULL; f = g_slist_next(f)) {
-                    OhmFact *fact = (OhmFact *) f->data;
-                    GValue *gval = ohm_fact_get(fact, "key");
+        gconf_client_notify_remove(plugin->client, obs->notify);
 
-                    if (gval && !strcmp(obs->key, g_value_get_string(gval))) {
-                        ohm_fact_store_remove(plugin->fs, fact);
-                        g_object_unref(fact);
-                        break;
-                    }
-                }
+        /* remove the observer */
 
-                /* recalculate the watched directory set */
-                recalculate_directories(plugin);
+        g_hash_table_remove(plugin->observers, obs->key);
 
-                free_observer(obs);
-                obs = NULL;
-            }
-            ret = TRUE;
-            break;
+        /* remove the fact from the FS that was observed */
+
+        if ((fact = obs->fact) != NULL) {
+            forget_fact(obs);
+            ohm_fact_store_remove(plugin->fs, fact);
+            g_object_unref(fact);
         }
+
+        /* update the watched directory set */
+        if (obs->dir)
+            unwatch_directory(plugin, obs->dir);
+
+        free_observer(obs);
     }
-    
-    return ret;
+
+    return TRUE;
 }
 
 /*
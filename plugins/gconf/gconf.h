@@ -59,9 +59,11 @@ typedef gboolean (*hal_cb) (OhmFact *hal_fact, gchar *capability, gboolean added
 
 typedef struct _gconf_plugin {
     guint notify;
-    GSList *observers;
-    GSList *watched_dirs;
+    GHashTable *observers;          /* key -> observer */
+    GHashTable *watched_dirs;       /* directories added to the client */
+    GHashTable *dirs;               /* directory -> # of observed keys */
     OhmFactStore *fs;
+    gulong removed;                 /* factstore 'removed' handler */
     GConfClient *client;
 } gconf_plugin;
 
@@ -39,16 +39,10 @@ static int DBG_HAL, DBG_FACTS;
 
 /* this uses libhal (for now) */
 
-typedef struct _hal_modified_property {
-    char *udi;
-    char *key;
-    dbus_bool_t is_removed;
-    dbus_bool_t is_added;
-} hal_modified_property;
-
 typedef struct _decorator {
     gchar *capability;
     GSList *devices;
+    GHashTable *facts;      /* udi -> last fact passed to the callback */
     hal_cb cb;
     void *user_data;
 } decorator;
@@ -190,6 +184,59 @@ static gboolean has_udi(decorator *dec, const gchar *udi)
     return FALSE;
 }
 
+static GValue *property_value(LibHalPropertySetIterator *iter)
+{
+    /* Convert the current HAL property of the iterator to a GValue */
+
+    LibHalPropertyType type = libhal_psi_get_type(iter);
+    GValue *val = NULL;
+
+    switch (type) {
+        case LIBHAL_PROPERTY_TYPE_INT32:
+            {
+                dbus_int32_t hal_value = libhal_psi_get_int(iter);
+                val = ohm_value_from_int(hal_value);
+                OHM_DEBUG(DBG_HAL, "int: '%i'", hal_value);
+                break;
+            }
+        case LIBHAL_PROPERTY_TYPE_STRING:
+            {
+                /* freed with propertyset */
+                char *hal_value = libhal_psi_get_string(iter);
+                val = ohm_value_from_string(hal_value);
+                OHM_DEBUG(DBG_HAL, "string: '%s'", hal_value);
+                break;
+            }
+        case LIBHAL_PROPERTY_TYPE_STRLIST:
+            {
+#define STRING_DELIMITER "\\"
+                /* freed with propertyset */
+                char **strlist = libhal_psi_get_strlist(iter);
+                gchar *escaped_string = g_strjoinv(STRING_DELIMITER, strlist);
+                val = ohm_value_from_string(escaped_string);
+                OHM_DEBUG(DBG_HAL, "escaped string: '%s'", escaped_string);
+                g_free(escaped_string);
+                break;
+#undef STRING_DELIMITER
+            }
+        case LIBHAL_PROPERTY_TYPE_BOOLEAN:
+            {
+                dbus_bool_t hal_value = libhal_psi_get_bool(iter);
+                int intval = (hal_value == TRUE) ? 1 : 0;
+                val = ohm_value_from_int(intval);
+                OHM_DEBUG(DBG_HAL, "boolean: '%s'", (hal_value == TRUE) ? "TRUE" : "FALSE");
+                break;
+            }
+        default:
+            OHM_DEBUG(DBG_HAL, "error with value (%i)", type);
+            /* error case, currently means that FactStore doesn't
+             * support the type yet */
+            break;
+    }
+
+    return val;
+}
+
 static OhmFact * create_fact(hal_plugin *plugin, const char *udi,
         const char *capability, LibHalPropertySet *properties)
 {
@@ -225,56 +272,10 @@ static OhmFact * create_fact(hal_plugin *plugin, const char *udi,
 
     for (i = 0; i < len; i++, libhal_psi_next(&iter)) {
         char *key = libhal_psi_get_key(&iter);
-        LibHalPropertyType type = libhal_psi_get_type(&iter);
-        val = NULL;
 
         OHM_DEBUG(DBG_HAL, "key: '%s', ", key);
-        /* Not good to duplicate the switch, consider strategy pattern. Still,
-         * it is a good idea to fetch the properties only once. */
-        switch (type) {
-            case LIBHAL_PROPERTY_TYPE_INT32:
-                {
-                    dbus_int32_t hal_value = libhal_psi_get_int(&iter);
-                    val = ohm_value_from_int(hal_value);
-                    OHM_DEBUG(DBG_HAL, "int: '%i'", hal_value);
-                    break;
-                }
-            case LIBHAL_PROPERTY_TYPE_STRING:
-                {
-                    /* freed with propertyset */
-                    char *hal_value = libhal_psi_get_string(&iter);
-                    val = ohm_value_from_string(hal_value);
-                    OHM_DEBUG(DBG_HAL, "string: '%s'", hal_value);
-                    break;
-                }
-            case LIBHAL_PROPERTY_TYPE_STRLIST:
-                {
-#define STRING_DELIMITER "\\"
-                    /* freed with propertyset */
-                    char **strlist = libhal_psi_get_strlist(&iter);
-                    gchar *escaped_string = g_strjoinv(STRING_DELIMITER, strlist);
-                    val = ohm_value_from_string(escaped_string);
-                    OHM_DEBUG(DBG_HAL, "escaped string: '%s'", escaped_string);
-                    g_free(escaped_string);
-                    break;
-#undef STRING_DELIMITER
-                }
-            case LIBHAL_PROPERTY_TYPE_BOOLEAN:
-                {
-                    dbus_bool_t hal_value = libhal_psi_get_bool(&iter);
-                    int intval = (hal_value == TRUE) ? 1 : 0;
-                    val = ohm_value_from_int(intval);
-                    OHM_DEBUG(DBG_HAL, "boolean: '%s'", (hal_value == TRUE) ? "TRUE" : "FALSE");
-                    break;
-                }
-            default:
-                OHM_DEBUG(DBG_HAL, "error with value (%i)", type);
-                /* error case, currently means that FactStore doesn't
-                 * support the type yet */
-                break;
-        }
 
-        if (val) {
+        if ((val = property_value(&iter)) != NULL) {
             ohm_fact_set(fact, key, val);
         }
     }
@@ -282,6 +283,79 @@ static OhmFact * create_fact(hal_plugin *plugin, const char *udi,
     return fact;
 }
 
+static gboolean value_equal(GValue *a, GValue *b)
+{
+    const gchar *sa, *sb;
+
+    if (G_VALUE_TYPE(a) != G_VALUE_TYPE(b))
+        return FALSE;
+
+    switch (G_VALUE_TYPE(a)) {
+        case G_TYPE_INT:
+            return g_value_get_int(a) == g_value_get_int(b);
+        case G_TYPE_STRING:
+            sa = g_value_get_string(a);
+            sb = g_value_get_string(b);
+            return (sa && sb) ? !strcmp(sa, sb) : sa == sb;
+        default:
+            return FALSE;
+    }
+}
+
+static int update_fact(OhmFact *fact, LibHalPropertySet *properties,
+        GHashTable *keys)
+{
+    /* Diff the modified keys of the property set against the fact and
+     * update only the fields whose value has really changed. Returns
+     * the number of changed fields. */
+
+    LibHalPropertySetIterator iter;
+    GHashTableIter ki;
+    gpointer name;
+    int i, len, changed = 0;
+    GValue *val = NULL, *old = NULL;
+
+    g_hash_table_iter_init(&ki, keys);
+
+    while (g_hash_table_iter_next(&ki, &name, NULL)) {
+        if (libhal_ps_get_type(properties, name) == LIBHAL_PROPERTY_TYPE_INVALID) {
+            if (ohm_fact_get(fact, name) != NULL) {
+                OHM_DEBUG(DBG_HAL, "removed key: '%s'", (char *) name);
+                ohm_fact_del(fact, name);
+                changed++;
+            }
+        }
+    }
+
+    libhal_psi_init(&iter, properties);
+
+    len = libhal_property_set_get_num_elems(properties);
+
+    for (i = 0; i < len; i++, libhal_psi_next(&iter)) {
+        char *key = libhal_psi_get_key(&iter);
+
+        if (!g_hash_table_lookup_extended(keys, key, NULL, NULL))
+            continue;
+
+        if ((val = property_value(&iter)) == NULL)
+            continue;
+
+        if ((old = ohm_fact_get(fact, key)) != NULL && value_equal(old, val)) {
+            /* reported as modified but the value is the same */
+            g_value_unset(val);
+            g_free(val);
+            continue;
+        }
+
+        OHM_DEBUG(DBG_HAL, "modified key: '%s', ", key);
+
+        ohm_fact_set(fact, key, val);
+        changed++;
+    }
+
+    return changed;
+}
+
 
 static gboolean process_decoration(hal_plugin *plugin, decorator *dec, 
         gboolean added, gboolean removed, const gchar *udi)
@@ -312,8 +386,15 @@ static gboolean process_decoration(hal_plugin *plugin, decorator *dec,
 
         fact = create_fact(plugin, udi, dec->capability, properties);
         dec->cb(fact, dec->capability, added, removed, dec->user_data);
-        if (fact)
+        if (fact) {
+            /* keep the fact for updating it on property changes */
+            if (removed)
+                g_hash_table_remove(dec->facts, udi);
+            else
+                g_hash_table_replace(dec->facts, g_strdup(udi),
+                                     g_object_ref(fact));
             g_object_unref(fact);
+        }
         libhal_free_property_set(properties);
     }
 
@@ -397,6 +478,7 @@ static void hal_capability_lost_cb (LibHalContext *ctx,
                 else {
                     OHM_DEBUG(DBG_FACTS, "Device was not found from the decorator list!\n");
                 }
+                g_hash_table_remove(dec->facts, udi);
                 process_decoration(plugin, dec, FALSE, TRUE, udi);
             }
         }
@@ -488,6 +570,7 @@ static void hal_device_removed_cb (LibHalContext *ctx, const char *udi)
             else {
                 OHM_DEBUG(DBG_FACTS, "Device was not found from the decorator list!\n");
             }
+            g_hash_table_remove(dec->facts, udi);
         }
     }
 
@@ -497,26 +580,77 @@ static void hal_device_removed_cb (LibHalContext *ctx, const char *udi)
     return;
 }
 
-static gboolean process_modified_properties(gpointer data)
+static void process_modified_udi(hal_plugin *plugin, const gchar *udi,
+        GHashTable *keys)
 {
-    hal_plugin *plugin = (hal_plugin *) data;
+    /* Fetch the properties of a modified device once and update the
+     * facts of all the decorators interested in it. The callbacks get
+     * the same fact every time with only the changed fields updated,
+     * so a fact kept in the factstore emits field-level updates. */
+
+    LibHalPropertySet *properties = NULL;
+    DBusError error;
     GSList *e = NULL;
+    OhmFact *fact = NULL;
 
-    OHM_DEBUG(DBG_FACTS, "> process_modified_properties\n");
+    for (e = plugin->decorators; e != NULL; e = g_slist_next(e)) {
+        decorator *dec = e->data;
 
-    for (e = plugin->modified_properties; e != NULL; e = g_slist_next(e)) {
+        if (!has_udi(dec, udi))
+            continue;
+
+        if (!properties) {
+            dbus_error_init(&error);
+            properties = libhal_device_get_all_properties(plugin->hal_ctx,
+                    udi, &error);
+
+            if (dbus_error_is_set(&error)) {
+                g_print("Error getting data for HAL object %s. '%s': '%s'\n",
+                        udi, error.name, error.message);
+                dbus_error_free(&error);
+                return;
+            }
+        }
 
-        hal_modified_property *modified_property = e->data;
-        process_udi(plugin, FALSE, FALSE, modified_property->udi);
+        if ((fact = g_hash_table_lookup(dec->facts, udi)) != NULL) {
+            if (!update_fact(fact, properties, keys)) {
+                OHM_DEBUG(DBG_FACTS, "no changes in '%s' for '%s'",
+                          udi, dec->capability);
+                continue;
+            }
+        }
+        else {
+            fact = create_fact(plugin, udi, dec->capability, properties);
+            if (!fact)
+                continue;
+            g_hash_table_replace(dec->facts, g_strdup(udi), fact);
+        }
 
-        g_free(modified_property->udi);
-        g_free(modified_property->key);
-        g_free(modified_property);
-        e->data = NULL;
+        dec->cb(fact, dec->capability, FALSE, FALSE, dec->user_data);
     }
 
-    g_slist_free(plugin->modified_properties);
+    libhal_free_property_set(properties);
+}
+
+static gboolean process_modified_properties(gpointer data)
+{
+    hal_plugin *plugin = (hal_plugin *) data;
+    GHashTable *modified = plugin->modified_properties;
+    GHashTableIter iter;
+    gpointer udi, keys;
+
+    OHM_DEBUG(DBG_FACTS, "> process_modified_properties\n");
+
+    /* changes arriving while we process start a new batch */
     plugin->modified_properties = NULL;
+    plugin->modified_idle = 0;
+
+    g_hash_table_iter_init(&iter, modified);
+
+    while (g_hash_table_iter_next(&iter, &udi, &keys))
+        process_modified_udi(plugin, udi, keys);
+
+    g_hash_table_destroy(modified);
 
     /* do not call again */
     return FALSE;
@@ -531,10 +665,12 @@ static void hal_property_modified_cb (LibHalContext *ctx,
 
     /* This function is called several times when a signal that contains
      * information of multiple HAL property modifications arrives.
-     * Schedule a delayed processing of data in the idle loop. */
+     * Collect the modified keys per device and schedule a delayed
+     * processing of them in the idle loop. */
 
-    hal_modified_property *modified_property = NULL;
     hal_plugin *plugin = (hal_plugin *) libhal_ctx_get_user_data(ctx);
+    GHashTable *keys = NULL;
+    gchar *dup_key;
 
     OHM_DEBUG(DBG_FACTS,"> hal_property_modified_cb: udi '%s', key '%s', %s, %s\n",
               udi, key,
@@ -542,19 +678,21 @@ static void hal_property_modified_cb (LibHalContext *ctx,
               is_added ? "added" : "not added");
 
     if (!plugin->modified_properties) {
-        g_idle_add(process_modified_properties, plugin);
+        plugin->modified_properties =
+            g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                  (GDestroyNotify) g_hash_table_destroy);
+        plugin->modified_idle = g_idle_add(process_modified_properties, plugin);
     }
 
-    modified_property = g_new0(hal_modified_property, 1);
-    
-    modified_property->udi = g_strdup(udi);
-    modified_property->key = g_strdup(key);
-    modified_property->is_removed = is_removed;
-    modified_property->is_added = is_added;
+    keys = g_hash_table_lookup(plugin->modified_properties, udi);
 
-    /* keep the order (even if O(n)) :-P */
-    plugin->modified_properties = g_slist_append(plugin->modified_properties,
-            modified_property);
+    if (!keys) {
+        keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        g_hash_table_insert(plugin->modified_properties, g_strdup(udi), keys);
+    }
+
+    dup_key = g_strdup(key);
+    g_hash_table_replace(keys, dup_key, dup_key);
 
     return;
 }
@@ -608,6 +746,8 @@ gboolean decorate(hal_plugin *plugin, const gchar *capability, hal_cb cb, void *
     dec->cb = cb;
     dec->user_data = user_data;
     dec->capability = g_strdup(capability);
+    dec->facts = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       g_free, g_object_unref);
 
     if (!fill_decorator(plugin, dec))
         goto error;
@@ -631,6 +771,7 @@ static void free_decorator(decorator *dec) {
         g_free(f->data);
     }
     g_slist_free(dec->devices);
+    g_hash_table_destroy(dec->facts);
     g_free(dec);
 
 }
@@ -782,6 +923,16 @@ void deinit_hal(hal_plugin *plugin)
 {
     GSList *e = NULL;
 
+    if (plugin->modified_idle) {
+        g_source_remove(plugin->modified_idle);
+        plugin->modified_idle = 0;
+    }
+
+    if (plugin->modified_properties) {
+        g_hash_table_destroy(plugin->modified_properties);
+        plugin->modified_properties = NULL;
+    }
+
     for (e = plugin->decorators; e != NULL; e = g_slist_next(e)) {
         decorator *dec = e->data;
         free_decorator(dec);
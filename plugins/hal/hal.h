@@ -55,7 +55,8 @@ typedef gboolean (*hal_cb) (OhmFact *hal_fact, gchar *capability, gboolean added
 typedef struct _hal_plugin {
     LibHalContext *hal_ctx;
     DBusConnection *c;
-    GSList *modified_properties;
+    GHashTable *modified_properties;    /* udi -> set of modified keys */
+    guint modified_idle;
     GSList *decorators;
     GSList *watched;
     /* GSList *all_devices; */
@@ -0,0 +1,507 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/**
+ * @file hal-replay-bench.c
+ * @brief Replay recorded HAL property signals through the hal plugin
+ *
+ * The HAL daemon is replaced by a small in-memory device database and
+ * the recorded PropertyModified signals are replayed twice: once the
+ * way the plugin used to process them (a property refetch and a new
+ * fact for every modified key) and once through the batched, diffing
+ * path. The observer keeps the facts it gets in the factstore and the
+ * factstore notifications are counted for both runs.
+ *
+ *  usage: hal-replay-bench [rounds]
+ */
+
+#include <hal/libhal.h>
+#include "../hal-internal.c"
+
+#define DEFAULT_ROUNDS 1000
+
+
+/*
+ * fake HAL device database
+ */
+
+struct LibHalContext_s {
+    void *user_data;
+};
+
+struct LibHalProperty_s {
+    const char         *key;
+    LibHalPropertyType  type;
+    int                 ival;
+    const char         *sval;
+};
+
+struct LibHalPropertySet_s {
+    unsigned int             n;
+    struct LibHalProperty_s *props;
+};
+
+typedef struct {
+    const char              *udi;
+    const char              *capability;
+    struct LibHalProperty_s  props[16];
+} device_t;
+
+#define INT(k, v)  { k, LIBHAL_PROPERTY_TYPE_INT32  , v, NULL }
+#define BOOL(k, v) { k, LIBHAL_PROPERTY_TYPE_BOOLEAN, v, NULL }
+#define STR(k, v)  { k, LIBHAL_PROPERTY_TYPE_STRING , 0, v    }
+
+static device_t devices[] = {
+    { "/org/freedesktop/Hal/devices/bme", "battery", {
+            STR ("info.udi"                        , "/org/freedesktop/Hal/devices/bme"),
+            STR ("info.product"                    , "Battery (BME-HAL)"),
+            STR ("battery.type"                    , "primary"),
+            BOOL("battery.present"                 , 1),
+            BOOL("battery.is_rechargeable"         , 1),
+            BOOL("battery.rechargeable.is_charging", 0),
+            BOOL("battery.rechargeable.is_discharging", 1),
+            INT ("battery.charge_level.design"     , 8),
+            INT ("battery.charge_level.current"    , 6),
+            INT ("battery.charge_level.percentage" , 75),
+            INT ("battery.reporting.design"        , 1320),
+            INT ("battery.reporting.current"       , 990),
+            STR ("battery.reporting.unit"          , "mAh"),
+            INT ("battery.voltage.design"          , 4200),
+            INT ("battery.voltage.current"         , 3920),
+            STR ("battery.voltage.unit"            , "mV"),
+        } },
+    { "/org/freedesktop/Hal/devices/platform_proximity", "button", {
+            STR ("info.udi"                        , "/org/freedesktop/Hal/devices/platform_proximity"),
+            STR ("info.product"                    , "Proximity sensor"),
+            STR ("platform.id"                     , "proximity"),
+            BOOL("button.has_state"                , 1),
+            BOOL("button.state.value"              , 0),
+            STR ("button.type"                     , "proximity"),
+        } },
+};
+
+#define BATTERY   0
+#define PROXIMITY 1
+
+
+/*
+ * recorded PropertyModified signals, one entry per signal
+ */
+
+typedef struct {
+    const char *key;
+    int         ival;
+} change_t;
+
+typedef struct {
+    int       dev;
+    change_t  changes[6];
+} signal_t;
+
+static signal_t recording[] = {
+    { BATTERY  , { { "battery.voltage.current"        , 3918 },
+                   { "battery.reporting.current"      ,  990 },
+                   { "battery.charge_level.current"   ,    6 },
+                   { "battery.charge_level.percentage",   75 } } },
+    { PROXIMITY, { { "button.state.value"             ,    1 } } },
+    { BATTERY  , { { "battery.voltage.current"        , 3915 },
+                   { "battery.reporting.current"      ,  988 },
+                   { "battery.charge_level.current"   ,    6 },
+                   { "battery.charge_level.percentage",   75 } } },
+    { PROXIMITY, { { "button.state.value"             ,    1 } } },
+    { BATTERY  , { { "battery.voltage.current"        , 3915 },
+                   { "battery.reporting.current"      ,  985 },
+                   { "battery.charge_level.current"   ,    6 },
+                   { "battery.charge_level.percentage",   74 } } },
+    { PROXIMITY, { { "button.state.value"             ,    0 } } },
+    { BATTERY  , { { "battery.rechargeable.is_charging"   , 1 },
+                   { "battery.rechargeable.is_discharging", 0 },
+                   { "battery.voltage.current"        , 4010 },
+                   { "battery.reporting.current"      ,  985 },
+                   { "battery.charge_level.current"   ,    6 },
+                   { "battery.charge_level.percentage",   74 } } },
+    { BATTERY  , { { "battery.voltage.current"        , 4030 },
+                   { "battery.reporting.current"      ,  992 },
+                   { "battery.charge_level.current"   ,    6 },
+                   { "battery.charge_level.percentage",   75 } } },
+    { BATTERY  , { { "battery.rechargeable.is_charging"   , 0 },
+                   { "battery.rechargeable.is_discharging", 1 },
+                   { "battery.voltage.current"        , 3920 },
+                   { "battery.reporting.current"      ,  990 },
+                   { "battery.charge_level.current"   ,    6 },
+                   { "battery.charge_level.percentage",   75 } } },
+};
+
+#define DIM(a) (sizeof(a) / sizeof((a)[0]))
+
+static struct LibHalContext_s context;
+static int fetches;
+
+
+static struct LibHalProperty_s *lookup_property(device_t *dev, const char *key)
+{
+    unsigned int i;
+
+    for (i = 0; i < DIM(dev->props) && dev->props[i].key; i++) {
+        if (!strcmp(dev->props[i].key, key))
+            return dev->props + i;
+    }
+
+    return NULL;
+}
+
+static device_t *lookup_device(const char *udi)
+{
+    unsigned int i;
+
+    for (i = 0; i < DIM(devices); i++) {
+        if (!strcmp(devices[i].udi, udi))
+            return devices + i;
+    }
+
+    return NULL;
+}
+
+
+/*
+ * libhal replacements
+ */
+
+void *libhal_ctx_get_user_data(LibHalContext *ctx)
+{
+    return ctx->user_data;
+}
+
+dbus_bool_t libhal_device_add_property_watch(LibHalContext *ctx,
+        const char *udi, DBusError *error)
+{
+    (void) ctx; (void) udi; (void) error;
+    return TRUE;
+}
+
+dbus_bool_t libhal_device_remove_property_watch(LibHalContext *ctx,
+        const char *udi, DBusError *error)
+{
+    (void) ctx; (void) udi; (void) error;
+    return TRUE;
+}
+
+dbus_bool_t libhal_device_query_capability(LibHalContext *ctx,
+        const char *udi, const char *capability, DBusError *error)
+{
+    device_t *dev = lookup_device(udi);
+
+    (void) ctx; (void) error;
+    return dev && !strcmp(dev->capability, capability);
+}
+
+char **libhal_find_device_by_capability(LibHalContext *ctx,
+        const char *capability, int *num_devices, DBusError *error)
+{
+    char **udis = g_new0(char *, DIM(devices) + 1);
+    unsigned int i;
+    int n = 0;
+
+    (void) ctx; (void) error;
+
+    for (i = 0; i < DIM(devices); i++) {
+        if (!strcmp(devices[i].capability, capability))
+            udis[n++] = g_strdup(devices[i].udi);
+    }
+
+    *num_devices = n;
+    return udis;
+}
+
+void libhal_free_string_array(char **str_array)
+{
+    g_strfreev(str_array);
+}
+
+LibHalPropertySet *libhal_device_get_all_properties(LibHalContext *ctx,
+        const char *udi, DBusError *error)
+{
+    LibHalPropertySet *set;
+    device_t *dev = lookup_device(udi);
+
+    (void) ctx; (void) error;
+
+    fetches++;
+
+    set = g_new0(LibHalPropertySet, 1);
+
+    if (dev) {
+        for (set->n = 0; set->n < DIM(dev->props) && dev->props[set->n].key; set->n++)
+            ;
+        set->props = g_memdup(dev->props, set->n * sizeof(set->props[0]));
+    }
+
+    return set;
+}
+
+void libhal_free_property_set(LibHalPropertySet *set)
+{
+    if (set) {
+        g_free(set->props);
+        g_free(set);
+    }
+}
+
+unsigned int libhal_property_set_get_num_elems(LibHalPropertySet *set)
+{
+    return set->n;
+}
+
+LibHalPropertyType libhal_ps_get_type(const LibHalPropertySet *set,
+        const char *key)
+{
+    unsigned int i;
+
+    for (i = 0; i < set->n; i++) {
+        if (!strcmp(set->props[i].key, key))
+            return set->props[i].type;
+    }
+
+    return LIBHAL_PROPERTY_TYPE_INVALID;
+}
+
+void libhal_psi_init(LibHalPropertySetIterator *iter, LibHalPropertySet *set)
+{
+    iter->set = set;
+    iter->idx = 0;
+}
+
+void libhal_psi_next(LibHalPropertySetIterator *iter)
+{
+    iter->idx++;
+}
+
+LibHalPropertyType libhal_psi_get_type(LibHalPropertySetIterator *iter)
+{
+    return iter->set->props[iter->idx].type;
+}
+
+char *libhal_psi_get_key(LibHalPropertySetIterator *iter)
+{
+    return (char *) iter->set->props[iter->idx].key;
+}
+
+char *libhal_psi_get_string(LibHalPropertySetIterator *iter)
+{
+    return (char *) iter->set->props[iter->idx].sval;
+}
+
+dbus_int32_t libhal_psi_get_int(LibHalPropertySetIterator *iter)
+{
+    return iter->set->props[iter->idx].ival;
+}
+
+dbus_bool_t libhal_psi_get_bool(LibHalPropertySetIterator *iter)
+{
+    return iter->set->props[iter->idx].ival ? TRUE : FALSE;
+}
+
+char **libhal_psi_get_strlist(LibHalPropertySetIterator *iter)
+{
+    (void) iter;
+    return NULL;
+}
+
+/* only needed for linking against hal-internal.c */
+
+LibHalContext *libhal_ctx_new(void) { return &context; }
+dbus_bool_t libhal_ctx_set_dbus_connection(LibHalContext *ctx, DBusConnection *conn) { (void) ctx; (void) conn; return TRUE; }
+dbus_bool_t libhal_ctx_set_user_data(LibHalContext *ctx, void *data) { ctx->user_data = data; return TRUE; }
+dbus_bool_t libhal_ctx_set_device_added(LibHalContext *ctx, LibHalDeviceAdded cb) { (void) ctx; (void) cb; return TRUE; }
+dbus_bool_t libhal_ctx_set_device_removed(LibHalContext *ctx, LibHalDeviceRemoved cb) { (void) ctx; (void) cb; return TRUE; }
+dbus_bool_t libhal_ctx_set_device_new_capability(LibHalContext *ctx, LibHalDeviceNewCapability cb) { (void) ctx; (void) cb; return TRUE; }
+dbus_bool_t libhal_ctx_set_device_lost_capability(LibHalContext *ctx, LibHalDeviceLostCapability cb) { (void) ctx; (void) cb; return TRUE; }
+dbus_bool_t libhal_ctx_set_device_property_modified(LibHalContext *ctx, LibHalDevicePropertyModified cb) { (void) ctx; (void) cb; return TRUE; }
+dbus_bool_t libhal_ctx_init(LibHalContext *ctx, DBusError *error) { (void) ctx; (void) error; return TRUE; }
+dbus_bool_t libhal_ctx_shutdown(LibHalContext *ctx, DBusError *error) { (void) ctx; (void) error; return TRUE; }
+dbus_bool_t libhal_ctx_free(LibHalContext *ctx) { (void) ctx; return TRUE; }
+
+
+/*
+ * observer keeping the facts in the factstore
+ */
+
+typedef struct {
+    int      callbacks;
+    int      inserted;
+    int      removed;
+    int      updated;
+    OhmFact *facts[DIM(devices)];
+} replay_t;
+
+static gboolean observer(OhmFact *fact, gchar *capability, gboolean added,
+        gboolean removed, void *user_data)
+{
+    OhmFactStore *fs = ohm_fact_store_get_fact_store();
+    replay_t *r = user_data;
+    GValue *gudi = ohm_fact_get(fact, "udi");
+    device_t *dev = lookup_device(g_value_get_string(gudi));
+    OhmFact **slot = r->facts + (dev - devices);
+
+    (void) capability;
+    (void) added;
+
+    r->callbacks++;
+
+    if (*slot == fact && !removed)
+        return TRUE;
+
+    if (*slot) {
+        ohm_fact_store_remove(fs, *slot);
+        g_object_unref(*slot);
+        *slot = NULL;
+    }
+
+    if (!removed) {
+        ohm_fact_store_insert(fs, fact);
+        *slot = g_object_ref(fact);
+    }
+
+    return TRUE;
+}
+
+static void inserted_cb(OhmFactStore *fs, OhmFact *fact, gpointer data)
+{
+    (void) fs; (void) fact;
+    ((replay_t *) data)->inserted++;
+}
+
+static void removed_cb(OhmFactStore *fs, OhmFact *fact, gpointer data)
+{
+    (void) fs; (void) fact;
+    ((replay_t *) data)->removed++;
+}
+
+static void updated_cb(OhmFactStore *fs, OhmFact *fact, GQuark field,
+        gpointer value, gpointer data)
+{
+    (void) fs; (void) fact; (void) field; (void) value;
+    ((replay_t *) data)->updated++;
+}
+
+
+/*
+ * replay
+ */
+
+static void replay(const char *name, int rounds, gboolean batched)
+{
+    OhmFactStore *fs = ohm_fact_store_get_fact_store();
+    hal_plugin *plugin = g_new0(hal_plugin, 1);
+    replay_t r;
+    gulong ids[3];
+    struct timespec start, end;
+    signal_t *sig;
+    change_t *c;
+    unsigned int i;
+    int round, nsignal = 0, nchange = 0;
+    double usecs;
+
+    memset(&r, 0, sizeof(r));
+    fetches = 0;
+
+    plugin->hal_ctx = &context;
+    context.user_data = plugin;
+
+    ids[0] = g_signal_connect(G_OBJECT(fs), "inserted", G_CALLBACK(inserted_cb), &r);
+    ids[1] = g_signal_connect(G_OBJECT(fs), "removed" , G_CALLBACK(removed_cb) , &r);
+    ids[2] = g_signal_connect(G_OBJECT(fs), "updated" , G_CALLBACK(updated_cb) , &r);
+
+    decorate(plugin, "battery", observer, &r);
+    decorate(plugin, "button" , observer, &r);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < DIM(recording); i++) {
+            sig = recording + i;
+            nsignal++;
+
+            for (c = sig->changes; c->key != NULL; c++) {
+                lookup_property(devices + sig->dev, c->key)->ival = c->ival;
+                nchange++;
+
+                if (batched)
+                    hal_property_modified_cb(&context, devices[sig->dev].udi,
+                                             c->key, FALSE, FALSE);
+                else
+                    process_udi(plugin, FALSE, FALSE, devices[sig->dev].udi);
+            }
+
+            /* the idle callback of the batch */
+            if (batched && plugin->modified_idle) {
+                g_source_remove(plugin->modified_idle);
+                process_modified_properties(plugin);
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    usecs = (end.tv_sec - start.tv_sec) * 1000000.0 +
+        (end.tv_nsec - start.tv_nsec) / 1000.0;
+
+    printf("%-8s %d signals, %d property changes: %d HAL fetches, "
+           "%d callbacks, factstore %d inserted, %d removed, %d updated, "
+           "%.3f usecs/signal\n", name, nsignal, nchange, fetches,
+           r.callbacks, r.inserted, r.removed, r.updated, usecs / nsignal);
+
+    for (i = 0; i < DIM(devices); i++) {
+        if (r.facts[i]) {
+            ohm_fact_store_remove(fs, r.facts[i]);
+            g_object_unref(r.facts[i]);
+        }
+    }
+
+    for (i = 0; i < DIM(ids); i++)
+        g_signal_handler_disconnect(G_OBJECT(fs), ids[i]);
+
+    deinit_hal(plugin);
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+    g_type_init();
+#endif
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    replay("per-key", rounds, FALSE);
+    replay("batched", rounds, TRUE);
+
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -117,7 +117,7 @@ static void bluetooth_changed_cb(fsif_entry_t *entry,
 
     value = override_value(bluetooth);
 
-    dbusif_signal_bluetooth_override(value, DBUSIF_SEND_NOW);
+    dbusif_signal_bluetooth_override(value, DBUSIF_QUEUE);
 }
 
 static char *override_str(int value)
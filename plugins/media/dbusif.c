@@ -46,20 +46,33 @@ typedef struct {
 typedef enum {
     unknown_bus = 0,
     system_bus,
-    session_bus
+    session_bus,
+    bus_max
 } bus_type_t;
 
+typedef enum {
+    privacy_signal = 0,
+    bluetooth_signal,
+    mute_signal,
+    signal_max
+} signal_type_t;
+
 typedef struct msg_queue_s {
-    struct msg_queue_s *next;
+    struct msg_queue_s *next;            /* next slot in the order queued */
     bus_type_t          bus;
-    DBusMessage        *msg;
+    signal_type_t       type;
+    DBusMessage        *msg;             /* latest message, NULL if none */
 } msg_queue_t;
 
 
 static DBusConnection    *sys_conn;      /* connection for D-Bus system bus */
 static DBusConnection    *sess_conn;     /* connection for D-Bus session bus */
 static int                timeout;       /* message timeout in msec */
-static msg_queue_t       *msg_que;       /* queued messages */
+static msg_queue_t        msg_que[bus_max][signal_max]; /* queue slots */
+static msg_queue_t       *que_head;      /* first queued slot */
+static msg_queue_t      **que_tail = &que_head; /* where to append */
+static guint              que_flush_id;  /* idle source to flush queue */
+static unsigned int       que_superseded;/* # of messages never sent */
 
 static void system_bus_init(void);
 static void session_bus_init(const char *);
@@ -74,9 +87,10 @@ static DBusMessage *bluetooth_get_message(DBusMessage *);
 static DBusMessage *mute_req_message( DBusMessage *);
 static DBusMessage *mute_get_message(DBusMessage *);
 
-static void send_message(bus_type_t, DBusMessage *, int);
-static void queue_message(bus_type_t, DBusMessage *);
+static void send_message(bus_type_t, signal_type_t, DBusMessage *, int);
+static void queue_message(bus_type_t, signal_type_t, DBusMessage *);
 static void queue_flush(void);
+static gboolean queue_flush_cb(gpointer);
 static void queue_purge(bus_type_t);
 
 /*! \addtogroup pubif
@@ -120,6 +134,9 @@ void dbusif_exit(OhmPlugin *plugin)
 {
 	(void)plugin;
 	resctl_exit();
+
+	queue_purge(system_bus);
+	queue_purge(session_bus);
 }
 
 DBusHandlerResult dbusif_session_notification(DBusConnection *conn,
@@ -188,7 +205,7 @@ void dbusif_signal_privacy_override(int value, int send_now)
                                            DBUS_TYPE_INVALID);
 
         if (success)
-            send_message(session_bus, msg, send_now);
+            send_message(session_bus, privacy_signal, msg, send_now);
         else
             OHM_ERROR("media [%s]: failed to build message", __FUNCTION__);
     }
@@ -214,7 +231,7 @@ void dbusif_signal_bluetooth_override(int value, int send_now)
                                             DBUS_TYPE_INVALID);
 
         if (success)
-            send_message(session_bus, msg, send_now);
+            send_message(session_bus, bluetooth_signal, msg, send_now);
         else
             OHM_ERROR("media [%s]: failed to build message", __FUNCTION__);
     }
@@ -240,7 +257,7 @@ void dbusif_signal_mute(int value, int send_now)
                                            DBUS_TYPE_INVALID);
 
         if (success)
-            send_message(session_bus, msg, send_now);
+            send_message(session_bus, mute_signal, msg, send_now);
         else
             OHM_ERROR("media [%s]: failed to build message", __FUNCTION__);
     }
@@ -438,7 +455,7 @@ static void session_bus_cleanup(void)
         dbus_connection_unregister_object_path(sess_conn,
                                                DBUS_MEDIA_MANAGER_PATH);
         
-        queue_purge(DBUS_BUS_SESSION);
+        queue_purge(session_bus);
         
         dbus_connection_unref(sess_conn);
         sess_conn = NULL;
@@ -715,12 +732,15 @@ static DBusMessage *mute_get_message(DBusMessage *msg)
     return reply;    
 }
 
-static void send_message(bus_type_t bus, DBusMessage *msg, int send_now)
+static void send_message(bus_type_t     bus,
+                         signal_type_t  type,
+                         DBusMessage   *msg,
+                         int            send_now)
 {
     DBusConnection *conn;
 
     if (!send_now)
-        queue_message(bus, msg);
+        queue_message(bus, type, msg);
     else {
         switch (bus) {
         case system_bus:   conn = sys_conn;    break;
@@ -733,66 +753,112 @@ static void send_message(bus_type_t bus, DBusMessage *msg, int send_now)
         else {
             if (!dbus_connection_send(conn, msg, NULL))
                 OHM_ERROR("media: failed to send D-Bus message");
-            
-            dbus_message_unref(msg);
         }
+
+        dbus_message_unref(msg);
     }
 }
 
-static void queue_message(bus_type_t bus, DBusMessage *msg)
+static void queue_message(bus_type_t bus, signal_type_t type, DBusMessage *msg)
 {
-    msg_queue_t *entry, *last;
+    msg_queue_t *slot;
 
-    for (last = (msg_queue_t *)&msg_que;  last->next;   last = last->next)
-        ;
+    if (bus <= unknown_bus || bus >= bus_max || type >= signal_max) {
+        OHM_ERROR("media: can't queue D-Bus message (bus %d, type %d)",
+                  bus, type);
+        dbus_message_unref(msg);
+        return;
+    }
 
-    if ((entry = malloc(sizeof(msg_queue_t))) == NULL)
-        OHM_ERROR("media: can't get memory to queue D-Bus message");
+    /*
+     * There is a single slot per bus and signal type. Only the latest
+     * value of a signal is of interest for the receivers so a message
+     * queued earlier in the same slot is dropped and the slot keeps its
+     * place in the queue.
+     */
+
+    slot = &msg_que[bus][type];
+
+    if (slot->msg != NULL) {
+        OHM_DEBUG(DBG_DBUS, "superseding queued '%s' signal",
+                  dbus_message_get_member(slot->msg));
+
+        dbus_message_unref(slot->msg);
+        que_superseded++;
+    }
     else {
-        memset(entry, 0, sizeof(msg_queue_t));
-        entry->bus = bus;
-        entry->msg = msg;
+        slot->bus  = bus;
+        slot->type = type;
+        slot->next = NULL;
 
-        last->next = entry;
+        *que_tail = slot;
+        que_tail  = &slot->next;
     }
+
+    slot->msg = msg;
+
+    if (!que_flush_id)
+        que_flush_id = g_idle_add(queue_flush_cb, NULL);
 }
 
 static void queue_flush(void)
 {
-    msg_queue_t *entry, *next;
+    msg_queue_t *slot, *next;
+    DBusMessage *msg;
+
+    if (que_flush_id) {
+        g_source_remove(que_flush_id);
+        que_flush_id = 0;
+    }
 
-    for (entry = msg_que;   entry;   entry = next) {
-        next = entry->next;
+    for (slot = que_head;   slot;   slot = next) {
+        next = slot->next;
+        msg  = slot->msg;
 
-        send_message(entry->bus, entry->msg, DBUSIF_SEND_NOW);
+        slot->next = NULL;
+        slot->msg  = NULL;
 
-        free(entry);
+        send_message(slot->bus, slot->type, msg, DBUSIF_SEND_NOW);
     } /* for */
 
-    msg_que = NULL;
+    que_head = NULL;
+    que_tail = &que_head;
+
+    OHM_DEBUG(DBG_DBUS, "queue flushed, %u messages superseded so far",
+              que_superseded);
 }
 
-static void queue_purge(bus_type_t bus)
+static gboolean queue_flush_cb(gpointer data)
 {
-    msg_queue_t *entry = msg_que, *prev = NULL, *next;
+    (void)data;
+
+    que_flush_id = 0;
+    queue_flush();
 
-    while (entry) {
-        next = entry->next;
+    return FALSE;
+}
 
-        if (entry->bus == bus) {
-            if (entry == msg_que)
-                msg_que = next;
+static void queue_purge(bus_type_t bus)
+{
+    msg_queue_t **prev, *slot;
 
-            if (prev)
-                prev->next = next;
+    for (prev = &que_head;  (slot = *prev) != NULL;  ) {
+        if (slot->bus == bus) {
+            *prev = slot->next;
 
-            dbus_message_unref(entry->msg);
-            free(entry);
-        } else {
-            prev = entry;
+            dbus_message_unref(slot->msg);
+            slot->msg  = NULL;
+            slot->next = NULL;
         }
+        else
+            prev = &slot->next;
+    }
+
+    que_tail = prev;
 
-        entry = next;
+    if (que_head == NULL && que_flush_id) {
+        g_source_remove(que_flush_id);
+        que_flush_id = 0;
     }
 }
 
@@ -106,7 +106,7 @@ static void mute_changed_cb(fsif_entry_t *entry,
 
     OHM_DEBUG(DBG_MUTE, "mute changed to '%s'", mute_str(mute.integer));
 
-    dbusif_signal_mute(mute.integer, DBUSIF_SEND_NOW);
+    dbusif_signal_mute(mute.integer, DBUSIF_QUEUE);
 }
 
 static char *mute_str(int value)
@@ -119,7 +119,7 @@ static void privacy_changed_cb(fsif_entry_t *entry,
         return;
     }
 
-    dbusif_signal_privacy_override(value, DBUSIF_SEND_NOW);
+    dbusif_signal_privacy_override(value, DBUSIF_QUEUE);
 }
 
 static char *override_str(int value)
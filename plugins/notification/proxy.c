@@ -26,6 +26,7 @@ USA.
 #include <stdarg.h>
 #include <stdint.h>
 #include <errno.h>
+#include <time.h>
 
 #include <glib/gmain.h>
 #include <res-conn.h>
@@ -35,6 +36,7 @@ USA.
 #include "dbusif.h"
 #include "ruleif.h"
 #include "resource.h"
+#include "../common/console-command.h"
 
 /*
  * these should match their counterpart
@@ -64,6 +66,11 @@ USA.
 #define CL_HASH_MASK      (CL_HASH_DIM - 1)
 #define CL_HASH_INDEX(i)  (i & CL_HASH_MASK) 
 
+/* event tracing and latency statistics */
+#define TRACE_DIM         256   /* must be a power of 2 */
+#define TRACE_MASK        (TRACE_DIM - 1)
+#define HISTO_BUCKETS     24    /* log2 usec buckets, the last one open */
+
 
 typedef enum {
     state_created = 0,          /* just created after a play request */
@@ -72,6 +79,8 @@ typedef enum {
     state_completed,            /* after reciving status from backend */
     state_stopped,              /* client stop request or lost resources */
     state_killed,               /* client died accrding to D-Bus */
+    state_destroyed,            /* pseudo state for tracing destruction */
+    state_max
 } proxy_state_t;
 
 typedef enum {
@@ -82,6 +91,7 @@ typedef enum {
     client_died,                /* client D-Bus connetion is down */
     client_pause,               /* client pause request */
     client_resume,              /* client resume request */
+    proxy_created,              /* pseudo event for tracing creation */
 } proxy_event_t;
 
 
@@ -98,8 +108,25 @@ typedef struct proxy_s {
     uint32_t         timeout;   /* timer ID or zero if no timer is set */
     void            *data;      /* play data */
     uint32_t         status;    /* status to reply */
+    uint64_t         created;   /* creation time in usecs */
+    uint64_t         entered;   /* time we entered the current state */
 } proxy_t;
 
+typedef struct {
+    uint32_t         id;        /* proxy ID */
+    uint8_t          state;     /* state when the event was received */
+    uint8_t          event;     /* received event */
+    uint8_t          next;      /* state after processing the event */
+    uint64_t         stamp;     /* monotonic time in usecs */
+} trace_entry_t;
+
+typedef struct {
+    uint32_t         count;
+    uint64_t         total;     /* sum of latencies in usecs */
+    uint64_t         max;
+    uint32_t         bucket[HISTO_BUCKETS];
+} histogram_t;
+
 
 static uint32_t      seqno = 1;              /* serial # for unique notif.ID */
 static proxy_t      *idhashtbl[ID_HASH_DIM]; /* for ID based access */
@@ -109,6 +136,11 @@ static uint32_t      play_limit;             /* notif. play limit in msec's */
 static uint32_t      play_timeout;           /* max.time for a play request */
 static uint32_t      stop_timeout;           /* max.time for a stop request */
 
+static trace_entry_t trace[TRACE_DIM];       /* ring of recent events */
+static uint32_t      trace_idx;              /* total # of traced events */
+static histogram_t   transition[state_max][state_max]; /* time in state */
+static histogram_t   play_latency;           /* request to backend */
+
 static proxy_t *proxy_create(uint32_t, const char *, void *);
 static void     proxy_destroy(proxy_t *);
 
@@ -149,6 +181,12 @@ static int premature_stop(proxy_t *);
 
 static uint32_t play_status(proxy_t *, uint32_t);
 
+static uint64_t trace_now(void);
+static void     trace_event(proxy_t *, proxy_event_t, proxy_state_t,
+                            proxy_state_t, uint64_t);
+static void     histogram_add(histogram_t *, uint64_t);
+static void     console_command(char *);
+
 static const char *state_str(proxy_state_t);
 static const char *event_str(proxy_event_t);
 
@@ -183,6 +221,12 @@ void proxy_init(OhmPlugin *plugin)
     play_timeout = play_limit + 30 * SECOND;
     stop_timeout = 10 * SECOND;
 
+    if (console_command_add("notification", console_command)) {
+        OHM_INFO("notification: registered console command handler");
+    }
+    else
+        OHM_INFO("notification: console commands not available");
+
     LEAVE;
 }
 
@@ -241,6 +285,9 @@ int proxy_playback_request(const char *what,    /* eg. ringtone, alarm, etc */
         proxy->state    = state;
         proxy->status   = status;
 
+        trace_event(proxy, proxy_created, state_created, state,
+                    proxy->created);
+
         if (!(mand | opt)) {
             timeout_create(proxy, 0);
         }
@@ -400,6 +447,7 @@ static proxy_t *proxy_create(uint32_t id, const char *client, void *data)
         proxy->client = strdup(client);
         proxy->state  = state_created; 
         proxy->data   = dbusif_engage_data(data);
+        proxy->created = proxy->entered = trace_now();
 
         if (!cl_hash_lookup_client(client))
             dbusif_monitor_client(client, TRUE);
@@ -798,9 +846,14 @@ static int state_machine(proxy_t *proxy, proxy_event_t ev, void *evdata)
     void          *data    = evdata;
     int            success = TRUE;
     int            type    = proxy->type;
+    uint32_t       id      = proxy->id;
     proxy_state_t  state   = proxy->state;
     int            killed  = FALSE;
+    uint64_t       created = proxy->created;
+    uint64_t       entered = proxy->entered;
+    uint64_t       now;
     uint32_t       status;
+    proxy_t        gone;
 
     /* this function can only be called with a good proxy pointer -- it
      * is the job of the caller to verify that */
@@ -952,6 +1005,27 @@ static int state_machine(proxy_t *proxy, proxy_event_t ev, void *evdata)
                   proxy->client,type, state_str(proxy->state));
     }
 
+    now = trace_now();
+
+    if (killed) {
+        /* the proxy is gone, trace it through a stand-in */
+        gone.id      = id;
+        gone.state   = state_destroyed;
+        gone.created = created;
+        gone.entered = entered;
+        proxy = &gone;
+    }
+
+    trace_event(proxy, ev, state, proxy->state, now);
+
+    if (state != proxy->state) {
+        histogram_add(&transition[state][proxy->state], now - entered);
+        proxy->entered = now;
+
+        if (proxy->state == state_forwarded)
+            histogram_add(&play_latency, now - created);
+    }
+
     return success;
 }
 
@@ -1177,6 +1251,123 @@ static uint32_t play_status(proxy_t *proxy, uint32_t granted)
     return play ? NGF_SHORT : NGF_BUSY;
 }
 
+static uint64_t trace_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void trace_event(proxy_t       *proxy,
+                        proxy_event_t  event,
+                        proxy_state_t  state,
+                        proxy_state_t  next,
+                        uint64_t       stamp)
+{
+    trace_entry_t *e = trace + (trace_idx++ & TRACE_MASK);
+
+    e->id    = proxy->id;
+    e->state = state;
+    e->event = event;
+    e->next  = next;
+    e->stamp = stamp;
+}
+
+static void histogram_add(histogram_t *h, uint64_t usecs)
+{
+    int i;
+
+    for (i = 0;  i < HISTO_BUCKETS - 1 && (usecs >> (i + 1));  i++)
+        ;
+
+    h->count++;
+    h->total += usecs;
+    h->bucket[i]++;
+
+    if (usecs > h->max)
+        h->max = usecs;
+}
+
+static void histogram_print(const char *name, histogram_t *h)
+{
+    int i;
+
+    if (!h->count)
+        return;
+
+    printf("%-24s count %u, avg %llu us, max %llu us\n", name, h->count,
+           (unsigned long long)(h->total / h->count),
+           (unsigned long long)h->max);
+
+    for (i = 0;  i < HISTO_BUCKETS;  i++) {
+        if (h->bucket[i]) {
+            printf("    %s%10u us: %u\n", i < HISTO_BUCKETS - 1 ? "<" : ">=",
+                   i < HISTO_BUCKETS - 1 ? 2U << i : 1U << i, h->bucket[i]);
+        }
+    }
+}
+
+static void show_trace(void)
+{
+    trace_entry_t *e;
+    uint32_t       i, first;
+    uint64_t       base;
+
+    first = trace_idx > TRACE_DIM ? trace_idx - TRACE_DIM : 0;
+    base  = trace_idx ? trace[first & TRACE_MASK].stamp : 0;
+
+    printf("last %u of %u proxy events:\n", trace_idx - first, trace_idx);
+
+    for (i = first;  i != trace_idx;  i++) {
+        e = trace + (i & TRACE_MASK);
+        printf("%12llu us  proxy %-10u %-10s %-16s -> %s\n",
+               (unsigned long long)(e->stamp - base), e->id,
+               state_str(e->state), event_str(e->event), state_str(e->next));
+    }
+}
+
+static void show_latency(void)
+{
+    char name[64];
+    int  from, to;
+
+    histogram_print("request -> forwarded", &play_latency);
+
+    for (from = 0;  from < state_max;  from++) {
+        for (to = 0;  to < state_max;  to++) {
+            snprintf(name, sizeof(name), "%s -> %s",
+                     state_str(from), state_str(to));
+            histogram_print(name, &transition[from][to]);
+        }
+    }
+}
+
+static void console_command(char *command)
+{
+    if (!strcmp(command, "help")) {
+        printf("notification help      show this help\n");
+        printf("notification trace     show recent proxy events\n");
+        printf("notification latency   show state transition latencies\n");
+        printf("notification reset     clear the trace and the latencies\n");
+        printf("notification rules     show the rule cache statistics\n");
+    }
+    else if (!strcmp(command, "trace"))
+        show_trace();
+    else if (!strcmp(command, "latency"))
+        show_latency();
+    else if (!strcmp(command, "rules"))
+        ruleif_show_cache();
+    else if (!strcmp(command, "reset")) {
+        trace_idx = 0;
+        memset(transition, 0, sizeof(transition));
+        memset(&play_latency, 0, sizeof(play_latency));
+    }
+    else
+        printf("unknown notification command \"%s\"\n", command);
+}
+
 static const char *state_str(proxy_state_t state)
 {
     switch (state) {
@@ -1186,6 +1377,7 @@ static const char *state_str(proxy_state_t state)
     case state_completed:    return "completed";
     case state_stopped:      return "stopped";
     case state_killed:       return "killed";
+    case state_destroyed:    return "destroyed";
     default:                 return "<unknown>";
     }
 }
@@ -1200,6 +1392,7 @@ static const char *event_str(proxy_event_t event)
     case client_died:       return "client died";
     case client_pause:      return "client pause";
     case client_resume:     return "client resume";
+    case proxy_created:     return "created";
     default:                return "<unknown>";
     }
 }
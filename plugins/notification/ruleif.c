@@ -28,6 +28,7 @@ USA.
 
 #include "plugin.h"
 #include "ruleif.h"
+#include "../common/rule-memo.h"
 
 #define IMPORT(name, func) {name, (char **)&func##_SIGNATURE, (void **)&func} 
 
@@ -56,6 +57,8 @@ static int    notplsh = -1;          /* 'notification-play_short' rule */
 
 static int copy_value(char *, int, void *, char **);
 
+static int memo_eval(int, char **, int, char ***);
+
 
 static int lookup_rules(void)
 {
@@ -96,8 +99,10 @@ static int lookup_rules(void)
     for (i = n = 0;  i < DIM(ruldefs);  i++) {
         rd = ruldefs + i;
 
-        if ((*(rd->rule) = rule_find(rd->name, rd->arity)) >= 0)
+        if ((*(rd->rule) = rule_find(rd->name, rd->arity)) >= 0) {
+            rule_memo_add_rule(*rd->rule, rd->name);
             n++;
+        }
         else {
             OHM_ERROR("notification can't find rule '%s/%d'",
                       rd->name, rd->arity);
@@ -120,20 +125,31 @@ static int lookup_rules(void)
 
 void ruleif_init(OhmPlugin *plugin)
 {
-    (void)plugin;
-
     ENTER;
-    
+
+    rule_memo_init(plugin, "notification", &DBG_RULE);
     lookup_rules();
 
     LEAVE;
 }
 
+void ruleif_exit(OhmPlugin *plugin)
+{
+    (void)plugin;
+
+    rule_memo_exit();
+}
+
+void ruleif_show_cache(void)
+{
+    rule_memo_show();
+}
+
 int ruleif_notification_request(const char *what, ...)
 {
     va_list  ap;
     char    *argv[16];
-    char  ***retval;
+    char   **entry;
     char    *name;
     int      type;
     void    *value;
@@ -145,45 +161,29 @@ int ruleif_notification_request(const char *what, ...)
         lookup_rules();
 
     if (notreq >= 0) {
-        retval = NULL;
-
         argv[i=0] = (char *)'s';
         argv[++i] = (char *)what;
 
-        status = rule_eval(notreq, &retval, (void **)argv, (i+1)/2);
+        status = memo_eval(notreq, argv, (i+1)/2, &entry);
 
-        OHM_DEBUG(DBG_RULE, "rule_eval returned %d (retval %p)",status,retval);
+        if (status > 0 && entry != NULL) {
 
-        if (status <= 0) {
-            if (retval && status < 0)
-                rules_dump_result(retval);
-        }
-        else {
-            if (OHM_LOGGED(INFO))
-                rules_dump_result(retval);
+            success = TRUE;
 
-            if (retval && retval[0] != NULL && retval[1] == NULL) {
+            va_start(ap, what);
 
-                success = TRUE;
+            while ((name = va_arg(ap, char *)) != NULL) {
+                type  = va_arg(ap, int);
+                value = va_arg(ap, void *);
 
-                va_start(ap, what);
-
-                while ((name = va_arg(ap, char *)) != NULL) {
-                    type  = va_arg(ap, int);
-                    value = va_arg(ap, void *);
-
-                    if (!copy_value(name, type, value, retval[0])) {
-                        success = FALSE;
-                        break;
-                    }
+                if (!copy_value(name, type, value, entry)) {
+                    success = FALSE;
+                    break;
                 }
-                    
-                va_end(ap);                    
             }
+                
+            va_end(ap);                    
         }
-
-        if (retval)
-            rules_free_result(retval);
     }
 
     OHM_DEBUG(DBG_RULE, "%s", success ? "succeeded" : "failed");
@@ -197,7 +197,6 @@ int ruleif_notification_events(int     id,
                                int    *length_ret)
 {
     char    *argv[16];
-    char  ***retval;
     char   **entry;
     char   **events;
     int      i, j, n, m;
@@ -208,58 +207,39 @@ int ruleif_notification_events(int     id,
         lookup_rules();
 
     if (notreq >= 0 && notevnt >= 0) {
-        retval = NULL;
-
         argv[i=0] = (char *)'i';
         argv[++i] = (char *)id;
 
-        status = rule_eval(notevnt, &retval, (void **)argv, (i+1)/2);
-
-        OHM_DEBUG(DBG_RULE, "rule_eval returned %d (retval %p)",status,retval);
-
-        if (status <= 0) {
-            if (retval && status < 0)
-                rules_dump_result(retval);
-        }
-        else {
-            if (OHM_LOGGED(INFO))
-                rules_dump_result(retval);
-
-            if (retval && retval[0] != NULL && retval[1] == NULL) {
-                entry = retval[0];
+        status = memo_eval(notevnt, argv, (i+1)/2, &entry);
 
-                if (entry[0] && !strcmp(entry[0], "name") &&
-                    (int)entry[1] == 's' && entry[2] )
-                {
-                    for (m = 3, n = 0;    entry[m];   m += 3, n++)
-                        ;
+        if (status > 0 && entry != NULL &&
+            entry[0] && !strcmp(entry[0], "name") &&
+            (int)entry[1] == 's' && entry[2] )
+        {
+            for (m = 3, n = 0;    entry[m];   m += 3, n++)
+                ;
 
-                    if ((events = malloc(sizeof(char *) * (n+1))) == NULL) {
-                        *events_ret = NULL;
-                        *length_ret = 0;
-                    }
-                    else {
-                        *events_ret = events;
-                        *length_ret = n;
-
-                        for (i = 3, j = 0;   i < m;   i += 3) {
-                            if (!strcmp(entry[i], "value") && 
-                                (int)entry[i+1] == 's')
-                            {
-                                events[j++] = strdup(entry[i+2]);
-                            }
-                        }
-
-                        events[j] = NULL;
-                        
-                        success = TRUE;
+            if ((events = malloc(sizeof(char *) * (n+1))) == NULL) {
+                *events_ret = NULL;
+                *length_ret = 0;
+            }
+            else {
+                *events_ret = events;
+                *length_ret = n;
+
+                for (i = 3, j = 0;   i < m;   i += 3) {
+                    if (!strcmp(entry[i], "value") && 
+                        (int)entry[i+1] == 's')
+                    {
+                        events[j++] = strdup(entry[i+2]);
                     }
                 }
+
+                events[j] = NULL;
+                
+                success = TRUE;
             }
         }
-
-        if (retval)
-            rules_free_result(retval);
     }
 
     OHM_DEBUG(DBG_RULE, "%s", success ? "succeeded" : "failed");
@@ -271,7 +251,6 @@ int ruleif_notification_events(int     id,
 int ruleif_notification_play_short(int id, int *play_ret)
 {
     char    *argv[16];
-    char  ***retval;
     char   **entry;
     int      i;
     int      status;
@@ -281,39 +260,20 @@ int ruleif_notification_play_short(int id, int *play_ret)
         lookup_rules();
 
     if (notplsh >= 0) {
-        retval = NULL;
-
         argv[i=0] = (char *)'i';
         argv[++i] = (char *)id;
 
-        status = rule_eval(notplsh, &retval, (void **)argv, (i+1)/2);
+        status = memo_eval(notplsh, argv, (i+1)/2, &entry);
 
-        OHM_DEBUG(DBG_RULE, "rule_eval returned %d (retval %p)",status,retval);
-
-        if (status <= 0) {
-            if (retval && status < 0)
-                rules_dump_result(retval);
+        if (status > 0 && entry != NULL &&
+            entry[0] && !strcmp(entry[0], "name") &&
+            (int)entry[1] == 's' && !strcmp(entry[2], "play") &&
+            entry[3] && !strcmp(entry[3], "value") &&
+            (int)entry[4] == 'i' && !entry[6])
+        {
+            *play_ret = (int)entry[5];
+            success = TRUE;
         }
-        else {
-            if (OHM_LOGGED(INFO))
-                rules_dump_result(retval);
-
-            if (retval && retval[0] != NULL && retval[1] == NULL) {
-                entry = retval[0];
-
-                if (entry[0] && !strcmp(entry[0], "name") &&
-                    (int)entry[1] == 's' && !strcmp(entry[2], "play") &&
-                    entry[3] && !strcmp(entry[3], "value") &&
-                    (int)entry[4] == 'i' && !entry[6])
-                {
-                    *play_ret = (int)entry[5];
-                    success = TRUE;
-                }
-            }
-        }
-
-        if (retval)
-            rules_free_result(retval);
     }
 
     OHM_DEBUG(DBG_RULE, "%s", success ? "succeeded" : "failed");
@@ -369,6 +329,42 @@ static int copy_value(char *name, int type, void *value, char **entry)
 }
 
 
+/*
+ * Evaluate a rule that is expected to return a single result entry.
+ * The returned entry is owned by the rule cache and stays valid until
+ * the next evaluation.
+ */
+static int memo_eval(int rule, char **argv, int narg, char ***entry_ret)
+{
+    char ***retval;
+    int     status;
+
+    if (rule_memo_lookup(rule, argv, narg, &status, entry_ret))
+        return status;
+
+    retval = NULL;
+    status = rule_eval(rule, &retval, (void **)argv, narg);
+
+    OHM_DEBUG(DBG_RULE, "rule_eval returned %d (retval %p)",status,retval);
+
+    if (status <= 0) {
+        if (retval && status < 0)
+            rules_dump_result(retval);
+    }
+    else {
+        if (OHM_LOGGED(INFO))
+            rules_dump_result(retval);
+    }
+
+    *entry_ret = rule_memo_store(rule, argv, narg, status, retval);
+
+    if (retval)
+        rules_free_result(retval);
+
+    return status;
+}
+
+
 /* 
  * Local Variables:
  * c-basic-offset: 4
@@ -31,6 +31,8 @@ USA.
 typedef struct _OhmPlugin OhmPlugin;
 
 void ruleif_init(OhmPlugin *);
+void ruleif_exit(OhmPlugin *);
+void ruleif_show_cache(void);
 int  ruleif_notification_request(const char *, ...);
 int  ruleif_notification_events(int, char ***, int *);
 int  ruleif_notification_play_short(int, int *);
@@ -0,0 +1,352 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/* playback client and request registry micro-benchmark
+ *
+ * usage: client-bench [notifications-per-client]
+ *
+ * Registers 10, 100 and 1000 playback clients, each with a queued
+ * state request, and handles property notifications for all of them:
+ * every notification looks up its client by D-Bus id and object (once
+ * in the D-Bus handler and once in the state machine), checks the
+ * client's request queue, and completes the request's transaction by
+ * its id, as a policy decision does. The same lookups are timed with
+ * the global list scans the plugin used to do. The state machine, the
+ * D-Bus interface and the factstore are replaced by stubs, so only the
+ * registry lookups are measured, not the cost of a whole notification. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include <glib.h>
+#include <ohm/ohm-plugin.h>
+
+#include "playback.h"
+#include "client.h"
+#include "pbreq.h"
+
+static int DBG_CLIENT, DBG_QUE;
+
+static sm_t bench_sm;
+
+#include "client.c"
+#include "pbreq.c"
+
+#define DEFAULT_NOTIFS 1000
+
+
+void ohm_log(OhmLogLevel level, const gchar *format, ...)
+{
+    va_list ap;
+
+    if (level != OHM_LOG_ERROR)
+        return;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    fputs("\n", stderr);
+    va_end(ap);
+}
+
+/*
+ * stubs for the rest of the plugin
+ */
+
+static sm_t *sm_create(char *name, void *usrdata)
+{
+    (void)name;
+    (void)usrdata;
+
+    return &bench_sm;
+}
+
+static int sm_destroy(sm_t *sm)
+{
+    (void)sm;
+
+    return TRUE;
+}
+
+static int sm_process_event(sm_t *sm, sm_evdata_t *evdata)
+{
+    (void)sm;
+    (void)evdata;
+
+    return TRUE;
+}
+
+static int dbusif_watch_client(const char *id, int watchit)
+{
+    (void)id;
+    (void)watchit;
+
+    return TRUE;
+}
+
+static void dbusif_get_property(char *dbusid, char *object, char *prname,
+                                get_property_cb_t cb)
+{
+    (void)dbusid;
+    (void)object;
+    (void)prname;
+    (void)cb;
+}
+
+static void dbusif_get_all_properties(char *dbusid, char *object,
+                                      char **prnames,
+                                      get_all_properties_cb_t cb)
+{
+    (void)dbusid;
+    (void)object;
+    (void)prnames;
+    (void)cb;
+}
+
+static void dbusif_set_property(char *dbusid, char *object, char *prname,
+                                char *prvalue, set_property_cb_t cb)
+{
+    (void)dbusid;
+    (void)object;
+    (void)prname;
+    (void)prvalue;
+    (void)cb;
+}
+
+int fsif_add_factstore_entry(char *name, fsif_field_t *fldlist)
+{
+    (void)name;
+    (void)fldlist;
+
+    return TRUE;
+}
+
+int fsif_delete_factstore_entry(char *name, fsif_field_t *selist)
+{
+    (void)name;
+    (void)selist;
+
+    return TRUE;
+}
+
+int fsif_update_factstore_entry(char *name, fsif_field_t *selist,
+                                fsif_field_t *fldlist)
+{
+    (void)name;
+    (void)selist;
+    (void)fldlist;
+
+    return TRUE;
+}
+
+/*
+ * the global list scans the registries replaced
+ */
+
+static client_t *scan_client_by_dbus(char *dbusid, char *object)
+{
+    client_t *cl;
+
+    for (cl = cl_head.next;   cl != (void *)&cl_head;   cl = cl->next) {
+        if (cl->dbusid && !strcmp(dbusid, cl->dbusid) &&
+            cl->object && !strcmp(object, cl->object)   )
+            return cl;
+    }
+
+    return NULL;
+}
+
+static pbreq_t *scan_pbreq_first(client_t *cl)
+{
+    pbreq_t *req;
+
+    for (req = rq_head.next;   req != (void *)&rq_head;   req = req->next) {
+        if (req->cl == cl)
+            return req;
+    }
+
+    return NULL;
+}
+
+static pbreq_t *scan_pbreq_by_trid(int trid)
+{
+    pbreq_t *req;
+
+    for (req = rq_head.next;   req != (void *)&rq_head;   req = req->next) {
+        if (req->trid == trid)
+            return req;
+    }
+
+    return NULL;
+}
+
+/*
+ * benchmark
+ */
+
+typedef struct {
+    char dbusid[32];
+    char object[64];
+} bench_client_t;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double handle_notifications(bench_client_t *clients, int nclient,
+                                   int rounds, int scan)
+{
+    client_t *cl;
+    pbreq_t  *req;
+    double    start;
+    int       i, r, failed = 0;
+
+    start = now();
+
+    for (r = 0;  r < rounds;  r++) {
+        for (i = 0;  i < nclient;  i++) {
+            if (scan) {
+                cl  = scan_client_by_dbus(clients[i].dbusid, clients[i].object);
+                cl  = scan_client_by_dbus(clients[i].dbusid, clients[i].object);
+                req = cl ? scan_pbreq_first(cl) : NULL;
+                req = req ? scan_pbreq_by_trid(req->trid) : NULL;
+            }
+            else {
+                cl  = client_find_by_dbus(clients[i].dbusid, clients[i].object);
+                cl  = client_find_by_dbus(clients[i].dbusid, clients[i].object);
+                req = cl ? pbreq_get_first(cl) : NULL;
+                req = req ? pbreq_get_by_trid(req->trid) : NULL;
+            }
+
+            failed += (req == NULL || req->cl != cl);
+        }
+    }
+
+    if (failed) {
+        fprintf(stderr, "%d notifications failed to find their client\n",
+                failed);
+        exit(1);
+    }
+
+    return now() - start;
+}
+
+static void run(int nclient, int notifs, DBusMessage *msg)
+{
+    bench_client_t *clients;
+    client_t       *cl;
+    char            pid[32], stream[32];
+    double          indexed, scanned;
+    int             i, n;
+
+    clients = calloc(nclient, sizeof(clients[0]));
+
+    for (i = 0;  i < nclient;  i++) {
+        /* most applications have a couple of playback objects */
+        snprintf(clients[i].dbusid, sizeof(clients[i].dbusid),
+                 ":1.%d", 100 + i / 2);
+        snprintf(clients[i].object, sizeof(clients[i].object),
+                 "/com/nokia/policy/playback/%d", i);
+        snprintf(pid, sizeof(pid), "%d", 1000 + i / 2);
+        snprintf(stream, sizeof(stream), "stream-%d", i);
+
+        cl = client_create(clients[i].dbusid, clients[i].object, pid, stream);
+
+        if (cl == NULL || pbreq_create(cl, msg) == NULL) {
+            fprintf(stderr, "failed to create client #%d\n", i);
+            exit(1);
+        }
+    }
+
+    /* rekeying keeps the creation order of the clients sharing a pid */
+    if (nclient > 1) {
+        cl = client_find_by_dbus(clients[0].dbusid, clients[0].object);
+        client_set_stream(cl, "1000", "stream-0");
+
+        if (client_find_by_stream("1000", NULL) != cl) {
+            fprintf(stderr, "pid chain order broken by rekeying\n");
+            exit(1);
+        }
+    }
+
+    n = notifs * nclient;
+
+    indexed = handle_notifications(clients, nclient, notifs, FALSE);
+    scanned = handle_notifications(clients, nclient, notifs, TRUE);
+
+    printf("%5d clients: %9.0f notifications/s indexed, "
+           "%9.0f notifications/s scanned\n", nclient,
+           n / indexed, n / scanned);
+
+    for (i = 0;  i < nclient;  i += 2)
+        client_purge(clients[i].dbusid);
+
+    if (cl_head.next != (void *)&cl_head || rq_head.next != (void *)&rq_head ||
+        g_hash_table_size(cl_dbus_hash) || g_hash_table_size(cl_pid_hash) ||
+        g_hash_table_size(rq_trid_hash)) {
+        fprintf(stderr, "clients or requests left after purging\n");
+        exit(1);
+    }
+
+    free(clients);
+}
+
+int main(int argc, char **argv)
+{
+    int          notifs = argc > 1 ? atoi(argv[1]) : DEFAULT_NOTIFS;
+    DBusMessage *msg;
+
+    if (notifs <= 0) {
+        fprintf(stderr, "usage: %s [notifications-per-client]\n", argv[0]);
+        exit(1);
+    }
+
+    client_init(NULL);
+    pbreq_init(NULL);
+
+    msg = dbus_message_new_method_call(":1.1", "/com/nokia/policy/playback/1",
+                                       "org.maemo.Playback", "RequestState");
+
+    printf("%d notifications per client\n", notifs);
+
+    run(  10, notifs     , msg);
+    run( 100, notifs     , msg);
+    run(1000, notifs / 10 > 0 ? notifs / 10 : 1, msg);
+
+    dbus_message_unref(msg);
+
+    return 0;
+}
+
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -23,8 +23,15 @@ USA.
 #define SELIST_DIM 3
 
 static client_listhead_t  cl_head;
+static GHashTable        *cl_dbus_hash;   /* (dbusid,object) => client */
+static GHashTable        *cl_pid_hash;    /* pid => chain of clients */
+static unsigned int       cl_seqno;       /* creation sequence number */
 
-static int init_selist(client_t *, fsif_field_t *, int);
+static guint    dbus_hash(gconstpointer);
+static gboolean dbus_equal(gconstpointer, gconstpointer);
+static void     pid_hash_add(client_t *);
+static void     pid_hash_remove(client_t *);
+static int      init_selist(client_t *, fsif_field_t *, int);
 
 static void client_init(OhmPlugin *plugin)
 {
@@ -35,6 +42,9 @@ static void client_init(OhmPlugin *plugin)
     cl_head.next = (void *)&cl_head;
     cl_head.prev = (void *)&cl_head;
 
+    cl_dbus_hash = g_hash_table_new(dbus_hash, dbus_equal);
+    cl_pid_hash  = g_hash_table_new(g_str_hash, g_str_equal);
+
     (void)plugin;
 }
 
@@ -67,6 +77,7 @@ static client_t *client_create(char *dbusid, char *object,
                 cl->stream   = stream ? strdup(stream) : NULL;
                 cl->playhint = strdup("Play");
                 cl->sm       = sm;  
+                cl->seqno    = ++cl_seqno;
 
                 next = (void *)&cl_head;
                 prev = cl_head.prev;
@@ -76,6 +87,11 @@ static client_t *client_create(char *dbusid, char *object,
                 
                 next->prev = cl;
                 cl->prev   = prev;
+
+                if (cl->dbusid && cl->object)
+                    g_hash_table_insert(cl_dbus_hash, cl, cl);
+
+                pid_hash_add(cl);
                 
                 dbusif_watch_client(dbusid, TRUE);
 
@@ -113,6 +129,12 @@ static void client_destroy(client_t *cl)
 
         dbusif_watch_client(cl->dbusid, FALSE);
 
+        if (cl->dbusid && cl->object &&
+            g_hash_table_lookup(cl_dbus_hash, cl) == cl)
+            g_hash_table_remove(cl_dbus_hash, cl);
+
+        pid_hash_remove(cl);
+
         free(cl->dbusid);
         free(cl->object);
         free(cl->pid);
@@ -143,14 +165,13 @@ static void client_destroy(client_t *cl)
 
 static client_t *client_find_by_dbus(char *dbusid, char *object)
 {
-    client_t *cl;
+    client_t key;
 
     if (dbusid && object) {
-        for (cl = cl_head.next;   cl != (void *)&cl_head;   cl = cl->next){
-            if (cl->dbusid && !strcmp(dbusid, cl->dbusid) &&
-                cl->object && !strcmp(object, cl->object)   )
-                return cl;
-        }
+        key.dbusid = dbusid;
+        key.object = object;
+
+        return g_hash_table_lookup(cl_dbus_hash, &key);
     }
     
     return NULL;
@@ -161,20 +182,41 @@ static client_t *client_find_by_stream(char *pid, char *stream)
     client_t *cl;
 
     if (pid) {
-        for (cl = cl_head.next;   cl != (void *)&cl_head;   cl = cl->next){
-            if (cl->pid && !strcmp(pid, cl->pid)) {
-                if (!stream)
-                    return cl;
+        cl = g_hash_table_lookup(cl_pid_hash, pid);
 
-                if (cl->stream && !strcmp(stream, cl->stream))
-                    return cl;
-            }
+        for (;  cl != NULL;  cl = cl->pidnext) {
+            if (!stream)
+                return cl;
+
+            if (cl->stream && !strcmp(stream, cl->stream))
+                return cl;
         }
     }
     
     return NULL;
 }
 
+static void client_set_stream(client_t *cl, char *pid, char *stream)
+{
+    char *newpid;
+    char *newstr;
+
+    if (cl != NULL) {
+        newpid = pid    ? strdup(pid)    : NULL;
+        newstr = stream ? strdup(stream) : NULL;
+
+        pid_hash_remove(cl);
+
+        free(cl->pid);
+        free(cl->stream);
+
+        cl->pid    = newpid;
+        cl->stream = newstr;
+
+        pid_hash_add(cl);
+    }
+}
+
 static void client_purge(char *dbusid)
 {
     client_t *cl, *nxcl;
@@ -253,6 +295,12 @@ static void client_get_property(client_t *cl, char *prname,
     dbusif_get_property(cl->dbusid, cl->object, prname, usercb);
 }
 
+static void client_get_all_properties(client_t *cl, char **prnames,
+                                      get_all_properties_cb_t usercb)
+{
+    dbusif_get_all_properties(cl->dbusid, cl->object, prnames, usercb);
+}
+
 static void client_set_property(client_t *cl, char *prname, char *prvalue,
                                 set_property_cb_t usercb)
 {
@@ -386,6 +434,83 @@ static void client_save_playback_hint(client_t *cl, client_htype_t type,
     }
 }
 
+static guint dbus_hash(gconstpointer key)
+{
+    const client_t *cl = key;
+
+    return g_str_hash(cl->dbusid) * 31 + g_str_hash(cl->object);
+}
+
+static gboolean dbus_equal(gconstpointer a, gconstpointer b)
+{
+    const client_t *cla = a;
+    const client_t *clb = b;
+
+    return !strcmp(cla->dbusid, clb->dbusid) &&
+           !strcmp(cla->object, clb->object);
+}
+
+static void pid_hash_add(client_t *cl)
+{
+    client_t *head;
+    client_t *prev;
+
+    /*
+     * clients with the same pid are chained in creation order so that
+     * client_find_by_stream() returns the same client as a list scan would,
+     * also when an existing client is rekeyed by client_set_stream()
+     */
+    cl->pidnext = NULL;
+
+    if (cl->pid != NULL) {
+        if ((head = g_hash_table_lookup(cl_pid_hash, cl->pid)) == NULL)
+            g_hash_table_insert(cl_pid_hash, cl->pid, cl);
+        else if (cl->seqno < head->seqno) {
+            /* the key string is owned by the head client; rekey the chain */
+            cl->pidnext = head;
+            g_hash_table_remove(cl_pid_hash, head->pid);
+            g_hash_table_insert(cl_pid_hash, cl->pid, cl);
+        }
+        else {
+            for (prev = head;  prev->pidnext;  prev = prev->pidnext) {
+                if (cl->seqno < prev->pidnext->seqno)
+                    break;
+            }
+
+            cl->pidnext   = prev->pidnext;
+            prev->pidnext = cl;
+        }
+    }
+}
+
+static void pid_hash_remove(client_t *cl)
+{
+    client_t *head;
+    client_t *prev;
+
+    if (cl->pid != NULL &&
+        (head = g_hash_table_lookup(cl_pid_hash, cl->pid)) != NULL)
+    {
+        if (head == cl) {
+            /* the key string is owned by the head client; rekey the chain */
+            g_hash_table_remove(cl_pid_hash, cl->pid);
+
+            if (cl->pidnext != NULL)
+                g_hash_table_insert(cl_pid_hash, cl->pidnext->pid,cl->pidnext);
+        }
+        else {
+            for (prev = head;  prev->pidnext;  prev = prev->pidnext) {
+                if (prev->pidnext == cl) {
+                    prev->pidnext = cl->pidnext;
+                    break;
+                }
+            }
+        }
+    }
+
+    cl->pidnext = NULL;
+}
+
 static int init_selist(client_t *cl, fsif_field_t *selist, int dim)
 {
     if (selist != NULL && dim > 0) {
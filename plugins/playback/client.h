@@ -22,6 +22,7 @@ USA.
 #define __OHM_PLAYBACK_CLIENT_H__
 
 #include <sys/types.h>
+#include <time.h>
 
 #include "sm.h"
 #include "dbusif.h"
@@ -31,11 +32,18 @@ USA.
     struct client_s  *next;  \
     struct client_s  *prev
 
+struct pbreq_s;
+
 typedef struct client_evfire_s {
     unsigned int      evsrc;
     char             *value;
 } client_evfire_t;
 
+typedef struct client_setup_s {
+    struct timespec   start;      /* when the property fetching started */
+    int               batched;    /* properties were fetched with GetAll */
+} client_setup_t;
+
 typedef struct client_s {
     CLIENT_LIST;
     char             *dbusid;     /* D-Bus id of the client */
@@ -51,6 +59,11 @@ typedef struct client_s {
     client_evfire_t   rqsetst;
     client_evfire_t   rqplayhint;
     sm_t             *sm;         /* state machine instance */
+    client_setup_t    setup;      /* setup bookkeeping */
+    unsigned int      seqno;      /* creation order */
+    struct client_s  *pidnext;    /* next client with the same pid */
+    struct pbreq_s   *rqfirst;    /* first queued request of the client */
+    struct pbreq_s   *rqlast;     /* last queued request of the client */
 } client_t;
 
 typedef enum {
@@ -79,6 +92,7 @@ static client_t  *client_create(char *, char *, char *, char *);
 static void       client_destroy(client_t *);
 static client_t  *client_find_by_dbus(char *, char *);
 static client_t  *client_find_by_stream(char *, char *);
+static void       client_set_stream(client_t *, char *, char *);
 static void       client_purge(char *);
 
 static int        client_add_factstore_entry(char *, char *, char *, char *);
@@ -86,6 +100,8 @@ static void       client_delete_factsore_entry(client_t *);
 static void       client_update_factstore_entry(client_t *, char *, void *);
 
 static void       client_get_property(client_t *, char *, get_property_cb_t);
+static void       client_get_all_properties(client_t *, char **,
+                                            get_all_properties_cb_t);
 static void       client_set_property(client_t *, char *, char *,
                                       set_property_cb_t);
 
@@ -22,6 +22,8 @@ USA.
 
 /*! \defgroup pubif Public Interfaces */
 
+#define GETALL_MAX_PROPS  16    /* max. number of properties per GetAll */
+
 typedef struct {
     char                 *dbusid;
     char                 *object;
@@ -29,6 +31,13 @@ typedef struct {
     get_property_cb_t     usercb;
 } get_property_cb_data_t;
 
+typedef struct {
+    char                 *dbusid;
+    char                 *object;
+    char                **prnames;
+    get_all_properties_cb_t usercb;
+} get_all_properties_cb_data_t;
+
 typedef struct {
     char                 *dbusid;
     char                 *object;
@@ -59,6 +68,9 @@ static DBusHandlerResult method(DBusConnection *, DBusMessage *, void *);
 
 static void get_property_cb(DBusPendingCall *, void *);
 static void free_get_property_cb_data(void *);
+static void get_all_properties_cb(DBusPendingCall *, void *);
+static void free_get_all_properties_cb_data(void *);
+static int  parse_all_properties(DBusMessage *, char **, char **);
 static void set_property_cb(DBusPendingCall *, void *);
 static void free_set_property_cb_data(void *);
 static void initialize_notification_registry(void);
@@ -535,6 +547,90 @@ static void dbusif_get_property(char *dbusid, char *object, char *prname,
     return;
 }
 
+/*
+ * Fetch all the listed properties in one round trip with a
+ * Properties.GetAll call. The callback gets the property values in the
+ * order of prnames. If the client does not support GetAll or does not
+ * report all the listed properties the callback gets NULL values so
+ * the caller can fall back to per-property queries.
+ */
+static void dbusif_get_all_properties(char *dbusid, char *object,
+                                      char **prnames,
+                                      get_all_properties_cb_t usercb)
+{
+    static char     *pbif   = DBUS_PLAYBACK_INTERFACE;
+    static char     *propif = DBUS_INTERFACE_PROPERTIES;
+
+    DBusMessage     *msg;
+    DBusPendingCall *pend;
+    get_all_properties_cb_data_t *ud;
+    int              nprop;
+    int              success;
+
+    for (nprop = 0;  prnames[nprop];  nprop++)
+        ;
+
+    if (nprop > GETALL_MAX_PROPS) {
+        OHM_ERROR("[%s] too many properties (%d) for one query",
+                  __FUNCTION__, nprop);
+        usercb(dbusid, object, prnames, NULL);
+        return;
+    }
+
+    if ((ud = malloc(sizeof(*ud))) == NULL) {
+        OHM_ERROR("[%s] Failed to allocate memory for callback data",
+                  __FUNCTION__);
+        usercb(dbusid, object, prnames, NULL);
+        return;
+    }
+
+    memset(ud, 0, sizeof(*ud));
+    ud->dbusid  = strdup(dbusid);
+    ud->object  = strdup(object);
+    ud->prnames = prnames;
+    ud->usercb  = usercb;
+
+    msg = dbus_message_new_method_call(dbusid, object, propif, "GetAll");
+
+    if (msg == NULL) {
+        OHM_ERROR("[%s] Failed to create D-Dbus message to get properties",
+                  __FUNCTION__);
+        free_get_all_properties_cb_data(ud);
+        usercb(dbusid, object, prnames, NULL);
+        return;
+    }
+
+    success = dbus_message_append_args(msg,
+                                       DBUS_TYPE_STRING, &pbif,
+                                       DBUS_TYPE_INVALID);
+    if (!success) {
+        OHM_ERROR("[%s] Can't setup D-Bus message to get properties",
+                  __FUNCTION__);
+        goto failed;
+    }
+    
+    success = dbus_connection_send_with_reply(sess_conn, msg, &pend, timeout);
+    if (!success) {
+        OHM_ERROR("[%s] Failed to query properties", __FUNCTION__);
+        goto failed;
+    }
+
+    success = dbus_pending_call_set_notify(pend, get_all_properties_cb, ud,
+                                           free_get_all_properties_cb_data);
+    if (!success) {
+        OHM_ERROR("[%s] Can't set notification for pending call",__FUNCTION__);
+    }
+
+ failed:
+    if (!success) {
+        /* failed to send the dbus query, free cb data */
+        free_get_all_properties_cb_data(ud);
+        usercb(dbusid, object, prnames, NULL);
+    }
+    dbus_message_unref(msg);
+    return;
+}
+
 static void dbusif_set_property(char *dbusid, char *object, char *prname,
                                 char *prvalue, set_property_cb_t usercb)
 {
@@ -1394,6 +1490,161 @@ static void free_get_property_cb_data(void *memory)
     }
 }
 
+static void get_all_properties_cb(DBusPendingCall *pend, void *data)
+{
+    get_all_properties_cb_data_t *cbd = (get_all_properties_cb_data_t *)data;
+    DBusMessage        *reply;
+    char               *prvalues[GETALL_MAX_PROPS + 1];
+    char              **values;
+    int                 i;
+
+    memset(prvalues, 0, sizeof(prvalues));
+    values = NULL;
+
+    if ((reply = dbus_pending_call_steal_reply(pend)) == NULL || cbd == NULL) {
+        OHM_ERROR("[%s] Property receiving failed: invalid argument",
+                  __FUNCTION__);
+        goto unref_and_out;
+    }
+
+    if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+        OHM_DEBUG(DBG_DBUS, "GetAll is not supported by %s%s (%s)",
+                  cbd->dbusid, cbd->object,
+                  dbus_message_get_error_name(reply));
+    }
+    else if (client_find_by_dbus(cbd->dbusid, cbd->object) == NULL) {
+        OHM_DEBUG(DBG_DBUS, "Property receiving failed: playback is gone");
+        goto unref_and_out;
+    }
+    else if (parse_all_properties(reply, cbd->prnames, prvalues)) {
+        for (i = 0;  cbd->prnames[i];  i++) {
+            OHM_DEBUG(DBG_DBUS, "Received property %s=%s",
+                      cbd->prnames[i], prvalues[i]);
+        }
+        values = prvalues;
+    }
+    else {
+        OHM_DEBUG(DBG_DBUS, "Incomplete GetAll reply from %s%s",
+                  cbd->dbusid, cbd->object);
+    }
+
+    if (cbd->usercb != NULL)
+        cbd->usercb(cbd->dbusid, cbd->object, cbd->prnames, values);
+
+ unref_and_out:
+    for (i = 0;  i < GETALL_MAX_PROPS;  i++)
+        free(prvalues[i]);
+
+    if (reply)
+        dbus_message_unref(reply);
+
+    dbus_pending_call_unref(pend);
+}
+
+static void free_get_all_properties_cb_data(void *memory)
+{
+    get_all_properties_cb_data_t *cbd = (get_all_properties_cb_data_t *)memory;
+
+    OHM_DEBUG(DBG_DBUS, "Freeing get all properties callback data");
+
+    if (cbd != NULL) {
+        free(cbd->dbusid);
+        free(cbd->object);
+
+        free(cbd);
+    }
+}
+
+/*
+ * Pick the values of the listed properties out of an a{sv} GetAll
+ * reply. String, integer and boolean values are accepted and are
+ * converted to strings as the legacy Get method would return them.
+ * Returns TRUE only if every listed property was found.
+ */
+static int parse_all_properties(DBusMessage *reply, char **prnames,
+                                char **prvalues)
+{
+    DBusMessageIter  rit, ait, dit, vit;
+    char            *name;
+    char            *strval;
+    dbus_int32_t     ival;
+    dbus_uint32_t    uval;
+    dbus_bool_t      bval;
+    char             buf[32];
+    char            *value;
+    int              i;
+    int              missing;
+
+    if (!dbus_message_iter_init(reply, &rit) ||
+        dbus_message_iter_get_arg_type(&rit) != DBUS_TYPE_ARRAY)
+        return FALSE;
+
+    dbus_message_iter_recurse(&rit, &ait);
+
+    while (dbus_message_iter_get_arg_type(&ait) == DBUS_TYPE_DICT_ENTRY) {
+        dbus_message_iter_recurse(&ait, &dit);
+        dbus_message_iter_next(&ait);
+
+        if (dbus_message_iter_get_arg_type(&dit) != DBUS_TYPE_STRING)
+            continue;
+
+        dbus_message_iter_get_basic(&dit, &name);
+        dbus_message_iter_next(&dit);
+
+        for (i = 0;  prnames[i];  i++) {
+            if (!strcmp(name, prnames[i]))
+                break;
+        }
+
+        if (prnames[i] == NULL || prvalues[i] != NULL)
+            continue;
+
+        if (dbus_message_iter_get_arg_type(&dit) == DBUS_TYPE_VARIANT)
+            dbus_message_iter_recurse(&dit, &vit);
+        else
+            vit = dit;
+
+        switch (dbus_message_iter_get_arg_type(&vit)) {
+
+        case DBUS_TYPE_STRING:
+            dbus_message_iter_get_basic(&vit, &strval);
+            value = strval;
+            break;
+
+        case DBUS_TYPE_INT32:
+            dbus_message_iter_get_basic(&vit, &ival);
+            snprintf(buf, sizeof(buf), "%d", ival);
+            value = buf;
+            break;
+
+        case DBUS_TYPE_UINT32:
+            dbus_message_iter_get_basic(&vit, &uval);
+            snprintf(buf, sizeof(buf), "%u", uval);
+            value = buf;
+            break;
+
+        case DBUS_TYPE_BOOLEAN:
+            dbus_message_iter_get_basic(&vit, &bval);
+            value = bval ? "1" : "0";
+            break;
+
+        default:
+            OHM_DEBUG(DBG_DBUS, "ignoring property %s of unsupported type",
+                      name);
+            continue;
+        }
+
+        prvalues[i] = strdup(value);
+    }
+
+    for (i = 0, missing = 0;  prnames[i];  i++) {
+        if (prvalues[i] == NULL)
+            missing++;
+    }
+
+    return !missing;
+}
+
 static void set_property_cb(DBusPendingCall *pend, void *data)
 {
     set_property_cb_data_t *cbd = (set_property_cb_data_t *)data;
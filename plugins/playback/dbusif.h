@@ -67,6 +67,7 @@ USA.
 #define DBUS_POLICY_DECISION_PATH        "/com/nokia/policy/decision"
 
 typedef void  (*get_property_cb_t)(char *, char *, char *, char *);
+typedef void  (*get_all_properties_cb_t)(char *, char *, char **, char **);
 typedef void  (*set_property_cb_t)(char *, char *, char *, char *,
                                    int, const char *);
 typedef void  (*notify_property_cb_t)(char *, char *, char *, char *);
@@ -81,6 +82,8 @@ static void dbusif_reply_to_req_state(DBusMessage *, const char *);
 static void dbusif_reply(DBusMessage *);
 static void dbusif_reply_with_error(DBusMessage *, const char *, const char *);
 static void dbusif_get_property(char *, char *, char *, get_property_cb_t);
+static void dbusif_get_all_properties(char *, char *, char **,
+                                      get_all_properties_cb_t);
 static void dbusif_set_property(char *, char *, char *, char *,
                                 set_property_cb_t);
 static void dbusif_add_property_notification(char *, notify_property_cb_t);
@@ -19,6 +19,7 @@ USA.
 
 
 static pbreq_listhead_t  rq_head;
+static GHashTable       *rq_trid_hash;  /* trid => request */
 
 static void pbreq_init(OhmPlugin *plugin)
 {
@@ -26,6 +27,8 @@ static void pbreq_init(OhmPlugin *plugin)
 
     rq_head.next = (void *)&rq_head;
     rq_head.prev = (void *)&rq_head;
+
+    rq_trid_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
 }
 
 static pbreq_t *pbreq_create(client_t *cl, DBusMessage *msg)
@@ -54,6 +57,17 @@ static pbreq_t *pbreq_create(client_t *cl, DBusMessage *msg)
             next->prev = req;
             req->prev  = prev;
 
+            if (cl != NULL) {
+                if ((req->clprev = cl->rqlast) != NULL)
+                    cl->rqlast->clnext = req;
+                else
+                    cl->rqfirst = req;
+
+                cl->rqlast = req;
+            }
+
+            g_hash_table_insert(rq_trid_hash, GINT_TO_POINTER(req->trid), req);
+
             OHM_DEBUG(DBG_QUE, "playback request %d created", req->trid);
         }
     }
@@ -75,6 +89,20 @@ static void pbreq_destroy(pbreq_t *req)
         prev->next = req->next;
         next->prev = req->prev;
 
+        if (req->cl != NULL) {
+            if (req->clprev != NULL)
+                req->clprev->clnext = req->clnext;
+            else
+                req->cl->rqfirst = req->clnext;
+
+            if (req->clnext != NULL)
+                req->clnext->clprev = req->clprev;
+            else
+                req->cl->rqlast = req->clprev;
+        }
+
+        g_hash_table_remove(rq_trid_hash, GINT_TO_POINTER(req->trid));
+
         if (req->msg != NULL)
             dbus_message_unref(req->msg);
 
@@ -99,37 +127,23 @@ static void pbreq_destroy(pbreq_t *req)
 
 static pbreq_t *pbreq_get_first(client_t *cl)
 {
-    pbreq_t *req;
-
-    for (req = rq_head.next;   req != (void *)&rq_head;   req = req->next) {
-        if (req->cl == cl)
-            return req;
-    }
-
-    return NULL;
+    return cl ? cl->rqfirst : NULL;
 }
 
 static pbreq_t *pbreq_get_by_trid(int trid)
 {
-    pbreq_t *req;
-
-    for (req = rq_head.next;   req != (void *)&rq_head;   req = req->next) {
-        if (req->trid == trid)
-            return req;
-    }
-
-    return NULL;
+    return g_hash_table_lookup(rq_trid_hash, GINT_TO_POINTER(trid));
 }
 
 static void pbreq_purge(client_t *cl)
 {
     pbreq_t *req, *nxreq;
 
-    for (req = rq_head.next;   req != (void *)&rq_head;   req = nxreq) {
-        nxreq = req->next;
-
-        if (cl == req->cl)
+    if (cl != NULL) {
+        for (req = cl->rqfirst;   req != NULL;   req = nxreq) {
+            nxreq = req->clnext;
             pbreq_destroy(req);
+        }
     }
 }
 
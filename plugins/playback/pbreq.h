@@ -35,6 +35,8 @@ typedef enum {
 typedef struct pbreq_s {
     PBREQ_LIST;
     struct client_s  *cl;
+    struct pbreq_s   *clnext;   /* next request of the same client */
+    struct pbreq_s   *clprev;   /* previous request of the same client */
     DBusMessage      *msg;
     int               trid;     /* transaction id */
     int               waiting;  /* waiting for transaction completion */
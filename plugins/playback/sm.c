@@ -270,6 +270,7 @@ static void  fire_hello_signal_event(char *, char *);
 static void  fire_client_gone_event(char *, char *);
 static void  fire_state_signal_event(char *, char *, char *, char *);
 static void  read_property_cb(char *, char *, char *, char *);
+static void  read_all_properties_cb(char *, char *, char **, char **);
 static void  write_property_cb(char *,char *, char *,char *, int,const char *);
 static void  setstate_cb(fsif_entry_t *, char *, fsif_field_t *, void *);
 static void  playhint_cb(fsif_entry_t *, char *, fsif_field_t *, void *);
@@ -718,9 +719,18 @@ static int read_property(sm_evdata_t *evdata, void *usrdata)
 {
     (void)evdata;
 
+    static char *setup_props[] = { "Pid", "Class", "State", "Flags", NULL };
+
     client_t  *cl = (client_t *)usrdata;
 
-    client_get_property(cl, "Pid"  , read_property_cb);
+    clock_gettime(CLOCK_MONOTONIC, &cl->setup.start);
+    cl->setup.batched = FALSE;
+
+    /*
+     * try to get all the properties in one go; read_all_properties_cb()
+     * falls back to the property-by-property chain for legacy clients
+     */
+    client_get_all_properties(cl, setup_props, read_all_properties_cb);
 
     return TRUE;
 }
@@ -740,15 +750,18 @@ static int save_property(sm_evdata_t *evdata, void *usrdata)
     sm_evdata_t *schedev;
     int          state_accepted;
     char        *end;
+    struct timespec now;
+    long         usec;
 
     if (!strcmp(property->name, "Pid")) {
-        cl->pid = strdup(property->value);
+        client_set_stream(cl, property->value, cl->stream);
         client_update_factstore_entry(cl, "pid", cl->pid);
         
         OHM_DEBUG(DBG_TRANS, "[%s] playback pid is set to %s",
                   sm->name, cl->pid);
 
-        client_get_property(cl, "Class", read_property_cb);
+        if (!cl->setup.batched)
+            client_get_property(cl, "Class", read_property_cb);
     }
     else if (!strcmp(property->name, "Class")) {
         group = class_to_group(property->value);
@@ -759,7 +772,8 @@ static int save_property(sm_evdata_t *evdata, void *usrdata)
         OHM_DEBUG(DBG_TRANS, "[%s] playback group is set to %s",
                   sm->name, cl->group);
 
-        client_get_property(cl, "State", read_property_cb);
+        if (!cl->setup.batched)
+            client_get_property(cl, "State", read_property_cb);
     }
     else if (!strcmp(property->name, "State")) {
         strncpylower(state, property->value, sizeof(state));
@@ -770,7 +784,8 @@ static int save_property(sm_evdata_t *evdata, void *usrdata)
         OHM_DEBUG(DBG_TRANS, "[%s] playback state is set to %s",
                   sm->name, cl->state);
 
-        client_get_property(cl, "Flags", read_property_cb);
+        if (!cl->setup.batched)
+            client_get_property(cl, "Flags", read_property_cb);
     }
     else if (!strcmp(property->name, "Flags")) {
         cl->flags = strtol(property->value, &end, 10);
@@ -825,6 +840,14 @@ static int save_property(sm_evdata_t *evdata, void *usrdata)
 
         sm_rename(cl->sm, name);
 
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        usec = (now.tv_sec  - cl->setup.start.tv_sec ) * 1000000 +
+               (now.tv_nsec - cl->setup.start.tv_nsec) / 1000;
+
+        OHM_DEBUG(DBG_CLIENT, "[%s] setup took %ld.%03ld msec (%s)",
+                  cl->sm->name, usec / 1000, usec % 1000,
+                  cl->setup.batched ? "GetAll" : "per-property Get");
+
         dbusif_send_stream_info_to_pep("register", cl->group,
                                        cl->pid, cl->stream);
 
@@ -989,11 +1012,7 @@ static int process_pbreq(sm_evdata_t *evdata, void *usrdata)
                                                    old_pid, old_str);
                 }
 
-                if (cl->pid)    free(cl->pid);
-                if (cl->stream) free(cl->stream);
-
-                cl->pid    = pid    ? strdup(pid)    : NULL;
-                cl->stream = stream ? strdup(stream) : NULL;
+                client_set_stream(cl, pid, stream);
 
                 client_update_factstore_entry(cl, "pid", pid);
                 if (stream) {
@@ -1287,6 +1306,42 @@ static void read_property_cb(char *dbusid, char *object,
     sm_process_event(cl->sm, &evdata);
 }
 
+static void read_all_properties_cb(char *dbusid, char *object,
+                                   char **prnames, char **prvalues)
+{
+    client_t             *cl;
+    sm_evdata_t           evdata;
+    sm_evdata_property_t *property = &evdata.property;
+    int                   i;
+
+    if ((cl = client_find_by_dbus(dbusid, object)) == NULL) {
+        OHM_ERROR("[%s] Can't find client %s%s any more",
+                  __FUNCTION__, dbusid, object);
+        return;
+    }
+
+    if (prvalues == NULL) {
+        OHM_DEBUG(DBG_TRANS, "[%s] falling back to per-property setup",
+                  cl->sm->name);
+
+        cl->setup.batched = FALSE;
+        client_get_property(cl, prnames[0], read_property_cb);
+
+        return;
+    }
+
+    cl->setup.batched = TRUE;
+
+    for (i = 0;  prnames[i];  i++) {
+        memset(&evdata, 0, sizeof(evdata));
+        property->evid  = evid_property_received;
+        property->name  = prnames[i];
+        property->value = prvalues[i];
+
+        sm_process_event(cl->sm, &evdata);
+    }
+}
+
 static void write_property_cb(char *dbusid, char *object, char *prname,
                               char *prvalue, int success, const char *error)
 {
@@ -26,10 +26,14 @@ USA.
  * Copyright (C) 2008, Nokia. All rights reserved.
  */
 
+#include <fcntl.h>
+#include <pthread.h>
+
 #include "profile.h"
 
 static int  profile_load_state(void);
-static int  profile_save_state(OhmFact *fact);
+static void profile_schedule_save(void);
+static void profile_flush_state(void);
 static void reconnect_profile(void);
 
 static int DBG_PROFILE, DBG_FACTS;
@@ -41,6 +45,32 @@ OHM_DEBUG_PLUGIN(profile,
 static profile_plugin *profile_plugin_p;
 static DBusConnection *bus_conn;
 
+/*
+ * State saving: changes are coalesced for PROFILE_SAVE_DELAY msecs, then
+ * the fact is serialized in the main loop and the buffer is handed over
+ * to a writer thread, which writes it to a temporary file and renames it
+ * over the saved state. Only the latest pending buffer is ever written.
+ */
+
+typedef struct {
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+    pthread_t        thread;
+    int              started;                /* writer thread running */
+    int              stop;                   /* writer asked to exit */
+    gchar           *data;                   /* pending state to write */
+    gsize            size;                   /* pending state size */
+    int              error;                  /* last write error */
+    unsigned int     written;                /* number of states written */
+} state_writer_t;
+
+static const char     *save_path = PROFILE_SAVE_PATH;
+static guint           save_timer;
+static state_writer_t  writer = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
 static void plugin_init(OhmPlugin * plugin)
 {
     (void) plugin;
@@ -66,6 +96,8 @@ static void plugin_exit(OhmPlugin * plugin)
     if (profile_plugin_p) {
         deinit_profile(profile_plugin_p);
     }
+
+    profile_flush_state();
     
     if (bus_conn != NULL) {
         dbus_connection_unref(bus_conn);
@@ -240,14 +272,45 @@ static gboolean profile_create_fact(const char *profile, profileval_t *values)
 
     OHM_DEBUG(DBG_PROFILE, "created fact: fs: %p, fact: %p", fs, fact);
 
-    profile_save_state(fact);
+    profile_schedule_save();
     
     return TRUE;
 }
 
 
-static int save_field(FILE *fp, const gchar *key, GValue *value)
+/*
+ * Saved state format: the magic PROFILE_STATE_MAGIC followed by one
+ * record per field,
+ *
+ *     <type: 's', 'i' or 'f'> <key> '\0' <value as a string> '\0'
+ *
+ * and finally an 'E' and the 32-bit FNV-1a checksum of everything before
+ * it in network byte order. A file without a valid trailer is torn and
+ * is rejected as a whole.
+ */
+
+#define PROFILE_STATE_MAGIC "OHMPROF1"
+#define PROFILE_STATE_MAGIC_LEN (sizeof(PROFILE_STATE_MAGIC) - 1)
+#define PROFILE_STATE_TRAILER_LEN 5
+
+static guint32 state_checksum(const gchar *data, gsize size)
 {
+    guint32 hash = 2166136261U;
+    gsize   i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= (guchar)data[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+
+static int save_field(GString *buf, const gchar *key, GValue *value)
+{
+    gchar dbl[G_ASCII_DTOSTR_BUF_SIZE];
+
     if (value == NULL)
         return EINVAL;
     
@@ -256,149 +319,409 @@ static int save_field(FILE *fp, const gchar *key, GValue *value)
      *   day we'd like to support some other types as well.
      */
 
-    fprintf(fp, "%s\n", key);
-
     switch (G_VALUE_TYPE(value)) {
     case G_TYPE_STRING:
-        fprintf(fp, "s:%s\n", g_value_get_string(value));
+        g_string_append_c(buf, 's');
+        g_string_append_len(buf, key, strlen(key) + 1);
+        g_string_append(buf, g_value_get_string(value));
         break;
     case G_TYPE_INT:
-        fprintf(fp, "i:%d\n", g_value_get_int(value));
+        g_string_append_c(buf, 'i');
+        g_string_append_len(buf, key, strlen(key) + 1);
+        g_string_append_printf(buf, "%d", g_value_get_int(value));
         break;
     case G_TYPE_DOUBLE:
-        fprintf(fp, "f:%f\n", g_value_get_double(value));
+        g_string_append_c(buf, 'f');
+        g_string_append_len(buf, key, strlen(key) + 1);
+        g_string_append(buf, g_ascii_dtostr(dbl, sizeof(dbl),
+                                            g_value_get_double(value)));
         break;
     default:
         return EINVAL;
     }
+
+    g_string_append_c(buf, '\0');
     
     return 0;
 }
 
 
-static int load_field(FILE *fp, char *key, size_t size, GValue **value)
+static gchar *serialize_state(OhmFact *fact, gsize *size)
 {
-    char val[256], *e;
-    size_t len;
+    GString *buf;
+    GSList *l;
+    GQuark  q;
+    const gchar *key;
+    guint32 sum;
+    int err;
+
+    buf = g_string_sized_new(256);
+    g_string_append(buf, PROFILE_STATE_MAGIC);
+
+    for (l = ohm_fact_get_fields(fact); l != NULL; l = l->next) {
+        q = (GQuark)GPOINTER_TO_INT(l->data);
+        key = g_quark_to_string(q);
+
+        if ((err = save_field(buf, key, ohm_fact_get(fact, key))) != 0) {
+            g_string_free(buf, TRUE);
+            errno = err;
+            return NULL;
+        }
+    }
+
+    sum = g_htonl(state_checksum(buf->str, buf->len));
+    g_string_append_c(buf, 'E');
+    g_string_append_len(buf, (gchar *)&sum, sizeof(sum));
+
+    *size = buf->len;
+    return g_string_free(buf, FALSE);
+}
+
+
+static GValue *parse_value(char type, const char *str)
+{
+    char *e;
     int i;
     double d;
 
-    if (fgets(key, size, fp) == NULL)
-        return ENOENT;
+    switch (type) {
+    case 's':
+        return ohm_value_from_string(str);
+    case 'i':
+        i = (int)strtol(str, &e, 10);
+        if (e == str || *e)
+            return NULL;
+        return ohm_value_from_int(i);
+    case 'f':
+        d = g_ascii_strtod(str, &e);
+        if (e == str || *e)
+            return NULL;
+        return ohm_value_from_double(d);
+    default:
+        return NULL;
+    }
+}
 
-    if ((len = strlen(key)) == 0 || key[len - 1] != '\n')
-        return EINVAL;
 
-    key[len - 1] = '\0';
-    
-    if (fgets(val, sizeof(val), fp) == NULL)
+static int parse_state(gchar *data, gsize size, OhmFact *fact)
+{
+    gchar *p, *end, *key, *val, *next;
+    guint32 sum;
+    GValue *value;
+
+    if (size < PROFILE_STATE_MAGIC_LEN + PROFILE_STATE_TRAILER_LEN)
         return EINVAL;
 
-    if ((len = strlen(val)) < 2 || val[1] != ':' || val[len - 1] != '\n')
+    end = data + size - PROFILE_STATE_TRAILER_LEN;
+    memcpy(&sum, end + 1, sizeof(sum));
+
+    if (*end != 'E' || g_ntohl(sum) != state_checksum(data, end - data))
         return EINVAL;
 
-    val[len - 1] = '\0';
+    for (p = data + PROFILE_STATE_MAGIC_LEN; p < end; p = next) {
+        key = p + 1;
 
-    switch (val[0]) {
-    case 's':
-        *value = ohm_value_from_string(val + 2);
-        break;
-    case 'i':
-        i = (int)strtol(val + 2, &e, 10);
-        if (e != NULL && *e)
+        if (key >= end || (val = memchr(key, '\0', end - key)) == NULL)
             return EINVAL;
-        *value = ohm_value_from_int(i);
-        break;
-    case 'f':
-        d = strtod(val + 2, &e);
-        if (e != NULL && *e)
+        val++;
+
+        if (val >= end || (next = memchr(val, '\0', end - val)) == NULL)
             return EINVAL;
-        *value = ohm_value_from_double(d);
-        break;
-    default:
+        next++;
+
+        if ((value = parse_value(*p, val)) == NULL)
+            return EINVAL;
+
+        ohm_fact_set(fact, key, value);
+    }
+
+    return 0;
+}
+
+
+static int parse_legacy_state(gchar *data, gsize size, OhmFact *fact)
+{
+    gchar *p, *end, *key, *val, *nl;
+    GValue *value;
+
+    /* the old line based format: key line followed by a 't:value' line */
+
+    if (size == 0)
         return EINVAL;
+
+    end = data + size;
+
+    for (p = data; p < end; p = nl + 1) {
+        key = p;
+        if ((nl = memchr(key, '\n', end - key)) == NULL)
+            return EINVAL;
+        *nl = '\0';
+
+        val = nl + 1;
+        if (val >= end || (nl = memchr(val, '\n', end - val)) == NULL)
+            return EINVAL;
+        *nl = '\0';
+
+        if (!*key || val[0] == '\0' || val[1] != ':')
+            return EINVAL;
+
+        if ((value = parse_value(val[0], val + 2)) == NULL)
+            return EINVAL;
+
+        ohm_fact_set(fact, key, value);
+    }
+
+    return 0;
+}
+
+
+static int write_state(const char *path, const gchar *data, gsize size)
+{
+    char    tmp[PATH_MAX];
+    ssize_t n;
+    int     fd, err;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        return errno;
+
+    while (size > 0) {
+        if ((n = write(fd, data, size)) < 0) {
+            if (errno == EINTR)
+                continue;
+            goto failed;
+        }
+        data += n;
+        size -= n;
+    }
+
+    if (fdatasync(fd) < 0)
+        goto failed;
+
+    if (close(fd) < 0) {
+        fd = -1;
+        goto failed;
+    }
+
+    if (rename(tmp, path) < 0) {
+        fd = -1;
+        goto failed;
     }
 
     return 0;
+
+ failed:
+    err = errno;
+    if (fd >= 0)
+        close(fd);
+    unlink(tmp);
+    return err;
+}
+
+
+static void *writer_thread(void *arg)
+{
+    gchar *data;
+    gsize  size;
+    int    err;
+
+    (void)arg;
+
+    pthread_mutex_lock(&writer.lock);
+
+    for (;;) {
+        while (writer.data == NULL && !writer.stop)
+            pthread_cond_wait(&writer.cond, &writer.lock);
+
+        if (writer.data == NULL)
+            break;
+
+        data = writer.data;
+        size = writer.size;
+        writer.data = NULL;
+
+        pthread_mutex_unlock(&writer.lock);
+        err = write_state(save_path, data, size);
+        g_free(data);
+        pthread_mutex_lock(&writer.lock);
+
+        writer.error = err;
+        writer.written++;
+    }
+
+    pthread_mutex_unlock(&writer.lock);
+
+    return NULL;
 }
 
 
 static int profile_save_state(OhmFact *fact)
 {
-    FILE *fp;
-    GSList *l;
-    GQuark  q;
-    const gchar *key;
-    GValue *value;
-    int err;
+    gchar *data;
+    gsize  size;
+    int    err;
     
-    if ((fp = fopen(PROFILE_SAVE_PATH, "w")) == NULL)
+    if ((data = serialize_state(fact, &size)) == NULL)
         return errno;
 
-    for (l = ohm_fact_get_fields(fact); l != NULL; l = l->next) {
-        q = (GQuark)GPOINTER_TO_INT(l->data);
-        key = g_quark_to_string(q);
-        value = ohm_fact_get(fact, key);
+    pthread_mutex_lock(&writer.lock);
+
+    if ((err = writer.error) != 0) {
+        OHM_ERROR("profile: failed to save state to %s (%d: %s)",
+                  save_path, err, strerror(err));
+        writer.error = 0;
+    }
+
+    if (!writer.started && !writer.stop) {
+        if (pthread_create(&writer.thread, NULL, writer_thread, NULL) == 0)
+            writer.started = TRUE;
+        else
+            OHM_WARNING("profile: failed to create state writer thread");
+    }
+
+    if (writer.started) {
+        /* a newer state supersedes any unwritten one */
+        g_free(writer.data);
+        writer.data = data;
+        writer.size = size;
+        pthread_cond_signal(&writer.cond);
+        pthread_mutex_unlock(&writer.lock);
+    }
+    else {
+        pthread_mutex_unlock(&writer.lock);
+        err = write_state(save_path, data, size);
+        g_free(data);
 
-        if ((err = save_field(fp, key, value)) != 0) {
-            fclose(fp);
-            unlink(PROFILE_SAVE_PATH);
+        if (err != 0) {
+            OHM_ERROR("profile: failed to save state to %s (%d: %s)",
+                      save_path, err, strerror(err));
             return err;
         }
     }
-    
-    fflush(fp);
-    /* fdatasync(fileno(fp)); */
-    fclose(fp);
 
-    OHM_INFO("Profile state saved.");
+    OHM_DEBUG(DBG_PROFILE, "profile state queued for saving");
     return 0;
 }
 
 
+static OhmFact *profile_get_fact(void)
+{
+    OhmFactStore *fs = ohm_fact_store_get_fact_store();
+    GSList *list = ohm_fact_store_get_facts_by_name(fs, FACTSTORE_PROFILE);
+
+    if (g_slist_length(list) != 1)
+        return NULL;
+    
+    return list->data;
+}
+
+
+static gboolean save_timer_cb(gpointer data)
+{
+    OhmFact *fact;
+
+    (void)data;
+
+    save_timer = 0;
+
+    if ((fact = profile_get_fact()) != NULL)
+        profile_save_state(fact);
+    else
+        OHM_DEBUG(DBG_PROFILE, "Error: there isn't a unique profile fact");
+
+    return FALSE;
+}
+
+
+static void profile_schedule_save(void)
+{
+    if (!save_timer)
+        save_timer = g_timeout_add(PROFILE_SAVE_DELAY, save_timer_cb, NULL);
+}
+
+
+static void profile_flush_state(void)
+{
+    /* save any pending changes and wait for the writer to finish */
+
+    if (save_timer) {
+        g_source_remove(save_timer);
+        save_timer_cb(NULL);
+    }
+
+    pthread_mutex_lock(&writer.lock);
+    writer.stop = TRUE;
+    pthread_cond_signal(&writer.cond);
+    pthread_mutex_unlock(&writer.lock);
+
+    if (writer.started) {
+        pthread_join(writer.thread, NULL);
+        writer.started = FALSE;
+    }
+
+    if (writer.error != 0)
+        OHM_ERROR("profile: failed to save state to %s (%d: %s)",
+                  save_path, writer.error, strerror(writer.error));
+
+    writer.stop = FALSE;
+    writer.error = 0;
+}
+
+
 static int profile_load_state(void)
 {
     OhmFactStore *fs = ohm_fact_store_get_fact_store();
     OhmFact *fact;
     GSList *l, *n;
-    gchar key[128];
-    GValue *value;
-    FILE *fp;
+    GError *error = NULL;
+    gchar *data, tmp[PATH_MAX];
+    gsize size;
     int err;
+
+    /* a leftover temporary file is an interrupted save, ignore it */
+    snprintf(tmp, sizeof(tmp), "%s.tmp", save_path);
+    unlink(tmp);
     
-    if ((fp = fopen(PROFILE_SAVE_PATH, "r")) == NULL) {
-        if (errno != ENOENT)
-            OHM_ERROR("profile: could not load saved state from %s (%d: %s)",
-                      PROFILE_SAVE_PATH, errno, strerror(errno));
-        return errno;
+    if (!g_file_get_contents(save_path, &data, &size, &error)) {
+        err = g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT) ?
+            ENOENT : EIO;
+        if (err != ENOENT)
+            OHM_ERROR("profile: could not load saved state from %s (%s)",
+                      save_path, error->message);
+        g_error_free(error);
+        return err;
     }
 
-    /* remove any old profile facts */
-    l = ohm_fact_store_get_facts_by_name(fs, FACTSTORE_PROFILE);
-    while (l != NULL) {
-        n = l->next;
-        ohm_fact_store_remove(fs, l->data);
-        l = n;
-    }
-    
     /* create new fact and populate it with saved fields */
     if ((fact = ohm_fact_new(FACTSTORE_PROFILE)) == NULL) {
         OHM_ERROR("profile: failed to create fact %s", FACTSTORE_PROFILE);
-        fclose(fp);
+        g_free(data);
         return ENOMEM;
     }
     
-    while ((err = load_field(fp, key, sizeof(key), &value)) == 0)
-        ohm_fact_set(fact, key, value);
+    if (size >= PROFILE_STATE_MAGIC_LEN &&
+        !memcmp(data, PROFILE_STATE_MAGIC, PROFILE_STATE_MAGIC_LEN))
+        err = parse_state(data, size, fact);
+    else
+        err = parse_legacy_state(data, size, fact);
     
-    fclose(fp);
+    g_free(data);
     
-    if (err != ENOENT) {
+    if (err != 0) {
         g_object_unref(fact);
         OHM_ERROR("profile: failed to load saved state");
         return err;
     }
 
+    /* remove any old profile facts */
+    l = ohm_fact_store_get_facts_by_name(fs, FACTSTORE_PROFILE);
+    while (l != NULL) {
+        n = l->next;
+        ohm_fact_store_remove(fs, l->data);
+        l = n;
+    }
+
     ohm_fact_store_insert(fs, fact);
     OHM_INFO("profile: saved state loaded");
     return 0;
@@ -448,6 +771,8 @@ static void profile_value_change(const char *profile, const char *key,
 
         OHM_DEBUG(DBG_PROFILE, "changing key %s with new value '%s'", key, val);
         ohm_fact_set(fact, key, gval);
+
+        profile_schedule_save();
     }
     else {
         OHM_DEBUG(DBG_PROFILE, "Error, no facts or empty key");
@@ -37,6 +37,7 @@ USA.
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <limits.h>
 #include <time.h>
 
 #include <glib.h>
@@ -59,6 +60,7 @@ USA.
 #define DBUS_POLICY_NEW_SESSION "NewSession"
 #define PROFILE_SAVE_DIR  "/var/lib/ohm"
 #define PROFILE_SAVE_PATH PROFILE_SAVE_DIR"/profile"
+#define PROFILE_SAVE_DELAY 1000            /* msecs to coalesce changes */
 
 typedef struct _profile_plugin {
     gchar *current_profile;
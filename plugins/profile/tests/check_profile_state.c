@@ -0,0 +1,288 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/**
+ * @file check_profile_state.c
+ * @brief Crash consistency tests for the profile state saving
+ *
+ * These tests do not need a session bus or profiled: they exercise the
+ * state saving and loading directly against a scratch directory.
+ */
+
+#include <check.h>
+#include "../profile.h"
+#include "../profile.c"
+
+/**
+ * ohm_log:
+ **/
+void
+ohm_log(OhmLogLevel level, const gchar *format, ...)
+{
+    va_list     ap;
+    FILE       *out;
+    const char *prefix;
+
+    switch (level) {
+    case OHM_LOG_ERROR:   prefix = "E: "; out = stderr; break;
+    case OHM_LOG_WARNING: prefix = "W: "; out = stderr; break;
+    case OHM_LOG_INFO:    prefix = "I: "; out = stdout; break;
+    default:                                           return;
+    }
+
+    va_start(ap, format);
+
+    fputs(prefix, out);
+    vfprintf(out, format, ap);
+    fputs("\n", out);
+
+    va_end(ap);
+}
+
+static gchar  test_dir[] = "/tmp/check_profile_state.XXXXXX";
+static gchar *test_path;
+static gchar *test_tmp;
+
+static void setup(void)
+{
+    fail_if(mkdtemp(test_dir) == NULL, "failed to create scratch directory");
+
+    test_path = g_strdup_printf("%s/profile", test_dir);
+    test_tmp  = g_strdup_printf("%s.tmp", test_path);
+    save_path = test_path;
+}
+
+static void teardown(void)
+{
+    OhmFactStore *fs = ohm_fact_store_get_fact_store();
+    GSList *l;
+
+    while ((l = ohm_fact_store_get_facts_by_name(fs, FACTSTORE_PROFILE)))
+        ohm_fact_store_remove(fs, l->data);
+
+    unlink(test_tmp);
+    unlink(test_path);
+    rmdir(test_dir);
+    strcpy(test_dir + strlen(test_dir) - 6, "XXXXXX");
+
+    g_free(test_path);
+    g_free(test_tmp);
+    save_path = PROFILE_SAVE_PATH;
+}
+
+static OhmFact *make_fact(const char *profile, const char *tone)
+{
+    OhmFact *fact = ohm_fact_new(FACTSTORE_PROFILE);
+
+    ohm_fact_set(fact, PROFILE_NAME_KEY, ohm_value_from_string(profile));
+    ohm_fact_set(fact, "ringing.alert.tone", ohm_value_from_string(tone));
+    ohm_fact_set(fact, "ringing.alert.volume", ohm_value_from_int(40));
+
+    return fact;
+}
+
+static void check_loaded(const char *profile, const char *tone)
+{
+    OhmFact *fact = profile_get_fact();
+    GValue  *gv;
+
+    fail_if(fact == NULL, "no unique profile fact after loading");
+
+    gv = ohm_fact_get(fact, PROFILE_NAME_KEY);
+    fail_unless(gv != NULL && G_VALUE_TYPE(gv) == G_TYPE_STRING &&
+                !strcmp(g_value_get_string(gv), profile),
+                "wrong profile name loaded");
+
+    gv = ohm_fact_get(fact, "ringing.alert.tone");
+    fail_unless(gv != NULL && G_VALUE_TYPE(gv) == G_TYPE_STRING &&
+                !strcmp(g_value_get_string(gv), tone),
+                "wrong ringtone loaded");
+
+    gv = ohm_fact_get(fact, "ringing.alert.volume");
+    fail_unless(gv != NULL && G_VALUE_TYPE(gv) == G_TYPE_INT &&
+                g_value_get_int(gv) == 40, "wrong volume loaded");
+}
+
+static void save_fact(OhmFact *fact)
+{
+    fail_unless(profile_save_state(fact) == 0, "failed to save state");
+    profile_flush_state();
+}
+
+START_TEST (test_state_roundtrip)
+{
+    OhmFact *fact = make_fact("general", "test_1.mp3");
+
+    save_fact(fact);
+    g_object_unref(fact);
+
+    fail_unless(profile_load_state() == 0, "failed to load saved state");
+    check_loaded("general", "test_1.mp3");
+}
+END_TEST
+
+START_TEST (test_state_interrupted_save)
+{
+    OhmFact *fact;
+    gchar   *data;
+    gsize    size;
+
+    fact = make_fact("general", "test_1.mp3");
+    save_fact(fact);
+    g_object_unref(fact);
+
+    /* crash while writing the next state: a partial temporary file */
+    fact = make_fact("silent", "test_2.mp3");
+    data = serialize_state(fact, &size);
+    fail_unless(g_file_set_contents(test_tmp, data, size / 2, NULL),
+                "failed to create partial temporary file");
+    g_free(data);
+    g_object_unref(fact);
+
+    fail_unless(profile_load_state() == 0, "failed to load saved state");
+    check_loaded("general", "test_1.mp3");
+    fail_unless(access(test_tmp, F_OK) < 0, "temporary file left behind");
+}
+END_TEST
+
+START_TEST (test_state_torn_file)
+{
+    OhmFact *fact;
+    gchar   *data;
+    gsize    size, i;
+
+    fact = make_fact("general", "test_1.mp3");
+    data = serialize_state(fact, &size);
+    g_object_unref(fact);
+
+    /* every truncated state must be rejected as a whole */
+    for (i = 0; i < size; i++) {
+        g_file_set_contents(test_path, data, i, NULL);
+        fail_unless(profile_load_state() != 0,
+                    "state truncated to %u bytes was accepted", (guint)i);
+        fail_unless(profile_get_fact() == NULL,
+                    "partial fact created from %u bytes", (guint)i);
+    }
+
+    /* a single flipped bit too */
+    data[size / 2] ^= 0x10;
+    g_file_set_contents(test_path, data, size, NULL);
+    fail_unless(profile_load_state() != 0, "corrupted state was accepted");
+
+    g_free(data);
+}
+END_TEST
+
+START_TEST (test_state_legacy)
+{
+    const char *legacy =
+        "value\ns:silent\n"
+        "ringing.alert.tone\ns:test_2.mp3\n"
+        "ringing.alert.volume\ni:40\n";
+
+    g_file_set_contents(test_path, legacy, -1, NULL);
+    fail_unless(profile_load_state() == 0, "failed to load legacy state");
+    check_loaded("silent", "test_2.mp3");
+}
+END_TEST
+
+static gboolean quit_cb(gpointer data)
+{
+    g_main_loop_quit((GMainLoop *)data);
+    return FALSE;
+}
+
+START_TEST (test_state_coalescing)
+{
+    OhmFactStore *fs = ohm_fact_store_get_fact_store();
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+    OhmFact *fact = make_fact("general", "test_0.mp3");
+    unsigned int written = writer.written;
+    char tone[32];
+    int i;
+
+    ohm_fact_store_insert(fs, fact);
+
+    /* a burst of changes results in a single write of the last state */
+    for (i = 1; i <= 100; i++) {
+        snprintf(tone, sizeof(tone), "test_%d.mp3", i);
+        ohm_fact_set(fact, "ringing.alert.tone", ohm_value_from_string(tone));
+        profile_schedule_save();
+    }
+
+    g_timeout_add(2 * PROFILE_SAVE_DELAY, quit_cb, loop);
+    g_main_loop_run(loop);
+    g_main_loop_unref(loop);
+
+    profile_flush_state();
+
+    fail_unless(writer.written - written == 1, "%u writes for a burst",
+                writer.written - written);
+
+    ohm_fact_store_remove(fs, fact);
+    g_object_unref(fact);
+
+    fail_unless(profile_load_state() == 0, "failed to load saved state");
+    check_loaded("general", "test_100.mp3");
+}
+END_TEST
+
+Suite *ohm_profile_state_suite(void)
+{
+    Suite *suite = suite_create("ohm_profile_state");
+
+    TCase *tc_all = tcase_create("All");
+    tcase_add_checked_fixture(tc_all, setup, teardown);
+
+    tcase_add_test(tc_all, test_state_roundtrip);
+    tcase_add_test(tc_all, test_state_interrupted_save);
+    tcase_add_test(tc_all, test_state_torn_file);
+    tcase_add_test(tc_all, test_state_legacy);
+    tcase_add_test(tc_all, test_state_coalescing);
+
+    tcase_set_timeout(tc_all, 30);
+    suite_add_tcase(suite, tc_all);
+
+    return suite;
+}
+
+int main (void) {
+
+    int failed = 0;
+    Suite *suite;
+
+    g_type_init();
+
+    suite = ohm_profile_state_suite();
+    SRunner *runner = srunner_create(suite);
+    srunner_run_all(runner, CK_NORMAL);
+
+    failed = srunner_ntests_failed(runner);
+    srunner_free(runner);
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -38,6 +38,11 @@ typedef struct {
     void                  *data;
 } query_t;
 
+/* shared, cached pid resolution of the dbus plugin, if it is loaded */
+OHM_IMPORTABLE(int, query_pid, (DBusBusType type, const char *name,
+                                void (*callback)(pid_t, const char *, void *),
+                                void *data));
+
 
 static DBusConnection   *sys_conn;       /* connection for D-Bus system bus */
 static DBusConnection   *sess_conn;      /* connection for D-Bus session bus */
@@ -49,6 +54,7 @@ static void system_bus_init(void);
 static void session_bus_init(const char *);
 static void res_conn_setup(DBusConnection *);
 static void pid_queried(DBusPendingCall *, void *);
+static void pid_resolved(pid_t, const char *, void *);
 
 
 
@@ -62,6 +68,7 @@ void dbusif_init(OhmPlugin *plugin)
 {
     const char *bus_str;
     const char *timeout_str;
+    char       *signature;
     char       *e;
 
     ENTER;
@@ -99,6 +106,13 @@ void dbusif_init(OhmPlugin *plugin)
 
     OHM_INFO("resource: D-Bus message timeout is %dmsec", timeout);
 
+    signature = (char *)query_pid_SIGNATURE;
+
+    if (ohm_module_find_method("dbus.query_pid", &signature,(void*)&query_pid))
+        OHM_INFO("resource: using shared D-Bus pid cache");
+    else
+        OHM_INFO("resource: no shared D-Bus pid cache, querying directly");
+
     /*
      * Notes: We get only on the system bus here. Session bus initialization
      *   is delayed until we get the correct address of the bus from our
@@ -186,6 +200,11 @@ void dbusif_query_pid(char *addr, dbusif_pid_query_cb_t func, void *data)
         query->func = func;
         query->data = data;
 
+        if (query_pid != NULL &&
+            query_pid(use_system_bus ? DBUS_BUS_SYSTEM : DBUS_BUS_SESSION,
+                      addr, pid_resolved, query))
+            return;
+
         msg = dbus_message_new_method_call(DBUS_ADMIN_NAME,
                                            DBUS_ADMIN_PATH,
                                            DBUS_ADMIN_INTERFACE,
@@ -384,6 +403,23 @@ static void pid_queried(DBusPendingCall *pend, void *data)
     dbus_pending_call_unref(pend);
 }
 
+static void pid_resolved(pid_t pid, const char *error, void *data)
+{
+    query_t *query = (query_t *)data;
+
+    if (error == NULL)
+        OHM_DEBUG(DBG_DBUS, "pid query succeeded: %s -> %u", query->addr, pid);
+    else {
+        OHM_DEBUG(DBG_DBUS, "pid query for %s failed: %s", query->addr, error);
+        pid = 0;
+    }
+
+    query->func(pid, query->data);
+
+    free(query->addr);
+    free(query);
+}
+
 /* 
  * Local Variables:
  * c-basic-offset: 4
@@ -170,6 +170,7 @@ static void plugin_init(OhmPlugin *plugin)
 
 static void plugin_destroy(OhmPlugin *plugin)
 {
+    ruleif_exit(plugin);
     auth_exit(plugin);
 }
 
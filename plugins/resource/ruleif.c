@@ -27,6 +27,8 @@ USA.
 
 #include "plugin.h"
 #include "ruleif.h"
+#include "../common/rule-memo.h"
+#include "../common/console-command.h"
 
 extern int DBG_RULE;
 #define DIM(a)   (sizeof(a) / sizeof(a[0]))
@@ -55,6 +57,10 @@ static int resource_class_req = -1;
 
 static int copy_value(char *, int, void *, char **);
 
+static int memo_eval(int, char **, int, char ***);
+static void console_init(void);
+static void console_command(char *);
+
 static int lookup_rules(void)
 {
     static import_t imports[] = {
@@ -92,8 +98,10 @@ static int lookup_rules(void)
     for (i = n = 0; i < DIM(ruldefs); i++) {
         rd = ruldefs + i;
 
-        if ((*(rd->rule) = rule_find(rd->name, rd->arity)) >= 0)
+        if ((*(rd->rule) = rule_find(rd->name, rd->arity)) >= 0) {
+            rule_memo_add_rule(*rd->rule, rd->name);
             n++;
+        }
         else {
             OHM_ERROR("resource: can't find rule '%s/%d'",
                       rd->name, rd->arity);
@@ -116,20 +124,27 @@ static int lookup_rules(void)
 
 void ruleif_init(OhmPlugin *plugin)
 {
-    (void)plugin;
-
     ENTER;
 
+    rule_memo_init(plugin, "resource", &DBG_RULE);
     lookup_rules();
+    console_init();
 
     LEAVE;
 }
 
+void ruleif_exit(OhmPlugin *plugin)
+{
+    (void)plugin;
+
+    rule_memo_exit();
+}
+
 int ruleif_valid_resource_request(const char *class, int mandatory, int optional, ...)
 {
     va_list  ap;
     char    *argv[16];
-    char  ***retval;
+    char   **entry;
     char    *name;
     int      type;
     void    *value;
@@ -141,8 +156,6 @@ int ruleif_valid_resource_request(const char *class, int mandatory, int optional
         lookup_rules();
 
     if (resource_class_req >= 0) {
-        retval = NULL;
-
         argv[i=0] = (char *)'s';
         argv[++i] = (char *)class;
 
@@ -152,37 +165,25 @@ int ruleif_valid_resource_request(const char *class, int mandatory, int optional
         argv[++i] = (char *)'i';
         argv[++i] = GINT_TO_POINTER(optional);
 
-        status = rule_eval(resource_class_req, &retval, (void **)argv, (i+1)/2);
+        status = memo_eval(resource_class_req, argv, (i+1)/2, &entry);
 
-        OHM_DEBUG(DBG_RULE, "rule_eval returned %d (retval %p)", status, retval);
+        if (status > 0 && entry != NULL) {
+            success = TRUE;
 
-        if (status <= 0 && retval) {
-            rules_dump_result(retval);
-        } else {
-            if (OHM_LOGGED(INFO) && retval)
-                rules_dump_result(retval);
+            va_start(ap, optional);
 
-            if (retval && retval[0] != NULL && retval[1] == NULL) {
-                success = TRUE;
-
-                va_start(ap, optional);
-
-                while ((name = va_arg(ap, char *)) != NULL) {
-                    type  = va_arg(ap, int);
-                    value = va_arg(ap, void *);
+            while ((name = va_arg(ap, char *)) != NULL) {
+                type  = va_arg(ap, int);
+                value = va_arg(ap, void *);
 
-                    if (!copy_value(name, type, value, retval[0])) {
-                        success = FALSE;
-                        break;
-                    }
+                if (!copy_value(name, type, value, entry)) {
+                    success = FALSE;
+                    break;
                 }
-
-                va_end(ap);
             }
-        }
 
-        if (retval)
-            rules_free_result(retval);
+            va_end(ap);
+        }
     }
 
     OHM_DEBUG(DBG_RULE, "%s", success ? "succeeded" : "failed");
@@ -233,6 +234,60 @@ static int copy_value(char *name, int type, void *value, char **entry)
 }
 
 
+/*
+ * Evaluate a rule that is expected to return a single result entry.
+ * The returned entry is owned by the rule cache and stays valid until
+ * the next evaluation.
+ */
+static int memo_eval(int rule, char **argv, int narg, char ***entry_ret)
+{
+    char ***retval;
+    int     status;
+
+    if (rule_memo_lookup(rule, argv, narg, &status, entry_ret))
+        return status;
+
+    retval = NULL;
+    status = rule_eval(rule, &retval, (void **)argv, narg);
+
+    OHM_DEBUG(DBG_RULE, "rule_eval returned %d (retval %p)", status, retval);
+
+    if (status <= 0 && retval) {
+        rules_dump_result(retval);
+    } else {
+        if (OHM_LOGGED(INFO) && retval)
+            rules_dump_result(retval);
+    }
+
+    *entry_ret = rule_memo_store(rule, argv, narg, status, retval);
+
+    if (retval)
+        rules_free_result(retval);
+
+    return status;
+}
+
+
+static void console_init(void)
+{
+    if (!console_command_add("resource", console_command))
+        OHM_INFO("resource: console commands not available");
+}
+
+
+static void console_command(char *command)
+{
+    if (!strcmp(command, "help")) {
+        printf("resource help    show this help\n");
+        printf("resource rules   show the rule cache statistics\n");
+    }
+    else if (!strcmp(command, "rules"))
+        rule_memo_show();
+    else
+        printf("unknown resource command \"%s\"\n", command);
+}
+
+
 /*
  * Local Variables:
  * c-basic-offset: 4
@@ -31,6 +31,7 @@ USA.
 typedef struct _OhmPlugin OhmPlugin;
 
 void ruleif_init(OhmPlugin *);
+void ruleif_exit(OhmPlugin *);
 int ruleif_valid_resource_request(const char *class, int mandatory, int optional, ...);
 
 #endif	/* __OHM_RESOURCE_RULEIF_H__ */
@@ -35,7 +35,7 @@ USA.
 #include "org.nemomobile.Route.Manager.xml.h"
 #include "ohm-ext/route.h"
 
-#define DBUSIF_INTERFACE_VERSION            (3)
+#define DBUSIF_INTERFACE_VERSION            (4)
 
 /* D-Bus errors */
 #define DBUS_NEMOMOBILE_ERROR_PREFIX        "org.nemomobile.Error"
@@ -114,6 +114,62 @@ void dbusif_signal_route_changed(const char *device, unsigned int device_type)
     }
 }
 
+void dbusif_signal_routes_changed(GSList *changes)
+{
+    DBusMessage                *msg;
+    DBusMessageIter             append;
+    DBusMessageIter             array;
+    DBusMessageIter             entry;
+    struct audio_route_change  *change;
+    GSList                     *i;
+
+    msg = dbus_message_new_signal(OHM_EXT_ROUTE_MANAGER_PATH,
+                                  OHM_EXT_ROUTE_MANAGER_INTERFACE,
+                                  OHM_EXT_ROUTE_CHANGES_SIGNAL);
+
+    if (msg == NULL) {
+        OHM_ERROR("route [%s]: failed to create message", __FUNCTION__);
+        return;
+    }
+
+    dbus_message_iter_init_append(msg, &append);
+
+    if (!dbus_message_iter_open_container(&append,
+                                          DBUS_TYPE_ARRAY,
+                                          DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+                                            DBUS_TYPE_STRING_AS_STRING
+                                            DBUS_TYPE_UINT32_AS_STRING
+                                            DBUS_TYPE_UINT32_AS_STRING
+                                          DBUS_STRUCT_END_CHAR_AS_STRING,
+                                          &array))
+        goto failed;
+
+    for (i = changes; i; i = g_slist_next(i)) {
+        change = i->data;
+
+        if (!dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT,
+                                              NULL, &entry)  ||
+            !dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING,
+                                            &change->name)   ||
+            !dbus_message_iter_append_basic(&entry, DBUS_TYPE_UINT32,
+                                            &change->type)   ||
+            !dbus_message_iter_append_basic(&entry, DBUS_TYPE_UINT32,
+                                            &change->changed) ||
+            !dbus_message_iter_close_container(&array, &entry))
+            goto failed;
+    }
+
+    if (!dbus_message_iter_close_container(&append, &array))
+        goto failed;
+
+    send_signal(msg);
+    return;
+
+ failed:
+    OHM_ERROR("route [%s]: failed to build message", __FUNCTION__);
+    dbus_message_unref(msg);
+}
+
 void dbusif_signal_feature_changed(const char *name,
                                    unsigned int allowed,
                                    unsigned int enabled)
@@ -46,6 +46,9 @@ USA.
 #define OHM_EXT_ROUTE_ROUTES_FILTERED_METHOD    "RoutesFiltered"
 #define OHM_EXT_ROUTE_PREFER_METHOD             "Prefer"
 
+/* Since InterfaceVersion 4 */
+#define OHM_EXT_ROUTE_CHANGES_SIGNAL            "AudioRoutesChanged"  /* arg: a(suu) device, type, changed bits */
+
 /* Bits defining audio route type. uint32 bitfield */
 #define OHM_EXT_ROUTE_TYPE_OUTPUT               (1 << 0)    /* sink     */
 #define OHM_EXT_ROUTE_TYPE_INPUT                (1 << 1)    /* source   */
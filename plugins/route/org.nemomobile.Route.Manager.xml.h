@@ -1,2 +1,2 @@
 /* Autogenerated using command ./generate.sh org.nemomobile.Route.Manager.xml route_plugin_introspect_string */
-const char *route_plugin_introspect_string = "<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n<node>\n    <interface name=\"org.nemomobile.Route.Manager\">\n        <method name=\"InterfaceVersion\">\n            <arg name=\"version\" type=\"u\" direction=\"out\"/>\n        </method>\n    <!-- since InterfaceVersion 1 -->\n        <method name=\"GetAll\">\n            <arg name=\"output_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"output_device_type\" type=\"u\" direction=\"out\"/>\n            <arg name=\"input_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"input_device_type\" type=\"u\" direction=\"out\"/>\n            <arg name=\"features\" type=\"a(suu)\" direction=\"out\"/>\n        </method>\n        <method name=\"Enable\">\n            <arg name=\"feature\" type=\"s\" direction=\"in\"/>\n        </method>\n        <method name=\"Disable\">\n            <arg name=\"feature\" type=\"s\" direction=\"in\"/>\n        </method>\n        <signal name=\"AudioRouteChanged\">\n            <arg name=\"device\" type=\"s\"/>\n            <arg name=\"device_type\" type=\"u\"/>\n        </signal>\n        <signal name=\"AudioFeatureChanged\">\n            <arg name=\"name\" type=\"s\"/>\n            <arg name=\"allowed\" type=\"u\"/>\n            <arg name=\"enabled\" type=\"u\"/>\n        </signal>\n\n    <!-- since InterfaceVersion 2 -->\n        <method name=\"Features\">\n            <arg name=\"features\" type=\"as\" direction=\"out\"/>\n        </method>\n        <method name=\"FeaturesAllowed\">\n            <arg name=\"features_allowed\" type=\"as\" direction=\"out\"/>\n        </method>\n        <method name=\"FeaturesEnabled\">\n            <arg name=\"features_enabled\" type=\"as\" direction=\"out\"/>\n        </method>\n        <method name=\"Routes\">\n            <arg name=\"routes\" type=\"a(su)\" direction=\"out\"/>\n        </method>\n        <method name=\"ActiveRoutes\">\n            <arg name=\"output_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"output_device_type\" type=\"u\" direction=\"out\"/>\n            <arg name=\"input_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"input_device_type\" type=\"u\" direction=\"out\"/>\n        </method>\n\n    <!-- since InterfaceVersion 3 -->\n        <method name=\"RoutesFiltered\">\n            <arg name=\"filter\" type=\"u\" direction=\"in\"/>\n            <arg name=\"routes\" type=\"a(su)\" direction=\"out\"/>\n        </method>\n\n        <method name=\"Prefer\">\n            <arg name=\"device\" type=\"sub\" direction=\"in\"/>\n        </method>\n    </interface>\n</node>\n";
+const char *route_plugin_introspect_string = "<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\" \"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n<node>\n    <interface name=\"org.nemomobile.Route.Manager\">\n        <method name=\"InterfaceVersion\">\n            <arg name=\"version\" type=\"u\" direction=\"out\"/>\n        </method>\n    <!-- since InterfaceVersion 1 -->\n        <method name=\"GetAll\">\n            <arg name=\"output_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"output_device_type\" type=\"u\" direction=\"out\"/>\n            <arg name=\"input_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"input_device_type\" type=\"u\" direction=\"out\"/>\n            <arg name=\"features\" type=\"a(suu)\" direction=\"out\"/>\n        </method>\n        <method name=\"Enable\">\n            <arg name=\"feature\" type=\"s\" direction=\"in\"/>\n        </method>\n        <method name=\"Disable\">\n            <arg name=\"feature\" type=\"s\" direction=\"in\"/>\n        </method>\n        <signal name=\"AudioRouteChanged\">\n            <arg name=\"device\" type=\"s\"/>\n            <arg name=\"device_type\" type=\"u\"/>\n        </signal>\n        <signal name=\"AudioFeatureChanged\">\n            <arg name=\"name\" type=\"s\"/>\n            <arg name=\"allowed\" type=\"u\"/>\n            <arg name=\"enabled\" type=\"u\"/>\n        </signal>\n\n    <!-- since InterfaceVersion 2 -->\n        <method name=\"Features\">\n            <arg name=\"features\" type=\"as\" direction=\"out\"/>\n        </method>\n        <method name=\"FeaturesAllowed\">\n            <arg name=\"features_allowed\" type=\"as\" direction=\"out\"/>\n        </method>\n        <method name=\"FeaturesEnabled\">\n            <arg name=\"features_enabled\" type=\"as\" direction=\"out\"/>\n        </method>\n        <method name=\"Routes\">\n            <arg name=\"routes\" type=\"a(su)\" direction=\"out\"/>\n        </method>\n        <method name=\"ActiveRoutes\">\n            <arg name=\"output_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"output_device_type\" type=\"u\" direction=\"out\"/>\n            <arg name=\"input_device\" type=\"s\" direction=\"out\"/>\n            <arg name=\"input_device_type\" type=\"u\" direction=\"out\"/>\n        </method>\n\n    <!-- since InterfaceVersion 3 -->\n        <method name=\"RoutesFiltered\">\n            <arg name=\"filter\" type=\"u\" direction=\"in\"/>\n            <arg name=\"routes\" type=\"a(su)\" direction=\"out\"/>\n        </method>\n\n        <method name=\"Prefer\">\n            <arg name=\"device\" type=\"sub\" direction=\"in\"/>\n        </method>\n\n    <!-- since InterfaceVersion 4 -->\n        <signal name=\"AudioRoutesChanged\">\n            <arg name=\"changes\" type=\"a(suu)\"/>\n        </signal>\n    </interface>\n</node>\n";
@@ -0,0 +1,336 @@
+/*************************************************************************
+Copyright (C) 2016 Jolla Ltd.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/* route change coalescing test
+ *
+ * usage: route-test
+ *
+ * Sets up the routes of a built-in speaker and of a wired headset that
+ * has an output and an input with the same name, then changes device
+ * properties the way the factstore watches do. The aggregated changes
+ * signalled once the main loop runs are checked against the expected
+ * ones. The factstore, D-Bus and dres layers are replaced by stubs. Run
+ * by 'make check'. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "route.c"
+
+int DBG_ROUTE, DBG_DBUS, DBG_DRES;
+
+/*
+ * factstore entries
+ */
+
+typedef struct {
+    const char *fact;
+    const char *field[4];               /* string field names */
+    const char *value[4];               /*   and values */
+} entry_t;
+
+static entry_t outputs[] = {
+    { FACTSTORE_AUDIO_OUTPUT, { "device", "type", "commonname" },
+                              { "ihf", "builtin", "speaker" } },
+    { FACTSTORE_AUDIO_OUTPUT, { "device", "type", "commonname" },
+                              { "headset", "wired", "headset" } },
+};
+
+static entry_t inputs[] = {
+    { FACTSTORE_AUDIO_INPUT, { "device", "type", "commonname" },
+                             { "headset", "wired", "headset" } },
+};
+
+static entry_t selectable[] = {
+    { FACTSTORE_AUDIO_SELECTABLE, { "name" }, { "headset" } },
+    { FACTSTORE_AUDIO_SELECTABLE, { "name" }, { "ihf" } },
+};
+
+/*
+ * changes seen in the last aggregated signal
+ */
+
+#define MAX_CHANGES 8
+
+static struct audio_route_change signalled[MAX_CHANGES];
+static int                       nsignalled;
+static int                       nsignal;
+
+
+void ohm_log(OhmLogLevel level, const gchar *format, ...)
+{
+    va_list ap;
+
+    if (level != OHM_LOG_ERROR)
+        return;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    fputs("\n", stderr);
+    va_end(ap);
+}
+
+const char *ohm_plugin_get_param(OhmPlugin *plugin, const char *key)
+{
+    (void) plugin;
+
+    return strcmp(key, "legacy-route-signal") ? NULL : "no";
+}
+
+/*
+ * stubs for the rest of the plugin
+ */
+
+int fsif_add_field_watch(char *factname, fsif_field_t *selist, char *fldname,
+                         fsif_field_watch_cb_t callback, void *usrdata)
+{
+    (void) factname;
+    (void) selist;
+    (void) fldname;
+    (void) callback;
+    (void) usrdata;
+
+    return 0;
+}
+
+int fsif_get_field_by_entry(fsif_entry_t *fsentry, fsif_fldtype_t type,
+                            char *name, fsif_value_t *vptr)
+{
+    entry_t *entry = (entry_t *) fsentry;
+    int      i;
+
+    memset(vptr, 0, sizeof(*vptr));
+
+    for (i = 0; i < 4 && entry->field[i]; i++) {
+        if (!strcmp(entry->field[i], name) && type == fldtype_string) {
+            vptr->string = (char *) entry->value[i];
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+fsif_entry_t *fsif_get_entry(char *name, fsif_field_t *selist)
+{
+    (void) name;
+    (void) selist;
+
+    return NULL;
+}
+
+GSList *fsif_get_entries_by_name(char *name)
+{
+    static GSList *entries;
+    entry_t       *table;
+    int            i, n;
+
+    g_slist_free(entries);
+    entries = NULL;
+
+    if (!strcmp(name, FACTSTORE_AUDIO_OUTPUT))
+        table = outputs, n = sizeof(outputs) / sizeof(outputs[0]);
+    else if (!strcmp(name, FACTSTORE_AUDIO_INPUT))
+        table = inputs, n = sizeof(inputs) / sizeof(inputs[0]);
+    else
+        return NULL;
+
+    for (i = 0; i < n; i++)
+        entries = g_slist_append(entries, table + i);
+
+    return entries;
+}
+
+void dbusif_signal_route_changed(const char *device, unsigned int device_type)
+{
+    (void) device;
+    (void) device_type;
+}
+
+void dbusif_signal_routes_changed(GSList *changes)
+{
+    struct audio_route_change *change;
+    GSList                    *i;
+
+    nsignal++;
+    nsignalled = 0;
+
+    for (i = changes; i && nsignalled < MAX_CHANGES; i = g_slist_next(i)) {
+        change = i->data;
+        signalled[nsignalled].name    = g_strdup(change->name);
+        signalled[nsignalled].type    = change->type;
+        signalled[nsignalled].changed = change->changed;
+        nsignalled++;
+    }
+}
+
+void dbusif_signal_feature_changed(const char *name, unsigned int allowed,
+                                   unsigned int enabled)
+{
+    (void) name;
+    (void) allowed;
+    (void) enabled;
+}
+
+int dresif_set_feature(const char *feature, int enabled)
+{
+    (void) feature;
+    (void) enabled;
+
+    return DRESIF_RESULT_SUCCESS;
+}
+
+int dresif_set_prefer(const char *route, int set)
+{
+    (void) route;
+    (void) set;
+
+    return DRESIF_RESULT_SUCCESS;
+}
+
+
+static void set_selectable(entry_t *entry, int selectable)
+{
+    fsif_field_t field;
+
+    field.type          = fldtype_integer;
+    field.name          = FACTSTORE_ARG_SELECTABLE;
+    field.value.integer = selectable;
+
+    audio_property_changed_cb((fsif_entry_t *) entry, FACTSTORE_AUDIO_SELECTABLE,
+                              &field,
+                              GUINT_TO_POINTER(OHM_EXT_ROUTE_TYPE_AVAILABLE));
+}
+
+
+static void run_mainloop(void)
+{
+    int i;
+
+    for (i = 0; i < nsignalled; i++)
+        g_free(signalled[i].name);
+    nsignalled = 0;
+    nsignal    = 0;
+
+    while (g_main_context_iteration(NULL, FALSE))
+        ;
+}
+
+
+static int check_change(int idx, const char *name, unsigned int direction,
+                        unsigned int changed)
+{
+    struct audio_route_change *c = signalled + idx;
+
+    if (idx >= nsignalled || strcmp(c->name, name) ||
+        ROUTE_DIRECTION(c->type) != direction || c->changed != changed) {
+        if (idx < nsignalled)
+            printf("  change #%d: %s type 0x%x changed 0x%x\n", idx,
+                   c->name, c->type, c->changed);
+        else
+            printf("  change #%d: missing\n", idx);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int test_both_directions(void)
+{
+    int failed = 0;
+
+    /* the headset output and input both become available in one batch */
+    set_selectable(selectable + 0, TRUE);
+    run_mainloop();
+
+    if (nsignal != 1 || nsignalled != 2)
+        failed = -1;
+    else {
+        failed |= check_change(0, "headset", OHM_EXT_ROUTE_TYPE_OUTPUT,
+                               OHM_EXT_ROUTE_TYPE_AVAILABLE);
+        failed |= check_change(1, "headset", OHM_EXT_ROUTE_TYPE_INPUT,
+                               OHM_EXT_ROUTE_TYPE_AVAILABLE);
+    }
+
+    printf("%s: both directions of a device in one batch "
+           "(%d signals, %d changes)\n", failed ? "FAIL" : "PASS",
+           nsignal, nsignalled);
+
+    return failed;
+}
+
+
+static int test_merged_direction(void)
+{
+    int failed = 0;
+
+    /* toggling the speaker twice in one batch leaves no net change */
+    set_selectable(selectable + 1, TRUE);
+    set_selectable(selectable + 1, FALSE);
+    set_selectable(selectable + 0, FALSE);
+    run_mainloop();
+
+    if (nsignal != 1 || nsignalled != 3)
+        failed = -1;
+    else {
+        failed |= check_change(0, "speaker", OHM_EXT_ROUTE_TYPE_OUTPUT, 0);
+        failed |= check_change(1, "headset", OHM_EXT_ROUTE_TYPE_OUTPUT,
+                               OHM_EXT_ROUTE_TYPE_AVAILABLE);
+        failed |= check_change(2, "headset", OHM_EXT_ROUTE_TYPE_INPUT,
+                               OHM_EXT_ROUTE_TYPE_AVAILABLE);
+    }
+
+    printf("%s: repeated changes of one direction merged "
+           "(%d signals, %d changes)\n", failed ? "FAIL" : "PASS",
+           nsignal, nsignalled);
+
+    return failed;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int failed;
+
+    (void) argc;
+    (void) argv;
+
+    route_init(NULL);
+
+    failed  = test_both_directions()  ? 1 : 0;
+    failed += test_merged_direction() ? 1 : 0;
+
+    run_mainloop();
+    route_exit(NULL);
+
+    return failed ? 1 : 0;
+}
+
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -37,6 +37,7 @@ struct audio_device_mapping {
     char *name;
     uint32_t type;
     GSList *routes;
+    guint order;                        /* position in mappings */
 };
 
 struct audio_device_mapping_route {
@@ -88,6 +89,17 @@ static struct audio_device_mapping_route   *audio_route_source;
 static GSList *mappings;
 static GSList *features;
 
+/* name-keyed indexes into mappings and features */
+static GHashTable *route_index;         /* device name -> GSList of routes */
+static GHashTable *mapping_index;       /* common name -> GSList of mappings */
+static GHashTable *feature_index;       /* feature name -> feature */
+
+/* route changes pending for the aggregated signal */
+static GHashTable *pending_index;       /* device name and direction -> change */
+static GSList     *pending_changes;     /* in order of first change */
+static guint       pending_flush;
+static gboolean    legacy_signal = TRUE;
+
 static void audio_route_changed_cb(fsif_entry_t *entry, char *name,
                                    fsif_field_t *fld, void *userdata);
 static void audio_property_changed_cb(fsif_entry_t *entry, char *name,
@@ -138,13 +150,132 @@ static gboolean set_mapping_bit(struct audio_device_mapping *mapping, uint32_t b
     return changed;
 }
 
+static void drop_changes(void)
+{
+    struct audio_route_change *change;
+    GSList                    *i;
+
+    for (i = pending_changes; i; i = g_slist_next(i)) {
+        change = i->data;
+        g_free(change->name);
+        g_free(change);
+    }
+
+    g_slist_free(pending_changes);
+    pending_changes = NULL;
+    g_hash_table_remove_all(pending_index);
+}
+
+#define ROUTE_DIRECTION(type) ((type) & (OHM_EXT_ROUTE_TYPE_OUTPUT | \
+                                           OHM_EXT_ROUTE_TYPE_INPUT))
+
+static guint change_hash(gconstpointer key)
+{
+    const struct audio_route_change *change = key;
+
+    return g_str_hash(change->name) ^ ROUTE_DIRECTION(change->type);
+}
+
+static gboolean change_equal(gconstpointer a, gconstpointer b)
+{
+    const struct audio_route_change *ca = a, *cb = b;
+
+    return ROUTE_DIRECTION(ca->type) == ROUTE_DIRECTION(cb->type) &&
+           strcmp(ca->name, cb->name) == 0;
+}
+
+static gboolean flush_changes(gpointer data)
+{
+    (void) data;
+
+    pending_flush = 0;
+
+    if (pending_changes) {
+        OHM_DEBUG(DBG_ROUTE, "signal %u coalesced route changes",
+                  g_slist_length(pending_changes));
+        dbusif_signal_routes_changed(pending_changes);
+    }
+
+    drop_changes();
+
+    return FALSE;
+}
+
+/*
+ * Queue a route change for the aggregated signal, which is sent once
+ * the running factstore transaction has finished and we are back in
+ * the main loop. Changes to the same direction of a device are merged,
+ * so changed ends up holding the net toggled type bits. The output and
+ * input of a device share the name but are signalled separately.
+ */
+static void route_changed(const char *device, uint32_t type, uint32_t changed)
+{
+    struct audio_route_change *change, key;
+
+    if (legacy_signal)
+        dbusif_signal_route_changed(device, type);
+
+    key.name = (char *) device;
+    key.type = type;
+
+    if (!(change = g_hash_table_lookup(pending_index, &key))) {
+        change = g_new0(struct audio_route_change, 1);
+        change->name = g_strdup(device);
+        change->type = type;
+        g_hash_table_insert(pending_index, change, change);
+        pending_changes = g_slist_append(pending_changes, change);
+    }
+
+    change->type     = type;
+    change->changed ^= changed;
+
+    if (!pending_flush)
+        pending_flush = g_idle_add_full(G_PRIORITY_HIGH, flush_changes, NULL, NULL);
+}
+
 static void set_mapping_bit_by_type(const char *device_name, uint32_t device_type, uint32_t bit, gboolean enable)
 {
     struct audio_device_mapping_route *route = NULL;
 
     if ((route = route_by_device_name_and_type(device_name, device_type))) {
         if (set_mapping_bit(route->common, bit, enable))
-            dbusif_signal_route_changed(route->common->name, route_type(route));
+            route_changed(route->common->name, route_type(route), bit);
+    }
+}
+
+static void index_add(GHashTable *index, const char *name, gpointer data)
+{
+    GSList *list;
+
+    /* keys are owned by the indexed entries, which outlive the index */
+    if ((list = g_hash_table_lookup(index, name)))
+        g_slist_append(list, data);
+    else
+        g_hash_table_insert(index, (gpointer) name, g_slist_append(NULL, data));
+}
+
+/*
+ * Routes are kept in the order a scan through the mappings and their
+ * routes would find them, so the first route of the right type is the
+ * same one as that scan would return.
+ */
+static void route_index_add(struct audio_device_mapping_route *route)
+{
+    GSList *list, *i, *prev;
+
+    list = g_hash_table_lookup(route_index, route->name);
+
+    for (i = list, prev = NULL; i; prev = i, i = g_slist_next(i)) {
+        struct audio_device_mapping_route *r = i->data;
+        if (r->common->order > route->common->order)
+            break;
+    }
+
+    if (prev)
+        prev->next = g_slist_prepend(prev->next, route);
+    else {
+        g_hash_table_steal(route_index, route->name);
+        g_hash_table_insert(route_index, route->name, g_slist_prepend(list, route));
     }
 }
 
@@ -153,10 +284,12 @@ static struct audio_device_mapping *mapping_by_commonname_and_type(const char *c
 {
     GSList *i;
 
-    for (i = mappings; i; i = g_slist_next(i)) {
-        struct audio_device_mapping *m = g_slist_nth_data(i, 0);
-        if (strcmp(commonname, m->name) == 0 &&
-            m->type & type)
+    if (!commonname)
+        return NULL;
+
+    for (i = g_hash_table_lookup(mapping_index, commonname); i; i = g_slist_next(i)) {
+        struct audio_device_mapping *m = i->data;
+        if (m->type & type)
             return m;
     }
 
@@ -166,19 +299,15 @@ static struct audio_device_mapping *mapping_by_commonname_and_type(const char *c
 static struct audio_device_mapping_route *route_by_device_name_and_type(const char *device,
                                                                         int         type)
 {
-    GSList *i, *n;
-    struct audio_device_mapping_route *r;
+    GSList *i;
 
-    for (i = mappings; i; i = g_slist_next(i)) {
-        struct audio_device_mapping *m = g_slist_nth_data(i, 0);
+    if (!device)
+        return NULL;
 
-        if (m->type & type) {
-            for (n = m->routes; n; n = g_slist_next(n)) {
-                r = g_slist_nth_data(n, 0);
-                if (strcmp(r->name, device) == 0)
-                    return r;
-            }
-        }
+    for (i = g_hash_table_lookup(route_index, device); i; i = g_slist_next(i)) {
+        struct audio_device_mapping_route *r = i->data;
+        if (r->common->type & type)
+            return r;
     }
 
     return NULL;
@@ -186,15 +315,10 @@ static struct audio_device_mapping_route *route_by_device_name_and_type(const ch
 
 static struct audio_feature *feature_by_name(const char *name)
 {
-    GSList *i;
-
-    for (i = features; i; i = g_slist_next(i)) {
-        struct audio_feature *f = g_slist_nth_data(i, 0);
-        if (strcmp(f->name, name) == 0)
-            return f;
-    }
+    if (!name)
+        return NULL;
 
-    return NULL;
+    return g_hash_table_lookup(feature_index, name);
 }
 
 static void read_devices(fsif_entry_t *entry, gpointer userdata)
@@ -238,7 +362,9 @@ static void read_devices(fsif_entry_t *entry, gpointer userdata)
             m->type |= (OHM_EXT_ROUTE_TYPE_BUILTIN | OHM_EXT_ROUTE_TYPE_WIRELESS);
 
         m->name = g_strdup(common.string);
+        m->order = g_slist_length(mappings);
         mappings = g_slist_append(mappings, m);
+        index_add(mapping_index, m->name, m);
         OHM_DEBUG(DBG_ROUTE, "init new %s device %s type %s (%d)",
                   m->type & OHM_EXT_ROUTE_TYPE_OUTPUT ? "output" : "input",
                   m->name, type.string, m->type);
@@ -252,17 +378,17 @@ static void read_devices(fsif_entry_t *entry, gpointer userdata)
         r->type |= OHM_EXT_ROUTE_TYPE_VOICE;
 
     m->routes = g_slist_append(m->routes, r);
+    route_index_add(r);
     OHM_DEBUG(DBG_ROUTE, "init     device %s policy route %s", m->name, r->name);
 }
 
 static void update_devices(fsif_entry_t *entry, const char *fact_name,
                            const char *value_name, int value_apply)
 {
-    struct audio_device_mapping        *m;
     struct audio_device_mapping_route  *r;
     fsif_value_t                        device;
     fsif_value_t                        value;
-    GSList                             *i, *n;
+    GSList                             *i;
 
     fsif_get_field_by_entry(entry, fldtype_string, FACTSTORE_ARG_NAME, &device);
     fsif_get_field_by_entry(entry, fldtype_integer, (char *) value_name, &value);
@@ -276,14 +402,9 @@ static void update_devices(fsif_entry_t *entry, const char *fact_name,
     if (!value.integer)
         return;
 
-    for (i = mappings; i; i = g_slist_next(i)) {
-        m = i->data;
-
-        for (n = m->routes; n; n = g_slist_next(n)) {
-            r = n->data;
-            if (strcmp(r->name, device.string) == 0)
-                set_mapping_bit(m, value_apply, TRUE);
-        }
+    for (i = g_hash_table_lookup(route_index, device.string); i; i = g_slist_next(i)) {
+        r = i->data;
+        set_mapping_bit(r->common, value_apply, TRUE);
     }
 }
 
@@ -349,6 +470,7 @@ static void read_features(fsif_entry_t *entry, gpointer userdata)
         f->allowed = allowed.integer;
         f->enabled = enabled.integer;
         features = g_slist_append(features, f);
+        g_hash_table_insert(feature_index, f->name, f);
         OHM_DEBUG(DBG_ROUTE, "init new feature %s (initial state allowed %d enabled %d",
                   f->name, f->allowed, f->enabled);
     } else
@@ -358,15 +480,27 @@ static void read_features(fsif_entry_t *entry, gpointer userdata)
 
 void route_init(OhmPlugin *plugin)
 {
-    GSList *entries;
+    GSList      *entries;
+    const char  *legacy;
 
-    (void)plugin;
+    if ((legacy = ohm_plugin_get_param(plugin, "legacy-route-signal")))
+        legacy_signal = strcmp(legacy, "no") != 0;
+
+    OHM_INFO("route: per-change %s signal %s", OHM_EXT_ROUTE_CHANGED_SIGNAL,
+             legacy_signal ? "enabled" : "disabled");
 
     audio_route_sink = NULL;
     audio_route_source = NULL;
     mappings = NULL;
     features = NULL;
 
+    route_index   = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          NULL, (GDestroyNotify) g_slist_free);
+    mapping_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          NULL, (GDestroyNotify) g_slist_free);
+    feature_index = g_hash_table_new(g_str_hash, g_str_equal);
+    pending_index = g_hash_table_new(change_hash, change_equal);
+
     if ((entries = fsif_get_entries_by_name(FACTSTORE_AUDIO_OUTPUT)))
         g_slist_foreach(entries, (GFunc) read_devices, GINT_TO_POINTER(OHM_EXT_ROUTE_TYPE_OUTPUT));
     if ((entries = fsif_get_entries_by_name(FACTSTORE_AUDIO_INPUT)))
@@ -418,6 +552,29 @@ void route_exit(OhmPlugin *plugin)
 {
     (void) plugin;
 
+    if (pending_flush) {
+        g_source_remove(pending_flush);
+        pending_flush = 0;
+    }
+    if (pending_index) {
+        drop_changes();
+        g_hash_table_destroy(pending_index);
+        pending_index = NULL;
+    }
+
+    if (route_index) {
+        g_hash_table_destroy(route_index);
+        route_index = NULL;
+    }
+    if (mapping_index) {
+        g_hash_table_destroy(mapping_index);
+        mapping_index = NULL;
+    }
+    if (feature_index) {
+        g_hash_table_destroy(feature_index);
+        feature_index = NULL;
+    }
+
     g_slist_free_full(mappings, (GDestroyNotify) mapping_free);
 }
 
@@ -446,6 +603,7 @@ static void audio_route_changed_cb(fsif_entry_t   *entry,
     int                                 type;
     struct audio_device_mapping_route  *route       = NULL;
     struct audio_device_mapping_route **active      = NULL;
+    uint32_t                            changed     = 0;
 
     (void) name;
     (void) userdata;
@@ -470,24 +628,26 @@ static void audio_route_changed_cb(fsif_entry_t   *entry,
             return;
 
         if (*active && set_mapping_bit((*active)->common, OHM_EXT_ROUTE_TYPE_ACTIVE, FALSE)) {
-            dbusif_signal_route_changed((*active)->common->name, route_type(*active));
+            route_changed((*active)->common->name, route_type(*active),
+                          OHM_EXT_ROUTE_TYPE_ACTIVE);
         }
 
         *active = route;
 
-        set_mapping_bit((*active)->common, OHM_EXT_ROUTE_TYPE_ACTIVE, TRUE);
+        if (set_mapping_bit((*active)->common, OHM_EXT_ROUTE_TYPE_ACTIVE, TRUE))
+            changed = OHM_EXT_ROUTE_TYPE_ACTIVE;
 
         OHM_DEBUG(DBG_ROUTE, "audio route: type=%s device=%s common_name=%s",
                              type_str.string, route->name, route->common->name);
     }
 
     if (route)
-        dbusif_signal_route_changed(route->common->name, route_type(route));
+        route_changed(route->common->name, route_type(route), changed);
     /* For unknown devices we will directly pass on
      * what the routing fact contains. */
     else {
         OHM_ERROR("route [%s]: unknown device %s", __FUNCTION__, device);
-        dbusif_signal_route_changed(device, type);
+        route_changed(device, type, 0);
     }
 }
 
@@ -43,6 +43,12 @@ struct audio_feature {
     unsigned int enabled;
 };
 
+struct audio_route_change {
+    char *name;
+    unsigned int type;          /* device type after the last change */
+    unsigned int changed;       /* type bits changed since last signal */
+};
+
 struct audio_device_mapping;
 
 void route_init(OhmPlugin *plugin);
@@ -172,6 +172,12 @@ button_handler(sensor_t *sensor, OhmFact *event)
 
     state = sensor->states[stid];
 
+    /* avoid a factstore update if nothing changed */
+    if (stid == sensor->state)
+        return TRUE;
+
+    sensor->state = stid;
+
     OHM_DEBUG(DBG_SENSOR, "new state for sensor %s: %s", sensor->id, state);
     
     ohm_fact_set(sensor->fact, "state", ohm_value_from_string(state));
@@ -0,0 +1,219 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/* libep micro-benchmark: decisions parsed and keys looked up per second
+ *
+ * usage: ep-bench [iterations [decisions-per-set [pairs-per-decision]]]
+ *
+ * Builds a decision signal like the policy engine sends and parses it
+ * repeatedly the way the signal filter does, looking up every key of
+ * every decision with the libep getters. No bus connection is needed. */
+
+#include <time.h>
+
+#include "ep.c"
+
+#define NUM_SETS 4
+
+static const char *set_names[NUM_SETS] = {
+    "com.nokia.policy.audio_route",
+    "com.nokia.policy.audio_mute",
+    "com.nokia.policy.volume_limit",
+    "com.nokia.policy.context",
+};
+
+static int append_pair(DBusMessageIter *it, const char *key, int type,
+        void *value)
+{
+    DBusMessageIter structit, variantit;
+    char sig[2] = { (char) type, '\0' };
+
+    return
+        dbus_message_iter_open_container(it, DBUS_TYPE_STRUCT, NULL, &structit) &&
+        dbus_message_iter_append_basic(&structit, DBUS_TYPE_STRING, &key) &&
+        dbus_message_iter_open_container(&structit, DBUS_TYPE_VARIANT, sig,
+                &variantit) &&
+        dbus_message_iter_append_basic(&variantit, type, value) &&
+        dbus_message_iter_close_container(&structit, &variantit) &&
+        dbus_message_iter_close_container(it, &structit);
+}
+
+static DBusMessage * build_message(int n_decisions, int n_pairs, char **keys)
+{
+    DBusMessage *msg;
+    DBusMessageIter msgit, arrit, entit, actit, pairit;
+    dbus_uint32_t txid = 0;
+    const char *str = "headset";
+    dbus_int32_t i32;
+    double dbl;
+    int i, j, k;
+
+    msg = dbus_message_new_signal(POLICY_DBUS_PATH "/" POLICY_DECISION,
+            POLICY_DBUS_INTERFACE, "actions");
+
+    if (msg == NULL)
+        return NULL;
+
+    dbus_message_iter_init_append(msg, &msgit);
+    dbus_message_iter_append_basic(&msgit, DBUS_TYPE_UINT32, &txid);
+    dbus_message_iter_open_container(&msgit, DBUS_TYPE_ARRAY, "{saa(sv)}",
+            &arrit);
+
+    for (i = 0; i < NUM_SETS; i++) {
+        dbus_message_iter_open_container(&arrit, DBUS_TYPE_DICT_ENTRY, NULL,
+                &entit);
+        dbus_message_iter_append_basic(&entit, DBUS_TYPE_STRING, &set_names[i]);
+        dbus_message_iter_open_container(&entit, DBUS_TYPE_ARRAY, "a(sv)",
+                &actit);
+
+        for (j = 0; j < n_decisions; j++) {
+            dbus_message_iter_open_container(&actit, DBUS_TYPE_ARRAY, "(sv)",
+                    &pairit);
+
+            for (k = 0; k < n_pairs; k++) {
+                switch (k % 3) {
+                    case 0:
+                        append_pair(&pairit, keys[k], DBUS_TYPE_STRING, &str);
+                        break;
+                    case 1:
+                        i32 = j * k;
+                        append_pair(&pairit, keys[k], DBUS_TYPE_INT32, &i32);
+                        break;
+                    default:
+                        dbl = j / 2.0;
+                        append_pair(&pairit, keys[k], DBUS_TYPE_DOUBLE, &dbl);
+                        break;
+                }
+            }
+
+            dbus_message_iter_close_container(&actit, &pairit);
+        }
+
+        dbus_message_iter_close_container(&entit, &actit);
+        dbus_message_iter_close_container(&arrit, &entit);
+    }
+
+    dbus_message_iter_close_container(&msgit, &arrit);
+
+    return msg;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    int n_decisions = argc > 2 ? atoi(argv[2]) : 4;
+    int n_pairs = argc > 3 ? atoi(argv[3]) : 8;
+    DBusMessage *msg;
+    DBusMessageIter msgit, arrit, entit;
+    struct ep_arena arena;
+    struct ep_decision **decisions, **d;
+    char **keys;
+    unsigned long parsed = 0, lookups = 0, found = 0;
+    double start, elapsed;
+    int i, k, success = TRUE;
+
+    if (iterations <= 0 || n_decisions <= 0 || n_pairs <= 0) {
+        fprintf(stderr, "usage: %s [iterations [decisions [pairs]]]\n",
+                argv[0]);
+        exit(1);
+    }
+
+    keys = calloc(n_pairs, sizeof(char *));
+
+    for (k = 0; k < n_pairs; k++) {
+        keys[k] = malloc(32);
+        snprintf(keys[k], 32, "key_%d", k);
+    }
+
+    if ((msg = build_message(n_decisions, n_pairs, keys)) == NULL) {
+        fprintf(stderr, "failed to build the decision message\n");
+        exit(1);
+    }
+
+    ep_arena_init(&arena);
+    start = now();
+
+    for (i = 0; i < iterations; i++) {
+        dbus_message_iter_init(msg, &msgit);
+        dbus_message_iter_next(&msgit);
+        dbus_message_iter_recurse(&msgit, &arrit);
+
+        do {
+            dbus_message_iter_recurse(&arrit, &entit);
+            dbus_message_iter_next(&entit);
+
+            decisions = parse_decisions(&entit, &arena, &success);
+
+            for (d = decisions; d != NULL && *d != NULL; d++) {
+                parsed++;
+
+                for (k = 0; k < n_pairs; k++) {
+                    switch (ep_decision_type(*d, keys[k])) {
+                        case EP_VALUE_STRING:
+                            found += ep_decision_get_string(*d, keys[k]) != NULL;
+                            break;
+                        case EP_VALUE_INT:
+                            found += ep_decision_get_int(*d, keys[k]) >= 0;
+                            break;
+                        case EP_VALUE_FLOAT:
+                            found += ep_decision_get_float(*d, keys[k]) >= 0.0;
+                            break;
+                        default:
+                            break;
+                    }
+                    lookups += 2;
+                }
+            }
+        } while (dbus_message_iter_next(&arrit));
+
+        ep_arena_free(&arena);
+    }
+
+    elapsed = now() - start;
+
+    if (!success || found * 2 != lookups) {
+        fprintf(stderr, "parsing failed (%lu/%lu keys found)\n",
+                found, lookups / 2);
+        exit(1);
+    }
+
+    printf("%d messages, %d sets of %d decisions with %d pairs each\n",
+            iterations, NUM_SETS, n_decisions, n_pairs);
+    printf("%.3f s, %.0f decisions/s, %.0f lookups/s\n", elapsed,
+            parsed / elapsed, lookups / elapsed);
+
+    dbus_message_unref(msg);
+
+    for (k = 0; k < n_pairs; k++)
+        free(keys[k]);
+    free(keys);
+
+    return 0;
+}
+
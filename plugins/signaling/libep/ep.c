@@ -124,47 +124,6 @@ static int ep_list_remove (struct ep_list_head_s *head, void *data)
     return TRUE;
 }
 
-static void ep_list_free_all (struct ep_list_head_s *head) {
-
-    struct ep_list_node_s *node = head->first, *p_node = NULL;
-
-    while (node) {
-        p_node = node;
-        node = node->next;
-
-        free(p_node);
-    }
-
-    head->first = NULL;
-    head->last = NULL;
-}
-
-static void ** ep_list_convert_to_array(struct ep_list_head_s *head) {
-
-    struct ep_list_node_s *node = head->first;
-    int node_count = 0, i = 0;
-    void **retval = NULL;
-
-    while (node) {
-        node_count++;
-        node = node->next;
-    }
-
-    retval = calloc(node_count + 1, sizeof(void *));
-
-    if (!retval)
-        return NULL;
-
-    node = head->first;
-
-    for (i = 0; i < node_count; i++) {
-        retval[i] = node->data;
-        node = node->next;
-    }
-    
-    return retval;
-}
-
 static struct transaction_data * ep_get_transaction(int txid) {
     
     /* check if it is still valid -- need to be in the list */
@@ -273,28 +232,251 @@ static void ep_ready(int txid, int status) {
 }
 
 
-static void free_decisions(struct ep_decision **decisions) {
+/* Decisions are parsed into a per message arena: the pair keys and string
+ * values point directly to the message, which outlives the callbacks, and
+ * everything else is bump-allocated. Small messages fit the inline buffer
+ * and need no heap allocations at all. */
+
+#define EP_ARENA_INLINE_SIZE 4096
+#define EP_ARENA_CHUNK_SIZE  16384
+
+struct ep_arena_chunk {
+    struct ep_arena_chunk *next;
+    double                 data[];       /* double for alignment */
+};
+
+struct ep_arena {
+    char                  *ptr;
+    size_t                 left;
+    struct ep_arena_chunk *chunks;
+    double                 buf[EP_ARENA_INLINE_SIZE / sizeof(double)];
+};
+
+static void ep_arena_init (struct ep_arena *arena)
+{
+    arena->ptr = (char *) arena->buf;
+    arena->left = sizeof(arena->buf);
+    arena->chunks = NULL;
+}
+
+static void * ep_arena_alloc (struct ep_arena *arena, size_t size)
+{
+    struct ep_arena_chunk *chunk;
+    size_t chunk_size;
+    void *p;
+
+    size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+
+    if (size > arena->left) {
+        chunk_size = size > EP_ARENA_CHUNK_SIZE ? size : EP_ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(struct ep_arena_chunk) + chunk_size);
+
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->ptr = (char *) chunk->data;
+        arena->left = chunk_size;
+    }
+
+    p = arena->ptr;
+    arena->ptr += size;
+    arena->left -= size;
+
+    return memset(p, 0, size);
+}
+
+static void ep_arena_free (struct ep_arena *arena)
+{
+    struct ep_arena_chunk *chunk;
+
+    while ((chunk = arena->chunks) != NULL) {
+        arena->chunks = chunk->next;
+        free(chunk);
+    }
+
+    ep_arena_init(arena);
+}
+
+static unsigned int ep_hash (const char *key)
+{
+    unsigned int hash = 2166136261U;
+
+    while (*key) {
+        hash ^= (unsigned char) *key++;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static int ep_count (DBusMessageIter *it)
+{
+    DBusMessageIter tmp = *it;
+    int n = 0;
+
+    while (dbus_message_iter_get_arg_type(&tmp) != DBUS_TYPE_INVALID) {
+        n++;
+        dbus_message_iter_next(&tmp);
+    }
+
+    return n;
+}
+
+static void ep_index_decision (struct ep_decision *decision,
+        struct ep_arena *arena)
+{
+    unsigned int size, slot, i;
+    const char *key;
+
+    /* open addressing table of pair index + 1, the first key wins */
+
+    if (decision->n_pairs == 0 || decision->n_pairs >= 0xffff)
+        return;
+
+    for (size = 4; size < 2 * decision->n_pairs; size <<= 1)
+        ;
+
+    decision->slots = ep_arena_alloc(arena, size * sizeof(unsigned short));
+
+    if (decision->slots == NULL)
+        return;
+
+    decision->mask = size - 1;
+
+    for (i = 0; i < decision->n_pairs; i++) {
+        key = decision->pairs[i]->key;
+        slot = ep_hash(key) & decision->mask;
+
+        while (decision->slots[slot] &&
+               strcmp(decision->pairs[decision->slots[slot] - 1]->key, key))
+            slot = (slot + 1) & decision->mask;
+
+        if (!decision->slots[slot])
+            decision->slots[slot] = i + 1;
+    }
+}
+
+static struct ep_decision * parse_decision (DBusMessageIter *actit,
+        struct ep_arena *arena, int *success)
+{
+    struct ep_decision *decision;
+    struct ep_key_value_pair *pair;
+    DBusMessageIter structit, structfieldit, variantit;
+    int max;
+
+    union {
+        dbus_int32_t  i;
+        double        d;
+        char         *s;
+    } value;
+
+    dbus_message_iter_recurse(actit, &structit);
+    max = ep_count(&structit);
+
+    decision = ep_arena_alloc(arena, sizeof(struct ep_decision));
+    pair = ep_arena_alloc(arena, max * sizeof(struct ep_key_value_pair));
+    
+    if (decision == NULL || pair == NULL)
+        return NULL;
+
+    decision->pairs = ep_arena_alloc(arena, (max + 1) * sizeof(pair));
+
+    if (decision->pairs == NULL)
+        return NULL;
+
+    /* gather the key-value pairs to the decision */
+    for ( ; dbus_message_iter_get_arg_type(&structit) != DBUS_TYPE_INVALID;
+          dbus_message_iter_next(&structit)) {
+
+        if (dbus_message_iter_get_arg_type(&structit) != DBUS_TYPE_STRUCT) {
+            *success = FALSE;
+            continue;
+        }
+        dbus_message_iter_recurse(&structit, &structfieldit);
+
+        /* there are two fields inside the struct: one string and one
+         * variant */
+
+        if (dbus_message_iter_get_arg_type(&structfieldit) != DBUS_TYPE_STRING) {
+            *success = FALSE;
+            continue;
+        }
+
+        dbus_message_iter_get_basic(&structfieldit, (void *)&pair->key);
+
+        if (!dbus_message_iter_next(&structfieldit) ||
+            dbus_message_iter_get_arg_type(&structfieldit) != DBUS_TYPE_VARIANT) {
+            *success = FALSE;
+            continue;
+        }
+        dbus_message_iter_recurse(&structfieldit, &variantit);
+
+        switch (dbus_message_iter_get_arg_type(&variantit)) {
+            case DBUS_TYPE_INT32:
+                dbus_message_iter_get_basic(&variantit, (void *)&value.i);
+                if ((pair->value = ep_arena_alloc(arena, sizeof(int))) == NULL)
+                    return NULL;
+                *(int *) pair->value = value.i;
+                pair->type = EP_VALUE_INT;
+                break;
+            case DBUS_TYPE_DOUBLE:
+                dbus_message_iter_get_basic(&variantit, (void *)&value.d);
+                if ((pair->value = ep_arena_alloc(arena, sizeof(double))) == NULL)
+                    return NULL;
+                *(double *) pair->value = value.d;
+                pair->type = EP_VALUE_FLOAT;
+                break;
+            case DBUS_TYPE_STRING:
+                dbus_message_iter_get_basic(&variantit, (void *)&value.s);
+                pair->value = value.s;
+                pair->type = EP_VALUE_STRING;
+                break;
+            default:
+                /* unknown D-Bus type, keep the key without a value */
+                break;
+        }
+
+        decision->pairs[decision->n_pairs++] = pair++;
+    }
 
-    struct ep_decision **decisions_iter = decisions;
+    ep_index_decision(decision, arena);
 
-    while (*decisions_iter) {
-        struct ep_decision *decision = *decisions_iter;
-        struct ep_key_value_pair **pairs = decision->pairs;
+    return decision;
+}
+
+static struct ep_decision ** parse_decisions (DBusMessageIter *entit,
+        struct ep_arena *arena, int *success)
+{
+    struct ep_decision **decisions, *decision;
+    DBusMessageIter actit;
+    int n = 0;
 
-        while (*pairs) {
-            struct ep_key_value_pair *pair = *pairs;
+    dbus_message_iter_recurse(entit, &actit);
 
-            free(pair->key);
-            free(pair->value);
-            free(pair);
+    decisions = ep_arena_alloc(arena,
+            (ep_count(&actit) + 1) * sizeof(struct ep_decision *));
+
+    if (decisions == NULL)
+        return NULL;
 
-            pairs++;
+    /* gather the decisions to the decision set */
+    for ( ; dbus_message_iter_get_arg_type(&actit) != DBUS_TYPE_INVALID;
+          dbus_message_iter_next(&actit)) {
+
+        if (dbus_message_iter_get_arg_type(&actit) != DBUS_TYPE_ARRAY) {
+            *success = FALSE;
+            continue;
         }
-        free(decision->pairs);
 
-        decisions_iter++;
+        if ((decision = parse_decision(&actit, arena, success)) == NULL)
+            return NULL;
+
+        decisions[n++] = decision;
     }
-    free(decisions);
+
+    return decisions;
 }
 
 static void handle_message (DBusMessage *msg, struct cb_data *data)
@@ -312,11 +494,8 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
     DBusMessageIter  msgit;
     DBusMessageIter  arrit;
     DBusMessageIter  entit;
-    DBusMessageIter  actit;
-    DBusMessageIter  structit;
-    DBusMessageIter  structfieldit;
-    DBusMessageIter  variantit;
 
+    struct ep_arena  arena;
     int              success = TRUE;
 
     /* printf("libep: parsing the message\n"); */
@@ -361,6 +540,8 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
     if (dbus_message_iter_get_arg_type(&msgit) != DBUS_TYPE_UINT32)
         return;
 
+    ep_arena_init(&arena);
+
     dbus_message_iter_get_basic(&msgit, (void *)&txid);
 
     if (txid != 0) {
@@ -394,10 +575,7 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
 
         do {
             struct ep_decision **decisions = NULL;
-            struct ep_list_head_s decision_list;
-            
-            memset(&decision_list, 0, sizeof(struct ep_list_head_s));
-    
+
             if (dbus_message_iter_get_arg_type(&entit) != DBUS_TYPE_STRING) {
                 success = FALSE;
                 continue;
@@ -413,104 +591,12 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
                 continue;
             }
             
-            dbus_message_iter_recurse(&entit, &actit);
-            
-            /* gather the decisions to the decision set */
-            do {
-                struct ep_decision *decision = calloc(1, sizeof(struct ep_decision));
-
-                struct ep_list_head_s pair_list;
-                memset(&pair_list, 0, sizeof(struct ep_list_head_s));
-
-                if (dbus_message_iter_get_arg_type(&actit) != DBUS_TYPE_ARRAY) {
-                    success = FALSE;
-                    free(decision);
-                    continue;
-                }
-                dbus_message_iter_recurse(&actit, &structit);
-
-                /* gather the key-value pairs to the decision */
-                do {
-                    struct ep_key_value_pair *pair =
-                        calloc(1, sizeof(struct ep_key_value_pair));
-                    void *tmp = NULL;
-                    char *key = NULL;
-
-                    if (dbus_message_iter_get_arg_type(&structit) != DBUS_TYPE_STRUCT) {
-                        success = FALSE;
-                        free(pair);
-                        continue;
-                    }
-                    dbus_message_iter_recurse(&structit, &structfieldit);
-
-                    /* there are two fields inside the struct: one
-                     * string and one variant */
-
-                    if (dbus_message_iter_get_arg_type(&structfieldit) != DBUS_TYPE_STRING) {
-                        success = FALSE;
-                        free(pair);
-                        continue;
-                    }
-
-                    dbus_message_iter_get_basic(&structfieldit, (void *)&key);
-                    pair->key = strdup(key);
-                    /* printf("libep:   key: '%s'\n", pair->key); */
-
-                    if (!dbus_message_iter_next(&structfieldit)) {
-                        success = FALSE;
-                        free(pair);
-                        continue;
-                    }
-
-                    if (dbus_message_iter_get_arg_type(&structfieldit) != DBUS_TYPE_VARIANT) {
-                        success = FALSE;
-                        free(pair);
-                        continue;
-                    }
-                    dbus_message_iter_recurse(&structfieldit, &variantit);
-                    dbus_message_iter_get_basic(&variantit, (void *)&tmp);
-                    
-                    switch (dbus_message_iter_get_arg_type(&variantit)) {
-                        case DBUS_TYPE_INT32:
-                            pair->value = malloc(sizeof(int));
-                            memcpy(pair->value, &tmp, sizeof(int));
-                            pair->type = EP_VALUE_INT;
-                            /* printf("libep:   value (int)    '%i'\n",
-                                    *(int *) pair->value); */
-                            break;
-                        case DBUS_TYPE_DOUBLE:
-                            pair->value = malloc(sizeof(double));
-                            memcpy(pair->value, &tmp, sizeof(double));
-                            pair->type = EP_VALUE_FLOAT;
-                            /* printf("libep:   value (float)  '%f'\n",
-                                    *(float *) pair->value); */
-                            break;
-                        case DBUS_TYPE_STRING:
-                            pair->value = strdup(tmp);
-                            pair->type = EP_VALUE_STRING;
-                            /* printf("libep:   value (string) '%s'\n",
-                                    (char *) pair->value); */
-                            break;
-                        default:
-                            /* printf("libep:   value is unknown D-Bus type '%i'\n", 
-                                    dbus_message_iter_get_arg_type(&variantit)); */
-                            break;
-                    }
-                    
-                    ep_list_append(&pair_list, pair);
+            decisions = parse_decisions(&entit, &arena, &success);
 
-                } while (dbus_message_iter_next(&structit));
-
-                decision->pairs =
-                    (struct ep_key_value_pair **) ep_list_convert_to_array(&pair_list);
-                ep_list_free_all(&pair_list);
-                
-                ep_list_append(&decision_list, decision);
-            
-            } while (dbus_message_iter_next(&entit));
-
-            decisions = (struct ep_decision **) ep_list_convert_to_array(&decision_list);
-            ep_list_free_all(&decision_list);
+            if (decisions == NULL) {
+                success = FALSE;
+                continue;
+            }
 
             /* count the callbacks if a transaction is needed */
             if (trans_data) {
@@ -552,8 +638,7 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
                 data->cb(actname, decisions, ep_ready, txid, data->user_data);
                 found = TRUE;
             }
-            
-            free_decisions(decisions);
+
 
         } while (dbus_message_iter_next(&entit));
 
@@ -571,6 +656,7 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
          * removed from the list and freed. See if this is the case. */
         trans_data = ep_get_transaction(txid);
         if (!trans_data) {
+            ep_arena_free(&arena);
             return;
         }
 
@@ -581,6 +667,7 @@ static void handle_message (DBusMessage *msg, struct cb_data *data)
 #if 0
         printf("libep: signal handling success, waiting for callbacks\n");
 #endif
+        ep_arena_free(&arena);
         return; /* success */
     }
 
@@ -589,7 +676,7 @@ send_signal:
     /* no-one is interested or everything failed, just send the signal
      * and be done with it */
 
-    /* TODO: free all memory */
+    ep_arena_free(&arena);
 
     if (trans_data) {
         ep_list_remove(&transaction_list, trans_data);
@@ -825,6 +912,24 @@ static struct ep_key_value_pair * ep_find_pair(
         struct ep_decision *decision, const char *key)
 {
     struct ep_key_value_pair **pairs = decision->pairs;
+    struct ep_key_value_pair *pair;
+    unsigned int slot;
+
+    if (decision->slots != NULL) {
+        slot = ep_hash(key) & decision->mask;
+
+        while (decision->slots[slot]) {
+            pair = pairs[decision->slots[slot] - 1];
+
+            if (strcmp(pair->key, key) == 0)
+                return pair;
+
+            slot = (slot + 1) & decision->mask;
+        }
+
+        return NULL;
+    }
+
     while (*pairs) {
         struct ep_key_value_pair *pair = *pairs;
 
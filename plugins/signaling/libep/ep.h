@@ -54,7 +54,12 @@ struct ep_key_value_pair {
 };
 
 struct ep_decision {
-    struct ep_key_value_pair **pairs;
+    struct ep_key_value_pair **pairs;   /* NULL-terminated */
+
+    /* key lookup index, maintained by libep */
+    unsigned int    n_pairs;
+    unsigned int    mask;
+    unsigned short *slots;
 };
 
 
@@ -66,6 +66,10 @@ OHM_IMPORTABLE(void *, timer_add  , (uint32_t delay,
                                      resconn_timercb_t callback,
                                      void *data));
 OHM_IMPORTABLE(void  , timer_del  , (void *timer));
+OHM_IMPORTABLE(int   , query_pid  , (DBusBusType type, const char *name,
+                                     void (*callback)(pid_t, const char *,
+                                                      void *),
+                                     void *data));
 
 
 
@@ -126,6 +130,9 @@ static void event_handler(event_t *event);
 static void plugin_reconnect(char *address);
 
 static void se_pid_query_cb(DBusPendingCall *pending, void *data);
+static void se_pid_resolved(pid_t pid, const char *error, void *data);
+static void se_pid_set(pid_t pid);
+static void se_query_pid(const char *addr);
 static void se_name_query_cb(DBusPendingCall *pending, void *data);
 static int  bus_query_name(const char *name,
                             void (*query_cb)(DBusPendingCall *, void *),
@@ -732,7 +739,7 @@ se_name_query_cb(DBusPendingCall *pending, void *data)
     
     OHM_INFO("telephony: stream engine address is %s.", addr);
 
-    bus_query_pid(addr, se_pid_query_cb, NULL);
+    se_query_pid(addr);
     
  unref_out:
     dbus_message_unref(reply);
@@ -812,16 +819,58 @@ se_pid_query_cb(DBusPendingCall *pending, void *data)
         goto unref_out;
     }
     
+    se_pid_set(pid);
+    
+ unref_out:
+    dbus_message_unref(reply);
+    dbus_pending_call_unref(pending);
+}
+
+
+/********************
+ * se_pid_resolved
+ ********************/
+static void
+se_pid_resolved(pid_t pid, const char *error, void *data)
+{
+    (void)data;
+
+    if (error != NULL) {
+        OHM_ERROR("telephony: DBUS pid query failed (%s).", error);
+        return;
+    }
+
+    se_pid_set(pid);
+}
+
+
+/********************
+ * se_pid_set
+ ********************/
+static void
+se_pid_set(pid_t pid)
+{
     OHM_INFO("telephony: stream engine PID is %u.", pid);
 
     video_pid = pid;
     RESCTL_VIDEO_PID(video_pid);
     if (need_video())
         RESCTL_REALLOC();
-    
- unref_out:
-    dbus_message_unref(reply);
-    dbus_pending_call_unref(pending);
+}
+
+
+/********************
+ * se_query_pid
+ ********************/
+static void
+se_query_pid(const char *addr)
+{
+    /* prefer the shared, cached pid resolution of the dbus plugin */
+    if (query_pid != NULL &&
+        query_pid(DBUS_BUS_SESSION, addr, se_pid_resolved, NULL))
+        return;
+
+    bus_query_pid(addr, se_pid_query_cb, NULL);
 }
 
 
@@ -2184,7 +2233,7 @@ name_owner_changed(DBusConnection *c, DBusMessage *msg, void *data)
         OHM_INFO("Telepathy stream engine is up (address %s).", after);
         video_pid = 0;
         
-        bus_query_pid(after, se_pid_query_cb, NULL);
+        se_query_pid(after);
     }
     
     return DBUS_HANDLER_RESULT_HANDLED;
@@ -4624,6 +4673,19 @@ resctl_update(int video)
  *                            *** OHM plugin glue ***                        *
  *****************************************************************************/
 
+static void pid_cache_init(void)
+{
+    char *signature;
+
+    signature = (char *)query_pid_SIGNATURE;
+
+    if (ohm_module_find_method("dbus.query_pid", &signature,(void *)&query_pid))
+        OHM_INFO("telephony: using shared DBUS pid cache.");
+    else
+        OHM_INFO("telephony: no shared DBUS pid cache, querying directly.");
+}
+
+
 static void timestamp_init(void)
 {
     char *signature;
@@ -4665,6 +4727,7 @@ plugin_init(OhmPlugin *plugin)
     call_init();
     policy_init();
     timestamp_init();
+    pid_cache_init();
 
     if (ohm_fact_store_get_facts_by_name(store, FACT_PLAYBACK) != NULL)
         resctl_disabled = TRUE;
@@ -26,6 +26,7 @@ USA.
 #include <stdarg.h>
 #include <stdint.h>
 #include <errno.h>
+#include <time.h>
 
 #include "plugin.h"
 #include "randr.h"
@@ -54,6 +55,7 @@ static randr_outprop_def_t *outprops;
 static statecb_slot_t      *statecbs;
 static int32_t              crtc_x;
 static int32_t              crtc_y;
+static struct timespec      connstamp;   /* when X connection came up */
 
 static void connection_state(int, void *);
 
@@ -63,7 +65,7 @@ static randr_screen_t *screen_register(xif_screen_t *);
 static void            screen_unregister(randr_screen_t *);
 static void            screen_reset(randr_screen_t *);
 static void            screen_query(void);
-static void            screen_query_finish(xif_screen_t *, void *);
+static void            screen_snapshot_finish(xif_snapshot_t *, void *);
 static int             screen_check_if_ready(randr_screen_t *);
 static void            screen_synchronize(randr_screen_t *);
 static void            screen_set_size(randr_screen_t *, uint32_t, uint32_t);
@@ -73,7 +75,7 @@ static randr_crtc_t   *crtc_register(randr_screen_t *, uint32_t);
 static void            crtc_unregister(randr_crtc_t *);
 static void            crtc_reset(randr_crtc_t *);
 static void            crtc_disable(randr_crtc_t *);
-static void            crtc_query(uint32_t, uint32_t, uint32_t);
+static void            crtc_setup(xif_crtc_t *);
 static void            crtc_query_finish(xif_crtc_t *, void *);
 static void            crtc_changed(xif_crtc_t *, void *);
 static void            crtc_update(xif_crtc_t *, void *);
@@ -86,7 +88,7 @@ static randr_crtc_t   *crtc_find_by_id(randr_screen_t *, uint32_t);
 static randr_output_t *output_register(randr_screen_t *, uint32_t);
 static void            output_unregister(randr_output_t *);
 static void            output_reset(randr_output_t *);
-static void            output_query(uint32_t, uint32_t, uint32_t);
+static void            output_setup(xif_output_t *, xif_snapshot_t *);
 static void            output_query_finish(xif_output_t *, void *);
 static void            output_changed(xif_output_t *, void *);
 static void            output_update(xif_output_t *, void *);
@@ -433,6 +435,8 @@ static void connection_state(int connection_is_up, void *data)
     if (connection_is_up) {
         if (!connup) {
             connup = TRUE;
+
+            clock_gettime(CLOCK_MONOTONIC, &connstamp);
             
             mode_create();
             screen_query();
@@ -448,8 +452,10 @@ static void connection_state(int connection_is_up, void *data)
 
 static void randr_check_if_ready(void)
 {
-    statecb_slot_t *slot;
-    int             i;
+    statecb_slot_t  *slot;
+    struct timespec  now;
+    long             msec;
+    int              i;
 
     if (!ready) {
         for (i = 0;   i < nscreen;  i++) {
@@ -465,6 +471,18 @@ static void randr_check_if_ready(void)
 
     for (slot = statecbs;  slot;   slot = slot->next)
         slot->cb(TRUE, slot->data);
+
+    if (connstamp.tv_sec || connstamp.tv_nsec) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        msec = (now.tv_sec  - connstamp.tv_sec ) * 1000 +
+               (now.tv_nsec - connstamp.tv_nsec) / 1000000;
+
+        OHM_DEBUG(DBG_RANDR, "first route was set %ld msec after connecting "
+                  "to the X server", msec);
+
+        memset(&connstamp, 0, sizeof(connstamp));
+    }
 }
 
 static randr_screen_t *screen_register(xif_screen_t *xif_screen)
@@ -547,29 +565,87 @@ static void screen_reset(randr_screen_t *screen)
 
 static void screen_query(void)
 {
-    uint32_t  rwins[SCREEN_MAX];
-    uint32_t  nrwin;
-    uint32_t  i;
+    randr_outprop_def_t *def;
+    xif_outprop_req_t   *reqs;
+    xif_outprop_req_t   *req;
+    int                  nreq;
+    uint32_t             rwins[SCREEN_MAX];
+    uint32_t             nrwin;
+    uint32_t             i;
 
     OHM_DEBUG(DBG_RANDR, "query screens");
 
+    for (nreq = 0, def = outprops;   def;   def = def->next)
+        nreq++;
+
+    if (nreq == 0 || !(reqs = malloc(sizeof(xif_outprop_req_t) * nreq)))
+        reqs = NULL;
+
+    /* ask the output properties whose atoms are known already */
+    for (nreq = 0, def = outprops;   reqs && def;   def = def->next) {
+        if (def->xid == ATOM_INVALID_VALUE)
+            continue;
+
+        req = reqs + nreq++;
+
+        req->xid  = def->xid;
+        req->type = def->type;
+
+        switch (def->type) {
+        case videoep_atom:   req->length = sizeof(uint32_t);       break;
+        case videoep_card:   req->length = sizeof(int32_t);        break;
+        default:             req->length = RANDR_STRPROP_MAX - 1;  break;
+        }
+    }
+
     nrwin = xif_root_window_query(rwins, SCREEN_MAX);
 
     for (i = 0;  i < nrwin;  i++)
-        xif_screen_query(rwins[i], screen_query_finish,NULL);
+        xif_screen_snapshot(rwins[i], nreq,reqs, screen_snapshot_finish,NULL);
 
+    free(reqs);
 }
 
-static void screen_query_finish(xif_screen_t *xif_screen, void *usrdata)
+static void screen_snapshot_finish(xif_snapshot_t *snap, void *usrdata)
 {
     randr_screen_t *randr_screen;
+    xif_crtc_t     *crtc;
+    xif_output_t   *output;
+    int             i;
 
     (void)usrdata;
 
-    if ((randr_screen = screen_register(xif_screen)) != NULL) {
+    if ((randr_screen = screen_register(&snap->screen)) != NULL) {
         OHM_DEBUG(DBG_RANDR, "screen query complete for rootwin 0x%x "
-                  "(resolution  %lf,%lf dot/mm)", xif_screen->window,
+                  "(resolution  %lf,%lf dot/mm)", snap->screen.window,
                   randr_screen->hdpm, randr_screen->vdpm);
+
+        /* whatever the snapshot failed to get is queried one by one */
+        for (i = 0;  i < snap->ncrtc;  i++) {
+            crtc = snap->crtcs + i;
+
+            if (!crtc->failed)
+                crtc_setup(crtc);
+            else {
+                OHM_DEBUG(DBG_RANDR, "querying crtc 0x%x", crtc->xid);
+                xif_crtc_query(crtc->window, crtc->xid, XCB_CURRENT_TIME,
+                               crtc_query_finish, NULL);
+            }
+        }
+
+        for (i = 0;  i < snap->noutput;  i++) {
+            output = snap->outputs + i;
+
+            if (!output->failed)
+                output_setup(output, snap);
+            else {
+                OHM_DEBUG(DBG_RANDR, "querying output 0x%x", output->xid);
+                xif_output_query(output->window, output->xid, XCB_CURRENT_TIME,
+                                 output_query_finish, NULL);
+            }
+        }
+
+        randr_check_if_ready();
     }    
 }
 
@@ -695,8 +771,6 @@ static randr_crtc_t *crtc_register(randr_screen_t *screen, uint32_t xid)
             crtc->xid    = xid;
             crtc->reqx   = POSITION_DONTCARE;
             crtc->reqy   = POSITION_DONTCARE;
-            
-            crtc_query(screen->rootwin, xid, XCB_CURRENT_TIME);
         }
     }
 
@@ -762,14 +836,7 @@ static void crtc_disable(randr_crtc_t *randr_crtc)
     }
 }
 
-static void crtc_query(uint32_t rootwin, uint32_t crtc, uint32_t tstamp)
-{
-    OHM_DEBUG(DBG_RANDR, "querying crtc 0x%x", crtc);
-
-    xif_crtc_query(rootwin, crtc, tstamp, crtc_query_finish,NULL);
-}
-
-static void crtc_query_finish(xif_crtc_t *xif_crtc, void *usrdata)
+static void crtc_setup(xif_crtc_t *xif_crtc)
 {
     randr_screen_t *screen;
     randr_crtc_t   *randr_crtc;
@@ -779,8 +846,6 @@ static void crtc_query_finish(xif_crtc_t *xif_crtc, void *usrdata)
     char            pb[64];
     int             i;
     
-    (void)usrdata;
-
     if ((screen = screen_find_by_rootwin(xif_crtc->window)) == NULL) {
         OHM_ERROR("videoep: crtc query failed: can't find screen "
                   "for root window 0x%x", xif_crtc->window);
@@ -842,7 +907,13 @@ static void crtc_query_finish(xif_crtc_t *xif_crtc, void *usrdata)
               );
 
     OHM_DEBUG(DBG_RANDR, "crtc 0x%x is ready", randr_crtc->xid);
+}
+
+static void crtc_query_finish(xif_crtc_t *xif_crtc, void *usrdata)
+{
+    (void)usrdata;
 
+    crtc_setup(xif_crtc);
     randr_check_if_ready();
 }
 
@@ -1056,8 +1127,6 @@ static randr_output_t *output_register(randr_screen_t *screen, uint32_t xid)
         if (output != NULL) {
             output->screen = screen;
             output->xid    = xid;
-
-            output_query(screen->rootwin, xid, XCB_CURRENT_TIME);
         }
     }
 
@@ -1102,24 +1171,16 @@ static void output_reset(randr_output_t *output)
 }
 
 
-static void output_query(uint32_t rootwin, uint32_t output, uint32_t tstamp)
-{
-    OHM_DEBUG(DBG_RANDR, "querying output 0x%x", output);
-
-    xif_output_query(rootwin, output, tstamp, output_query_finish,NULL);
-}
-
-static void output_query_finish(xif_output_t *xif_output, void *usrdata)
+static void output_setup(xif_output_t *xif_output, xif_snapshot_t *snap)
 {
     randr_screen_t       *screen;
     randr_output_t       *randr_output;
     randr_outprop_inst_t *outprop_inst;
     randr_outprop_def_t  *outprop_def;
+    xif_outprop_t        *prop;
     uint32_t             *modes;
     char                  buf[256];
-    int                   i;
-
-    (void)usrdata;
+    int                   i, j;
 
     if ((screen = screen_find_by_rootwin(xif_output->window)) == NULL) {
         OHM_ERROR("videoep: output query failed: can't find screen "
@@ -1164,13 +1225,44 @@ static void output_query_finish(xif_output_t *xif_output, void *usrdata)
 
     for (outprop_def = outprops; outprop_def; outprop_def = outprop_def->next){
         for (i = 0;   i < outprop_def->noutput;   i++) {
-            if (!strcmp(randr_output->name, outprop_def->outputs[i])) {
-                outprop_inst = outprop_instance_create(randr_output,
-                                                       outprop_def);
+            if (strcmp(randr_output->name, outprop_def->outputs[i]))
+                continue;
+
+            if (!(outprop_inst = outprop_instance_create(randr_output,
+                                                         outprop_def)))
+                continue;
+
+            for (j = 0, prop = NULL;  snap && j < snap->nprop;  j++) {
+                if (snap->props[j].output == randr_output->xid &&
+                    snap->props[j].xid    == outprop_def->xid    )
+                {
+                    prop = snap->props + j;
+                    break;
+                }
+            }
+
+            if (prop == NULL || prop->failed) {
+                /* missing from the snapshot; ask it if we know the atom */
+                if (outprop_def->xid != ATOM_INVALID_VALUE)
+                    outprop_instance_query(outprop_inst);
+            }
+            else if (prop->value != NULL) {
+                outprop_instance_update_value(screen->rootwin,
+                                              randr_output->xid,
+                                              prop->xid, prop->type,
+                                              prop->value, prop->length,
+                                              outprop_inst);
+                outprop_inst->hasvalue = TRUE;
             }
         }
     }
+}
 
+static void output_query_finish(xif_output_t *xif_output, void *usrdata)
+{
+    (void)usrdata;
+
+    output_setup(xif_output, NULL);
     randr_check_if_ready();
 }
 
@@ -1475,9 +1567,6 @@ static randr_outprop_inst_t *outprop_instance_create(randr_output_t *output,
 
         OHM_DEBUG(DBG_RANDR, "property instance '%s' created for output 0x%x",
                   def->name, output->xid);
-
-        if (def->xid != ATOM_INVALID_VALUE)
-            outprop_instance_query(inst);
     }
 
     return inst;
@@ -1499,7 +1588,7 @@ static void outprop_instance_query(randr_outprop_inst_t *prop)
         switch (def->type) {
         case videoep_atom:   length = sizeof(uint32_t);                break;
         case videoep_card:   length = sizeof(int32_t);                 break; 
-        case videoep_string: length = sizeof(prop->value.string) - 1;  break;
+        case videoep_string: length = RANDR_STRPROP_MAX - 1;           break;
         default:                /* unsupported type */                 return;
         }
 
@@ -31,6 +31,8 @@ USA.
 #define RANDR_PROPLIST_QUERIED    0x08
 #define RANDR_PROPERTIES_QUERIED  0x10
 
+#define RANDR_STRPROP_MAX         256  /* max. length of string props */
+
 #define POSITION_DONTCARE         (UINT32_MAX - 0)
 #define POSITION_APPEND           (UINT32_MAX - 1)
 
@@ -118,7 +120,7 @@ typedef struct randr_outprop_inst_s {
     union {
         uint32_t atom;
         int32_t  card;
-        char     string[256];
+        char     string[RANDR_STRPROP_MAX];
     }                            value;
     int                          hasvalue;
 } randr_outprop_inst_t;
@@ -0,0 +1,437 @@
+/*************************************************************************
+Copyright (C) 2010 Nokia Corporation.
+
+These OHM Modules are free software; you can redistribute
+it and/or modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation
+version 2.1 of the License.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+USA.
+*************************************************************************/
+
+
+/* window tracker test driver
+ *
+ * usage: tracker-test [windows]
+ *
+ * Feeds the window tracker the events of a busy X session: windows of
+ * a few clients get created, receive property changes, some of them
+ * turn into application windows and become the current one, and finally
+ * all of them are destroyed in a scrambled order. After every phase the
+ * window hash and the application window list are checked against the
+ * expected set of windows. The atom,
+ * property, window, exec and xif layers are replaced by stubs. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "tracker.c"
+
+#define DEFAULT_WINDOWS 5000
+#define CLIENTS         8
+#define ROUNDS          10
+
+#define PROP_PID        0
+#define PROP_STATE      1
+
+int DBG_TRACK;
+
+static int executed;            /* number of property executions */
+
+
+void ohm_log(OhmLogLevel level, const gchar *format, ...)
+{
+    va_list ap;
+
+    if (level != OHM_LOG_ERROR)
+        return;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    fputs("\n", stderr);
+    va_end(ap);
+}
+
+void plugin_print_timestamp(const char *func, const char *what)
+{
+    (void)func;
+    (void)what;
+}
+
+/*
+ * stubs for the rest of the plugin
+ */
+
+uint32_t atom_create(const char *id, const char *name)
+{
+    (void)id;
+    (void)name;
+
+    return ATOM_INVALID_INDEX;
+}
+
+int atom_add_query_callback(uint32_t idx, atom_callback_t cb, void *data)
+{
+    (void)idx;
+    (void)cb;
+    (void)data;
+
+    return -1;
+}
+
+uint32_t atom_index_by_id(const char *id)
+{
+    (void)id;
+
+    return ATOM_INVALID_INDEX;
+}
+
+uint32_t property_definition_index(const char *id)
+{
+    if (!strcmp(id, "pid"))
+        return PROP_PID;
+    if (!strcmp(id, "state"))
+        return PROP_STATE;
+
+    return PROPERTY_MAX;
+}
+
+int exec_definition_setup(exec_def_t     *exdef,
+                          exec_type_t     type,
+                          const char     *name,
+                          int             argc,
+                          argument_def_t *argd)
+{
+    memset(exdef, 0, sizeof(exec_def_t));
+    exdef->type = type;
+    exdef->name = name;
+    exdef->argc = argc;
+    exdef->argd = argd;
+
+    return 0;
+}
+
+int exec_instance_setup(exec_inst_t *exinst, exec_def_t *exdef)
+{
+    memset(exinst, 0, sizeof(exec_inst_t));
+    exinst->exdef = exdef;
+
+    return 0;
+}
+
+int exec_instance_finalize(exec_inst_t *exinst, uint32_t *xid)
+{
+    (void)exinst;
+    (void)xid;
+
+    return 0;
+}
+
+void exec_instance_clear(exec_inst_t *exinst)
+{
+    memset(exinst, 0, sizeof(exec_inst_t));
+}
+
+int exec_instance_execute(exec_inst_t *exinst)
+{
+    (void)exinst;
+
+    executed++;
+
+    return 0;
+}
+
+uint32_t window_create(uint32_t xid, window_destcb_t destcb, void *data)
+{
+    (void)destcb;
+    (void)data;
+
+    return xid;
+}
+
+int window_add_property(uint32_t xid, uint32_t def,
+                        window_propcb_t propcb, void *data)
+{
+    (void)xid;
+    (void)def;
+    (void)propcb;
+    (void)data;
+
+    return 0;
+}
+
+int xif_add_connection_callback(xif_connectioncb_t cb, void *data)
+{
+    (void)cb;
+    (void)data;
+
+    return 0;
+}
+
+int xif_remove_connection_callback(xif_connectioncb_t cb, void *data)
+{
+    (void)cb;
+    (void)data;
+
+    return 0;
+}
+
+videoep_value_type_t videoep_get_argument_type(videoep_arg_t *arg)
+{
+    return arg->type;
+}
+
+uint32_t videoep_get_argument_dimension(videoep_arg_t *arg)
+{
+    return arg->dim;
+}
+
+void *videoep_get_argument_data(videoep_arg_t *arg)
+{
+    return arg->value.pointer;
+}
+
+/*
+ * test driver
+ */
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void check(int ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "tracker-test: %s\n", what);
+        exit(1);
+    }
+}
+
+static void check_windows(uint32_t *xids, int *types, int nwin)
+{
+    tracker_window_t *win;
+    uint32_t          nhashed;
+    uint32_t          chain, maxchain;
+    uint32_t          i;
+    int               n;
+
+    for (n = nwin, i = 0;  i < (uint32_t)nwin;  i++) {
+        if (types[i] == tracker_wintype_unknown) {
+            check(find_in_winhash(xids[i]) == NULL, "destroyed window found");
+            n--;
+        }
+        else {
+            check(tracker_window_exists(types[i], xids[i]),
+                  "window missing or has a wrong type");
+        }
+    }
+
+    for (nhashed = maxchain = 0, i = 0;  i < (1U << winhash.bits);  i++) {
+        for (chain = 0, win = winhash.buckets[i];  win;  win = win->next)
+            chain++;
+
+        nhashed += chain;
+        maxchain = chain > maxchain ? chain : maxchain;
+    }
+
+    check(nhashed == winhash.nwin && nhashed == (uint32_t)n,
+          "number of hashed windows is wrong");
+
+    printf("  %6u windows in %6u buckets, longest chain %u\n",
+           nhashed, 1U << winhash.bits, maxchain);
+}
+
+static int count_appwin(uint32_t xid, void *data)
+{
+    int *n = (int *)data;
+
+    check(tracker_window_exists(tracker_appwin, xid),
+          "application window list has a foreign window");
+
+    (*n)++;
+
+    return TRUE;
+}
+
+static int stop_appwin(uint32_t xid, void *data)
+{
+    (void)xid;
+    (void)data;
+
+    return FALSE;
+}
+
+static void check_appwins(int *types, int nwin)
+{
+    int n, napp, i;
+
+    for (napp = i = 0;  i < nwin;  i++)
+        napp += (types[i] == tracker_appwin);
+
+    n = 0;
+
+    check(tracker_appwin_count() == (uint32_t)napp &&
+          tracker_appwin_foreach(count_appwin, &n) == napp && n == napp,
+          "application window list is out of sync");
+
+    check(tracker_appwin_foreach(stop_appwin, NULL) == (napp ? 1 : 0),
+          "application window iteration did not stop");
+
+    printf("  %6d application windows\n", napp);
+}
+
+static void set_property(uint32_t xid, uint32_t def, int32_t value)
+{
+    videoep_value_t v;
+
+    v.card = &value;
+
+    window_property_changed(xid, def, videoep_card, v, 1, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    int       nwin = argc > 1 ? atoi(argv[1]) : DEFAULT_WINDOWS;
+    uint32_t *xids;
+    int      *types;
+    int       nevent, napp, nexec;
+    double    start, elapsed;
+    int       i, j, r, tmp;
+
+    if (nwin <= 0) {
+        fprintf(stderr, "usage: %s [windows]\n", argv[0]);
+        exit(1);
+    }
+
+    xids  = calloc(nwin, sizeof(xids[0]));
+    types = calloc(nwin, sizeof(types[0]));
+
+    check(xids != NULL && types != NULL, "can't allocate memory");
+
+    tracker_init(NULL);
+
+    check(!tracker_add_newwin_property("pid"  , exec_function, "f", 0, NULL) &&
+          !tracker_add_appwin_property("state", exec_function, "f", 0, NULL),
+          "failed to add window properties");
+
+    tracker_complete_configuration();
+
+    /* X hands out the ids of a client sequentially from its id base */
+    for (i = 0;  i < nwin;  i++)
+        xids[i] = ((i % CLIENTS + 1) << 21) | (i / CLIENTS + 1);
+
+    srand(1);
+    nevent = 0;
+    start  = now();
+
+    /* new windows announce their pid */
+    for (i = 0;  i < nwin;  i++) {
+        check(tracker_window_create(tracker_newwin, xids[i]) == 0,
+              "failed to create window");
+        set_property(xids[i], PROP_PID, 1000 + i % CLIENTS);
+        types[i] = tracker_newwin;
+        nevent  += 2;
+    }
+
+    check(tracker_window_create(tracker_newwin, xids[0]) < 0,
+          "window created twice");
+
+    printf("created:\n");
+    check_windows(xids, types, nwin);
+
+    /* half of them turn out to be application windows */
+    for (napp = 0, i = 0;  i < nwin;  i += 2, napp++) {
+        check(tracker_window_set_type(tracker_appwin, xids[i]) == 0,
+              "failed to change window type");
+        types[i] = tracker_appwin;
+        nevent++;
+    }
+
+    printf("typed:\n");
+    check_windows(xids, types, nwin);
+    check_appwins(types, nwin);
+
+    /* state changes; only actual changes get executed */
+    nexec    = executed;
+    executed = 0;
+
+    for (r = 0;  r < ROUNDS;  r++) {
+        for (i = 0;  i < nwin;  i += 2) {
+            set_property(xids[i], PROP_STATE, r / 2);
+            nevent++;
+
+            if (rand() % 64 == 0) {
+                tracker_window_set_current(xids[i]);
+                nevent++;
+            }
+        }
+    }
+
+    check(executed == napp * ROUNDS / 2,
+          "unexpected number of property executions");
+
+    executed += nexec;
+
+    /* everything goes away in a scrambled order */
+    for (i = nwin - 1;  i > 0;  i--) {
+        j = rand() % (i + 1);
+
+        tmp = xids[i];   xids[i]  = xids[j];   xids[j]  = tmp;
+        tmp = types[i];  types[i] = types[j];  types[j] = tmp;
+    }
+
+    for (i = 0;  i < nwin;  i++) {
+        window_destroyed(xids[i], NULL);
+        types[i] = tracker_wintype_unknown;
+        nevent++;
+
+        if (i == nwin / 2) {
+            printf("half destroyed:\n");
+            check_windows(xids, types, nwin);
+            check_appwins(types, nwin);
+        }
+    }
+
+    elapsed = now() - start;
+
+    printf("destroyed:\n");
+    check_windows(xids, types, nwin);
+    check_appwins(types, nwin);
+
+    check(appwinxid == WINDOW_INVALID_ID, "destroyed window is still current");
+
+    printf("%d events, %d executions in %.3f msec (%.0f events/s)\n",
+           nevent, executed, elapsed * 1000.0, nevent / elapsed);
+
+    tracker_exit(NULL);
+
+    free(xids);
+    free(types);
+
+    return 0;
+}
+
+
+/*
+ * Local Variables:
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ * vim:set expandtab shiftwidth=4:
+ */
@@ -41,10 +41,9 @@ USA.
 
 #define INVALID_INDEX        (~((uint32_t)0))
 
-#define WINDOW_HASH_BITS     8
-#define WINDOW_HASH_DIM      (1 << WINDOW_HASH_BITS)
-#define WINDOW_HASH_MASK     (WINDOW_HASH_DIM - 1)
-#define WINDOW_HASH_INDEX(w) ((w) & WINDOW_HASH_MASK)
+#define WINDOW_HASH_MIN_BITS 6
+#define WINDOW_HASH_MAX_BITS 20
+#define WINDOW_HASH_LOAD     2    /* max. average chain length before grow */
 
 #define STRDUP(s)    (s) ? strdup(s) : NULL
 
@@ -82,6 +81,8 @@ typedef struct tracker_newwin_s {
 
 typedef struct tracker_appwin_s {
     TRACK_WINDOW_COMMON(appwin);
+    struct tracker_appwin_s *appnext;           /* list of all appwins */
+    struct tracker_appwin_s *appprev;
     uint32_t            def2idx[PROPERTY_MAX];  /* prop. def.idx => inst.idx */
     uint32_t            nprinst;                /* # of property values  */
     tracker_propinst_t  prinsts[0];             /* property values */
@@ -95,9 +96,23 @@ typedef union tracker_window_u {
 } tracker_window_t;
 
 
+typedef struct {
+    tracker_window_t **buckets;   /* hash chains */
+    uint32_t           bits;      /* log2 of the number of buckets */
+    uint32_t           nwin;      /* number of windows in the hash */
+} tracker_winhash_t;
+
+typedef struct {
+    tracker_appwin_t  *first;
+    tracker_appwin_t  *last;
+    uint32_t           count;
+} tracker_applist_t;
+
+
 static uint32_t            atomval[ATOM_MAX];
 
-static tracker_window_t   *winhash[WINDOW_HASH_DIM];
+static tracker_winhash_t   winhash;
+static tracker_applist_t   applist;
 
 static uint32_t            rootwinxid;
 static uint32_t            rootdef2idx[PROPERTY_MAX];
@@ -118,10 +133,16 @@ static uint32_t            appwprdim = APPPROP_MAX;
 
 static void connection_state(int, void *);
 
+static uint32_t          winhash_index(uint32_t, uint32_t);
+static int               resize_winhash(uint32_t);
+static void              destroy_winhash(void);
 static int               add_to_winhash(tracker_window_t *);
 static tracker_window_t *delete_from_winhash(uint32_t);
 static tracker_window_t *find_in_winhash(uint32_t);
 
+static void              add_to_applist(tracker_appwin_t *);
+static void              delete_from_applist(tracker_appwin_t *);
+
 static tracker_newwin_t *create_newwin(uint32_t);
 static void              destroy_newwin(tracker_newwin_t *);
 static tracker_newwin_t *find_newwin(uint32_t);
@@ -179,6 +200,8 @@ void tracker_exit(OhmPlugin *plugin)
     (void)plugin;
 
     xif_remove_connection_callback(connection_state, NULL);
+
+    destroy_winhash();
 }
 
 int tracker_add_atom(const char *id, const char *name)
@@ -515,6 +538,30 @@ int tracker_window_exists(tracker_wintype_t type, uint32_t xid)
     return FALSE;
 }
 
+int tracker_appwin_foreach(tracker_appwin_cb_t cb, void *data)
+{
+    tracker_appwin_t *appw;
+    tracker_appwin_t *next;
+    int               cnt = 0;
+
+    if (cb != NULL) {
+        for (appw = applist.first;  appw;  appw = next) {
+            next = appw->appnext;
+            cnt++;
+
+            if (!cb(appw->xid, data))
+                break;
+        }
+    }
+
+    return cnt;
+}
+
+uint32_t tracker_appwin_count(void)
+{
+    return applist.count;
+}
+
 
 /*!
  * @}
@@ -536,6 +583,90 @@ static void connection_state(int connection_is_up, void *data)
     }
 }
 
+static uint32_t winhash_index(uint32_t xid, uint32_t bits)
+{
+    /*
+     * X resource ids of a client share their high bits and the low bits
+     * are handed out sequentially, so mix all the bits before masking
+     * (this is the 32-bit finalizer of murmur3)
+     */
+    xid ^= xid >> 16;
+    xid *= 0x85ebca6bU;
+    xid ^= xid >> 13;
+    xid *= 0xc2b2ae35U;
+    xid ^= xid >> 16;
+
+    return xid & ((1U << bits) - 1);
+}
+
+static int resize_winhash(uint32_t bits)
+{
+    tracker_window_t **buckets;
+    tracker_window_t  *win;
+    tracker_window_t  *next;
+    uint32_t           dim;
+    uint32_t           idx;
+    uint32_t           i;
+
+    if (bits < WINDOW_HASH_MIN_BITS || bits > WINDOW_HASH_MAX_BITS)
+        return -1;
+
+    dim = 1U << bits;
+
+    if ((buckets = calloc(dim, sizeof(tracker_window_t *))) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for window hash");
+        return -1;
+    }
+
+    if (winhash.buckets != NULL) {
+        for (i = 0;  i < (1U << winhash.bits);  i++) {
+            for (win = winhash.buckets[i];  win;  win = next) {
+                next = win->next;
+                idx  = winhash_index(win->any.xid, bits);
+
+                win->next    = buckets[idx];
+                buckets[idx] = win;
+            }
+        }
+
+        OHM_DEBUG(DBG_TRACK, "window hash resized %u => %u buckets "
+                  "(%u windows)", 1U << winhash.bits, dim, winhash.nwin);
+
+        free(winhash.buckets);
+    }
+
+    winhash.buckets = buckets;
+    winhash.bits    = bits;
+
+    return 0;
+}
+
+static void destroy_winhash(void)
+{
+    tracker_window_t *win;
+    tracker_window_t *next;
+    uint32_t          i;
+
+    if (winhash.buckets != NULL) {
+        for (i = 0;  i < (1U << winhash.bits);  i++) {
+            for (win = winhash.buckets[i];  win;  win = next) {
+                next = win->next;
+
+                switch (win->any.type) {
+                case tracker_newwin: destroy_newwin(&win->new);        break;
+                case tracker_appwin: destroy_appwin(&win->app);        break;
+                default:             free(win);                        break;
+                }
+            }
+        }
+
+        free(winhash.buckets);
+    }
+
+    memset(&winhash, 0, sizeof(winhash));
+    memset(&applist, 0, sizeof(applist));
+}
+
 static int add_to_winhash(tracker_window_t *win)
 {
     uint32_t xid;
@@ -544,12 +675,22 @@ static int add_to_winhash(tracker_window_t *win)
 
     if (win == NULL || (xid = win->any.xid) == WINDOW_INVALID_ID)
         sts = -1;
+    else if (!winhash.buckets && resize_winhash(WINDOW_HASH_MIN_BITS) < 0)
+        sts = -1;
     else {
         sts = 0;
-        idx = WINDOW_HASH_INDEX(xid);
 
-        win->next = winhash[idx];
-        winhash[idx] = win;
+        if (winhash.nwin >= (WINDOW_HASH_LOAD << winhash.bits))
+            resize_winhash(winhash.bits + 1); /* on failure keep going */
+
+        idx = winhash_index(xid, winhash.bits);
+
+        win->next = winhash.buckets[idx];
+        winhash.buckets[idx] = win;
+        winhash.nwin++;
+
+        if (win->any.type == tracker_appwin)
+            add_to_applist(&win->app);
     }
 
     return sts;
@@ -561,16 +702,21 @@ static tracker_window_t *delete_from_winhash(uint32_t xid)
     tracker_window_t *win;
     tracker_window_t *prev;
 
-    if (xid != WINDOW_INVALID_ID) {
-        idx = WINDOW_HASH_INDEX(xid);
+    if (xid != WINDOW_INVALID_ID && winhash.buckets != NULL) {
+        idx = winhash_index(xid, winhash.bits);
 
-        for (prev = (tracker_window_t *)&winhash[idx];
+        for (prev = (tracker_window_t *)&winhash.buckets[idx];
              (win = prev->next) != NULL;
              prev = prev->next)
         {
             if (xid == win->any.xid) {
                 prev->next = win->next;
                 win->next  = NULL;
+                winhash.nwin--;
+
+                if (win->any.type == tracker_appwin)
+                    delete_from_applist(&win->app);
+
                 return win;
             }
         }
@@ -584,10 +730,10 @@ static tracker_window_t *find_in_winhash(uint32_t xid)
     uint32_t          idx;
     tracker_window_t *win;
 
-    if (xid != WINDOW_INVALID_ID) {
-        idx = WINDOW_HASH_INDEX(xid);
+    if (xid != WINDOW_INVALID_ID && winhash.buckets != NULL) {
+        idx = winhash_index(xid, winhash.bits);
 
-        for (win = winhash[idx];  win;  win = win->next) {
+        for (win = winhash.buckets[idx];  win;  win = win->next) {
             if (xid == win->any.xid)
                 return win;
         }
@@ -596,6 +742,36 @@ static tracker_window_t *find_in_winhash(uint32_t xid)
     return NULL;
 } 
 
+static void add_to_applist(tracker_appwin_t *appw)
+{
+    appw->appnext = NULL;
+    appw->appprev = applist.last;
+
+    if (applist.last != NULL)
+        applist.last->appnext = appw;
+    else
+        applist.first = appw;
+
+    applist.last = appw;
+    applist.count++;
+}
+
+static void delete_from_applist(tracker_appwin_t *appw)
+{
+    if (appw->appprev != NULL)
+        appw->appprev->appnext = appw->appnext;
+    else
+        applist.first = appw->appnext;
+
+    if (appw->appnext != NULL)
+        appw->appnext->appprev = appw->appprev;
+    else
+        applist.last = appw->appprev;
+
+    appw->appnext = appw->appprev = NULL;
+    applist.count--;
+}
+
 static tracker_newwin_t *create_newwin(uint32_t xid)
 {
     tracker_window_t   *win;
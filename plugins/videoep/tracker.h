@@ -34,6 +34,9 @@ typedef enum {
     tracker_dialog,    
 } tracker_wintype_t;
 
+/* return FALSE to stop the iteration */
+typedef int (*tracker_appwin_cb_t)(uint32_t, void *);
+
 
 void tracker_init(OhmPlugin *);
 void tracker_exit(OhmPlugin *);
@@ -63,6 +66,9 @@ void tracker_window_set_current(uint32_t);
 
 int  tracker_window_exists(tracker_wintype_t, uint32_t);
 
+int      tracker_appwin_foreach(tracker_appwin_cb_t, void *);
+uint32_t tracker_appwin_count(void);
+
 #endif /* __OHM_VIDEOEP_TRACKER_H__ */
 
 /* 
@@ -43,38 +43,52 @@ USA.
 
 #define SCREEN_MAX 4
 
+#define SNAPSHOT_RETRY_MAX 2
+
 #define QUEUE_BITS               5
 #define QUEUE_DIM                (1 << QUEUE_BITS)
-#define QUEUE_MASK               (QUEUE_DIM - 1)
-#define QUEUE_INDEX(i)           ((i) & QUEUE_MASK)
-
-#define ATOM_QUERY_DIM           QUEUE_DIM
-#define ATOM_QUERY_INDEX(i)      QUEUE_INDEX(i)
-
-#define PROPERTY_QUERY_DIM       QUEUE_DIM
-#define PROPERTY_QUERY_INDEX(i)  QUEUE_INDEX(i)
-
-#define MODE_CREATE_DIM          QUEUE_DIM
-#define MODE_CREATE_INDEX(i)     QUEUE_INDEX(i)
-
-#define RANDR_QUERY_DIM          QUEUE_DIM
-#define RANDR_QUERY_INDEX(i)     QUEUE_INDEX(i)
 
 struct xif_s;
 
 typedef void (*reply_handler_t)(struct xif_s *, void *, void *);
+typedef void (*release_t)(void *);
 
 typedef struct {
     unsigned int        sequence;
     reply_handler_t     handler;
+    release_t           release;   /* frees data if the reply never comes */
     void               *data;
 } request_t;
 
 typedef struct {
-    int                 length;
-    request_t           requests[QUEUE_DIM];
+    int                 head;      /* index of the oldest pending request */
+    int                 length;    /* number of pending requests */
+    int                 size;      /* number of slots; always a power of 2 */
+    int                 maxlen;    /* max. number of pending requests seen */
+    request_t          *requests;  /* ring of requests in sequence order */
 } rque_t;
 
+struct snapshot_s;
+
+typedef struct {
+    struct snapshot_s  *snap;
+    int                 idx;       /* index within the crtcs/outputs/props */
+} snapshot_slot_t;
+
+typedef struct snapshot_s {
+    struct snapshot_s      *next;
+    xif_snapshot_t          st;        /* what is handed to the caller */
+    int                     nreq;      /* number of props per output */
+    xif_outprop_req_t      *reqs;      /* requested output properties */
+    snapshot_slot_t        *slots;     /* reply handler data */
+    int                     pending;   /* number of outstanding replies */
+    int                     failed;    /* number of failed requests */
+    int                     resources; /* got the screen resources */
+    int                     retries;   /* times the snapshot was retried */
+    xif_snapshot_replycb_t  replycb;
+    void                   *usrdata;
+} snapshot_t;
+
 typedef struct conncb_s {
     struct conncb_s    *next;
     xif_connectioncb_t  callback;
@@ -121,6 +135,7 @@ typedef struct xif_s {
         uint16_t height;
     }                   screen[SCREEN_MAX];
     rque_t              rque;      /* que for the pending requests */
+    snapshot_t         *snapshots; /* RandR snapshots in progress */
     conncb_t           *conncb;    /* connection callbacks */
     structcb_t         *destcb;    /* window destroy callbacks */
     propcb_t           *propcb;    /* property change callbacks */
@@ -129,14 +144,12 @@ typedef struct xif_s {
 } xif_t;
 
 typedef struct {
-    int                busy;
     const char        *name;
     xif_atom_replycb_t replycb;
     void              *usrdata;
 } atom_query_t;
 
 typedef struct {
-    int                   busy;
     uint32_t              window;
     uint32_t              property;
     videoep_value_type_t  type;
@@ -146,33 +159,23 @@ typedef struct {
 
 
 typedef struct {
-    int          busy;
     const char  *name;
 } mode_create_t;
 
 typedef enum {
     query_unknown = 0,
-    query_screen,
     query_crtc,
     query_output,
     query_outprop,
 } randr_query_type_t;
 
 #define RANDR_QUERY_COMMON      \
-    int                   busy; \
     randr_query_type_t    type
 
 typedef struct {
     RANDR_QUERY_COMMON;
 } randr_query_any_t;
 
-typedef struct {
-    RANDR_QUERY_COMMON;
-    uint32_t              window;
-    xif_screen_replycb_t  replycb;
-    void                 *usrdata;
-} randr_query_screen_t;
-
 typedef struct {
     RANDR_QUERY_COMMON;
     uint32_t              window;
@@ -200,7 +203,6 @@ typedef struct {
 
 typedef union {
     randr_query_any_t     any;
-    randr_query_screen_t  screen;
     randr_query_crtc_t    crtc;
     randr_query_output_t  output;
     randr_query_outprop_t outprop;
@@ -222,14 +224,6 @@ typedef struct {
 static uint32_t       polltime = 1000; /* 1 sec */
 static xif_t         *xiface;
 static extension_t    randr;
-static atom_query_t   atom_qry[ATOM_QUERY_DIM];
-static uint32_t       atom_idx;
-static prop_query_t   prop_qry[PROPERTY_QUERY_DIM];
-static uint32_t       prop_idx;
-static mode_create_t  mode_creat[MODE_CREATE_DIM];
-static uint32_t       mode_idx;
-static randr_query_t  randr_qry[RANDR_QUERY_DIM];
-static uint32_t       randr_idx;
 static int            conn_warn = TRUE;
 
 
@@ -243,6 +237,7 @@ static int  event_select(xif_t *, uint32_t, uint32_t *, event_t, int);
 
 static int  atom_query(xif_t *, const char *, xif_atom_replycb_t, void *);
 static void atom_query_finish(xif_t *, void *, void *);
+static void atom_query_free(void *);
 
 static int  property_query(xif_t *, uint32_t, uint32_t, videoep_value_type_t,
                            uint32_t, xif_prop_replycb_t, void *);
@@ -253,9 +248,7 @@ static int  randr_set_screen_size(xif_t *, xcb_window_t, uint16_t,uint16_t,
                                   uint32_t,uint32_t);
 static int  randr_create_mode(xif_t *, xcb_window_t, xif_mode_t *);
 static void randr_create_mode_finish(xif_t *, void *, void *);
-static int  randr_query_screen(xif_t *, xcb_window_t,
-                               xif_screen_replycb_t, void *);
-static void randr_query_screen_finish(xif_t *, void *, void *);
+static void randr_create_mode_free(void *);
 static int  randr_query_crtc(xif_t *, uint32_t, uint32_t, uint32_t,
                              xif_crtc_replycb_t, void *);
 static void randr_query_crtc_finish(xif_t *, void *, void *);
@@ -267,13 +260,24 @@ static int  randr_query_output_property(xif_t *, uint32_t,uint32_t,uint32_t,
                                         videoep_value_type_t, uint32_t,
                                         xif_outprop_replycb_t, void *);
 static void randr_query_output_property_finish(xif_t *, void  *, void  *);
+static int  randr_snapshot(xif_t *, xcb_window_t, int, xif_outprop_req_t *,
+                           xif_snapshot_replycb_t, void *, int);
+static void randr_snapshot_screen_finish(xif_t *, void *, void *);
+static void randr_snapshot_crtc_finish(xif_t *, void *, void *);
+static void randr_snapshot_output_finish(xif_t *, void *, void *);
+static void randr_snapshot_outprop_finish(xif_t *, void *, void *);
+static void randr_snapshot_check_if_complete(xif_t *, snapshot_t *);
+static void randr_snapshot_destroy(xif_t *, snapshot_t *);
+static uint32_t *copy_xids(int, uint32_t *);
 static int  randr_event_handler(xif_t *, xcb_generic_event_t *);
 static xif_connstate_t randr_connection_to_state(uint8_t);
 
 static int  check_version(uint32_t, uint32_t, uint32_t, uint32_t);
 
-static int  rque_is_full(rque_t *);
-static int  rque_append_request(rque_t *, unsigned int, reply_handler_t,void*);
+static int  rque_reserve(rque_t *);
+static void rque_reset(rque_t *);
+static int  rque_append_request(rque_t *, unsigned int, reply_handler_t,
+                                release_t, void *);
 static int  rque_poll_reply(xcb_connection_t *, rque_t *,
                             void **, reply_handler_t *, void **);
 
@@ -819,14 +823,19 @@ int xif_screen_set_size(uint32_t rootwin, uint32_t width, uint32_t height,
     return status;
 }
 
-int xif_screen_query(uint32_t win, xif_screen_replycb_t replycb, void *usrdata)
+int xif_screen_snapshot(uint32_t                win,
+                        int                     nreq,
+                        xif_outprop_req_t      *reqs,
+                        xif_snapshot_replycb_t  replycb,
+                        void                   *usrdata)
 {
     int status;
 
-    if (!win || !replycb || !xiface || !randr.present)
+    if (!win || nreq < 0 || (nreq && !reqs) || !replycb ||
+        !xiface || !randr.present)
         status = -1;
     else
-        status = randr_query_screen(xiface, win, replycb,usrdata);
+        status = randr_snapshot(xiface, win, nreq,reqs, replycb,usrdata, 0);
 
     return status;
 }
@@ -1052,6 +1061,10 @@ static void xif_destroy(xif_t *xif)
             free(ccb);
         }
 
+        OHM_DEBUG(DBG_XCB, "max. xif request queue depth was %d",
+                  xif->rque.maxlen);
+
+        free(xif->rque.requests);
         free(xif->display);
 
         free(xif);
@@ -1190,7 +1203,11 @@ static void disconnect_from_xserver(xif_t *xif)
         if (xif->xconn != NULL)
             xcb_disconnect(xif->xconn);
 
-        memset(&xif->rque, 0, sizeof(xif->rque));
+        rque_reset(&xif->rque);
+
+        while (xif->snapshots != NULL)
+            randr_snapshot_destroy(xif, xif->snapshots);
+
         memset( xif->root, 0, sizeof(xif->root));
 
         xif->propcb  = NULL;
@@ -1267,19 +1284,21 @@ static int atom_query(xif_t              *xif,
                       xif_atom_replycb_t  replycb,
                       void               *usrdata)
 {
-    atom_query_t             *aq = atom_qry + atom_idx;
+    atom_query_t             *aq;
     xcb_intern_atom_cookie_t  ckie;
 
     if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
         return -1;
 
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
         return -1;
     }
 
-    if (aq->busy) {
-        OHM_ERROR("videoep: maximum number of pending atom queries reached");
+    if ((aq = calloc(1, sizeof(atom_query_t))) == NULL ||
+        (aq->name = strdup(name)) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for atom query");
+        free(aq);
         return -1;
     }
 
@@ -1287,19 +1306,17 @@ static int atom_query(xif_t              *xif,
 
     if (xcb_connection_has_error(xif->xconn)) {
         OHM_ERROR("videoep: failed to query attribute def '%s'", name);
+        atom_query_free(aq);
         return -1;
     }
 
     OHM_DEBUG(DBG_XCB, "querying atom '%s'", name);
 
-    aq->busy    = TRUE;
-    aq->name    = strdup(name);
     aq->replycb = replycb;
     aq->usrdata = usrdata;
 
-    atom_idx = ATOM_QUERY_INDEX(atom_idx + 1);
-
-    rque_append_request(&xif->rque, ckie.sequence, atom_query_finish, aq);
+    rque_append_request(&xif->rque, ckie.sequence,
+                        atom_query_finish, atom_query_free, aq);
 
     xcb_flush(xif->xconn);
 
@@ -1319,11 +1336,17 @@ static void atom_query_finish(xif_t *xif, void *reply_data, void *data)
         OHM_DEBUG(DBG_XCB, "atom '%s' queried: %u", aq->name, reply->atom);
 
         aq->replycb(aq->name, reply->atom, aq->usrdata);
-
-        free((void *)aq->name);
     }
 
-    memset(aq, 0, sizeof(atom_query_t));
+    atom_query_free(aq);
+}
+
+static void atom_query_free(void *data)
+{
+    atom_query_t *aq = data;
+
+    free((void *)aq->name);
+    free(aq);
 }
 
 
@@ -1335,20 +1358,19 @@ static int property_query(xif_t                *xif,
                           xif_prop_replycb_t    replycb,
                           void                 *usrdata)
 {
-    prop_query_t              *pq = prop_qry + prop_idx;
+    prop_query_t              *pq;
     xcb_get_property_cookie_t  ckie;
 
     if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
         return -1;
 
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
         return -1;
     }
 
-    if (pq->busy) {
-        OHM_ERROR("videoep: maximum number of pending property "
-                  "queries reached");
+    if ((pq = calloc(1, sizeof(prop_query_t))) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for property query");
         return -1;
     }
 
@@ -1356,21 +1378,20 @@ static int property_query(xif_t                *xif,
 
     if (xcb_connection_has_error(xif->xconn)) {
         OHM_ERROR("videoep: failed to query property");
+        free(pq);
         return -1;
     }
 
     OHM_DEBUG(DBG_XCB, "querying property");
 
-    pq->busy     = TRUE;
     pq->window   = window;
     pq->property = property;
     pq->type     = type;
     pq->replycb  = replycb;
     pq->usrdata  = usrdata;
 
-    prop_idx = PROPERTY_QUERY_INDEX(prop_idx + 1);
-
-    rque_append_request(&xif->rque, ckie.sequence, property_query_finish, pq);
+    rque_append_request(&xif->rque, ckie.sequence,
+                        property_query_finish, free, pq);
 
     xcb_flush(xif->xconn);
 
@@ -1410,7 +1431,7 @@ static void property_query_finish(xif_t *xif, void *reply_data, void *data)
 
     }
 
-    memset(pq, 0, sizeof(prop_query_t));
+    free(pq);
 }
 
 
@@ -1527,7 +1548,7 @@ static int randr_set_screen_size(xif_t        *xif,
 
 static int randr_create_mode(xif_t *xif, xcb_window_t rwin, xif_mode_t *mode)
 {
-    mode_create_t                  *mc = mode_creat + mode_idx;
+    mode_create_t                  *mc;
     xcb_randr_create_mode_cookie_t  ckie;
     xcb_randr_mode_info_t           info;
     size_t                          namlen;
@@ -1535,13 +1556,15 @@ static int randr_create_mode(xif_t *xif, xcb_window_t rwin, xif_mode_t *mode)
     if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
         return -1;
 
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
         return -1;
     }
 
-    if (mc->busy) {
-        OHM_ERROR("videoep: maximum number of pending mode cretation reached");
+    if ((mc = calloc(1, sizeof(mode_create_t))) == NULL ||
+        (mc->name = strdup(mode->name)) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for mode creation");
+        free(mc);
         return -1;
     }
 
@@ -1565,16 +1588,12 @@ static int randr_create_mode(xif_t *xif, xcb_window_t rwin, xif_mode_t *mode)
 
     if (xcb_connection_has_error(xif->xconn)) {
         OHM_ERROR("videoep: failed to create new mode '%s'", mode->name);
+        randr_create_mode_free(mc);
         return -1;
     }
 
-    mc->busy = TRUE;
-    mc->name = strdup(mode->name);
-
-    mode_idx = MODE_CREATE_INDEX(mode_idx + 1);
-
     rque_append_request(&xif->rque, ckie.sequence,
-                        randr_create_mode_finish, mc);
+                        randr_create_mode_finish, randr_create_mode_free, mc);
 
     xcb_flush(xif->xconn);
 
@@ -1596,155 +1615,17 @@ static void randr_create_mode_finish(xif_t *xif, void *reply_data, void *data)
     else {
         OHM_INFO("videoep: '%s' mode (0x%x) successfuly created",
                  mc->name, reply->mode);
-
-        free((void *)mc->name);
-        mc->name = NULL;
     }
 
-    memset(mc, 0, sizeof(mode_create_t));
+    randr_create_mode_free(mc);
 }
 
-static int randr_query_screen(xif_t                *xif,
-                              xcb_window_t          window,
-                              xif_screen_replycb_t  replycb,
-                              void                 *usrdata)
+static void randr_create_mode_free(void *data)
 {
-    randr_query_t                           *rq = randr_qry + randr_idx;
-    xcb_randr_get_screen_resources_cookie_t  ckie;
-
-    (void)xif;
-
-    if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
-        return -1;
-
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
-        return -1;
-    }
-
-    if (rq->any.busy) {
-        OHM_ERROR("videoep: maximum number of pending RandR queries reached");
-        return -1;
-    }
-
-    ckie = xcb_randr_get_screen_resources(xif->xconn, window);
+    mode_create_t *mc = data;
 
-    if (xcb_connection_has_error(xif->xconn)) {
-        OHM_ERROR("videoep: failed to query RandR screen resources");
-        return -1;
-    }
-
-    OHM_DEBUG(DBG_XCB, "querying RandR screen resources");
-
-    rq->screen.busy    = TRUE;
-    rq->screen.type    = query_screen;
-    rq->screen.window  = window;
-    rq->screen.replycb = replycb;
-    rq->screen.usrdata = usrdata;
-
-    randr_idx = RANDR_QUERY_INDEX(randr_idx + 1);
-
-    rque_append_request(&xif->rque, ckie.sequence,
-                        randr_query_screen_finish, rq);
-    xcb_flush(xif->xconn);
-
-    return 0;
-}
-
-static void randr_query_screen_finish(xif_t *xif, void *reply_data, void *data)
-{
-#define NAME_LENGTH 64
-#define MAX_MODES   16
-
-    xcb_randr_get_screen_resources_reply_t *reply = reply_data;
-    randr_query_t                          *rq    = data;
-    randr_query_screen_t                   *sq    = &rq->screen;
-    xif_screen_t                            st;
-    xcb_randr_mode_info_t                  *minfs;
-    xcb_randr_mode_info_t                  *minf;
-    char                                    names[NAME_LENGTH];
-    xif_mode_t                              modes[MAX_MODES];
-    xif_mode_t                             *mode;
-    int                                     nmode;
-    char                                   *name;
-    uint8_t                                *nbuf;
-    int                                     namlen;
-    double                                  hdpm;
-    double                                  vdpm;
-    int                                     i;
-    uint32_t                                j;
-
-    (void)xif;
-
-    if (!reply)
-        OHM_ERROR("videoep: could not get RandR screen resources");
-    else if (sq->type != query_screen)
-        OHM_ERROR("videoep: %s() confused with type", __FUNCTION__);
-    else {
-        nmode = xcb_randr_get_screen_resources_modes_length(reply);
-        minfs = xcb_randr_get_screen_resources_modes(reply);
-        nbuf  = xcb_randr_get_screen_resources_names(reply);
-
-        if (nmode > MAX_MODES)
-            nmode = MAX_MODES;
-
-        for (i = 0, name = names;   i < nmode;   i++, nbuf += minf->name_len) {
-            minf = minfs + i;
-            mode = modes + i;
-
-            namlen = minf->name_len;
-
-            if (namlen <= 0 || name + namlen >= names + NAME_LENGTH)
-                mode->name = NULL;
-            else {
-                mode->name = name;
-
-                strncpy(name, (char *)nbuf, namlen);
-                name[namlen] = '\0';
-                
-                name += namlen + 1;
-            }
-
-            mode->xid    = minf->id;
-            mode->width  = minf->width; 
-            mode->height = minf->height;
-            mode->clock  = minf->dot_clock;
-            mode->hstart = minf->hsync_start;
-            mode->hend   = minf->hsync_end;
-            mode->htotal = minf->htotal;
-            mode->vstart = minf->vsync_start;
-            mode->vend   = minf->vsync_end;
-            mode->vtotal = minf->vtotal;
-            mode->hskew  = minf->hskew;
-            mode->flags  = minf->mode_flags;
-        }
-
-        for (j = 0, hdpm = vdpm = 0;    j < xif->nscreen;    j++) {
-            if (sq->window == xif->root[j]) {
-                hdpm = xif->screen[j].hdpm;
-                vdpm = xif->screen[j].vdpm;
-            }
-        }
-
-        memset(&st, 0, sizeof(st));
-        st.window  = sq->window;
-        st.tstamp  = reply->config_timestamp;
-        st.ncrtc   = xcb_randr_get_screen_resources_crtcs_length(reply);
-        st.crtcs   = xcb_randr_get_screen_resources_crtcs(reply);
-        st.noutput = xcb_randr_get_screen_resources_outputs_length(reply);
-        st.outputs = xcb_randr_get_screen_resources_outputs(reply);
-        st.nmode   = nmode;
-        st.modes   = modes;
-        st.hdpm    = hdpm;
-        st.vdpm    = vdpm;
-
-        sq->replycb(&st, sq->usrdata);
-    }
-
-    memset(rq, 0, sizeof(randr_query_t));
-
-#undef MAX_MODES
-#undef NAME_LENGTH
+    free((void *)mc->name);
+    free(mc);
 }
 
 static int randr_query_crtc(xif_t              *xif,
@@ -1754,19 +1635,19 @@ static int randr_query_crtc(xif_t              *xif,
                             xif_crtc_replycb_t  replycb,
                             void               *usrdata)
 {
-    randr_query_t                    *rq = randr_qry + randr_idx;
+    randr_query_t                    *rq;
     xcb_randr_get_crtc_info_cookie_t  ckie;
 
     if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
         return -1;
 
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
         return -1;
     }
 
-    if (rq->any.busy) {
-        OHM_ERROR("videoep: maximum number of pending RandR queries reached");
+    if ((rq = calloc(1, sizeof(randr_query_t))) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for RandR query");
         return -1;
     }
 
@@ -1774,22 +1655,20 @@ static int randr_query_crtc(xif_t              *xif,
 
     if (xcb_connection_has_error(xif->xconn)) {
         OHM_ERROR("videoep: failed to query RandR crtc");
+        free(rq);
         return -1;
     }
 
     OHM_DEBUG(DBG_XCB, "querying RandR crtc 0x%x", crtc);
 
-    rq->crtc.busy    = TRUE;
     rq->crtc.type    = query_crtc;
     rq->crtc.window  = window;
     rq->crtc.xid     = crtc;
     rq->crtc.replycb = replycb;
     rq->crtc.usrdata = usrdata;
 
-    randr_idx = RANDR_QUERY_INDEX(randr_idx + 1);
-
     rque_append_request(&xif->rque, ckie.sequence,
-                        randr_query_crtc_finish, rq);
+                        randr_query_crtc_finish, free, rq);
     xcb_flush(xif->xconn);
 
     return 0;
@@ -1826,7 +1705,7 @@ static void randr_query_crtc_finish(xif_t *xif, void *reply_data, void *data)
         cq->replycb(&ct, cq->usrdata);
     }
 
-    memset(rq, 0, sizeof(randr_query_t));
+    free(rq);
 }
 
 static int randr_config_crtc(xif_t      *xif,
@@ -1869,19 +1748,19 @@ static int randr_query_output(xif_t                *xif,
                               xif_output_replycb_t  replycb,
                               void                 *usrdata)
 {
-    randr_query_t                      *rq = randr_qry + randr_idx;
+    randr_query_t                      *rq;
     xcb_randr_get_output_info_cookie_t  ckie;
 
     if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
         return -1;
 
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
         return -1;
     }
 
-    if (rq->any.busy) {
-        OHM_ERROR("videoep: maximum number of pending RandR queries reached");
+    if ((rq = calloc(1, sizeof(randr_query_t))) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for RandR query");
         return -1;
     }
 
@@ -1889,22 +1768,20 @@ static int randr_query_output(xif_t                *xif,
 
     if (xcb_connection_has_error(xif->xconn)) {
         OHM_ERROR("videoep: failed to query RandR output");
+        free(rq);
         return -1;
     }
 
     OHM_DEBUG(DBG_XCB, "querying RandR output 0x%x", output);
 
-    rq->output.busy    = TRUE;
     rq->output.type    = query_output;
     rq->output.window  = window;
     rq->output.xid     = output;
     rq->output.replycb = replycb;
     rq->output.usrdata = usrdata;
 
-    randr_idx = RANDR_QUERY_INDEX(randr_idx + 1);
-
     rque_append_request(&xif->rque, ckie.sequence,
-                        randr_query_output_finish, rq);
+                        randr_query_output_finish, free, rq);
     xcb_flush(xif->xconn);
 
     return 0;
@@ -1952,7 +1829,7 @@ static void randr_query_output_finish(xif_t *xif, void *reply_data, void *data)
         oq->replycb(&ot, oq->usrdata);
     }
 
-    memset(rq, 0, sizeof(randr_query_t));
+    free(rq);
 
 #undef NAME_MAX_LENGTH
 }
@@ -1966,19 +1843,19 @@ static int randr_query_output_property(xif_t                  *xif,
                                        xif_outprop_replycb_t   replycb,
                                        void                   *usrdata)
 {
-    randr_query_t                          *rq = randr_qry + randr_idx;
+    randr_query_t                          *rq;
     xcb_randr_get_output_property_cookie_t  ckie;
 
     if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
         return -1;
 
-    if (rque_is_full(&xif->rque)) {
-        OHM_ERROR("videoep: xif request queue is full");
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
         return -1;
     }
 
-    if (rq->any.busy) {
-        OHM_ERROR("videoep: maximum number of pending RandR queries reached");
+    if ((rq = calloc(1, sizeof(randr_query_t))) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for RandR query");
         return -1;
     }
 
@@ -1987,13 +1864,13 @@ static int randr_query_output_property(xif_t                  *xif,
 
     if (xcb_connection_has_error(xif->xconn)) {
         OHM_ERROR("videoep: failed to query RandR output property");
+        free(rq);
         return -1;
     }
 
     OHM_DEBUG(DBG_XCB, "querying RandR output property 0x%x/0x%x",
               output, property);
 
-    rq->outprop.busy    = TRUE;
     rq->outprop.type    = query_outprop;
     rq->outprop.window  = window;
     rq->outprop.output  = output;
@@ -2001,10 +1878,8 @@ static int randr_query_output_property(xif_t                  *xif,
     rq->outprop.replycb = replycb;
     rq->outprop.usrdata = usrdata;
 
-    randr_idx = RANDR_QUERY_INDEX(randr_idx + 1);
-
     rque_append_request(&xif->rque, ckie.sequence,
-                        randr_query_output_property_finish, rq);
+                        randr_query_output_property_finish, free, rq);
     xcb_flush(xif->xconn);
 
     return 0;
@@ -2041,7 +1916,465 @@ static void randr_query_output_property_finish(xif_t *xif,
                     value, length, pq->usrdata);
     }
 
-    memset(rq, 0, sizeof(randr_query_t));
+    free(rq);
+}
+
+
+/*
+ * A snapshot collects the whole RandR topology of a screen. Once the
+ * screen resources arrive all crtc, output and output property requests
+ * are sent at once so that they travel pipelined on the X connection,
+ * and the result is handed over when the last reply has arrived. Failed
+ * crtc, output and property replies are marked in the snapshot; if the
+ * screen resources can't be obtained the whole snapshot is retried.
+ */
+static int randr_snapshot(xif_t                  *xif,
+                          xcb_window_t            window,
+                          int                     nreq,
+                          xif_outprop_req_t      *reqs,
+                          xif_snapshot_replycb_t  replycb,
+                          void                   *usrdata,
+                          int                     retries)
+{
+    xcb_randr_get_screen_resources_cookie_t  ckie;
+    snapshot_t                              *snap;
+    size_t                                   size;
+
+    if (xif->xconn == NULL || xcb_connection_has_error(xif->xconn))
+        return -1;
+
+    if (rque_reserve(&xif->rque) < 0) {
+        OHM_ERROR("videoep: can't grow xif request queue");
+        return -1;
+    }
+
+    if ((snap = malloc(sizeof(snapshot_t))) == NULL) {
+        OHM_ERROR("videoep: can't allocate memory for RandR snapshot");
+        return -1;
+    }
+
+    memset(snap, 0, sizeof(snapshot_t));
+    snap->st.screen.window = window;
+    snap->nreq    = nreq;
+    snap->replycb = replycb;
+    snap->usrdata = usrdata;
+    snap->retries = retries;
+
+    if (nreq > 0) {
+        size = sizeof(xif_outprop_req_t) * nreq;
+
+        if ((snap->reqs = malloc(size)) == NULL) {
+            OHM_ERROR("videoep: can't allocate memory for RandR snapshot");
+            free(snap);
+            return -1;
+        }
+
+        memcpy(snap->reqs, reqs, size);
+    }
+
+    ckie = xcb_randr_get_screen_resources(xif->xconn, window);
+
+    if (xcb_connection_has_error(xif->xconn)) {
+        OHM_ERROR("videoep: failed to query RandR screen resources");
+        free(snap->reqs);
+        free(snap);
+        return -1;
+    }
+
+    OHM_DEBUG(DBG_XCB, "taking RandR snapshot of root window 0x%x", window);
+
+    snap->next     = xif->snapshots;
+    xif->snapshots = snap;
+    snap->pending  = 1;
+
+    rque_append_request(&xif->rque, ckie.sequence,
+                        randr_snapshot_screen_finish, NULL, snap);
+    xcb_flush(xif->xconn);
+
+    return 0;
+}
+
+static void randr_snapshot_screen_finish(xif_t *xif,
+                                         void  *reply_data,
+                                         void  *data)
+{
+    xcb_randr_get_screen_resources_reply_t *reply = reply_data;
+    snapshot_t                             *snap  = data;
+    xif_snapshot_t                         *st    = &snap->st;
+    xcb_randr_mode_info_t                  *minfs;
+    xcb_randr_mode_info_t                  *minf;
+    xif_mode_t                             *mode;
+    uint8_t                                *nbuf;
+    uint32_t                               *xids;
+    snapshot_slot_t                        *slot;
+    xif_outprop_req_t                      *req;
+    xif_outprop_t                          *prop;
+    int                                     nslot;
+    int                                     i, j;
+    uint32_t                                k;
+
+    snap->pending--;
+
+    if (!reply) {
+        OHM_ERROR("videoep: could not get RandR screen resources");
+        snap->failed++;
+        randr_snapshot_check_if_complete(xif, snap);
+        return;
+    }
+
+    st->screen.tstamp = reply->config_timestamp;
+
+    for (k = 0;    k < xif->nscreen;    k++) {
+        if (st->screen.window == xif->root[k]) {
+            st->screen.hdpm = xif->screen[k].hdpm;
+            st->screen.vdpm = xif->screen[k].vdpm;
+        }
+    }
+
+    st->screen.nmode = xcb_randr_get_screen_resources_modes_length(reply);
+    minfs = xcb_randr_get_screen_resources_modes(reply);
+    nbuf  = xcb_randr_get_screen_resources_names(reply);
+
+    if (st->screen.nmode > 0 &&
+        !(st->screen.modes = calloc(st->screen.nmode, sizeof(xif_mode_t))))
+        goto no_memory;
+
+    for (i = 0;   i < st->screen.nmode;   i++, nbuf += minf->name_len) {
+        minf = minfs + i;
+        mode = st->screen.modes + i;
+
+        if (minf->name_len > 0 &&
+            (mode->name = malloc(minf->name_len + 1)) != NULL)
+        {
+            memcpy(mode->name, nbuf, minf->name_len);
+            mode->name[minf->name_len] = '\0';
+        }
+
+        mode->xid    = minf->id;
+        mode->width  = minf->width; 
+        mode->height = minf->height;
+        mode->clock  = minf->dot_clock;
+        mode->hstart = minf->hsync_start;
+        mode->hend   = minf->hsync_end;
+        mode->htotal = minf->htotal;
+        mode->vstart = minf->vsync_start;
+        mode->vend   = minf->vsync_end;
+        mode->vtotal = minf->vtotal;
+        mode->hskew  = minf->hskew;
+        mode->flags  = minf->mode_flags;
+    }
+
+    st->screen.ncrtc   = xcb_randr_get_screen_resources_crtcs_length(reply);
+    st->screen.crtcs   = copy_xids(st->screen.ncrtc,
+                                   xcb_randr_get_screen_resources_crtcs(reply));
+    st->screen.noutput = xcb_randr_get_screen_resources_outputs_length(reply);
+    st->screen.outputs = copy_xids(st->screen.noutput,
+                                  xcb_randr_get_screen_resources_outputs(reply));
+
+    if ((st->screen.ncrtc   > 0 && !st->screen.crtcs  ) ||
+        (st->screen.noutput > 0 && !st->screen.outputs)   )
+        goto no_memory;
+
+    st->ncrtc   = st->screen.ncrtc;
+    st->noutput = st->screen.noutput;
+    st->nprop   = st->noutput * snap->nreq;
+    nslot       = st->ncrtc + st->noutput + st->nprop;
+
+    if ((st->ncrtc   && !(st->crtcs   = calloc(st->ncrtc,  sizeof(xif_crtc_t))))||
+        (st->noutput && !(st->outputs = calloc(st->noutput,sizeof(xif_output_t))))||
+        (st->nprop   && !(st->props   = calloc(st->nprop,  sizeof(xif_outprop_t))))||
+        (nslot       && !(snap->slots = calloc(nslot,  sizeof(snapshot_slot_t)))))
+        goto no_memory;
+
+    /* everything is failed until its reply has arrived */
+    for (i = 0;  i < st->ncrtc;  i++)
+        st->crtcs[i].failed = TRUE;
+    for (i = 0;  i < st->noutput;  i++)
+        st->outputs[i].failed = TRUE;
+    for (i = 0;  i < st->nprop;  i++)
+        st->props[i].failed = TRUE;
+
+    snap->resources = TRUE;
+
+    /*
+     * fire all the requests without waiting for any of the replies
+     */
+    xids = st->screen.crtcs;
+    slot = snap->slots;
+
+    for (i = 0;  i < st->ncrtc;  i++, slot++) {
+        xcb_randr_get_crtc_info_cookie_t ckie;
+
+        st->crtcs[i].window = st->screen.window;
+        st->crtcs[i].xid    = xids[i];
+
+        if (rque_reserve(&xif->rque) < 0)
+            goto no_memory;
+
+        ckie = xcb_randr_get_crtc_info(xif->xconn, xids[i], XCB_CURRENT_TIME);
+
+        slot->snap = snap;
+        slot->idx  = i;
+
+        snap->pending++;
+        rque_append_request(&xif->rque, ckie.sequence,
+                            randr_snapshot_crtc_finish, NULL, slot);
+    }
+
+    xids = st->screen.outputs;
+
+    for (i = 0;  i < st->noutput;  i++, slot++) {
+        xcb_randr_get_output_info_cookie_t ckie;
+
+        st->outputs[i].window = st->screen.window;
+        st->outputs[i].xid    = xids[i];
+
+        if (rque_reserve(&xif->rque) < 0)
+            goto no_memory;
+
+        ckie = xcb_randr_get_output_info(xif->xconn, xids[i], XCB_CURRENT_TIME);
+
+        slot->snap = snap;
+        slot->idx  = i;
+
+        snap->pending++;
+        rque_append_request(&xif->rque, ckie.sequence,
+                            randr_snapshot_output_finish, NULL, slot);
+    }
+
+    for (i = 0;  i < st->noutput;  i++) {
+        for (j = 0;  j < snap->nreq;  j++, slot++) {
+            xcb_randr_get_output_property_cookie_t ckie;
+
+            req  = snap->reqs + j;
+            prop = st->props + (i * snap->nreq + j);
+
+            prop->output = xids[i];
+            prop->xid    = req->xid;
+            prop->type   = req->type;
+
+            if (rque_reserve(&xif->rque) < 0)
+                goto no_memory;
+
+            ckie = xcb_randr_get_output_property(xif->xconn, xids[i],
+                                                 req->xid, req->type,
+                                                 0, req->length, FALSE,FALSE);
+
+            slot->snap = snap;
+            slot->idx  = i * snap->nreq + j;
+
+            snap->pending++;
+            rque_append_request(&xif->rque, ckie.sequence,
+                                randr_snapshot_outprop_finish, NULL, slot);
+        }
+    }
+
+    if (xcb_connection_has_error(xif->xconn))
+        OHM_ERROR("videoep: failed to query RandR screen topology");
+    else {
+        OHM_DEBUG(DBG_XCB, "RandR snapshot of root window 0x%x: %d requests "
+                  "sent", st->screen.window, snap->pending);
+
+        xcb_flush(xif->xconn);
+    }
+
+    randr_snapshot_check_if_complete(xif, snap);
+    return;
+
+ no_memory:
+    OHM_ERROR("videoep: can't allocate memory for RandR snapshot");
+    snap->failed++;
+    xcb_flush(xif->xconn);
+    randr_snapshot_check_if_complete(xif, snap);
+}
+
+static void randr_snapshot_crtc_finish(xif_t *xif, void *reply_data,void *data)
+{
+    xcb_randr_get_crtc_info_reply_t *reply = reply_data;
+    snapshot_slot_t                 *slot  = data;
+    snapshot_t                      *snap  = slot->snap;
+    xif_crtc_t                      *ct    = snap->st.crtcs + slot->idx;
+
+    snap->pending--;
+
+    if (!reply) {
+        OHM_ERROR("videoep: could not get RandR crtc info");
+        snap->failed++;
+    }
+    else {
+        ct->x         = reply->x;
+        ct->y         = reply->y;
+        ct->width     = reply->width;
+        ct->height    = reply->height;
+        ct->mode      = reply->mode;
+        ct->rotation  = reply->rotation;
+        ct->noutput   = xcb_randr_get_crtc_info_outputs_length(reply);
+        ct->outputs   = copy_xids(ct->noutput,
+                                  xcb_randr_get_crtc_info_outputs(reply));
+        ct->npossible = xcb_randr_get_crtc_info_possible_length(reply);
+        ct->possibles = copy_xids(ct->npossible,
+                                  xcb_randr_get_crtc_info_possible(reply));
+        ct->failed    = FALSE;
+    }
+
+    randr_snapshot_check_if_complete(xif, snap);
+}
+
+static void randr_snapshot_output_finish(xif_t *xif,
+                                         void  *reply_data,
+                                         void  *data)
+{
+    xcb_randr_get_output_info_reply_t *reply = reply_data;
+    snapshot_slot_t                   *slot  = data;
+    snapshot_t                        *snap  = slot->snap;
+    xif_output_t                      *ot    = snap->st.outputs + slot->idx;
+    int                                length;
+
+    snap->pending--;
+
+    if (!reply) {
+        OHM_ERROR("videoep: could not get RandR output info");
+        snap->failed++;
+    }
+    else {
+        length = xcb_randr_get_output_info_name_length(reply);
+
+        if ((ot->name = malloc(length + 1)) == NULL)
+            snap->failed++;
+        else {
+            memcpy(ot->name, xcb_randr_get_output_info_name(reply), length);
+            ot->name[length] = '\0';
+            ot->failed = FALSE;
+        }
+
+        ot->state  = randr_connection_to_state(reply->connection);
+        ot->crtc   = reply->crtc;
+        ot->nclone = xcb_randr_get_output_info_clones_length(reply);
+        ot->clones = copy_xids(ot->nclone,
+                               xcb_randr_get_output_info_clones(reply));
+        ot->nmode  = xcb_randr_get_output_info_modes_length(reply);
+        ot->modes  = copy_xids(ot->nmode,
+                               xcb_randr_get_output_info_modes(reply));
+    }
+
+    randr_snapshot_check_if_complete(xif, snap);
+}
+
+static void randr_snapshot_outprop_finish(xif_t *xif,
+                                          void  *reply_data,
+                                          void  *data)
+{
+    xcb_randr_get_output_property_reply_t *reply = reply_data;
+    snapshot_slot_t                       *slot  = data;
+    snapshot_t                            *snap  = slot->snap;
+    xif_outprop_t                         *prop  = snap->st.props + slot->idx;
+    int                                    size;
+
+    snap->pending--;
+
+    if (!reply) {
+        OHM_ERROR("videoep: could not get RandR output property info");
+        snap->failed++;
+    }
+    else if (reply->type != (uint32_t)prop->type) {
+        /* outputs without the property reply with type None */
+        prop->failed = FALSE;
+    }
+    else {
+        size = xcb_randr_get_output_property_data_length(reply);
+
+        if ((prop->value = malloc(size + 1)) == NULL)
+            snap->failed++;
+        else {
+            memcpy(prop->value, xcb_randr_get_output_property_data(reply),size);
+            ((char *)prop->value)[size] = '\0';
+
+            prop->length = (reply->format == 8) ? size : (int)reply->length;
+            prop->failed = FALSE;
+        }
+    }
+
+    randr_snapshot_check_if_complete(xif, snap);
+}
+
+static void randr_snapshot_check_if_complete(xif_t *xif, snapshot_t *snap)
+{
+    if (snap->pending > 0)
+        return;
+
+    OHM_DEBUG(DBG_XCB, "RandR snapshot of root window 0x%x complete: "
+              "%d crtcs, %d outputs, %d properties, %d failures",
+              snap->st.screen.window, snap->st.ncrtc, snap->st.noutput,
+              snap->st.nprop, snap->failed);
+
+    if (snap->resources)
+        snap->replycb(&snap->st, snap->usrdata);
+    else if (snap->retries < SNAPSHOT_RETRY_MAX) {
+        OHM_INFO("videoep: retrying RandR snapshot of root window 0x%x",
+                 snap->st.screen.window);
+
+        randr_snapshot(xif, snap->st.screen.window, snap->nreq, snap->reqs,
+                       snap->replycb, snap->usrdata, snap->retries + 1);
+    }
+    else {
+        OHM_ERROR("videoep: failed to take RandR snapshot of root "
+                  "window 0x%x", snap->st.screen.window);
+    }
+
+    randr_snapshot_destroy(xif, snap);
+}
+
+static void randr_snapshot_destroy(xif_t *xif, snapshot_t *snap)
+{
+    xif_snapshot_t *st = &snap->st;
+    snapshot_t     *prev;
+    int             i;
+
+    for (prev = (snapshot_t *)&xif->snapshots;  prev->next;  prev = prev->next){
+        if (prev->next == snap) {
+            prev->next = snap->next;
+            break;
+        }
+    }
+
+    for (i = 0;  i < st->screen.nmode;  i++)
+        free(st->screen.modes[i].name);
+
+    for (i = 0;  st->crtcs && i < st->ncrtc;  i++) {
+        free(st->crtcs[i].outputs);
+        free(st->crtcs[i].possibles);
+    }
+
+    for (i = 0;  st->outputs && i < st->noutput;  i++) {
+        free(st->outputs[i].name);
+        free(st->outputs[i].clones);
+        free(st->outputs[i].modes);
+    }
+
+    for (i = 0;  st->props && i < st->nprop;  i++)
+        free(st->props[i].value);
+
+    free(st->screen.modes);
+    free(st->screen.crtcs);
+    free(st->screen.outputs);
+    free(st->crtcs);
+    free(st->outputs);
+    free(st->props);
+    free(snap->slots);
+    free(snap->reqs);
+    free(snap);
+}
+
+static uint32_t *copy_xids(int nxid, uint32_t *xids)
+{
+    uint32_t *copy;
+
+    if (nxid <= 0 || !(copy = malloc(sizeof(uint32_t) * nxid)))
+        return NULL;
+
+    memcpy(copy, xids, sizeof(uint32_t) * nxid);
+
+    return copy;
 }
 
 
@@ -2168,27 +2501,82 @@ static int check_version(uint32_t required_major_version,
 }
 
 
-static int rque_is_full(rque_t *rque)
+/*
+ * The pending requests are kept in a ring in the order they were sent,
+ * ie. in increasing XCB sequence number order. Since the X server replies
+ * in sequence order, it is enough to poll the oldest request; when it is
+ * not completed none of the later ones are either.
+ */
+static int rque_reserve(rque_t *rque)
+{
+    request_t *requests;
+    int        size;
+    int        i;
+
+    if (rque->length < rque->size)
+        return 0;
+
+    size = rque->size ? rque->size * 2 : QUEUE_DIM;
+
+    if ((requests = malloc(sizeof(request_t) * size)) == NULL)
+        return -1;
+
+    for (i = 0;  i < rque->length;  i++)
+        requests[i] = rque->requests[(rque->head + i) & (rque->size - 1)];
+
+    free(rque->requests);
+
+    rque->requests = requests;
+    rque->size     = size;
+    rque->head     = 0;
+
+    OHM_DEBUG(DBG_XCB, "xif request queue grown to %d entries", size);
+
+    return 0;
+}
+
+static void rque_reset(rque_t *rque)
 {
-    return (rque->length >= QUEUE_DIM);
+    request_t *req;
+
+    while (rque->length > 0) {
+        req = rque->requests + rque->head;
+
+        if (req->release != NULL)
+            req->release(req->data);
+
+        rque->head = (rque->head + 1) & (rque->size - 1);
+        rque->length--;
+    }
+
+    rque->head = 0;
 }
 
 static int rque_append_request(rque_t          *rque,
                                unsigned int     seq,
                                reply_handler_t  hlr,
+                               release_t        release,
                                void            *data)
 {
     request_t *req;
 
-    if (rque_is_full(rque))
+    if (rque_reserve(rque) < 0)
         return -1;
     
-    req = rque->requests + rque->length++;
+    req = rque->requests + ((rque->head + rque->length++) & (rque->size - 1));
 
     req->sequence = seq;
     req->handler  = hlr;
+    req->release  = release;
     req->data     = data;
 
+    if (rque->length > rque->maxlen) {
+        rque->maxlen = rque->length;
+
+        OHM_DEBUG(DBG_XCB, "max. xif request queue depth is %d",
+                  rque->maxlen);
+    }
+
     return 0;
 }
 
@@ -2199,33 +2587,32 @@ static int rque_poll_reply(xcb_connection_t *xconn,
                            void             **data_ret)
 {
     xcb_generic_error_t *e;
-    int i, j;
+    request_t           *req;
 
     if (!reply || !hlr_ret || !data_ret)
         return 0;
 
-    for (i = 0;  i < rque->length;  i++) {
-        e = NULL;
+    while (rque->length > 0) {
+        req = rque->requests + rque->head;
+        e   = NULL;
 
-        if (xcb_poll_for_reply(xconn, rque->requests[i].sequence, reply, &e)) {
+        if (!xcb_poll_for_reply(xconn, req->sequence, reply, &e))
+            break;
 
-            *hlr_ret  = rque->requests[i].handler;
-            *data_ret = rque->requests[i].data;
- 
-            for (j = i+1;  j < rque->length;  j++) 
-                rque->requests[j-1] = rque->requests[j];
+        *hlr_ret  = req->handler;
+        *data_ret = req->data;
 
-            rque->length--;
+        rque->head = (rque->head + 1) & (rque->size - 1);
+        rque->length--;
 
-            if (e == NULL && *reply != NULL) {
-                return 1;
-            }
+        if (e == NULL && *reply != NULL) {
+            return 1;
+        }
 
-            if (e != NULL) {
-                free(e);
-                *reply = NULL;
-                return 1;
-            }
+        if (e != NULL) {
+            free(e);
+            *reply = NULL;
+            return 1;
         }
     }
 
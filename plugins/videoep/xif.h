@@ -84,6 +84,7 @@ typedef struct {
     uint32_t *outputs;
     int       npossible;
     uint32_t *possibles;
+    int       failed;           /* snapshot could not get this crtc */
 } xif_crtc_t;
 
 typedef enum {
@@ -103,8 +104,40 @@ typedef struct {
     uint32_t        *clones;
     int              nmode;
     uint32_t        *modes;
+    int              failed;    /* snapshot could not get this output */
 } xif_output_t;
 
+typedef struct {
+    uint32_t              xid;      /* property atom */
+    videoep_value_type_t  type;
+    uint32_t              length;
+} xif_outprop_req_t;
+
+typedef struct {
+    uint32_t              output;
+    uint32_t              xid;      /* property atom */
+    videoep_value_type_t  type;
+    void                 *value;    /* NULL if output has no such property */
+    int                   length;
+    int                   failed;   /* snapshot could not get the property */
+} xif_outprop_t;
+
+/*
+ * complete RandR topology of a screen, collected with pipelined
+ * requests. It is owned by xif and is valid only during the callback.
+ * Crtcs, outputs and properties whose query failed are marked 'failed'
+ * and are up to the caller to query again.
+ */
+typedef struct {
+    xif_screen_t          screen;
+    int                   ncrtc;
+    xif_crtc_t           *crtcs;
+    int                   noutput;
+    xif_output_t         *outputs;
+    int                   nprop;    /* noutput x number of requested props */
+    xif_outprop_t        *props;
+} xif_snapshot_t;
+
 
 typedef void (*xif_connectioncb_t)(int, void *);
 typedef void (*xif_structurecb_t)(uint32_t, void *);
@@ -112,13 +145,13 @@ typedef void (*xif_propertycb_t)(uint32_t, uint32_t, void *);
 typedef void (*xif_atom_replycb_t)(const char *, uint32_t, void *);
 typedef void (*xif_prop_replycb_t)(uint32_t, uint32_t, videoep_value_type_t,
                                    void *, int, void *);
-typedef void (*xif_screen_replycb_t)(xif_screen_t *, void *);
 typedef void (*xif_crtc_replycb_t)(xif_crtc_t *, void *);
 typedef void (*xif_outprop_replycb_t)(uint32_t, uint32_t, uint32_t,
                                       videoep_value_type_t,void *,int, void *);
 typedef void (*xif_crtc_notifycb_t)(xif_crtc_t *, void *);
 typedef void (*xif_output_replycb_t)(xif_output_t *, void *);
 typedef void (*xif_output_notifycb_t)(xif_output_t *, void *);
+typedef void (*xif_snapshot_replycb_t)(xif_snapshot_t *, void *);
 
 
 void xif_init(OhmPlugin *);
@@ -149,7 +182,8 @@ int      xif_property_query(uint32_t, uint32_t, videoep_value_type_t,
                             uint32_t, xif_prop_replycb_t, void *);
 int      xif_create_mode(uint32_t, xif_mode_t *);
 int      xif_screen_set_size(uint32_t, uint32_t,uint32_t, uint32_t,uint32_t);
-int      xif_screen_query(uint32_t, xif_screen_replycb_t, void *);
+int      xif_screen_snapshot(uint32_t, int, xif_outprop_req_t *,
+                             xif_snapshot_replycb_t, void *);
 int      xif_crtc_query(uint32_t,uint32_t,uint32_t,
                         xif_crtc_replycb_t, void *);
 int      xif_output_query(uint32_t, uint32_t, uint32_t,